@@ -0,0 +1,388 @@
+// common code for OZ benchmarks
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <libgen.h>
+#include <sys/wait.h>
+
+#include <string>
+#include <vector>
+#include <functional>
+using namespace std;
+
+#include <wombat/wSemaphore.h>
+#include <mama/mama.h>
+
+#include "ozimpl.h"
+#include "ozbench.h"
+
+namespace ozbench {
+
+const char* FIELD_TYPE = "type";
+const char* FIELD_SEQ  = "seq";
+const char* FIELD_TS   = "ts";
+const char* FIELD_PAD  = "pad";
+
+int64_t nowNanos()
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ((int64_t) ts.tv_sec * 1000000000) + ts.tv_nsec;
+}
+
+
+///////////////////////////////////////////////////////////////////////
+// histogram
+void histogram::print(FILE* out, const string& label, int64_t lost) const
+{
+   fprintf(out, "%-8s count=%-9ld lost=%-6ld min=%-9.3f mean=%-9.3f p50=%-9.3f p90=%-9.3f p99=%-9.3f p99.9=%-9.3f p99.99=%-9.3f max=%.3f (usec)\n",
+      label.c_str(), (long) count(), (long) lost,
+      min() / 1000.0, mean() / 1000.0, percentile(50) / 1000.0, percentile(90) / 1000.0, percentile(99) / 1000.0,
+      percentile(99.9) / 1000.0, percentile(99.99) / 1000.0, max() / 1000.0);
+}
+
+bool histogram::write(int fd) const
+{
+   const char* p = (const char*) &hist_;
+   size_t remaining = sizeof(hist_);
+   while (remaining > 0) {
+      ssize_t rc = ::write(fd, p, remaining);
+      if (rc < 0) {
+         if (errno == EINTR) {
+            continue;
+         }
+         return false;
+      }
+      p += rc;
+      remaining -= rc;
+   }
+
+   return true;
+}
+
+bool histogram::read(int fd)
+{
+   char* p = (char*) &hist_;
+   size_t remaining = sizeof(hist_);
+   while (remaining > 0) {
+      ssize_t rc = ::read(fd, p, remaining);
+      if (rc < 0) {
+         if (errno == EINTR) {
+            continue;
+         }
+         return false;
+      }
+      if (rc == 0) {
+         return false;
+      }
+      p += rc;
+      remaining -= rc;
+   }
+
+   return true;
+}
+
+
+///////////////////////////////////////////////////////////////////////
+// options
+bool options::parse(int argc, char** argv)
+{
+   char* temp = getenv("MAMA_MW");
+   mw = temp ? temp : "zmq";
+   temp = getenv("MAMA_PAYLOAD");
+   payload = temp ? temp : "omnmmsg";
+   temp = getenv("MAMA_TPORT_PUB");
+   tport = temp ? temp : "oz";
+
+   for (int i = 1; i < argc; i++) {
+      string arg = argv[i];
+      if ((arg == "-h") || (arg == "-?")) {
+         return false;
+      }
+      if (i + 1 >= argc) {
+         fprintf(stderr, "Missing value for %s\n", argv[i]);
+         return false;
+      }
+      string value = argv[++i];
+
+      if      (arg == "-m")          { mw = value; }
+      else if (arg == "-p")          { payload = value; }
+      else if (arg == "-tport")      { tport = value; }
+      else if (arg == "-size")       { size = atoi(value.c_str()); }
+      else if (arg == "-rate")       { rate = atoi(value.c_str()); }
+      else if (arg == "-count")      { count = atol(value.c_str()); }
+      else if (arg == "-warmup")     { warmup = atol(value.c_str()); }
+      else if (arg == "-topics")     { topics = atoi(value.c_str()); }
+      else if (arg == "-subs")       { subs = atoi(value.c_str()); }
+      else if (arg == "-nsd")        { nsd = value; }
+      else if (arg == "-nsdport")    { nsdPort = atoi(value.c_str()); }
+      else if (arg == "-queue") {
+         if      (value == "shared")     { queue = queueMode::shared; }
+         else if (value == "dedicated")  { queue = queueMode::dedicated; }
+         else {
+            fprintf(stderr, "Invalid queue mode: %s\n", value.c_str());
+            return false;
+         }
+      }
+      else if (arg == "-D") {
+         size_t pos = value.find('=');
+         if (pos == string::npos) {
+            fprintf(stderr, "Invalid property (must be name=value): %s\n", value.c_str());
+            return false;
+         }
+         props.push_back(make_pair(value.substr(0, pos), value.substr(pos + 1)));
+      }
+      else {
+         fprintf(stderr, "Unknown option: %s\n", argv[i-1]);
+         return false;
+      }
+   }
+
+   if ((size < 0) || (rate < 0) || (count < 1) || (warmup < 0) || (topics < 1) || (subs < 1) || (nsdPort < 1)) {
+      fprintf(stderr, "Invalid option value\n");
+      return false;
+   }
+
+   return true;
+}
+
+void options::usage(FILE* out, const char* prog) const
+{
+   fprintf(out, "Usage: %s [options]\n", prog);
+   fprintf(out, "  -m <middleware>        middleware bridge (default: $MAMA_MW or zmq)\n");
+   fprintf(out, "  -p <payload>           payload bridge (default: $MAMA_PAYLOAD or omnmmsg)\n");
+   fprintf(out, "  -tport <name>          transport name in mama.properties (default: $MAMA_TPORT_PUB or oz)\n");
+   fprintf(out, "  -size <bytes>          size of msg payload (default: %d)\n", size);
+   fprintf(out, "  -rate <n>              msgs per second, 0 for as fast as possible (default: %d)\n", rate);
+   fprintf(out, "  -count <n>             number of msgs to measure (default: %ld)\n", count);
+   fprintf(out, "  -warmup <n>            number of msgs to send before measuring (default: %ld)\n", warmup);
+   fprintf(out, "  -topics <n>            number of topics to send on, round-robin (default: %d)\n", topics);
+   fprintf(out, "  -subs <n>              number of subscriber processes (default: %d)\n", subs);
+   fprintf(out, "  -queue <mode>          shared (one queue for all topics) or dedicated (one queue per topic) (default: shared)\n");
+   fprintf(out, "  -nsd <path>            nsd executable, or none to use an already running nsd (default: nsd next to %s, or on PATH)\n", prog);
+   fprintf(out, "  -nsdport <port>        port for private nsd (default: %d)\n", nsdPort);
+   fprintf(out, "  -D <name>=<value>      set transport property (e.g., -D topic_ids=1)\n");
+}
+
+void options::print(FILE* out, const char* prog) const
+{
+   fprintf(out, "%s: mw=%s payload=%s tport=%s size=%d rate=%d count=%ld warmup=%ld topics=%d subs=%d queue=%s\n",
+      prog, mw.c_str(), payload.c_str(), tport.c_str(), size, rate, count, warmup, topics, subs,
+      (queue == queueMode::shared) ? "shared" : "dedicated");
+   for (auto& prop : props) {
+      fprintf(out, "   %s=%s\n", prop.first.c_str(), prop.second.c_str());
+   }
+}
+
+string options::getTopic(int i) const
+{
+   return "ozbench/" + to_string(i);
+}
+
+
+///////////////////////////////////////////////////////////////////////
+// nsd
+pid_t startNsd(const options& opts, const char* argv0)
+{
+   if (opts.nsd == "none") {
+      return 0;
+   }
+
+   // look for nsd next to this program, then on PATH
+   string path = opts.nsd;
+   if (path.empty()) {
+      string self = argv0;
+      path = string(dirname(&self[0])) + "/nsd";
+      if (access(path.c_str(), X_OK) != 0) {
+         path = "nsd";
+      }
+   }
+
+   string port = to_string(opts.nsdPort);
+   pid_t pid = fork();
+   if (pid < 0) {
+      fprintf(stderr, "Unable to fork nsd: %d(%s)\n", errno, strerror(errno));
+      return -1;
+   }
+   if (pid == 0) {
+      execlp(path.c_str(), "nsd", "-i", "127.0.0.1", "-p", port.c_str(), (char*) NULL);
+      fprintf(stderr, "Unable to exec %s: %d(%s)\n", path.c_str(), errno, strerror(errno));
+      _exit(127);
+   }
+
+   // give nsd a chance to bind (transports retry in any case)
+   usleep(100000);
+   return pid;
+}
+
+void stopNsd(pid_t pid)
+{
+   if (pid > 0) {
+      kill(pid, SIGINT);
+      waitpid(pid, NULL, 0);
+   }
+}
+
+mama_status setProperties(const options& opts)
+{
+   string prefix = "mama." + opts.mw + ".transport." + opts.tport + ".";
+
+   if (opts.nsd != "none") {
+      // these take precedence over subscribe_address_0 etc.
+      CALL_MAMA_FUNC(mama_setProperty((prefix + "naming.subscribe_address").c_str(), "127.0.0.1"));
+      CALL_MAMA_FUNC(mama_setProperty((prefix + "naming.subscribe_port").c_str(), to_string(opts.nsdPort).c_str()));
+   }
+
+   for (auto& prop : opts.props) {
+      CALL_MAMA_FUNC(mama_setProperty((prefix + prop.first).c_str(), prop.second.c_str()));
+   }
+
+   return MAMA_STATUS_OK;
+}
+
+
+///////////////////////////////////////////////////////////////////////
+// child processes
+child forkChild(const function<int(int)>& fn)
+{
+   child c;
+   int fds[2];
+   if (pipe(fds) != 0) {
+      fprintf(stderr, "Unable to create pipe: %d(%s)\n", errno, strerror(errno));
+      return c;
+   }
+
+   c.pid = fork();
+   if (c.pid < 0) {
+      fprintf(stderr, "Unable to fork: %d(%s)\n", errno, strerror(errno));
+      close(fds[0]);
+      close(fds[1]);
+      return c;
+   }
+   if (c.pid == 0) {
+      close(fds[0]);
+      int rc = fn(fds[1]);
+      close(fds[1]);
+      _exit(rc);
+   }
+
+   close(fds[1]);
+   c.fd = fds[0];
+   return c;
+}
+
+int waitChild(child& c)
+{
+   int status = 0;
+   if (c.pid > 0) {
+      waitpid(c.pid, &status, 0);
+      c.pid = 0;
+   }
+   if (c.fd >= 0) {
+      close(c.fd);
+      c.fd = -1;
+   }
+
+   return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+bool waitReady(vector<child>& children, int timeout)
+{
+   int64_t deadline = nowNanos() + ((int64_t) timeout * 1000000);
+
+   while (1) {
+      vector<struct pollfd> items(children.size());
+      size_t numReady = 0;
+      for (size_t i = 0; i < children.size(); ++i) {
+         items[i].fd = children[i].ready ? -1 : children[i].fd;
+         items[i].events = POLLIN;
+         items[i].revents = 0;
+         numReady += children[i].ready ? 1 : 0;
+      }
+      if (numReady == children.size()) {
+         return true;
+      }
+
+      int remaining = (int) ((deadline - nowNanos()) / 1000000);
+      if (remaining <= 0) {
+         return false;
+      }
+      int rc = poll(items.data(), items.size(), remaining);
+      if ((rc < 0) && (errno != EINTR)) {
+         return false;
+      }
+      for (size_t i = 0; i < children.size(); ++i) {
+         if (items[i].revents & (POLLIN | POLLHUP)) {
+            char c;
+            if (::read(children[i].fd, &c, 1) != 1) {
+               // child exited
+               return false;
+            }
+            children[i].ready = true;
+         }
+      }
+   }
+}
+
+
+///////////////////////////////////////////////////////////////////////
+// msgs
+mama_status createMsg(mamaMsg* msg, int size)
+{
+   CALL_MAMA_FUNC(mamaMsg_create(msg));
+   CALL_MAMA_FUNC(mamaMsg_updateU8(*msg, FIELD_TYPE, 0, MSG_PROBE));
+   CALL_MAMA_FUNC(mamaMsg_updateU64(*msg, FIELD_SEQ, 0, 0));
+   CALL_MAMA_FUNC(mamaMsg_updateI64(*msg, FIELD_TS, 0, 0));
+   if (size > 0) {
+      vector<char> pad(size, 'x');
+      CALL_MAMA_FUNC(mamaMsg_updateOpaque(*msg, FIELD_PAD, 0, pad.data(), pad.size()));
+   }
+
+   return MAMA_STATUS_OK;
+}
+
+mama_status updateMsg(mamaMsg msg, msgType type, uint64_t seq, int64_t ts)
+{
+   CALL_MAMA_FUNC(mamaMsg_updateU8(msg, FIELD_TYPE, 0, type));
+   CALL_MAMA_FUNC(mamaMsg_updateU64(msg, FIELD_SEQ, 0, seq));
+   CALL_MAMA_FUNC(mamaMsg_updateI64(msg, FIELD_TS, 0, ts));
+   return MAMA_STATUS_OK;
+}
+
+
+///////////////////////////////////////////////////////////////////////
+// pacer
+pacer::pacer(int rate)
+   : interval_((rate > 0) ? (1000000000 / rate) : 0), next_(0)
+{
+}
+
+int64_t pacer::next()
+{
+   int64_t now = nowNanos();
+   if (interval_ == 0) {
+      return now;
+   }
+
+   if (next_ == 0) {
+      next_ = now;
+   }
+   // spin rather than sleep -- sleeping adds too much jitter at typical rates
+   while (now < next_) {
+      now = nowNanos();
+   }
+
+   // msgs are timestamped w/the time they *should* have been sent, so any delay in sending
+   // (e.g., because the sender was blocked) is included in the measured latency
+   // (see "coordinated omission")
+   int64_t scheduled = next_;
+   next_ += interval_;
+   return scheduled;
+}
+
+}
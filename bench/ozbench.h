@@ -0,0 +1,132 @@
+// common code for OZ benchmarks
+
+#include <stdio.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include <string>
+#include <vector>
+#include <functional>
+
+#include <mama/mama.h>
+
+#include "histogram.h"
+
+namespace ozbench {
+
+// nanoseconds from CLOCK_MONOTONIC -- this is system-wide, so timestamps taken in one process can be compared
+// to timestamps taken in another process on the same host
+int64_t nowNanos();
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Latency histogram -- wraps the bridge's own zmqHistogram (see src/histogram.h), so benchmark results
+// are bucketed the same way as the latency stats reported by OZ itself.
+class histogram
+{
+public:
+   histogram()                   { zmqBridgeMamaHistogram_init(&hist_); }
+
+   void record(int64_t value)    { zmqBridgeMamaHistogram_record(&hist_, (value > 0) ? value : 0); }
+   void merge(const histogram& other)  { zmqBridgeMamaHistogram_merge(&hist_, &other.hist_); }
+
+   // returns the value at or below which p percent of recorded values fall
+   int64_t percentile(double p) const  { return zmqBridgeMamaHistogram_percentile(&hist_, p); }
+
+   int64_t count() const         { return hist_.mCount; }
+   int64_t min() const           { return (hist_.mCount > 0) ? hist_.mMin : 0; }
+   int64_t max() const           { return hist_.mMax; }
+   double mean() const           { return (hist_.mCount > 0) ? (double) hist_.mSum / hist_.mCount : 0; }
+
+   // prints a one-line summary, w/values in microseconds
+   void print(FILE* out, const std::string& label, int64_t lost = 0) const;
+
+   // used to pass results from child processes back to parent
+   bool write(int fd) const;
+   bool read(int fd);
+
+private:
+   zmqHistogram   hist_;
+};
+
+
+///////////////////////////////////////////////////////////////////////////////
+enum class queueMode { shared, dedicated };
+
+// benchmark options -- parsed from command line
+struct options
+{
+   std::string    mw;
+   std::string    payload;
+   std::string    tport;
+   int            size        {100};            // size of payload (bytes)
+   int            rate        {10000};          // msgs/requests per second (0 = as fast as possible)
+   long           count       {100000};         // number of msgs/requests measured
+   long           warmup      {1000};           // number of msgs/requests sent before measuring
+   int            topics      {1};              // number of topics (msgs are sent round-robin)
+   int            subs        {1};              // number of subscriber processes
+   queueMode      queue       {queueMode::shared};
+   std::string    nsd;                          // path to nsd executable ("none" to use an existing nsd)
+   int            nsdPort     {5757};
+   std::vector<std::pair<std::string, std::string>> props;    // additional transport properties
+
+   bool parse(int argc, char** argv);
+   void usage(FILE* out, const char* prog) const;
+   void print(FILE* out, const char* prog) const;
+
+   std::string getTopic(int i) const;
+};
+
+
+///////////////////////////////////////////////////////////////////////////////
+// starts a private nsd (unless nsd is "none"), and points the transport at it
+// returns the pid of the nsd, or 0 if none was started
+pid_t startNsd(const options& opts, const char* argv0);
+void stopNsd(pid_t pid);
+
+// sets transport properties from options -- must be called before creating the connection
+mama_status setProperties(const options& opts);
+
+// runs fn in a child process, passing the write end of a pipe that the child can use to send
+// results back to the parent
+struct child
+{
+   pid_t       pid      {0};
+   int         fd       {-1};           // read end of pipe
+   bool        ready    {false};
+};
+child forkChild(const std::function<int(int)>& fn);
+// waits for child to exit, returns its exit status
+int waitChild(child& c);
+
+// waits up to timeout millis for a single byte from each child that is not yet ready -- returns true if all
+// children are ready
+bool waitReady(std::vector<child>& children, int timeout);
+
+// names of fields used in benchmark msgs
+extern const char* FIELD_TYPE;
+extern const char* FIELD_SEQ;
+extern const char* FIELD_TS;
+extern const char* FIELD_PAD;
+
+// values of FIELD_TYPE
+enum msgType : uint8_t { MSG_PROBE = 0, MSG_DATA, MSG_DONE };
+
+// creates a benchmark msg w/payload of the specified size
+mama_status createMsg(mamaMsg* msg, int size);
+mama_status updateMsg(mamaMsg msg, msgType type, uint64_t seq, int64_t ts);
+
+// paces sends at the specified rate -- returns the time at which the next msg was scheduled to be sent
+// (or the current time if rate is zero)
+class pacer
+{
+public:
+   explicit pacer(int rate);
+   int64_t next();
+
+private:
+   int64_t     interval_;
+   int64_t     next_;
+};
+
+}
@@ -0,0 +1,318 @@
+// one-way pub/sub latency benchmark -- w/-subs > 1, also measures fan-out to multiple subscriber processes
+//
+// The publisher runs in the main process, and each subscriber runs in its own child process.  Msgs are
+// timestamped by the publisher and the latency is calculated by the subscriber, which sends its
+// histogram back to the publisher over a pipe at the end of the run.
+
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <poll.h>
+#include <errno.h>
+#include <libgen.h>
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+using namespace std;
+
+#include <wombat/wSemaphore.h>
+#include <mama/mama.h>
+
+#include "ozimpl.h"
+using namespace oz;
+
+#include "ozbench.h"
+using namespace ozbench;
+
+#ifndef OZBENCH_DEFAULT_SUBS
+#define OZBENCH_DEFAULT_SUBS 1
+#endif
+
+
+///////////////////////////////////////////////////////////////////////////////
+// subscriber
+
+// state shared by all topics in a subscriber process
+struct subscriberState
+{
+   subscriberState(const options& opts, int fd)
+      : opts_(opts), fd_(fd), numProbed_(0), numDone_(0)
+   {
+      wsem_init(&done_, 0, 0);
+   }
+   ~subscriberState()
+   {
+      wsem_destroy(&done_);
+   }
+
+   const options&    opts_;
+   int               fd_;
+   atomic<int>       numProbed_;
+   atomic<int>       numDone_;
+   wsem_t            done_;
+};
+
+// there is one of these per topic, and each is only ever called on its session's dispatch thread
+class latencyEvents : public subscriberEvents
+{
+public:
+   explicit latencyEvents(subscriberState& state)
+      : state_(state)
+   {}
+
+   const histogram& getHistogram() const   { return hist_; }
+
+private:
+   virtual void MAMACALLTYPE onMsg(subscriber* pSubscriber, const char* topic, mamaMsg msg, void* itemClosure) override
+   {
+      int64_t now = nowNanos();
+
+      mama_u8_t type;
+      if (mamaMsg_getU8(msg, FIELD_TYPE, 0, &type) != MAMA_STATUS_OK) {
+         return;
+      }
+
+      switch (type) {
+         case MSG_PROBE:
+            // tell publisher we're ready once we've gotten a probe on every topic
+            if (!probed_) {
+               probed_ = true;
+               if (++state_.numProbed_ == state_.opts_.topics) {
+                  char c = 'R';
+                  if (write(state_.fd_, &c, 1) != 1) {
+                     mama_log(MAMA_LOG_LEVEL_ERROR, "Unable to signal publisher: %d(%s)", errno, strerror(errno));
+                  }
+               }
+            }
+            break;
+
+         case MSG_DATA:
+         {
+            mama_u64_t seq;
+            mama_i64_t ts;
+            if ((mamaMsg_getU64(msg, FIELD_SEQ, 0, &seq) == MAMA_STATUS_OK) && (mamaMsg_getI64(msg, FIELD_TS, 0, &ts) == MAMA_STATUS_OK)) {
+               if ((long) seq >= state_.opts_.warmup) {
+                  hist_.record(now - ts);
+               }
+            }
+            break;
+         }
+
+         case MSG_DONE:
+            // publisher repeats these until it hears back from us
+            if (!done_) {
+               done_ = true;
+               if (++state_.numDone_ == state_.opts_.topics) {
+                  wsem_post(&state_.done_);
+               }
+            }
+            break;
+      }
+   }
+
+   subscriberState&  state_;
+   histogram         hist_;
+   bool              probed_     {false};
+   bool              done_       {false};
+};
+
+int runSubscriber(const options& opts, int fd)
+{
+   try {
+      TRY_MAMA_FUNC(setProperties(opts));
+      auto conn = createConnection(opts.mw, opts.payload, opts.tport);
+      TRY_MAMA_FUNC(conn->start());
+
+      // NOTE: order of declaration is important -- sinks must outlive sessions, which must outlive subscribers
+      subscriberState state(opts, fd);
+      vector<unique_ptr<latencyEvents>> sinks;
+      vector<unique_ptr<session, decltype(sessionDeleter)>> sessions;
+      vector<unique_ptr<subscriber, decltype(subscriberDeleter)>> subs;
+
+      int numSessions = (opts.queue == queueMode::dedicated) ? opts.topics : 1;
+      for (int i = 0; i < numSessions; ++i) {
+         sessions.push_back(conn->createSession());
+         TRY_MAMA_FUNC(sessions.back()->start());
+      }
+
+      for (int i = 0; i < opts.topics; ++i) {
+         sinks.emplace_back(new latencyEvents(state));
+         subs.push_back(sessions[i % numSessions]->createSubscriber(opts.getTopic(i), sinks.back().get()));
+         TRY_MAMA_FUNC(subs.back()->start());
+      }
+
+      // wait for publisher to finish (or die)
+      while (wsem_timedwait(&state.done_, 1000) != 0) {
+         if (getppid() == 1) {
+            return 1;
+         }
+      }
+
+      histogram result;
+      for (auto& sink : sinks) {
+         result.merge(sink->getHistogram());
+      }
+      if (!result.write(fd)) {
+         return 1;
+      }
+   }
+   catch (mama_status status) {
+      return 1;
+   }
+
+   return 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// publisher
+
+// reads results from children, re-sending done msgs until all children have reported back
+bool waitResults(vector<child>& children, vector<histogram>& results, vector<shared_ptr<publisher>>& pubs, mamaMsg msg)
+{
+   vector<bool> done(children.size(), false);
+   size_t numDone = 0;
+   for (int tries = 0; (tries < 300) && (numDone < children.size()); ++tries) {
+      for (auto& pub : pubs) {
+         TRY_MAMA_FUNC(pub->publish(msg));
+      }
+
+      vector<struct pollfd> items(children.size());
+      for (size_t i = 0; i < children.size(); ++i) {
+         items[i].fd = done[i] ? -1 : children[i].fd;
+         items[i].events = POLLIN;
+         items[i].revents = 0;
+      }
+      if (poll(items.data(), items.size(), 100) < 0) {
+         continue;
+      }
+      for (size_t i = 0; i < children.size(); ++i) {
+         if (items[i].revents & (POLLIN | POLLHUP)) {
+            if (!results[i].read(children[i].fd)) {
+               fprintf(stderr, "Unable to read results from subscriber %zu\n", i);
+               return false;
+            }
+            done[i] = true;
+            ++numDone;
+         }
+      }
+   }
+
+   return (numDone == children.size());
+}
+
+int runPublisher(const options& opts, vector<child>& children)
+{
+   TRY_MAMA_FUNC(setProperties(opts));
+   auto conn = createConnection(opts.mw, opts.payload, opts.tport);
+   TRY_MAMA_FUNC(conn->start());
+
+   vector<shared_ptr<publisher>> pubs;
+   for (int i = 0; i < opts.topics; ++i) {
+      pubs.push_back(conn->getPublisher(opts.getTopic(i)));
+   }
+
+   mamaMsg msg;
+   TRY_MAMA_FUNC(createMsg(&msg, opts.size));
+
+   // send probes until all subscribers have discovered us
+   bool ready = false;
+   for (int tries = 0; (tries < 1000) && !ready; ++tries) {
+      for (auto& pub : pubs) {
+         TRY_MAMA_FUNC(pub->publish(msg));
+      }
+      ready = waitReady(children, 10);
+   }
+   if (!ready) {
+      fprintf(stderr, "Timed out waiting for subscribers\n");
+      mamaMsg_destroy(msg);
+      return 1;
+   }
+
+   pacer pace(opts.rate);
+   long total = opts.warmup + opts.count;
+   int64_t start = nowNanos();
+   for (long seq = 0; seq < total; ++seq) {
+      TRY_MAMA_FUNC(updateMsg(msg, MSG_DATA, seq, pace.next()));
+      TRY_MAMA_FUNC(pubs[seq % opts.topics]->publish(msg));
+   }
+   int64_t elapsed = nowNanos() - start;
+
+   TRY_MAMA_FUNC(updateMsg(msg, MSG_DONE, total, 0));
+   vector<histogram> results(children.size());
+   bool ok = waitResults(children, results, pubs, msg);
+   mamaMsg_destroy(msg);
+   if (!ok) {
+      fprintf(stderr, "Timed out waiting for results\n");
+      return 1;
+   }
+
+   printf("sent %ld msgs in %.3f secs (%.0f msgs/sec)\n", total, elapsed / 1e9, total / (elapsed / 1e9));
+   histogram all;
+   int64_t allLost = 0;
+   for (size_t i = 0; i < results.size(); ++i) {
+      int64_t lost = opts.count - results[i].count();
+      results[i].print(stdout, "sub[" + to_string(i) + "]", lost);
+      all.merge(results[i]);
+      allLost += lost;
+   }
+   if (results.size() > 1) {
+      all.print(stdout, "all", allLost);
+   }
+
+   return 0;
+}
+
+
+int main(int argc, char** argv)
+{
+   const char* prog = basename(argv[0]);
+
+   options opts;
+   opts.subs = OZBENCH_DEFAULT_SUBS;
+   if (!opts.parse(argc, argv)) {
+      opts.usage(stderr, prog);
+      return 1;
+   }
+   opts.print(stdout, prog);
+
+   // NOTE: must fork before initializing MAMA
+   pid_t nsd = startNsd(opts, argv[0]);
+   if (nsd < 0) {
+      return 1;
+   }
+
+   int rc = 0;
+   vector<child> children;
+   for (int i = 0; i < opts.subs; ++i) {
+      child c = forkChild([&opts](int fd) { return runSubscriber(opts, fd); });
+      if (c.pid <= 0) {
+         rc = 1;
+         break;
+      }
+      children.push_back(c);
+   }
+
+   if (rc == 0) {
+      try {
+         rc = runPublisher(opts, children);
+      }
+      catch (mama_status status) {
+         rc = 1;
+      }
+   }
+
+   for (auto& c : children) {
+      if (rc != 0) {
+         kill(c.pid, SIGKILL);
+      }
+      if (waitChild(c) != 0) {
+         rc = 1;
+      }
+   }
+   stopNsd(nsd);
+
+   return rc;
+}
@@ -0,0 +1,280 @@
+// request/reply round-trip latency benchmark
+//
+// The requester runs in the main process, and the replier runs in a child process.  Each request is
+// timestamped by the requester, echoed back by the replier, and the round-trip time is calculated
+// when the reply is received.  Requests are synchronous -- i.e., the next request is not sent until
+// the reply to the previous one has been received (or timed out).
+
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <libgen.h>
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+using namespace std;
+
+#include <wombat/wSemaphore.h>
+#include <mama/mama.h>
+
+#include "ozimpl.h"
+using namespace oz;
+
+#include "ozbench.h"
+using namespace ozbench;
+
+
+///////////////////////////////////////////////////////////////////////////////
+// replier
+
+// state shared by all topics in the replier process
+struct replierState
+{
+   replierState(const options& opts, int fd)
+      : opts_(opts), fd_(fd), numDone_(0)
+   {
+      wsem_init(&done_, 0, 0);
+   }
+   ~replierState()
+   {
+      wsem_destroy(&done_);
+   }
+
+   const options&    opts_;
+   int               fd_;
+   atomic<int>       numDone_;
+   wsem_t            done_;
+};
+
+// there is one of these per topic
+class echoEvents : public subscriberEvents
+{
+public:
+   echoEvents(replierState& state, connection* pConn)
+      : state_(state), reply_(pConn->createReply())
+   {}
+
+private:
+   virtual void MAMACALLTYPE onMsg(subscriber* pSubscriber, const char* topic, mamaMsg msg, void* itemClosure) override
+   {
+      if (mamaMsg_isFromInbox(msg)) {
+         // echo request back to requester
+         mamaMsg temp;
+         TRY_MAMA_FUNC(mamaMsg_getTempCopy(msg, &temp));
+         TRY_MAMA_FUNC(reply_->send(temp));
+         return;
+      }
+
+      mama_u8_t type;
+      if ((mamaMsg_getU8(msg, FIELD_TYPE, 0, &type) == MAMA_STATUS_OK) && (type == MSG_DONE) && (!done_)) {
+         // requester repeats these until it hears back from us
+         done_ = true;
+         if (++state_.numDone_ == state_.opts_.topics) {
+            char c = 'D';
+            if (write(state_.fd_, &c, 1) != 1) {
+               mama_log(MAMA_LOG_LEVEL_ERROR, "Unable to signal requester: %d(%s)", errno, strerror(errno));
+            }
+            wsem_post(&state_.done_);
+         }
+      }
+   }
+
+   replierState&  state_;
+   unique_ptr<reply, decltype(replyDeleter)> reply_;
+   bool           done_       {false};
+};
+
+int runReplier(const options& opts, int fd)
+{
+   try {
+      TRY_MAMA_FUNC(setProperties(opts));
+      auto conn = createConnection(opts.mw, opts.payload, opts.tport);
+      TRY_MAMA_FUNC(conn->start());
+
+      // NOTE: order of declaration is important -- sinks must outlive sessions, which must outlive subscribers
+      replierState state(opts, fd);
+      vector<unique_ptr<echoEvents>> sinks;
+      vector<unique_ptr<session, decltype(sessionDeleter)>> sessions;
+      vector<unique_ptr<subscriber, decltype(subscriberDeleter)>> subs;
+
+      int numSessions = (opts.queue == queueMode::dedicated) ? opts.topics : 1;
+      for (int i = 0; i < numSessions; ++i) {
+         sessions.push_back(conn->createSession());
+         TRY_MAMA_FUNC(sessions.back()->start());
+      }
+
+      for (int i = 0; i < opts.topics; ++i) {
+         sinks.emplace_back(new echoEvents(state, conn.get()));
+         subs.push_back(sessions[i % numSessions]->createSubscriber(opts.getTopic(i), sinks.back().get()));
+         TRY_MAMA_FUNC(subs.back()->start());
+      }
+
+      // wait for requester to finish (or die)
+      while (wsem_timedwait(&state.done_, 1000) != 0) {
+         if (getppid() == 1) {
+            return 1;
+         }
+      }
+   }
+   catch (mama_status status) {
+      return 1;
+   }
+
+   return 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// requester
+
+// there is one of these per topic, and all share the same histogram -- since requests are synchronous,
+// only one can be outstanding at a time
+class rttRequest : public request, requestEvents
+{
+public:
+   rttRequest(session* pSession, const string& topic, const options& opts, histogram& hist)
+      : request(pSession, topic), opts_(opts), hist_(hist)
+   {
+      pSink_ = this;
+   }
+
+private:
+   virtual void MAMACALLTYPE onReply(request* pRequest, mamaMsg msg) override
+   {
+      int64_t now = nowNanos();
+
+      mama_u8_t type;
+      mama_u64_t seq;
+      mama_i64_t ts;
+      if ((mamaMsg_getU8(msg, FIELD_TYPE, 0, &type) == MAMA_STATUS_OK) && (type == MSG_DATA)
+         && (mamaMsg_getU64(msg, FIELD_SEQ, 0, &seq) == MAMA_STATUS_OK) && (mamaMsg_getI64(msg, FIELD_TS, 0, &ts) == MAMA_STATUS_OK)) {
+         if ((long) seq >= opts_.warmup) {
+            hist_.record(now - ts);
+         }
+      }
+   }
+
+   const options&    opts_;
+   histogram&        hist_;
+};
+
+int runRequester(const options& opts, vector<child>& children)
+{
+   TRY_MAMA_FUNC(setProperties(opts));
+   auto conn = createConnection(opts.mw, opts.payload, opts.tport);
+   TRY_MAMA_FUNC(conn->start());
+
+   auto sess = conn->createSession();
+   TRY_MAMA_FUNC(sess->start());
+
+   histogram hist;
+   vector<rttRequest*> reqs;
+   for (int i = 0; i < opts.topics; ++i) {
+      reqs.push_back(new rttRequest(sess.get(), opts.getTopic(i), opts, hist));
+   }
+
+   mamaMsg msg;
+   TRY_MAMA_FUNC(createMsg(&msg, opts.size));
+
+   // send probes until the replier has discovered us on all topics
+   int rc = 0;
+   for (auto req : reqs) {
+      mama_status status = MAMA_STATUS_TIMEOUT;
+      for (int tries = 0; (tries < 100) && (status != MAMA_STATUS_OK); ++tries) {
+         TRY_MAMA_FUNC(req->send(msg));
+         status = req->waitReply(.1);
+      }
+      if (status != MAMA_STATUS_OK) {
+         fprintf(stderr, "Timed out waiting for replier on %s\n", req->getTopic().c_str());
+         rc = 1;
+         break;
+      }
+   }
+
+   if (rc == 0) {
+      pacer pace(opts.rate);
+      long total = opts.warmup + opts.count;
+      long lost = 0;
+      int64_t start = nowNanos();
+      for (long seq = 0; seq < total; ++seq) {
+         TRY_MAMA_FUNC(updateMsg(msg, MSG_DATA, seq, pace.next()));
+         rttRequest* req = reqs[seq % opts.topics];
+         TRY_MAMA_FUNC(req->send(msg));
+         if ((req->waitReply(1) != MAMA_STATUS_OK) && (seq >= opts.warmup)) {
+            ++lost;
+         }
+      }
+      int64_t elapsed = nowNanos() - start;
+
+      // tell replier we're done
+      TRY_MAMA_FUNC(updateMsg(msg, MSG_DONE, total, 0));
+      bool done = false;
+      for (int tries = 0; (tries < 300) && !done; ++tries) {
+         for (int i = 0; i < opts.topics; ++i) {
+            TRY_MAMA_FUNC(conn->getPublisher(opts.getTopic(i))->publish(msg));
+         }
+         done = waitReady(children, 100);
+      }
+
+      printf("sent %ld requests in %.3f secs (%.0f requests/sec)\n", total, elapsed / 1e9, total / (elapsed / 1e9));
+      hist.print(stdout, "rtt", lost);
+   }
+
+   mamaMsg_destroy(msg);
+   for (auto req : reqs) {
+      req->destroy();
+   }
+
+   return rc;
+}
+
+
+int main(int argc, char** argv)
+{
+   const char* prog = basename(argv[0]);
+
+   options opts;
+   if (!opts.parse(argc, argv)) {
+      opts.usage(stderr, prog);
+      return 1;
+   }
+   if (opts.subs != 1) {
+      fprintf(stderr, "%s only supports a single replier\n", prog);
+      return 1;
+   }
+   opts.print(stdout, prog);
+
+   // NOTE: must fork before initializing MAMA
+   pid_t nsd = startNsd(opts, argv[0]);
+   if (nsd < 0) {
+      return 1;
+   }
+
+   int rc = 1;
+   vector<child> children;
+   child c = forkChild([&opts](int fd) { return runReplier(opts, fd); });
+   if (c.pid > 0) {
+      children.push_back(c);
+      try {
+         rc = runRequester(opts, children);
+      }
+      catch (mama_status status) {
+         rc = 1;
+      }
+   }
+
+   for (auto& c : children) {
+      if (rc != 0) {
+         kill(c.pid, SIGKILL);
+      }
+      if (waitChild(c) != 0) {
+         rc = 1;
+      }
+   }
+   stopNsd(nsd);
+
+   return rc;
+}
@@ -37,6 +37,8 @@
 #include <mama/integration/mama.h>
 #include "zmqdefs.h"
 #include "util.h"
+#include "params.h"
+#include "timerwheel.h"
 
 #include <zmq.h>
 
@@ -111,6 +113,21 @@ zmqBridge_open(mamaBridge bridgeImpl)
    /* Set the queue name (used to identify this queue in MAMA stats) */
    mamaQueue_setQueueName(defaultEventQueue, ZMQ_DEFAULT_QUEUE_NAME);
 
+   zmqBridgeMamaImpl_parseBridgeParams(closure);
+
+   /* Create the timing wheel (which will create a new thread) */
+   if (closure->mUseTimerWheel == 1) {
+      status = zmqBridgeMamaTimerWheel_create(&closure->mWheel, (uint64_t) closure->mTimerWheelTick * 1000);
+      if (MAMA_STATUS_OK == status) {
+         status = zmqBridgeMamaTimerWheel_start(closure->mWheel);
+      }
+      if (MAMA_STATUS_OK != status) {
+         MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Failed to start timer wheel.");
+         return status;
+      }
+      return MAMA_STATUS_OK;
+   }
+
    /* Create the timer heap */
     if (0 != createTimerHeap (&closure->mTimerHeap)) {
       MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Failed to initialize timers.");
@@ -138,6 +155,8 @@ zmqBridge_close(mamaBridge bridgeImpl)
 
    zmqBridgeClosure* closure = NULL;
    mamaBridgeImpl_getClosure(bridgeImpl, (void**)&closure);
+   /* Remove the timer wheel (joins its thread) */
+   zmqBridgeMamaTimerWheel_destroy(closure->mWheel);
    /* Remove the timer heap */
    if (NULL != closure->mTimerHeap) {
         /* The timer heap allows us to access it's thread ID for joining */
@@ -0,0 +1,449 @@
+//
+// queue groups -- see groups.h
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <mama/mama.h>
+#include <wombat/wtable.h>
+#include <wombat/wInterlocked.h>
+#include <wombat/strutils.h>
+
+#include "zmqdefs.h"
+#include "util.h"
+#include "transport.h"
+#include "msg.h"
+#include "zmqbridgefunctions.h"
+#include "shmring.h"
+#include "stats.h"
+#include "groups.h"
+
+#include <zmq.h>
+
+// members that miss this many heartbeats are forgotten
+#define ZMQ_GROUP_MISSED_HEARTBEATS    3
+// if the chosen member is unreachable, try (at most) this many others
+#define ZMQ_GROUP_MAX_ATTEMPTS         3
+
+typedef struct zmqGroupMember_ {
+   char                    mUuid[UUID_STRING_SIZE +1];
+   uint32_t                mLoad;               // as of last announcement
+   uint32_t                mSent;               // msgs sent to member since last announcement
+   uint64_t                mLastSeen;           // millis
+} zmqGroupMember;
+
+typedef struct zmqGroup_ {
+   struct zmqGroup_*       mNext;               // next group w/the same subject
+   char                    mName[ZMQ_MAX_GROUP_NAME_LENGTH +1];
+   zmqGroupMember*         mMembers;
+   int                     mNumMembers;
+   int                     mCapacity;
+   unsigned int            mNextMember;         // round-robin cursor
+} zmqGroup;
+
+
+///////////////////////////////////////////////////////////////////////////////
+// publisher side -- the group table is protected by mGroupsLock
+
+static zmqGroup* zmqBridgeMamaGroupsImpl_find(zmqTransportBridge* impl, const char* subject, const char* name, int create)
+{
+   zmqGroup* head = wtable_lookup(impl->mGroups, subject);
+   for (zmqGroup* group = head; group != NULL; group = group->mNext) {
+      if (strcmp(group->mName, name) == 0) {
+         return group;
+      }
+   }
+   if (create == 0) {
+      return NULL;
+   }
+
+   zmqGroup* group = (zmqGroup*) calloc(1, sizeof(zmqGroup));
+   if (group == NULL) {
+      return NULL;
+   }
+   wmStrSizeCpy(group->mName, name, sizeof(group->mName));
+   group->mNext = head;
+   if (head != NULL) {
+      wtable_remove(impl->mGroups, subject);
+   }
+   wtable_insert(impl->mGroups, subject, group);
+   wInterlocked_increment(&impl->mNumGroups);
+   return group;
+}
+
+
+// returns non-zero if group was freed (because it has no members left)
+static int zmqBridgeMamaGroupsImpl_removeMember(zmqTransportBridge* impl, const char* subject, zmqGroup* group, int index)
+{
+   MAMA_LOG(MAMA_LOG_LEVEL_FINE, "Removing member %s from group %s on %s", group->mMembers[index].mUuid, group->mName, subject);
+
+   group->mMembers[index] = group->mMembers[--group->mNumMembers];
+   if (group->mNumMembers > 0) {
+      return 0;
+   }
+
+   // no members left -- forget the group
+   zmqGroup* head = wtable_remove(impl->mGroups, subject);
+   zmqGroup** pGroup = &head;
+   while (*pGroup != group) {
+      pGroup = &(*pGroup)->mNext;
+   }
+   *pGroup = group->mNext;
+   if (head != NULL) {
+      wtable_insert(impl->mGroups, subject, head);
+   }
+   free(group->mMembers);
+   free(group);
+   wInterlocked_decrement(&impl->mNumGroups);
+   return 1;
+}
+
+
+mama_status zmqBridgeMamaGroups_onMsg(zmqTransportBridge* impl, const char* subject, zmq_msg_t* zmsg)
+{
+   size_t subjectSize = strlen(subject) + 1;
+   if (zmq_msg_size(zmsg) < subjectSize + sizeof(zmqGroupMsg)) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Discarding malformed group msg (%zu bytes)", zmq_msg_size(zmsg));
+      return MAMA_STATUS_INVALID_ARG;
+   }
+   zmqGroupMsg msg;
+   memcpy(&msg, (const char*) zmq_msg_data(zmsg) + subjectSize, sizeof(msg));
+   msg.mGroup[sizeof(msg.mGroup) -1] = '\0';
+   msg.mUuid[sizeof(msg.mUuid) -1] = '\0';
+   const char* groupSubject = subject + strlen(ZMQ_GROUP_PREFIX);
+
+   MAMA_LOG(MAMA_LOG_LEVEL_FINER, "Received group msg: type=%c group=%s subject=%s uuid=%s load=%u", msg.mType, msg.mGroup, groupSubject, msg.mUuid, msg.mLoad);
+
+   wlock_lock(impl->mGroupsLock);
+   zmqGroup* group = zmqBridgeMamaGroupsImpl_find(impl, groupSubject, msg.mGroup, msg.mType != 'L');
+   if (group == NULL) {
+      wlock_unlock(impl->mGroupsLock);
+      return (msg.mType == 'L') ? MAMA_STATUS_OK : MAMA_STATUS_NOMEM;
+   }
+
+   int index = 0;
+   while ((index < group->mNumMembers) && (strcmp(group->mMembers[index].mUuid, msg.mUuid) != 0)) {
+      ++index;
+   }
+
+   if (msg.mType == 'L') {
+      if (index < group->mNumMembers) {
+         zmqBridgeMamaGroupsImpl_removeMember(impl, groupSubject, group, index);
+      }
+      wlock_unlock(impl->mGroupsLock);
+      return MAMA_STATUS_OK;
+   }
+
+   if (index == group->mNumMembers) {
+      if (group->mNumMembers == group->mCapacity) {
+         int capacity = (group->mCapacity == 0) ? 4 : group->mCapacity * 2;
+         zmqGroupMember* members = realloc(group->mMembers, capacity * sizeof(zmqGroupMember));
+         if (members == NULL) {
+            wlock_unlock(impl->mGroupsLock);
+            return MAMA_STATUS_NOMEM;
+         }
+         group->mMembers = members;
+         group->mCapacity = capacity;
+      }
+      wmStrSizeCpy(group->mMembers[index].mUuid, msg.mUuid, sizeof(group->mMembers[index].mUuid));
+      ++group->mNumMembers;
+      MAMA_LOG(MAMA_LOG_LEVEL_FINE, "Added member %s to group %s on %s", msg.mUuid, group->mName, groupSubject);
+   }
+   group->mMembers[index].mLoad = msg.mLoad;
+   group->mMembers[index].mSent = 0;
+   group->mMembers[index].mLastSeen = getMillis();
+   wlock_unlock(impl->mGroupsLock);
+
+   return MAMA_STATUS_OK;
+}
+
+
+typedef struct zmqGroupsRemoveClosure {
+   zmqTransportBridge*     mTransport;
+   const char*             mUuid;               // remove members w/this uuid, or ...
+   uint64_t                mStaleTime;          // ... members not seen since this time
+   char**                  mSubjects;           // subjects w/groups to check
+   size_t                  mNumSubjects;
+} zmqGroupsRemoveClosure;
+
+static void zmqBridgeMamaGroupsImpl_collectSubject(wtable_t table, void* data, const char* key, void* closure)
+{
+   zmqGroupsRemoveClosure* remove = (zmqGroupsRemoveClosure*) closure;
+   char** subjects = realloc(remove->mSubjects, (remove->mNumSubjects + 1) * sizeof(char*));
+   if (subjects != NULL) {
+      remove->mSubjects = subjects;
+      remove->mSubjects[remove->mNumSubjects++] = strdup(key);
+   }
+}
+
+// removes members matching closure (caller must hold mGroupsLock)
+// NOTE: removing members may remove groups, and so modify the table, so collect subjects first
+static void zmqBridgeMamaGroupsImpl_removeMembers(zmqTransportBridge* impl, zmqGroupsRemoveClosure* remove)
+{
+   wtable_for_each(impl->mGroups, zmqBridgeMamaGroupsImpl_collectSubject, remove);
+
+   for (size_t i = 0; i < remove->mNumSubjects; ++i) {
+      const char* subject = remove->mSubjects[i];
+      zmqGroup* group = wtable_lookup(impl->mGroups, subject);
+      while (group != NULL) {
+         // group may be freed when its last member is removed
+         zmqGroup* next = group->mNext;
+         for (int index = group->mNumMembers - 1; index >= 0; --index) {
+            zmqGroupMember* member = &group->mMembers[index];
+            if (((remove->mUuid != NULL) && (strcmp(member->mUuid, remove->mUuid) == 0))
+               || ((remove->mUuid == NULL) && (member->mLastSeen < remove->mStaleTime))) {
+               if (zmqBridgeMamaGroupsImpl_removeMember(impl, subject, group, index) != 0) {
+                  break;
+               }
+            }
+         }
+         group = next;
+      }
+      free(remove->mSubjects[i]);
+   }
+   free(remove->mSubjects);
+}
+
+
+void zmqBridgeMamaGroups_removePeer(zmqTransportBridge* impl, const char* uuid)
+{
+   if ((impl->mQueueGroups == 0) || (wInterlocked_read(&impl->mNumGroups) == 0)) {
+      return;
+   }
+
+   zmqGroupsRemoveClosure remove;
+   memset(&remove, '\0', sizeof(remove));
+   remove.mTransport = impl;
+   remove.mUuid = uuid;
+   wlock_lock(impl->mGroupsLock);
+   zmqBridgeMamaGroupsImpl_removeMembers(impl, &remove);
+   wlock_unlock(impl->mGroupsLock);
+}
+
+
+// chooses members of group to send to, in order of preference (caller must hold mGroupsLock)
+static int zmqBridgeMamaGroupsImpl_choose(zmqTransportBridge* impl, zmqGroup* group, char uuids[][UUID_STRING_SIZE +1])
+{
+   if (group->mNumMembers == 0) {
+      return 0;
+   }
+
+   int first = group->mNextMember++ % group->mNumMembers;
+   if (impl->mQueueGroupPolicy == ZMQ_GROUP_LEAST_LOADED) {
+      // load is as of last announcement, plus whatever we've sent since then
+      // (start from the round-robin cursor, so that ties are broken fairly)
+      uint64_t minLoad = UINT64_MAX;
+      int start = first;
+      for (int i = 0; i < group->mNumMembers; ++i) {
+         int index = (start + i) % group->mNumMembers;
+         uint64_t load = (uint64_t) group->mMembers[index].mLoad + group->mMembers[index].mSent;
+         if (load < minLoad) {
+            minLoad = load;
+            first = index;
+         }
+      }
+   }
+   group->mMembers[first].mSent++;
+
+   int count = 0;
+   for (int i = 0; (i < group->mNumMembers) && (count < ZMQ_GROUP_MAX_ATTEMPTS); ++i) {
+      strcpy(uuids[count++], group->mMembers[(first + i) % group->mNumMembers].mUuid);
+   }
+   return count;
+}
+
+
+mama_status zmqBridgeMamaGroups_send(zmqTransportBridge* impl, msgBridge bridgeMsg, mamaMsg mamaMsg)
+{
+   zmqBridgeMsgImpl* msgImpl = (zmqBridgeMsgImpl*) bridgeMsg;
+   if (msgImpl->mMsgType == ZMQ_MSG_INBOX_RESPONSE) {
+      return MAMA_STATUS_OK;
+   }
+   const char* subject = msgImpl->mSendSubject;
+
+   // choose members while holding the lock, but send w/o it
+   char uuids[ZMQ_MAX_GROUPS_PER_SUBJECT][ZMQ_GROUP_MAX_ATTEMPTS][UUID_STRING_SIZE +1];
+   int counts[ZMQ_MAX_GROUPS_PER_SUBJECT];
+   int numGroups = 0;
+   wlock_lock(impl->mGroupsLock);
+   for (zmqGroup* group = wtable_lookup(impl->mGroups, subject); (group != NULL) && (numGroups < ZMQ_MAX_GROUPS_PER_SUBJECT); group = group->mNext) {
+      counts[numGroups] = zmqBridgeMamaGroupsImpl_choose(impl, group, uuids[numGroups]);
+      if (counts[numGroups] > 0) {
+         ++numGroups;
+      }
+   }
+   wlock_unlock(impl->mGroupsLock);
+   if (numGroups == 0) {
+      return MAMA_STATUS_OK;
+   }
+
+   // members may not know the topic id, so always send the full subject
+   msgImpl->mIsCompact = 0;
+   if (msgImpl->mMsgType == ZMQ_MSG_PUB_SUB_TOPICID) {
+      msgImpl->mMsgType = ZMQ_MSG_PUB_SUB;
+   }
+   zmq_msg_t zmsg;
+   CALL_MAMA_FUNC(zmqBridgeMamaMsgImpl_serialize(bridgeMsg, mamaMsg, &zmsg));
+
+   mama_status status = MAMA_STATUS_OK;
+   for (int i = 0; i < numGroups; ++i) {
+      mama_status groupStatus = MAMA_STATUS_IO_ERROR;
+      for (int j = 0; (j < counts[i]) && (groupStatus == MAMA_STATUS_IO_ERROR); ++j) {
+         // sendDirect consumes the msg only if it succeeds
+         zmq_msg_t copy;
+         zmq_msg_init(&copy);
+         zmq_msg_copy(&copy, &zmsg);
+         groupStatus = zmqBridgeMamaPublisherImpl_sendDirect(impl, uuids[i][j], &copy, ZMQ_STAT_GROUP_MSGS_OUT);
+         zmq_msg_close(&copy);
+      }
+      if (groupStatus != MAMA_STATUS_OK) {
+         MAMA_LOG(MAMA_LOG_LEVEL_WARN, "Unable to deliver msg on %s to any member of group", subject);
+         status = groupStatus;
+      }
+   }
+   zmq_msg_close(&zmsg);
+
+   return status;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// member side -- the list of members is protected by mGroupsLock
+
+int zmqBridgeMamaGroups_isMember(zmqTransportBridge* impl, const char* subject)
+{
+   if ((impl->mQueueGroups == 0) || (impl->mQueueGroup == NULL) || (impl->mQueueGroupPrefix[0] == '\0')) {
+      return 0;
+   }
+   return (strncmp(subject, impl->mQueueGroupPrefix, strlen(impl->mQueueGroupPrefix)) == 0) ? 1 : 0;
+}
+
+
+// publishes a membership announcement on the data socket (and shm ring, if any)
+static mama_status zmqBridgeMamaGroupsImpl_announce(zmqTransportBridge* impl, zmqSubscription* subscription, char type)
+{
+   char buf[MAX_SUBJECT_LENGTH + 1 + sizeof(ZMQ_GROUP_PREFIX) + sizeof(zmqGroupMsg)];
+   int subjectSize = snprintf(buf, sizeof(buf) - sizeof(zmqGroupMsg), "%s%s", ZMQ_GROUP_PREFIX, subscription->mSubjectKey) + 1;
+   if (subjectSize > (int) (sizeof(buf) - sizeof(zmqGroupMsg))) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Subject too long for group msg: %s", subscription->mSubjectKey);
+      return MAMA_STATUS_INVALID_ARG;
+   }
+
+   zmqGroupMsg msg;
+   memset(&msg, '\0', sizeof(msg));
+   msg.mType = type;
+   wmStrSizeCpy(msg.mGroup, impl->mQueueGroup, sizeof(msg.mGroup));
+   wmStrSizeCpy(msg.mUuid, impl->mUuid, sizeof(msg.mUuid));
+   size_t load = 0;
+   zmqBridgeMamaQueue_getEventCount((queueBridge) subscription->mZmqQueue, &load);
+   msg.mLoad = (load > UINT32_MAX) ? UINT32_MAX : (uint32_t) load;
+   memcpy(buf + subjectSize, &msg, sizeof(msg));
+   size_t size = subjectSize + sizeof(msg);
+
+   mama_status status = MAMA_STATUS_OK;
+   wlock_lock(impl->mZmqDataPub.mLock);
+   if (impl->mShmRing != NULL) {
+      zmqBridgeMamaShmRing_write(impl->mShmRing, buf, size);
+   }
+   if (zmq_send(impl->mZmqDataPub.mSocket, buf, size, ZMQ_DONTWAIT) != (int) size) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Failed to publish group msg for %s: %d(%s)", subscription->mSubjectKey, zmq_errno(), zmq_strerror(zmq_errno()));
+      status = MAMA_STATUS_PLATFORM;
+   }
+   wlock_unlock(impl->mZmqDataPub.mLock);
+
+   return status;
+}
+
+
+mama_status zmqBridgeMamaGroups_join(zmqTransportBridge* impl, zmqSubscription* subscription)
+{
+   wlock_lock(impl->mGroupsLock);
+   subscription->mNextMember = impl->mMembers;
+   impl->mMembers = subscription;
+   wlock_unlock(impl->mGroupsLock);
+
+   MAMA_LOG(MAMA_LOG_LEVEL_FINE, "Joined group %s on %s", impl->mQueueGroup, subscription->mSubjectKey);
+
+   return zmqBridgeMamaGroupsImpl_announce(impl, subscription, 'J');
+}
+
+
+mama_status zmqBridgeMamaGroups_leave(zmqTransportBridge* impl, zmqSubscription* subscription)
+{
+   wlock_lock(impl->mGroupsLock);
+   zmqSubscription** pMember = &impl->mMembers;
+   while ((*pMember != NULL) && (*pMember != subscription)) {
+      pMember = &(*pMember)->mNextMember;
+   }
+   if (*pMember != NULL) {
+      *pMember = subscription->mNextMember;
+   }
+   wlock_unlock(impl->mGroupsLock);
+
+   MAMA_LOG(MAMA_LOG_LEVEL_FINE, "Left group %s on %s", impl->mQueueGroup, subscription->mSubjectKey);
+
+   return zmqBridgeMamaGroupsImpl_announce(impl, subscription, 'L');
+}
+
+
+void zmqBridgeMamaGroups_heartbeat(zmqTransportBridge* impl)
+{
+   wlock_lock(impl->mGroupsLock);
+
+   for (zmqSubscription* member = impl->mMembers; member != NULL; member = member->mNextMember) {
+      zmqBridgeMamaGroupsImpl_announce(impl, member, 'H');
+   }
+
+   if (wInterlocked_read(&impl->mNumGroups) > 0) {
+      zmqGroupsRemoveClosure remove;
+      memset(&remove, '\0', sizeof(remove));
+      remove.mTransport = impl;
+      remove.mStaleTime = getMillis() - (uint64_t) impl->mQueueGroupInterval * ZMQ_GROUP_MISSED_HEARTBEATS;
+      zmqBridgeMamaGroupsImpl_removeMembers(impl, &remove);
+   }
+
+   wlock_unlock(impl->mGroupsLock);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+
+mama_status zmqBridgeMamaGroups_create(zmqTransportBridge* impl)
+{
+   impl->mGroups = wtable_create("groups", GROUP_TABLE_SIZE);
+   if (impl->mGroups == NULL) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Failed to create groups table");
+      return MAMA_STATUS_NOMEM;
+   }
+   impl->mGroupsLock = wlock_create();
+   wInterlocked_initialize(&impl->mNumGroups);
+   wInterlocked_set(0, &impl->mNumGroups);
+
+   return MAMA_STATUS_OK;
+}
+
+
+static void zmqBridgeMamaGroupsImpl_freeGroups(wtable_t table, void* data, const char* key, void* closure)
+{
+   zmqGroup* group = (zmqGroup*) data;
+   while (group != NULL) {
+      zmqGroup* next = group->mNext;
+      free(group->mMembers);
+      free(group);
+      group = next;
+   }
+}
+
+
+void zmqBridgeMamaGroups_destroy(zmqTransportBridge* impl)
+{
+   if (impl->mGroups == NULL) {
+      return;
+   }
+
+   wtable_for_each(impl->mGroups, zmqBridgeMamaGroupsImpl_freeGroups, NULL);
+   wtable_destroy(impl->mGroups);
+   wlock_destroy(impl->mGroupsLock);
+   wInterlocked_destroy(&impl->mNumGroups);
+}
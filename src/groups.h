@@ -0,0 +1,70 @@
+//
+// queue groups -- load balancing of msgs across the members of a group
+//
+// Subscriptions on a transport w/naming.queue_group set (whose subjects match naming.queue_group.prefix) are
+// members of that group.  Members do not subscribe to their subjects on the data socket, but instead announce
+// their membership (and their current load, i.e., the depth of the subscription's queue) on the subject
+// "_GROUP.<subject>", when they join and leave, and periodically thereafter.
+//
+// Transports w/naming.queue_groups enabled track the members of each group for each subject, and whenever
+// they send a msg on a subject that has groups, also send a copy directly (via the direct reply sockets) to
+// one member of each group, chosen by round-robin or least-loaded.  Members only dispatch group msgs that are
+// sent to them directly, so that each msg is delivered to exactly one member of each group.  Non-member
+// subscriptions to the same subject receive msgs as usual.
+//
+
+#ifndef MAMA_BRIDGE_ZMQ_GROUPS_H__
+#define MAMA_BRIDGE_ZMQ_GROUPS_H__
+
+#include <stdint.h>
+#include <mama/mama.h>
+
+#include "zmqdefs.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#define ZMQ_GROUP_PREFIX               "_GROUP."
+#define ZMQ_MAX_GROUP_NAME_LENGTH      63
+// max # of groups on a single subject that a msg will be sent to
+#define ZMQ_MAX_GROUPS_PER_SUBJECT     8
+
+// how publishers choose a member
+#define ZMQ_GROUP_ROUND_ROBIN          0
+#define ZMQ_GROUP_LEAST_LOADED         1
+
+#pragma pack(push, 1)
+// follows the (null-terminated) "_GROUP.<subject>" in membership announcements
+typedef struct zmqGroupMsg {
+   unsigned char           mType;                                       // "J"=join, "H"=heartbeat, "L"=leave
+   char                    mGroup[ZMQ_MAX_GROUP_NAME_LENGTH +1];
+   char                    mUuid[UUID_STRING_SIZE +1];                  // uuid of member's transport
+   uint32_t                mLoad;                                       // msgs waiting on member's queue
+} zmqGroupMsg;
+#pragma pack(pop)
+
+mama_status zmqBridgeMamaGroups_create(zmqTransportBridge* impl);
+void zmqBridgeMamaGroups_destroy(zmqTransportBridge* impl);
+
+// member side
+// should a (non-wildcard) subscription on subject join this transport's group?
+int zmqBridgeMamaGroups_isMember(zmqTransportBridge* impl, const char* subject);
+mama_status zmqBridgeMamaGroups_join(zmqTransportBridge* impl, zmqSubscription* subscription);
+mama_status zmqBridgeMamaGroups_leave(zmqTransportBridge* impl, zmqSubscription* subscription);
+// announces all memberships, and forgets members that have stopped announcing theirs (dispatch thread only)
+void zmqBridgeMamaGroups_heartbeat(zmqTransportBridge* impl);
+
+// publisher side
+// processes a membership announcement (dispatch thread only)
+mama_status zmqBridgeMamaGroups_onMsg(zmqTransportBridge* impl, const char* subject, zmq_msg_t* zmsg);
+// forgets all memberships of a peer that has disconnected (dispatch thread only)
+void zmqBridgeMamaGroups_removePeer(zmqTransportBridge* impl, const char* uuid);
+// sends msg to one member of each group on its send subject (if any)
+mama_status zmqBridgeMamaGroups_send(zmqTransportBridge* impl, msgBridge bridgeMsg, mamaMsg mamaMsg);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* MAMA_BRIDGE_ZMQ_GROUPS_H__ */
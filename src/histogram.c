@@ -0,0 +1,110 @@
+//
+// latency histogram -- log-linear buckets, along the lines of HdrHistogram
+//
+
+#include <stdio.h>
+#include <string.h>
+
+#include "histogram.h"
+
+
+static int zmqBridgeMamaHistogramImpl_indexOf(uint64_t value)
+{
+   if (value < ZMQ_HISTOGRAM_SUB_BUCKETS) {
+      return (int) value;
+   }
+
+   // shift so that the top SUB_BUCKET_BITS+1 bits of value remain
+   int shift = (63 - __builtin_clzll(value)) - ZMQ_HISTOGRAM_SUB_BUCKET_BITS;
+   return ZMQ_HISTOGRAM_SUB_BUCKETS + (shift * ZMQ_HISTOGRAM_SUB_BUCKETS) + (int) ((value >> shift) - ZMQ_HISTOGRAM_SUB_BUCKETS);
+}
+
+
+// returns the highest value that maps to index
+static uint64_t zmqBridgeMamaHistogramImpl_valueOf(int index)
+{
+   if (index < ZMQ_HISTOGRAM_SUB_BUCKETS) {
+      return index;
+   }
+
+   int shift = (index / ZMQ_HISTOGRAM_SUB_BUCKETS) - 1;
+   uint64_t sub = (index % ZMQ_HISTOGRAM_SUB_BUCKETS) + ZMQ_HISTOGRAM_SUB_BUCKETS;
+   return ((sub + 1) << shift) - 1;
+}
+
+
+void zmqBridgeMamaHistogram_init(zmqHistogram* hist)
+{
+   memset(hist, '\0', sizeof(zmqHistogram));
+   hist->mMin = UINT64_MAX;
+}
+
+
+void zmqBridgeMamaHistogram_record(zmqHistogram* hist, uint64_t value)
+{
+   hist->mCounts[zmqBridgeMamaHistogramImpl_indexOf(value)]++;
+   hist->mCount++;
+   hist->mSum += value;
+   if (value < hist->mMin) {
+      hist->mMin = value;
+   }
+   if (value > hist->mMax) {
+      hist->mMax = value;
+   }
+}
+
+
+void zmqBridgeMamaHistogram_merge(zmqHistogram* dest, const zmqHistogram* src)
+{
+   for (int i = 0; i < ZMQ_HISTOGRAM_BUCKETS; ++i) {
+      dest->mCounts[i] += src->mCounts[i];
+   }
+   dest->mCount += src->mCount;
+   dest->mSum += src->mSum;
+   if (src->mMin < dest->mMin) {
+      dest->mMin = src->mMin;
+   }
+   if (src->mMax > dest->mMax) {
+      dest->mMax = src->mMax;
+   }
+}
+
+
+uint64_t zmqBridgeMamaHistogram_percentile(const zmqHistogram* hist, double p)
+{
+   if (hist->mCount == 0) {
+      return 0;
+   }
+
+   uint64_t target = (uint64_t) ((p / 100.0) * hist->mCount + 0.5);
+   if (target < 1) {
+      target = 1;
+   }
+   uint64_t total = 0;
+   for (int i = 0; i < ZMQ_HISTOGRAM_BUCKETS; ++i) {
+      total += hist->mCounts[i];
+      if (total >= target) {
+         uint64_t value = zmqBridgeMamaHistogramImpl_valueOf(i);
+         return (value < hist->mMax) ? value : hist->mMax;
+      }
+   }
+
+   return hist->mMax;
+}
+
+
+const char* zmqBridgeMamaHistogram_format(const zmqHistogram* hist, char* buf, size_t size)
+{
+   snprintf(buf, size, "count=%llu min=%.3f mean=%.3f p50=%.3f p90=%.3f p99=%.3f p99.9=%.3f p99.99=%.3f max=%.3f (usec)",
+      (unsigned long long) hist->mCount,
+      ((hist->mCount > 0) ? hist->mMin : 0) / 1000.0,
+      ((hist->mCount > 0) ? (double) hist->mSum / hist->mCount : 0) / 1000.0,
+      zmqBridgeMamaHistogram_percentile(hist, 50) / 1000.0,
+      zmqBridgeMamaHistogram_percentile(hist, 90) / 1000.0,
+      zmqBridgeMamaHistogram_percentile(hist, 99) / 1000.0,
+      zmqBridgeMamaHistogram_percentile(hist, 99.9) / 1000.0,
+      zmqBridgeMamaHistogram_percentile(hist, 99.99) / 1000.0,
+      hist->mMax / 1000.0);
+
+   return buf;
+}
@@ -0,0 +1,46 @@
+//
+// latency histogram -- log-linear buckets, along the lines of HdrHistogram
+//
+// Each power of two is divided into 2^ZMQ_HISTOGRAM_SUB_BUCKET_BITS linear buckets, so recorded values
+// are accurate to within 1/2^ZMQ_HISTOGRAM_SUB_BUCKET_BITS (i.e., better than 1%), regardless of magnitude.
+// Histograms are not thread-safe -- use one per thread, and merge them.
+//
+
+#ifndef MAMA_BRIDGE_ZMQ_HISTOGRAM_H__
+#define MAMA_BRIDGE_ZMQ_HISTOGRAM_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#define ZMQ_HISTOGRAM_SUB_BUCKET_BITS  7
+#define ZMQ_HISTOGRAM_SUB_BUCKETS      (1 << ZMQ_HISTOGRAM_SUB_BUCKET_BITS)
+#define ZMQ_HISTOGRAM_BUCKETS          (ZMQ_HISTOGRAM_SUB_BUCKETS * (64 - ZMQ_HISTOGRAM_SUB_BUCKET_BITS + 1))
+
+typedef struct zmqHistogram {
+   uint64_t                mCounts[ZMQ_HISTOGRAM_BUCKETS];
+   uint64_t                mCount;
+   uint64_t                mSum;
+   uint64_t                mMin;
+   uint64_t                mMax;
+} zmqHistogram;
+
+void zmqBridgeMamaHistogram_init(zmqHistogram* hist);
+void zmqBridgeMamaHistogram_record(zmqHistogram* hist, uint64_t value);
+void zmqBridgeMamaHistogram_merge(zmqHistogram* dest, const zmqHistogram* src);
+
+// returns the value at or below which p percent of recorded values fall
+uint64_t zmqBridgeMamaHistogram_percentile(const zmqHistogram* hist, double p);
+
+// formats a one-line summary (count, min, mean, percentiles, max), assuming values are in nanos and
+// converting them to micros
+const char* zmqBridgeMamaHistogram_format(const zmqHistogram* hist, char* buf, size_t size);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* MAMA_BRIDGE_ZMQ_HISTOGRAM_H__ */
@@ -43,6 +43,7 @@
 #include "msg.h"
 #include "subscription.h"
 #include "zmqbridgefunctions.h"
+#include "queue.h"
 
 extern subscriptionBridge
 mamaSubscription_getSubscriptionBridge(
@@ -136,6 +137,12 @@ mama_status zmqBridgeMamaInbox_createByIndex(inboxBridge* bridge, mamaTransport
    impl->mTransport = zmqBridgeMamaTransportImpl_getTransportBridge(transport);
    impl->mMamaQueue = queue;
    mamaQueue_getNativeHandle(queue, &impl->mZmqQueue);
+   if (impl->mTransport->mLatency != NULL) {
+      zmqBridgeMamaQueue_enableLatency(impl->mZmqQueue);
+   }
+   if (impl->mTransport->mQueueMaxAge > 0) {
+      zmqBridgeMamaQueue_applyMaxAge(impl->mZmqQueue, impl->mTransport->mQueueMaxAge, impl->mTransport->mQueueDropStale);
+   }
 
    // generate reply address
    const char* inboxSubject;
@@ -0,0 +1,471 @@
+//
+// inbox pools -- see inboxpool.h
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <mama/mama.h>
+#include <mama/timer.h>
+#include <wombat/wInterlocked.h>
+
+#include "zmqdefs.h"
+#include "util.h"
+#include "transport.h"
+#include "msg.h"
+#include "queue.h"
+#include "timerwheel.h"
+#include "zmqbridgefunctions.h"
+#include "inboxpool.h"
+
+// request ids are (generation << 16) | slot -- generation changes each time a slot is re-used, so late replies
+// to a previous request in the same slot are recognized as such
+#define ZMQ_INBOXPOOL_SLOT_BITS        16
+#define ZMQ_INBOXPOOL_SLOT_MASK        ((1 << ZMQ_INBOXPOOL_SLOT_BITS) -1)
+#define ZMQ_INBOXPOOL_CHUNK_BITS       10
+#define ZMQ_INBOXPOOL_CHUNK_SIZE       (1 << ZMQ_INBOXPOOL_CHUNK_BITS)
+#define ZMQ_INBOXPOOL_MAX_CHUNKS       ((1 << ZMQ_INBOXPOOL_SLOT_BITS) / ZMQ_INBOXPOOL_CHUNK_SIZE)
+
+// timeouts are checked this often (seconds)
+#define ZMQ_INBOXPOOL_TIMER_INTERVAL   0.01
+#define ZMQ_INBOXPOOL_TIMER_TICK       1000000
+
+typedef struct zmqInboxPoolRequest_ {
+   zmqTimerWheelEntry      mTimeout;
+   struct zmqInboxPool_*   mPool;
+   uint32_t                mId;                 // 0 => free
+   uint32_t                mNextFree;           // slot + 1 (0 => none)
+   uint32_t                mTimeoutId;          // id of the request the timeout was scheduled for (0 => none)
+   uint16_t                mGeneration;
+   void*                   mClosure;
+   // gather requests only
+   zmqInboxPoolGatherCB    mOnGather;           // NULL for single-reply requests
+   mamaMsg*                mReplies;            // copies of replies received so far
+   size_t                  mNumReplies;
+   size_t                  mMaxReplies;
+} zmqInboxPoolRequest;
+
+struct zmqInboxPool_ {
+   zmqInboxImpl            mInbox;              // registered w/the transport in place of a regular inbox
+   pthread_mutex_t         mLock;               // protects requests (and is taken before the wheel's lock)
+   // requests are allocated in chunks, which never move (the timeout entries are intrusive)
+   zmqInboxPoolRequest*    mChunks[ZMQ_INBOXPOOL_MAX_CHUNKS];
+   uint32_t                mNumSlots;
+   uint32_t                mFirstFree;          // slot + 1 (0 => none)
+   zmqTimerWheel*          mTimeouts;           // advanced by mTimer
+   mamaTimer               mTimer;
+   zmqInboxPoolReplyCB     mOnReply;
+   zmqInboxPoolTimeoutCB   mOnTimeout;
+   void*                   mClosure;
+   uint64_t                mOutstanding;
+   uint64_t                mReplies;
+   uint64_t                mTimeoutCount;
+   uint64_t                mLateReplies;
+};
+
+
+static zmqInboxPoolRequest* zmqBridgeMamaInboxPoolImpl_getSlot(zmqInboxPool pool, uint32_t slot)
+{
+   return &pool->mChunks[slot >> ZMQ_INBOXPOOL_CHUNK_BITS][slot & (ZMQ_INBOXPOOL_CHUNK_SIZE -1)];
+}
+
+
+// returns the request w/the given id, or NULL if it is no longer outstanding (caller must hold mLock)
+static zmqInboxPoolRequest* zmqBridgeMamaInboxPoolImpl_find(zmqInboxPool pool, uint32_t requestId)
+{
+   uint32_t slot = requestId & ZMQ_INBOXPOOL_SLOT_MASK;
+   if ((requestId == 0) || (slot >= pool->mNumSlots)) {
+      return NULL;
+   }
+   zmqInboxPoolRequest* request = zmqBridgeMamaInboxPoolImpl_getSlot(pool, slot);
+   return (request->mId == requestId) ? request : NULL;
+}
+
+
+// caller must hold mLock
+static zmqInboxPoolRequest* zmqBridgeMamaInboxPoolImpl_alloc(zmqInboxPool pool)
+{
+   if (pool->mFirstFree == 0) {
+      if (pool->mNumSlots == ZMQ_INBOXPOOL_MAX_CHUNKS * ZMQ_INBOXPOOL_CHUNK_SIZE) {
+         return NULL;
+      }
+      zmqInboxPoolRequest* chunk = (zmqInboxPoolRequest*) calloc(ZMQ_INBOXPOOL_CHUNK_SIZE, sizeof(zmqInboxPoolRequest));
+      if (chunk == NULL) {
+         return NULL;
+      }
+      pool->mChunks[pool->mNumSlots >> ZMQ_INBOXPOOL_CHUNK_BITS] = chunk;
+      // slot 0 is never used, so that request ids are never zero
+      for (int i = ZMQ_INBOXPOOL_CHUNK_SIZE -1; i >= 0; --i) {
+         uint32_t slot = pool->mNumSlots + i;
+         if (slot == 0) {
+            continue;
+         }
+         chunk[i].mPool = pool;
+         chunk[i].mNextFree = pool->mFirstFree;
+         pool->mFirstFree = slot + 1;
+      }
+      pool->mNumSlots += ZMQ_INBOXPOOL_CHUNK_SIZE;
+   }
+
+   uint32_t slot = pool->mFirstFree - 1;
+   zmqInboxPoolRequest* request = zmqBridgeMamaInboxPoolImpl_getSlot(pool, slot);
+   pool->mFirstFree = request->mNextFree;
+   if (++request->mGeneration == 0) {
+      request->mGeneration = 1;
+   }
+   request->mId = ((uint32_t) request->mGeneration << ZMQ_INBOXPOOL_SLOT_BITS) | slot;
+   ++pool->mOutstanding;
+
+   return request;
+}
+
+
+// caller must hold mLock
+static void zmqBridgeMamaInboxPoolImpl_free(zmqInboxPool pool, zmqInboxPoolRequest* request)
+{
+   zmqBridgeMamaTimerWheel_cancel(pool->mTimeouts, &request->mTimeout);
+   request->mNextFree = pool->mFirstFree;
+   pool->mFirstFree = (request->mId & ZMQ_INBOXPOOL_SLOT_MASK) + 1;
+   request->mId = 0;
+   request->mTimeoutId = 0;
+   request->mClosure = NULL;
+   // caller takes ownership of any replies
+   request->mOnGather = NULL;
+   request->mReplies = NULL;
+   request->mNumReplies = 0;
+   request->mMaxReplies = 0;
+   --pool->mOutstanding;
+}
+
+
+static void zmqBridgeMamaInboxPoolImpl_destroyReplies(mamaMsg* replies, size_t numReplies)
+{
+   for (size_t i = 0; i < numReplies; ++i) {
+      mamaMsg_destroy(replies[i]);
+   }
+   free(replies);
+}
+
+
+// called (via zmqBridgeMamaTimerWheel_advance) from onTimer
+static void zmqBridgeMamaInboxPoolImpl_onTimeout(zmqTimerWheelEntry* entry, void* closure)
+{
+   zmqInboxPoolRequest* request = (zmqInboxPoolRequest*) closure;
+   zmqInboxPool pool = request->mPool;
+
+   pthread_mutex_lock(&pool->mLock);
+   // request may have been answered (or cancelled), and its slot re-used, since the timeout was collected
+   if ((request->mId == 0) || (request->mTimeoutId != request->mId) || (entry->mNext != NULL)) {
+      pthread_mutex_unlock(&pool->mLock);
+      return;
+   }
+   uint32_t requestId = request->mId;
+   void* requestClosure = request->mClosure;
+   zmqInboxPoolGatherCB onGather = request->mOnGather;
+   mamaMsg* replies = request->mReplies;
+   size_t numReplies = request->mNumReplies;
+   zmqBridgeMamaInboxPoolImpl_free(pool, request);
+   ++pool->mTimeoutCount;
+   pthread_mutex_unlock(&pool->mLock);
+
+   MAMA_LOG(log_level_inbox, "Request %08x timed out on inbox pool %s", requestId, pool->mInbox.mReplyHandle);
+
+   if (onGather != NULL) {
+      // gather requests complete on timeout w/whatever replies have been received
+      onGather(pool, requestId, MAMA_STATUS_TIMEOUT, replies, numReplies, requestClosure, pool->mClosure);
+      zmqBridgeMamaInboxPoolImpl_destroyReplies(replies, numReplies);
+   }
+   else if (pool->mOnTimeout != NULL) {
+      pool->mOnTimeout(pool, requestId, requestClosure, pool->mClosure);
+   }
+}
+
+
+static void MAMACALLTYPE zmqBridgeMamaInboxPoolImpl_onTimer(mamaTimer timer, void* closure)
+{
+   zmqInboxPool pool = (zmqInboxPool) closure;
+   zmqBridgeMamaTimerWheel_advance(pool->mTimeouts);
+}
+
+
+mama_status zmqBridgeMamaInboxPool_create(zmqInboxPool* result, mamaTransport transport, mamaQueue queue,
+   zmqInboxPoolReplyCB onReply, zmqInboxPoolTimeoutCB onTimeout, void* closure)
+{
+   if ((result == NULL) || (transport == NULL) || (queue == NULL)) {
+      return MAMA_STATUS_NULL_ARG;
+   }
+
+   zmqInboxPool pool = (zmqInboxPool) calloc(1, sizeof(struct zmqInboxPool_));
+   if (pool == NULL) {
+      return MAMA_STATUS_NOMEM;
+   }
+
+   pthread_mutex_init(&pool->mLock, NULL);
+   pool->mOnReply = onReply;
+   pool->mOnTimeout = onTimeout;
+   pool->mClosure = closure;
+
+   zmqInboxImpl* inbox = &pool->mInbox;
+   inbox->mPool = pool;
+   inbox->mTransport = zmqBridgeMamaTransportImpl_getTransportBridge(transport);
+   inbox->mMamaQueue = queue;
+   mamaQueue_getNativeHandle(queue, &inbox->mZmqQueue);
+   if (inbox->mTransport->mLatency != NULL) {
+      zmqBridgeMamaQueue_enableLatency(inbox->mZmqQueue);
+   }
+   if (inbox->mTransport->mQueueMaxAge > 0) {
+      zmqBridgeMamaQueue_applyMaxAge(inbox->mZmqQueue, inbox->mTransport->mQueueMaxAge, inbox->mTransport->mQueueDropStale);
+   }
+
+   // generate (partial) reply address -- each request appends its id
+   const char* inboxSubject;
+   zmqBridgeMamaTransportImpl_getInboxSubject(inbox->mTransport, &inboxSubject);
+   char replyHandle[ZMQ_REPLYHANDLE_SIZE +1];
+   unsigned long long poolId = __sync_add_and_fetch(&inbox->mTransport->mInboxUid, 1);
+   snprintf(replyHandle, sizeof(replyHandle), "%s.%c%07llx", inboxSubject, ZMQ_INBOXPOOL_MARKER, poolId & 0xfffffff);
+   inbox->mReplyHandle = strdup(replyHandle);
+
+   mama_status status = zmqBridgeMamaTimerWheel_create(&pool->mTimeouts, ZMQ_INBOXPOOL_TIMER_TICK);
+   if (status == MAMA_STATUS_OK) {
+      status = mamaTimer_create(&pool->mTimer, queue, zmqBridgeMamaInboxPoolImpl_onTimer, ZMQ_INBOXPOOL_TIMER_INTERVAL, pool);
+   }
+   if (status == MAMA_STATUS_OK) {
+      status = zmqBridgeMamaTransportImpl_registerInbox(inbox->mTransport, inbox);
+   }
+   if (status != MAMA_STATUS_OK) {
+      if (pool->mTimer != NULL) {
+         mamaTimer_destroy(pool->mTimer);
+      }
+      zmqBridgeMamaTimerWheel_destroy(pool->mTimeouts);
+      free((void*) inbox->mReplyHandle);
+      pthread_mutex_destroy(&pool->mLock);
+      free(pool);
+      return status;
+   }
+
+   MAMA_LOG(log_level_inbox, "Created inbox pool replyAddr=%s", inbox->mReplyHandle);
+
+   *result = pool;
+   return MAMA_STATUS_OK;
+}
+
+
+mama_status zmqBridgeMamaInboxPool_destroy(zmqInboxPool pool)
+{
+   if (pool == NULL) {
+      return MAMA_STATUS_NULL_ARG;
+   }
+
+   MAMA_LOG(log_level_inbox, "Destroying inbox pool replyAddr=%s with %llu requests outstanding", pool->mInbox.mReplyHandle,
+      (unsigned long long) pool->mOutstanding);
+
+   // replies already queued are discarded by the transport once the pool is unregistered
+   mama_status status = zmqBridgeMamaTransportImpl_unregisterInbox(pool->mInbox.mTransport, &pool->mInbox);
+
+   mamaTimer_destroy(pool->mTimer);
+   zmqBridgeMamaTimerWheel_destroy(pool->mTimeouts);
+
+   for (uint32_t slot = 1; slot < pool->mNumSlots; ++slot) {
+      zmqInboxPoolRequest* request = zmqBridgeMamaInboxPoolImpl_getSlot(pool, slot);
+      if ((request->mId != 0) && (request->mReplies != NULL)) {
+         zmqBridgeMamaInboxPoolImpl_destroyReplies(request->mReplies, request->mNumReplies);
+      }
+   }
+   for (int i = 0; i < ZMQ_INBOXPOOL_MAX_CHUNKS; ++i) {
+      free(pool->mChunks[i]);
+   }
+   free((void*) pool->mInbox.mReplyHandle);
+   pthread_mutex_destroy(&pool->mLock);
+   free(pool);
+
+   return status;
+}
+
+
+static mama_status zmqBridgeMamaInboxPoolImpl_send(zmqInboxPool pool, const char* subject, mamaMsg msg, double timeout,
+   size_t maxReplies, zmqInboxPoolGatherCB onGather, void* requestClosure, uint32_t* requestId)
+{
+   mamaMsg* replies = NULL;
+   if (onGather != NULL) {
+      replies = (mamaMsg*) calloc(maxReplies, sizeof(mamaMsg));
+      if (replies == NULL) {
+         return MAMA_STATUS_NOMEM;
+      }
+   }
+
+   pthread_mutex_lock(&pool->mLock);
+   zmqInboxPoolRequest* request = zmqBridgeMamaInboxPoolImpl_alloc(pool);
+   if (request == NULL) {
+      pthread_mutex_unlock(&pool->mLock);
+      free(replies);
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Too many requests outstanding on inbox pool %s", pool->mInbox.mReplyHandle);
+      return MAMA_STATUS_NOMEM;
+   }
+   request->mClosure = requestClosure;
+   request->mOnGather = onGather;
+   request->mReplies = replies;
+   request->mMaxReplies = maxReplies;
+   uint32_t id = request->mId;
+   if (timeout > 0) {
+      request->mTimeoutId = id;
+      zmqBridgeMamaTimerWheel_add(pool->mTimeouts, &request->mTimeout, (uint64_t) (timeout * 1000000000.0), zmqBridgeMamaInboxPoolImpl_onTimeout, request);
+   }
+   pthread_mutex_unlock(&pool->mLock);
+
+   // allocate bridge msg on stack
+   zmqBridgeMsgImpl bridgeMsg;
+   CALL_MAMA_FUNC(zmqBridgeMamaMsgImpl_init(&bridgeMsg));
+   CALL_MAMA_FUNC(zmqBridgeMamaMsgImpl_setMsgType((msgBridge) &bridgeMsg, ZMQ_MSG_INBOX_REQUEST));
+   snprintf(bridgeMsg.mReplyHandle, sizeof(bridgeMsg.mReplyHandle), "%s%08x", pool->mInbox.mReplyHandle, id);
+   zmqBridgeMamaMsg_setSendSubject((msgBridge) &bridgeMsg, subject, NULL);
+
+   MAMA_LOG(log_level_inbox, "Send request on %s from inbox pool %s", subject, bridgeMsg.mReplyHandle);
+
+   if (requestId != NULL) {
+      *requestId = id;
+   }
+
+   mama_status status = zmqBridgeMamaPublisherImpl_sendMsg(pool->mInbox.mTransport, (msgBridge) &bridgeMsg, msg);
+   if (status != MAMA_STATUS_OK) {
+      // no reply is coming
+      zmqBridgeMamaInboxPool_cancel(pool, id);
+   }
+
+   return status;
+}
+
+
+mama_status zmqBridgeMamaInboxPool_sendRequest(zmqInboxPool pool, const char* subject, mamaMsg msg, double timeout,
+   void* requestClosure, uint32_t* requestId)
+{
+   if ((pool == NULL) || (subject == NULL) || (msg == NULL)) {
+      return MAMA_STATUS_NULL_ARG;
+   }
+
+   return zmqBridgeMamaInboxPoolImpl_send(pool, subject, msg, timeout, 1, NULL, requestClosure, requestId);
+}
+
+
+mama_status zmqBridgeMamaInboxPool_sendGather(zmqInboxPool pool, const char* subject, mamaMsg msg, double timeout,
+   size_t maxReplies, zmqInboxPoolGatherCB onComplete, void* requestClosure, uint32_t* requestId)
+{
+   if ((pool == NULL) || (subject == NULL) || (msg == NULL) || (onComplete == NULL)) {
+      return MAMA_STATUS_NULL_ARG;
+   }
+   // w/o a timeout, a request that doesn't get all its replies would never complete
+   if (timeout <= 0) {
+      return MAMA_STATUS_INVALID_ARG;
+   }
+
+   if (maxReplies == ZMQ_INBOXPOOL_ALL_PEERS) {
+      // NOTE: includes this transport, which may well reply to its own requests
+      maxReplies = wInterlocked_read(&pool->mInbox.mTransport->mNumPeers);
+      if (maxReplies == 0) {
+         MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "No peers known to transport for gather request on %s", subject);
+         return MAMA_STATUS_INVALID_ARG;
+      }
+   }
+
+   return zmqBridgeMamaInboxPoolImpl_send(pool, subject, msg, timeout, maxReplies, onComplete, requestClosure, requestId);
+}
+
+
+mama_status zmqBridgeMamaInboxPool_cancel(zmqInboxPool pool, uint32_t requestId)
+{
+   if (pool == NULL) {
+      return MAMA_STATUS_NULL_ARG;
+   }
+
+   pthread_mutex_lock(&pool->mLock);
+   zmqInboxPoolRequest* request = zmqBridgeMamaInboxPoolImpl_find(pool, requestId);
+   if (request == NULL) {
+      pthread_mutex_unlock(&pool->mLock);
+      return MAMA_STATUS_NOT_FOUND;
+   }
+   mamaMsg* replies = request->mReplies;
+   size_t numReplies = request->mNumReplies;
+   zmqBridgeMamaInboxPoolImpl_free(pool, request);
+   pthread_mutex_unlock(&pool->mLock);
+
+   if (replies != NULL) {
+      zmqBridgeMamaInboxPoolImpl_destroyReplies(replies, numReplies);
+   }
+
+   return MAMA_STATUS_OK;
+}
+
+
+mama_status zmqBridgeMamaInboxPool_getStats(zmqInboxPool pool, uint64_t* outstanding, uint64_t* replies, uint64_t* timeouts, uint64_t* lateReplies)
+{
+   if ((pool == NULL) || (outstanding == NULL) || (replies == NULL) || (timeouts == NULL) || (lateReplies == NULL)) {
+      return MAMA_STATUS_NULL_ARG;
+   }
+
+   pthread_mutex_lock(&pool->mLock);
+   *outstanding = pool->mOutstanding;
+   *replies = pool->mReplies;
+   *timeouts = pool->mTimeoutCount;
+   *lateReplies = pool->mLateReplies;
+   pthread_mutex_unlock(&pool->mLock);
+
+   return MAMA_STATUS_OK;
+}
+
+
+void zmqBridgeMamaInboxPoolImpl_onMsg(zmqInboxPool pool, mamaMsg msg, const char* requestId)
+{
+   char* end = NULL;
+   uint32_t id = (uint32_t) strtoul(requestId, &end, 16);
+   if ((end == requestId) || (*end != '\0')) {
+      MAMA_LOG(MAMA_LOG_LEVEL_SEVERE, "Discarding msg w/invalid request id (%s) for inbox pool %s", requestId, pool->mInbox.mReplyHandle);
+      return;
+   }
+
+   pthread_mutex_lock(&pool->mLock);
+   zmqInboxPoolRequest* request = zmqBridgeMamaInboxPoolImpl_find(pool, id);
+   if (request == NULL) {
+      // already answered, timed out or cancelled
+      ++pool->mLateReplies;
+      pthread_mutex_unlock(&pool->mLock);
+      MAMA_LOG(log_level_inbox, "Discarding reply for request %08x which is no longer outstanding on inbox pool %s", id, pool->mInbox.mReplyHandle);
+      return;
+   }
+   ++pool->mReplies;
+
+   if (request->mOnGather != NULL) {
+      // msg is only valid for the duration of this call, so keep a copy
+      mamaMsg copy = NULL;
+      if (mamaMsg_copy(msg, &copy) != MAMA_STATUS_OK) {
+         pthread_mutex_unlock(&pool->mLock);
+         MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Unable to copy reply for request %08x on inbox pool %s", id, pool->mInbox.mReplyHandle);
+         return;
+      }
+      request->mReplies[request->mNumReplies++] = copy;
+      if (request->mNumReplies < request->mMaxReplies) {
+         pthread_mutex_unlock(&pool->mLock);
+         return;
+      }
+
+      // got all expected replies
+      zmqInboxPoolGatherCB onGather = request->mOnGather;
+      void* requestClosure = request->mClosure;
+      mamaMsg* replies = request->mReplies;
+      size_t numReplies = request->mNumReplies;
+      zmqBridgeMamaInboxPoolImpl_free(pool, request);
+      pthread_mutex_unlock(&pool->mLock);
+
+      onGather(pool, id, MAMA_STATUS_OK, replies, numReplies, requestClosure, pool->mClosure);
+      zmqBridgeMamaInboxPoolImpl_destroyReplies(replies, numReplies);
+      return;
+   }
+
+   void* requestClosure = request->mClosure;
+   zmqBridgeMamaInboxPoolImpl_free(pool, request);
+   pthread_mutex_unlock(&pool->mLock);
+
+   if (pool->mOnReply != NULL) {
+      pool->mOnReply(pool, msg, id, requestClosure, pool->mClosure);
+   }
+}
@@ -0,0 +1,77 @@
+//
+// inbox pools -- request/reply w/o creating an inbox per request
+//
+// A pool is a single long-lived inbox, registered w/the transport once, that can have many requests outstanding.
+// Each request is sent w/a reply handle that identifies both the pool and the request (see zmqdefs.h), so
+// replies are routed to the pool, and matched to their request w/o any allocation or table updates.
+// Requests that are not answered within their timeout are reported to the pool's timeout callback.
+//
+// Gather requests (zmqBridgeMamaInboxPool_sendGather) collect multiple replies, e.g., from several responders,
+// and complete when the expected number of replies has been received, or on timeout, whichever comes first.
+// Either way, all replies received are passed to the request's completion callback in a single batch.
+//
+// All callbacks are called on the pool's queue.  Requests can be sent (and cancelled) from any thread, but the
+// pool must be destroyed on its queue's thread.
+//
+
+#ifndef MAMA_BRIDGE_ZMQ_INBOXPOOL_H__
+#define MAMA_BRIDGE_ZMQ_INBOXPOOL_H__
+
+#include <stdint.h>
+#include <mama/mama.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+typedef struct zmqInboxPool_* zmqInboxPool;
+
+// called for the reply to a request -- the request is complete, and requestId may be re-used after this returns
+typedef void (MAMACALLTYPE *zmqInboxPoolReplyCB)(zmqInboxPool pool, mamaMsg reply, uint32_t requestId, void* requestClosure, void* closure);
+// called when a request times out w/o a reply
+typedef void (MAMACALLTYPE *zmqInboxPoolTimeoutCB)(zmqInboxPool pool, uint32_t requestId, void* requestClosure, void* closure);
+// called when a gather request completes -- status is MAMA_STATUS_OK if all expected replies were received, or
+// MAMA_STATUS_TIMEOUT if not (in which case numReplies may be zero)
+// NOTE: replies are owned by the pool, and are destroyed when the callback returns
+typedef void (MAMACALLTYPE *zmqInboxPoolGatherCB)(zmqInboxPool pool, uint32_t requestId, mama_status status,
+   mamaMsg* replies, size_t numReplies, void* requestClosure, void* closure);
+
+// for sendGather -- expect a reply from each peer currently known to the transport
+#define ZMQ_INBOXPOOL_ALL_PEERS     0
+
+// onReply (and onTimeout) may be NULL if the pool is only used for gather requests
+MAMAExpDLL
+mama_status zmqBridgeMamaInboxPool_create(zmqInboxPool* pool, mamaTransport transport, mamaQueue queue,
+   zmqInboxPoolReplyCB onReply, zmqInboxPoolTimeoutCB onTimeout, void* closure);
+// any outstanding requests are discarded (w/o calling the timeout callback)
+MAMAExpDLL
+mama_status zmqBridgeMamaInboxPool_destroy(zmqInboxPool pool);
+
+// sends msg on subject as a request, w/a reply address that routes to the pool
+// timeout is in seconds (zero => no timeout), and requestId (which may be NULL) identifies the request in callbacks
+MAMAExpDLL
+mama_status zmqBridgeMamaInboxPool_sendRequest(zmqInboxPool pool, const char* subject, mamaMsg msg, double timeout,
+   void* requestClosure, uint32_t* requestId);
+
+// sends msg on subject as a request that completes after maxReplies replies (or ZMQ_INBOXPOOL_ALL_PEERS), or
+// on timeout (in seconds, must be non-zero), at which point onComplete is called w/the replies received
+MAMAExpDLL
+mama_status zmqBridgeMamaInboxPool_sendGather(zmqInboxPool pool, const char* subject, mamaMsg msg, double timeout,
+   size_t maxReplies, zmqInboxPoolGatherCB onComplete, void* requestClosure, uint32_t* requestId);
+
+// stops waiting for a reply -- no further callbacks will be made for the request
+MAMAExpDLL
+mama_status zmqBridgeMamaInboxPool_cancel(zmqInboxPool pool, uint32_t requestId);
+
+// outstanding is a snapshot, the others are totals since the pool was created
+MAMAExpDLL
+mama_status zmqBridgeMamaInboxPool_getStats(zmqInboxPool pool, uint64_t* outstanding, uint64_t* replies, uint64_t* timeouts, uint64_t* lateReplies);
+
+// called by the transport (on the pool's queue) w/replies -- requestId is the last part of the reply handle
+void zmqBridgeMamaInboxPoolImpl_onMsg(zmqInboxPool pool, mamaMsg msg, const char* requestId);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* MAMA_BRIDGE_ZMQ_INBOXPOOL_H__ */
@@ -0,0 +1,211 @@
+//
+// interest-based connections -- see interest.h
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <mama/mama.h>
+#include <wombat/wtable.h>
+
+#include "zmqdefs.h"
+#include "transport.h"
+#include "interest.h"
+
+typedef struct zmqInterestClosure {
+   zmqTransportBridge*     mTransport;
+   const char*             mTopic;
+   int                     mFound;
+   zmqNamingMsg**          mPeers;              // peers to (dis)connect
+   size_t                  mNumPeers;
+} zmqInterestClosure;
+
+
+// does topic intersect any of the (comma-separated) prefixes?
+static int zmqBridgeMamaInterestImpl_matches(const char* topic, const char* prefixes)
+{
+   size_t topicLen = strlen(topic);
+   const char* prefix = prefixes;
+   while (*prefix != '\0') {
+      size_t prefixLen = strcspn(prefix, ",");
+      // either can be a prefix of the other
+      size_t len = (prefixLen < topicLen) ? prefixLen : topicLen;
+      if (strncmp(topic, prefix, len) == 0) {
+         return 1;
+      }
+      prefix += prefixLen;
+      if (*prefix == ',') {
+         ++prefix;
+      }
+   }
+   return 0;
+}
+
+
+static void zmqBridgeMamaInterestImpl_matchInterest(wtable_t table, void* data, const char* key, void* closure)
+{
+   zmqInterestClosure* interest = (zmqInterestClosure*) closure;
+   if ((interest->mFound == 0) && zmqBridgeMamaInterestImpl_matches(key, interest->mTopic)) {
+      interest->mFound = 1;
+   }
+}
+
+
+int zmqBridgeMamaInterest_isInteresting(zmqTransportBridge* impl, const zmqNamingMsg* peer)
+{
+   // peers that dont advertise prefixes (e.g., older peers) may publish anything
+   if ((impl->mInterestConnect == 0) || (peer->mPrefixes[0] == '\0')) {
+      return 1;
+   }
+
+   zmqInterestClosure interest;
+   memset(&interest, '\0', sizeof(interest));
+   interest.mTopic = peer->mPrefixes;
+   wtable_for_each(impl->mInterests, zmqBridgeMamaInterestImpl_matchInterest, &interest);
+   return interest.mFound;
+}
+
+
+void zmqBridgeMamaInterest_addUnconnected(zmqTransportBridge* impl, zmqNamingMsg* peer)
+{
+   wtable_insert(impl->mUnconnectedPeers, peer->mUuid, peer);
+}
+
+
+int zmqBridgeMamaInterest_removeUnconnected(zmqTransportBridge* impl, const char* uuid)
+{
+   if (impl->mUnconnectedPeers == NULL) {
+      return 0;
+   }
+   return (wtable_remove(impl->mUnconnectedPeers, uuid) != NULL) ? 1 : 0;
+}
+
+
+static void zmqBridgeMamaInterestImpl_collectPeer(zmqInterestClosure* interest, zmqNamingMsg* peer)
+{
+   zmqNamingMsg** peers = realloc(interest->mPeers, (interest->mNumPeers + 1) * sizeof(zmqNamingMsg*));
+   if (peers != NULL) {
+      interest->mPeers = peers;
+      interest->mPeers[interest->mNumPeers++] = peer;
+   }
+}
+
+
+static void zmqBridgeMamaInterestImpl_findConnectable(wtable_t table, void* data, const char* key, void* closure)
+{
+   zmqInterestClosure* interest = (zmqInterestClosure*) closure;
+   zmqNamingMsg* peer = (zmqNamingMsg*) data;
+   if (zmqBridgeMamaInterestImpl_matches(interest->mTopic, peer->mPrefixes)) {
+      zmqBridgeMamaInterestImpl_collectPeer(interest, peer);
+   }
+}
+
+
+void zmqBridgeMamaInterest_onSubscribe(zmqTransportBridge* impl, const char* topic)
+{
+   if (impl->mInterestConnect == 0) {
+      return;
+   }
+
+   // interests are reference-counted, like zmq subscriptions
+   uintptr_t count = (uintptr_t) wtable_remove(impl->mInterests, topic);
+   wtable_insert(impl->mInterests, topic, (void*) (count + 1));
+   if (count > 0) {
+      return;
+   }
+
+   // connect to peers that have become interesting
+   // (collect them first, since connecting removes them from the table)
+   zmqInterestClosure interest;
+   memset(&interest, '\0', sizeof(interest));
+   interest.mTransport = impl;
+   interest.mTopic = topic;
+   wtable_for_each(impl->mUnconnectedPeers, zmqBridgeMamaInterestImpl_findConnectable, &interest);
+   for (size_t i = 0; i < interest.mNumPeers; ++i) {
+      zmqNamingMsg* peer = interest.mPeers[i];
+      const char* endpoint = NULL;
+      if (zmqBridgeMamaTransportImpl_connectPeer(impl, peer, &endpoint) == MAMA_STATUS_OK) {
+         wtable_remove(impl->mUnconnectedPeers, peer->mUuid);
+         MAMA_LOG(log_level_naming, "Connecting to publisher at endpoint:%s (subscribed to %s)", endpoint, topic);
+      }
+   }
+   free(interest.mPeers);
+}
+
+
+static void zmqBridgeMamaInterestImpl_findDisconnectable(wtable_t table, void* data, const char* key, void* closure)
+{
+   zmqInterestClosure* interest = (zmqInterestClosure*) closure;
+   zmqNamingMsg* peer = (zmqNamingMsg*) data;
+   // only peers that advertised a prefix that matched the topic can have become uninteresting
+   if ((peer->mPrefixes[0] != '\0')
+      && (wtable_lookup(interest->mTransport->mUnconnectedPeers, peer->mUuid) == NULL)
+      && zmqBridgeMamaInterestImpl_matches(interest->mTopic, peer->mPrefixes)
+      && (zmqBridgeMamaInterest_isInteresting(interest->mTransport, peer) == 0)) {
+      zmqBridgeMamaInterestImpl_collectPeer(interest, peer);
+   }
+}
+
+
+void zmqBridgeMamaInterest_onUnsubscribe(zmqTransportBridge* impl, const char* topic)
+{
+   if (impl->mInterestConnect == 0) {
+      return;
+   }
+
+   uintptr_t count = (uintptr_t) wtable_remove(impl->mInterests, topic);
+   if (count > 1) {
+      wtable_insert(impl->mInterests, topic, (void*) (count - 1));
+      return;
+   }
+
+   // disconnect from peers that are no longer interesting
+   zmqInterestClosure interest;
+   memset(&interest, '\0', sizeof(interest));
+   interest.mTransport = impl;
+   interest.mTopic = topic;
+   wtable_for_each(impl->mPeers, zmqBridgeMamaInterestImpl_findDisconnectable, &interest);
+   for (size_t i = 0; i < interest.mNumPeers; ++i) {
+      zmqNamingMsg* peer = interest.mPeers[i];
+      if (((zmqPeer*) peer)->mPending) {
+         // not connected yet (see naming.connect_rate)
+         ((zmqPeer*) peer)->mPending = 0;
+      }
+      else {
+         zmqBridgeMamaTransportImpl_disconnectPeer(impl, peer);
+      }
+      zmqBridgeMamaInterest_addUnconnected(impl, peer);
+      MAMA_LOG(log_level_naming, "Disconnected from publisher uuid=%s (unsubscribed from %s)", peer->mUuid, topic);
+   }
+   free(interest.mPeers);
+}
+
+
+mama_status zmqBridgeMamaInterest_create(zmqTransportBridge* impl)
+{
+   if (impl->mInterestConnect == 0) {
+      return MAMA_STATUS_OK;
+   }
+
+   impl->mInterests = wtable_create("interests", TOPIC_TABLE_SIZE);
+   impl->mUnconnectedPeers = wtable_create("unconnectedPeers", PEER_TABLE_SIZE);
+   if ((impl->mInterests == NULL) || (impl->mUnconnectedPeers == NULL)) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Failed to create interest tables");
+      return MAMA_STATUS_NOMEM;
+   }
+
+   return MAMA_STATUS_OK;
+}
+
+
+void zmqBridgeMamaInterest_destroy(zmqTransportBridge* impl)
+{
+   // peers are owned by mPeers, and counts are not allocated
+   if (impl->mInterests != NULL) {
+      wtable_destroy(impl->mInterests);
+   }
+   if (impl->mUnconnectedPeers != NULL) {
+      wtable_destroy(impl->mUnconnectedPeers);
+   }
+}
@@ -0,0 +1,44 @@
+//
+// interest-based connections -- connect only to peers that publish topics we subscribe to
+//
+// Transports w/naming.publish_prefixes set advertise those topic prefixes in their naming msgs.  Transports
+// w/naming.interest_connect enabled only connect their data socket to peers that advertise at least one prefix
+// that intersects one of their subscriptions (i.e., one is a prefix of the other) -- or that advertise no
+// prefixes at all.  As subscriptions are added and removed, peers are connected and disconnected accordingly.
+//
+// All of the following must only be called on the dispatch thread.
+//
+
+#ifndef MAMA_BRIDGE_ZMQ_INTEREST_H__
+#define MAMA_BRIDGE_ZMQ_INTEREST_H__
+
+#include <mama/mama.h>
+
+#include "zmqdefs.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+// create/destroy the interest tables for a transport (no-op unless interest_connect is enabled)
+mama_status zmqBridgeMamaInterest_create(zmqTransportBridge* impl);
+void zmqBridgeMamaInterest_destroy(zmqTransportBridge* impl);
+
+// should we connect to this peer?
+int zmqBridgeMamaInterest_isInteresting(zmqTransportBridge* impl, const zmqNamingMsg* peer);
+
+// records a peer that we're not connected to (because it's not interesting)
+void zmqBridgeMamaInterest_addUnconnected(zmqTransportBridge* impl, zmqNamingMsg* peer);
+// forgets peer -- returns non-zero if we were not connected to it
+int zmqBridgeMamaInterest_removeUnconnected(zmqTransportBridge* impl, const char* uuid);
+
+// called when topic is subscribed/unsubscribed -- connects to newly interesting peers, and disconnects from
+// peers that are no longer interesting
+void zmqBridgeMamaInterest_onSubscribe(zmqTransportBridge* impl, const char* topic);
+void zmqBridgeMamaInterest_onUnsubscribe(zmqTransportBridge* impl, const char* topic);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* MAMA_BRIDGE_ZMQ_INTEREST_H__ */
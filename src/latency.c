@@ -0,0 +1,213 @@
+//
+// latency stats -- per-stage latency histograms for msgs received by a transport
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <mama/mama.h>
+#include <mama/integration/transport.h>
+#include <mama/integration/queue.h>
+#include <wombat/port.h>
+
+#include "latency.h"
+#include "zmqdefs.h"
+#include "util.h"
+
+// each thread caches the shards it records to, keyed by the stats' id -- ids are never reused, so entries for
+// stats that have been destroyed are simply never matched again
+#define ZMQ_LATENCY_SHARD_CACHE  8
+
+typedef struct zmqLatencyShardCache {
+   uint64_t                mId;
+   zmqLatencyShard*        mShard;
+} zmqLatencyShardCache;
+
+static __thread zmqLatencyShardCache tShards[ZMQ_LATENCY_SHARD_CACHE];
+static uint64_t gNextId = 0;
+
+
+zmqLatencyStats* zmqBridgeMamaLatency_create(void)
+{
+   zmqLatencyStats* stats = malloc(sizeof(zmqLatencyStats));
+   if (stats == NULL) {
+      return NULL;
+   }
+
+   wthread_mutex_init(&stats->mLock, NULL);
+   stats->mId = __atomic_add_fetch(&gNextId, 1, __ATOMIC_RELAXED);
+   stats->mShards = NULL;
+
+   return stats;
+}
+
+
+void zmqBridgeMamaLatency_destroy(zmqLatencyStats* stats)
+{
+   if (stats == NULL) {
+      return;
+   }
+
+   zmqLatencyShard* shard = stats->mShards;
+   while (shard != NULL) {
+      zmqLatencyShard* next = shard->mNext;
+      wthread_mutex_destroy(&shard->mLock);
+      free(shard);
+      shard = next;
+   }
+   wthread_mutex_destroy(&stats->mLock);
+   free(stats);
+}
+
+
+// returns the calling thread's shard, creating it if necessary (or NULL if out of memory)
+static zmqLatencyShard* zmqBridgeMamaLatencyImpl_getShard(zmqLatencyStats* stats)
+{
+   zmqLatencyShardCache* cached = &tShards[stats->mId % ZMQ_LATENCY_SHARD_CACHE];
+   if (cached->mId == stats->mId) {
+      return cached->mShard;
+   }
+
+   // not cached (or evicted) -- a thread only ever has one shard per stats
+   pthread_t self = pthread_self();
+   wthread_mutex_lock(&stats->mLock);
+   zmqLatencyShard* shard = stats->mShards;
+   while ((shard != NULL) && (!pthread_equal(shard->mOwner, self))) {
+      shard = shard->mNext;
+   }
+   if (shard == NULL) {
+      shard = malloc(sizeof(zmqLatencyShard));
+      if (shard != NULL) {
+         shard->mOwner = self;
+         wthread_mutex_init(&shard->mLock, NULL);
+         for (int i = 0; i < ZMQ_LATENCY_STAGES; ++i) {
+            zmqBridgeMamaHistogram_init(&shard->mStages[i]);
+         }
+         shard->mNext = stats->mShards;
+         stats->mShards = shard;
+      }
+   }
+   wthread_mutex_unlock(&stats->mLock);
+
+   if (shard != NULL) {
+      cached->mId = stats->mId;
+      cached->mShard = shard;
+   }
+   return shard;
+}
+
+
+void zmqBridgeMamaLatency_record(zmqLatencyStats* stats, zmqLatencyStage stage, uint64_t value)
+{
+   zmqLatencyShard* shard = zmqBridgeMamaLatencyImpl_getShard(stats);
+   if (shard == NULL) {
+      return;
+   }
+
+   wthread_mutex_lock(&shard->mLock);
+   zmqBridgeMamaHistogram_record(&shard->mStages[stage], value);
+   wthread_mutex_unlock(&shard->mLock);
+}
+
+
+void zmqBridgeMamaLatency_recordDispatch(zmqLatencyStats* stats, uint64_t enqueueTime, uint64_t dequeueTime,
+   uint64_t callbackTime, uint64_t doneTime)
+{
+   zmqLatencyShard* shard = zmqBridgeMamaLatencyImpl_getShard(stats);
+   if (shard == NULL) {
+      return;
+   }
+
+   wthread_mutex_lock(&shard->mLock);
+   zmqBridgeMamaHistogram_record(&shard->mStages[ZMQ_LATENCY_QUEUE], dequeueTime - enqueueTime);
+   zmqBridgeMamaHistogram_record(&shard->mStages[ZMQ_LATENCY_DISPATCH], callbackTime - dequeueTime);
+   zmqBridgeMamaHistogram_record(&shard->mStages[ZMQ_LATENCY_CALLBACK], doneTime - callbackTime);
+   wthread_mutex_unlock(&shard->mLock);
+}
+
+
+void zmqBridgeMamaLatency_snapshot(zmqLatencyStats* stats, zmqLatencyStage stage, zmqHistogram* result, int reset)
+{
+   zmqBridgeMamaHistogram_init(result);
+
+   wthread_mutex_lock(&stats->mLock);
+   for (zmqLatencyShard* shard = stats->mShards; shard != NULL; shard = shard->mNext) {
+      wthread_mutex_lock(&shard->mLock);
+      zmqBridgeMamaHistogram_merge(result, &shard->mStages[stage]);
+      if (reset) {
+         zmqBridgeMamaHistogram_init(&shard->mStages[stage]);
+      }
+      wthread_mutex_unlock(&shard->mLock);
+   }
+   wthread_mutex_unlock(&stats->mLock);
+}
+
+
+void zmqBridgeMamaLatency_log(zmqLatencyStats* stats, const char* name)
+{
+   if (stats == NULL) {
+      return;
+   }
+
+   // histograms are too big for the stack
+   zmqHistogram* hist = malloc(sizeof(zmqHistogram));
+   if (hist == NULL) {
+      return;
+   }
+   char buf[512];
+   for (int i = 0; i < ZMQ_LATENCY_STAGES; ++i) {
+      zmqBridgeMamaLatency_snapshot(stats, (zmqLatencyStage) i, hist, 0);
+      if (hist->mCount > 0) {
+         MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Latency %s %s: %s", name, zmqBridgeMamaLatency_stageName((zmqLatencyStage) i),
+            zmqBridgeMamaHistogram_format(hist, buf, sizeof(buf)));
+      }
+   }
+   free(hist);
+}
+
+
+const char* zmqBridgeMamaLatency_stageName(zmqLatencyStage stage)
+{
+   switch (stage) {
+      case ZMQ_LATENCY_RECEIVE:     return "receive";
+      case ZMQ_LATENCY_QUEUE:       return "queue";
+      case ZMQ_LATENCY_DISPATCH:    return "dispatch";
+      case ZMQ_LATENCY_CALLBACK:    return "callback";
+      default:                      return "unknown";
+   }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+mama_status zmqBridgeMamaTransport_getLatency(mamaTransport transport, zmqLatencyStage stage, zmqHistogram* result, int reset)
+{
+   if ((transport == NULL) || (result == NULL) || (stage < 0) || (stage >= ZMQ_LATENCY_STAGES)) {
+      return MAMA_STATUS_NULL_ARG;
+   }
+
+   zmqTransportBridge* impl = NULL;
+   CALL_MAMA_FUNC(mamaTransport_getBridgeTransport(transport, (transportBridge*) &impl));
+   if ((impl == NULL) || (impl->mLatency == NULL)) {
+      return MAMA_STATUS_NOT_FOUND;
+   }
+
+   zmqBridgeMamaLatency_snapshot(impl->mLatency, stage, result, reset);
+   return MAMA_STATUS_OK;
+}
+
+
+mama_status zmqBridgeMamaQueue_getLatency(mamaQueue queue, zmqLatencyStage stage, zmqHistogram* result, int reset)
+{
+   if ((queue == NULL) || (result == NULL) || (stage < 0) || (stage >= ZMQ_LATENCY_STAGES)) {
+      return MAMA_STATUS_NULL_ARG;
+   }
+
+   zmqQueueBridge* impl = NULL;
+   CALL_MAMA_FUNC(mamaQueue_getNativeHandle(queue, (void**) &impl));
+   if ((impl == NULL) || (impl->mLatency == NULL)) {
+      return MAMA_STATUS_NOT_FOUND;
+   }
+
+   zmqBridgeMamaLatency_snapshot(impl->mLatency, stage, result, reset);
+   return MAMA_STATUS_OK;
+}
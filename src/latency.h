@@ -0,0 +1,75 @@
+//
+// latency stats -- per-stage latency histograms for msgs received by a transport
+//
+// When enabled (w/the latency_stats transport param), each msg is stamped w/the time it was received from
+// zmq (or a shm ring) and the time it was enqueued, and these are carried in the queue item.  Histograms
+// are kept for each stage, both for the transport and for each queue that msgs are dispatched from.
+//
+// Each thread that records values has its own set of histograms (a "shard"), so that the dispatch thread and
+// the queues' threads don't contend w/each other -- the shards are merged when a snapshot is taken.
+//
+
+#ifndef MAMA_BRIDGE_ZMQ_LATENCY_H__
+#define MAMA_BRIDGE_ZMQ_LATENCY_H__
+
+#include <pthread.h>
+#include <mama/mama.h>
+#include <wombat/port.h>
+#include "histogram.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+typedef enum zmqLatencyStage {
+   ZMQ_LATENCY_RECEIVE = 0,         // from zmq_msg_recv to enqueue (dispatch thread)
+   ZMQ_LATENCY_QUEUE,               // from enqueue to dequeue (queue residency)
+   ZMQ_LATENCY_DISPATCH,            // from dequeue to calling the user callback (lookup, deserialize etc.)
+   ZMQ_LATENCY_CALLBACK,            // time spent in the user callback
+   ZMQ_LATENCY_STAGES
+} zmqLatencyStage;
+
+typedef struct zmqLatencyShard_ {
+   struct zmqLatencyShard_*   mNext;
+   pthread_t                  mOwner;
+   wthread_mutex_t            mLock;            // only contended when a snapshot is taken
+   zmqHistogram               mStages[ZMQ_LATENCY_STAGES];
+} zmqLatencyShard;
+
+typedef struct zmqLatencyStats_ {
+   wthread_mutex_t         mLock;               // protects mShards
+   uint64_t                mId;                 // unique for the life of the process (see getShard)
+   zmqLatencyShard*        mShards;
+} zmqLatencyStats;
+
+zmqLatencyStats* zmqBridgeMamaLatency_create(void);
+void zmqBridgeMamaLatency_destroy(zmqLatencyStats* stats);
+
+void zmqBridgeMamaLatency_record(zmqLatencyStats* stats, zmqLatencyStage stage, uint64_t value);
+
+// records the queue, dispatch and callback stages of a msg in one go (all times in nanos, per getNanos)
+void zmqBridgeMamaLatency_recordDispatch(zmqLatencyStats* stats, uint64_t enqueueTime, uint64_t dequeueTime,
+   uint64_t callbackTime, uint64_t doneTime);
+
+// copies the histogram for stage into result, optionally resetting it
+void zmqBridgeMamaLatency_snapshot(zmqLatencyStats* stats, zmqLatencyStage stage, zmqHistogram* result, int reset);
+
+// logs a summary of each stage that has recorded any values
+void zmqBridgeMamaLatency_log(zmqLatencyStats* stats, const char* name);
+
+const char* zmqBridgeMamaLatency_stageName(zmqLatencyStage stage);
+
+///////////////////////////////////////////////////////////////////////////////
+// for applications -- return MAMA_STATUS_NOT_FOUND if latency stats are not enabled for the transport/queue
+
+MAMAExpDLL
+mama_status zmqBridgeMamaTransport_getLatency(mamaTransport transport, zmqLatencyStage stage, zmqHistogram* result, int reset);
+
+MAMAExpDLL
+mama_status zmqBridgeMamaQueue_getLatency(mamaQueue queue, zmqLatencyStage stage, zmqHistogram* result, int reset);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* MAMA_BRIDGE_ZMQ_LATENCY_H__ */
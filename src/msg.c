@@ -41,6 +41,7 @@
 #include "msg.h"
 #include "zmqbridgefunctions.h"
 #include "zmqdefs.h"
+#include "topicids.h"
 
 
 /*=========================================================================
@@ -303,10 +304,14 @@ mama_status zmqBridgeMamaMsgImpl_serialize(msgBridge msg, mamaMsg source, zmq_ms
    CALL_MAMA_FUNC(mamaMsg_getByteBuffer(source, &payloadBuffer, &payloadSize));
 
    // get size of buffer needed
-   size_t serializedSize = (strlen(impl->mSendSubject) + 1) + sizeof(impl->mMsgType) + payloadSize;
+   size_t subjectSize = (impl->mIsCompact == 1) ? ZMQ_TOPICID_PREFIX_SIZE : strlen(impl->mSendSubject) + 1;
+   size_t serializedSize = subjectSize + sizeof(impl->mMsgType) + payloadSize;
    if (impl->mMsgType== ZMQ_MSG_INBOX_REQUEST) {
       serializedSize += strlen(impl->mReplyHandle);
    }
+   else if (impl->mMsgType == ZMQ_MSG_PUB_SUB_TOPICID) {
+      serializedSize += ZMQ_TOPICID_PREFIX_SIZE -1;
+   }
    serializedSize++;    // trailing null for reply handle (even if not present)
 
    int rc =zmq_msg_init_size(zmsg, serializedSize);
@@ -318,10 +323,14 @@ mama_status zmqBridgeMamaMsgImpl_serialize(msgBridge msg, mamaMsg source, zmq_ms
    // Ok great - we have a buffer now of appropriate size, let's populate it
    uint8_t* bufferPos = (uint8_t*)zmq_msg_data(zmsg);
 
-   // Copy across the subject
-   size_t msgSubjectByteCount = strlen(impl->mSendSubject) + 1;
-   memcpy(bufferPos, impl->mSendSubject, msgSubjectByteCount);
-   bufferPos += msgSubjectByteCount;
+   // Copy across the subject (or topic id)
+   if (impl->mIsCompact == 1) {
+      zmqBridgeMamaTopicIds_encodePrefix(bufferPos, impl->mTopicTag, impl->mTopicId);
+   }
+   else {
+      memcpy(bufferPos, impl->mSendSubject, subjectSize);
+   }
+   bufferPos += subjectSize;
 
    // Copy across the message type
    memcpy(bufferPos, &impl->mMsgType, sizeof(impl->mMsgType));
@@ -333,6 +342,13 @@ mama_status zmqBridgeMamaMsgImpl_serialize(msgBridge msg, mamaMsg source, zmq_ms
       memcpy(bufferPos, impl->mReplyHandle, msgInboxByteCount);
       bufferPos += msgInboxByteCount;
    }
+   // copy topic id announcement (tag + id, as in compact prefix but w/o the marker)
+   else if (impl->mMsgType == ZMQ_MSG_PUB_SUB_TOPICID) {
+      uint8_t prefix[ZMQ_TOPICID_PREFIX_SIZE];
+      zmqBridgeMamaTopicIds_encodePrefix(prefix, impl->mTopicTag, impl->mTopicId);
+      memcpy(bufferPos, &prefix[1], ZMQ_TOPICID_PREFIX_SIZE -1);
+      bufferPos += ZMQ_TOPICID_PREFIX_SIZE -1;
+   }
    *bufferPos = '\0';   // trailing null for reply handle (even if not present)
    bufferPos++;
 
@@ -354,15 +370,25 @@ mama_status zmqBridgeMamaMsgImpl_deserialize(msgBridge msg, zmq_msg_t *zmsg, mam
    mama_size_t size = zmq_msg_size(zmsg);
    uint8_t* bufferPos = (uint8_t*)source;
 
-   // Skip past the subject - don't care about that here
-   bufferPos += strlen((char*)source) + 1;
+   // Skip past the subject (or topic id) - don't care about that here
+   if (*bufferPos == ZMQ_TOPICID_MARKER) {
+      bufferPos += ZMQ_TOPICID_PREFIX_SIZE;
+   }
+   else {
+      bufferPos += strlen((char*)source) + 1;
+   }
 
    // Set the message type
    memcpy(&impl->mMsgType, bufferPos, sizeof(impl->mMsgType));
    bufferPos+=sizeof(impl->mMsgType);
 
    // set reply handle
-   if (impl->mMsgType == ZMQ_MSG_INBOX_REQUEST) {
+   if (impl->mMsgType == ZMQ_MSG_PUB_SUB_TOPICID) {
+      // skip topic id announcement (already processed by the dispatch thread)
+      impl->mMsgType = ZMQ_MSG_PUB_SUB;
+      bufferPos += ZMQ_TOPICID_PREFIX_SIZE -1;
+   }
+   else if (impl->mMsgType == ZMQ_MSG_INBOX_REQUEST) {
       // for requests, reply address is embedded in msg
       strcpy(impl->mReplyHandle, (const char*)bufferPos);
       bufferPos += strlen((char*) bufferPos);
@@ -391,6 +417,9 @@ mama_status zmqBridgeMamaMsgImpl_init(zmqBridgeMsgImpl* msg)
    msg->mMsgType = ZMQ_MSG_PUB_SUB;
    strcpy(msg->mReplyHandle, "");
    strcpy(msg->mSendSubject, "");
+   msg->mTopicTag = 0;
+   msg->mTopicId = 0;
+   msg->mIsCompact = 0;
 
    return MAMA_STATUS_OK;
 }
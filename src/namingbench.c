@@ -0,0 +1,579 @@
+//
+// naming benchmark -- simulates many transports discovering each other via a (local) nsd
+//
+// Each simulated peer has its own namingPub & namingSub sockets and its own peer table, and handles naming msgs
+// the same way zmqBridgeMamaTransportImpl_dispatchNamingMsg does (except that data sockets are not connected):
+//    - on the welcome msg, connect namingPub to the nsd, and publish a connect ("C") msg until it comes back
+//    - on a connect msg from a new peer, save a copy in the peer table, and re-publish our own connect msg
+//      (unless -S is specified, in which case peers learn about each other from the nsd's snapshot)
+//    - beacon every -b millis ("c" msgs in v1, "h" msgs in v2)
+//    - in v2, ask for the details of unknown peers ("R"), and answer requests for our own
+//
+// Phases:
+//    converge    peers start (at -r peers/sec, or all at once), and the time until each peer's table contains
+//                every peer is measured
+//    steady      peers beacon for -d seconds, and the cost of handling naming msgs is measured
+//
+// The peers are spread across -t threads, each of which owns the sockets of its peers.  Start an nsd first
+// (e.g., "nsd -i 127.0.0.1 -p 5756 -s 1"), and pass its pid w/-P to report its cpu and memory usage.
+// Each peer uses two sockets, and the nsd two more, so the fd limit (ulimit -n) needs to be at least
+// 4x the number of peers.
+//
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <stddef.h>
+#include <inttypes.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <sys/resource.h>
+
+#include <mama/mama.h>
+#include <wombat/port.h>
+#include <wombat/wtable.h>
+#include <wombat/wInterlocked.h>
+
+#include <zmq.h>
+
+#include "zmqdefs.h"
+#include "util.h"
+#include "histogram.h"
+#include "namingmsg.h"
+
+#define PHASE_CONVERGE     0
+#define PHASE_STEADY       1
+#define PHASE_DONE         2
+
+typedef struct nbPeer {
+   int                     mIndex;
+   void*                   mPub;
+   void*                   mSub;
+   int                     mConnected;          // namingPub connected to nsd (i.e., got welcome msg)
+   int                     mSeenSelf;           // got our own connect msg back
+   uint64_t                mStartTime;          // nanos
+   uint64_t                mConvergedTime;      // nanos (zero until table contains every peer)
+   uint64_t                mNextSend;           // millis -- next beacon (or connect msg, until seen)
+   uint64_t                mLastFullMsg;        // millis
+   wtable_t                mPeers;              // uuid => zmqNamingMsg*, as in transport
+   zmqNamingMsg            mMsg;
+} nbPeer;
+
+typedef struct nbThread {
+   int                     mIndex;
+   wthread_t               mThread;
+   nbPeer**                mPeers;
+   int                     mNumPeers;
+   int                     mNumStarted;
+   zmq_pollitem_t*         mItems;
+   // per phase
+   uint64_t                mMsgsIn[2];
+   uint64_t                mBytesIn[2];
+   uint64_t                mMsgsOut[2];
+   uint64_t                mCpu[2];             // thread cpu nanos
+   zmqHistogram            mDispatch[2];        // nanos per naming msg
+} nbThread;
+
+// options
+int gNumPeers = 1000;
+int gNumThreads = 4;
+double gRate = 0;                               // peers/sec (zero = all at once)
+int gBeaconInterval = 1000;                     // millis
+int gDuration = 10;                             // secs
+int gTimeout = 60;                              // secs
+int gProtocol = 1;
+int gSnapshot = 0;
+const char* gNsdEndpoint = "tcp://127.0.0.1:5756";
+int gNsdPid = 0;
+
+void* gContext = NULL;
+nbPeer* gPeers = NULL;
+nbThread* gThreads = NULL;
+uint64_t gStartTime = 0;                        // nanos
+wInterlockedInt gPhase;
+wInterlockedInt gConverged;
+
+
+///////////////////////////////////////////////////////////////////////////////
+// utility
+
+static uint64_t nbThreadCpu(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+   return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// resident set size, in KB
+static long nbRss(int pid)
+{
+   char path[64];
+   sprintf(path, "/proc/%d/status", pid ? pid : getpid());
+   FILE* f = fopen(path, "r");
+   if (f == NULL) {
+      return 0;
+   }
+   long rss = 0;
+   char line[256];
+   while (fgets(line, sizeof(line), f) != NULL) {
+      if (sscanf(line, "VmRSS: %ld", &rss) == 1) {
+         break;
+      }
+   }
+   fclose(f);
+   return rss;
+}
+
+// user + system cpu, in millis
+static uint64_t nbProcessCpu(int pid)
+{
+   char path[64];
+   sprintf(path, "/proc/%d/stat", pid);
+   FILE* f = fopen(path, "r");
+   if (f == NULL) {
+      return 0;
+   }
+   unsigned long utime = 0, stime = 0;
+   // skip pid, comm (which may contain spaces) and the 11 fields after it
+   int rc = fscanf(f, "%*d (%*[^)]) %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime, &stime);
+   fclose(f);
+   if (rc != 2) {
+      return 0;
+   }
+   return (uint64_t) (utime + stime) * 1000 / sysconf(_SC_CLK_TCK);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// simulated transport
+
+static void nbSend(nbThread* thread, nbPeer* peer, unsigned char type, const char* uuid)
+{
+   if (peer->mConnected == 0) {
+      return;
+   }
+
+   zmqNamingMsg msg = peer->mMsg;
+   msg.mType = type;
+   if (uuid != NULL) {
+      wmStrSizeCpy(msg.mUuid, uuid, sizeof(msg.mUuid));
+   }
+
+   char buf[ZMQ_NAMING_V2_MAX_SIZE];
+   const void* data = &msg;
+   size_t size = ZMQ_NAMING_V1_SIZE;
+   if (gProtocol == 2) {
+      size = zmqBridgeMamaNamingMsg_encode(&msg, buf, sizeof(buf));
+      data = buf;
+   }
+   if ((size > 0) && (zmq_send(peer->mPub, data, size, ZMQ_DONTWAIT) >= 0)) {
+      ++thread->mMsgsOut[wInterlocked_read(&gPhase) == PHASE_CONVERGE ? 0 : 1];
+   }
+   if ((type == 'C') || (type == 'c')) {
+      peer->mLastFullMsg = getMillis();
+   }
+}
+
+static void nbDispatch(nbThread* thread, nbPeer* peer, const void* data, size_t size);
+
+static void nbDispatchSnapshot(nbThread* thread, nbPeer* peer, const char* data, size_t size)
+{
+   const char* p = memchr(data, '\0', size);
+   if (p == NULL) {
+      return;
+   }
+   const char* end = data + size;
+   ++p;
+   while (p + sizeof(uint32_t) <= end) {
+      uint32_t netSize;
+      memcpy(&netSize, p, sizeof(netSize));
+      size_t entrySize = ntohl(netSize);
+      p += sizeof(netSize);
+      if (p + entrySize > end) {
+         return;
+      }
+      nbDispatch(thread, peer, p, entrySize);
+      p += entrySize;
+   }
+}
+
+static void nbDispatch(nbThread* thread, nbPeer* peer, const void* data, size_t size)
+{
+   if ((size > strlen(ZMQ_SNAPSHOT_PREFIX)) && (memcmp(data, ZMQ_SNAPSHOT_PREFIX, strlen(ZMQ_SNAPSHOT_PREFIX)) == 0)) {
+      nbDispatchSnapshot(thread, peer, data, size);
+      return;
+   }
+
+   const zmqNamingMsg* pMsg = data;
+   zmqNamingMsg shortMsg;
+   if (zmqBridgeMamaNamingMsg_isV2(data, size)) {
+      if (zmqBridgeMamaNamingMsg_decode(data, size, &shortMsg) != MAMA_STATUS_OK) {
+         return;
+      }
+      pMsg = &shortMsg;
+   }
+   else {
+      if (size < ZMQ_NAMING_V1_SIZE) {
+         return;
+      }
+      memset(&shortMsg, '\0', sizeof(shortMsg));
+      memcpy(&shortMsg, data, ZMQ_NAMING_V1_SIZE);
+      pMsg = &shortMsg;
+   }
+
+   if (pMsg->mType == 'W') {
+      if (peer->mConnected == 0) {
+         if (zmq_connect(peer->mPub, pMsg->mEndPointAddr) != 0) {
+            fprintf(stderr, "Unable to connect to %s: %d(%s)\n", pMsg->mEndPointAddr, errno, zmq_strerror(errno));
+            exit(3);
+         }
+         peer->mConnected = 1;
+         nbSend(thread, peer, 'C', NULL);
+         peer->mNextSend = getMillis() + 100;
+      }
+   }
+   else if (pMsg->mType == 'h') {
+      zmqNamingMsg* pOrigMsg = wtable_lookup(peer->mPeers, pMsg->mUuid);
+      if ((pOrigMsg == NULL) || (pOrigMsg->mGeneration != pMsg->mGeneration)) {
+         nbSend(thread, peer, 'R', pMsg->mUuid);
+      }
+   }
+   else if (pMsg->mType == 'R') {
+      if ((strcmp(pMsg->mUuid, peer->mMsg.mUuid) == 0) && (getMillis() - peer->mLastFullMsg >= ZMQ_NAMING_MIN_DETAILS_INTERVAL)) {
+         nbSend(thread, peer, 'c', NULL);
+      }
+   }
+   else if ((pMsg->mType == 'C') || (pMsg->mType == 'c')) {
+      if (wtable_lookup(peer->mPeers, pMsg->mUuid) == NULL) {
+         zmqNamingMsg* pOrigMsg = malloc(sizeof(zmqNamingMsg));
+         if (pOrigMsg == NULL) {
+            fprintf(stderr, "Out of memory\n");
+            exit(2);
+         }
+         memcpy(pOrigMsg, pMsg, sizeof(zmqNamingMsg));
+         if (gSnapshot == 0) {
+            nbSend(thread, peer, 'C', NULL);
+         }
+         wtable_insert(peer->mPeers, pOrigMsg->mUuid, pOrigMsg);
+         if ((peer->mConvergedTime == 0) && ((int) wtable_get_count(peer->mPeers) == gNumPeers)) {
+            peer->mConvergedTime = getNanos();
+            wInterlocked_increment(&gConverged);
+         }
+      }
+      if ((peer->mSeenSelf == 0) && (strcmp(pMsg->mUuid, peer->mMsg.mUuid) == 0)) {
+         peer->mSeenSelf = 1;
+         peer->mNextSend = getMillis() + gBeaconInterval;
+      }
+   }
+   else if (pMsg->mType == 'D') {
+      free(wtable_remove(peer->mPeers, pMsg->mUuid));
+   }
+}
+
+static void nbStartPeer(nbThread* thread, nbPeer* peer)
+{
+   peer->mPeers = wtable_create("peers", PEER_TABLE_SIZE);
+   peer->mPub = zmq_socket(gContext, ZMQ_PUB);
+   peer->mSub = zmq_socket(gContext, ZMQ_SUB);
+   if ((peer->mPeers == NULL) || (peer->mPub == NULL) || (peer->mSub == NULL)) {
+      fprintf(stderr, "Unable to create peer %d: %d(%s)\n", peer->mIndex, errno, zmq_strerror(errno));
+      exit(2);
+   }
+   zmq_setsockopt(peer->mSub, ZMQ_SUBSCRIBE, ZMQ_NAMING_PREFIX, strlen(ZMQ_NAMING_PREFIX));
+   if (gSnapshot) {
+      char topic[sizeof(ZMQ_SNAPSHOT_PREFIX) + UUID_STRING_SIZE];
+      sprintf(topic, "%s%s", ZMQ_SNAPSHOT_PREFIX, peer->mMsg.mUuid);
+      zmq_setsockopt(peer->mSub, ZMQ_SUBSCRIBE, topic, strlen(topic));
+   }
+   if (zmq_connect(peer->mSub, gNsdEndpoint) != 0) {
+      fprintf(stderr, "Unable to connect to %s: %d(%s)\n", gNsdEndpoint, errno, zmq_strerror(errno));
+      exit(3);
+   }
+   peer->mStartTime = getNanos();
+
+   zmq_pollitem_t* item = &thread->mItems[thread->mNumStarted++];
+   item->socket = peer->mSub;
+   item->events = ZMQ_POLLIN;
+}
+
+static void nbStopPeer(nbThread* thread, nbPeer* peer)
+{
+   nbSend(thread, peer, 'D', NULL);
+   zmq_close(peer->mPub);
+   zmq_close(peer->mSub);
+}
+
+static void* nbThreadMain(void* closure)
+{
+   nbThread* thread = (nbThread*) closure;
+   int phase = PHASE_CONVERGE;
+   uint64_t cpu = nbThreadCpu();
+   zmq_msg_t msg;
+   zmq_msg_init(&msg);
+
+   while (phase != PHASE_DONE) {
+      // start peers that are due
+      uint64_t elapsed = getNanos() - gStartTime;
+      while ((thread->mNumStarted < thread->mNumPeers)
+         && ((gRate == 0) || (thread->mPeers[thread->mNumStarted]->mIndex * 1e9 / gRate <= elapsed))) {
+         nbStartPeer(thread, thread->mPeers[thread->mNumStarted]);
+      }
+      uint64_t now = getMillis();
+
+      // beacons (or connect msgs, until they come back)
+      for (int i = 0; i < thread->mNumStarted; ++i) {
+         nbPeer* peer = thread->mPeers[i];
+         if ((peer->mConnected) && (peer->mNextSend <= now)) {
+            if (peer->mSeenSelf == 0) {
+               nbSend(thread, peer, 'C', NULL);
+               peer->mNextSend = now + 100;
+            }
+            else if (gBeaconInterval > 0) {
+               nbSend(thread, peer, (gProtocol == 2) ? 'h' : 'c', NULL);
+               peer->mNextSend = now + gBeaconInterval;
+            }
+            else {
+               peer->mNextSend = UINT64_MAX;
+            }
+         }
+      }
+
+      if (zmq_poll(thread->mItems, thread->mNumStarted, 10) > 0) {
+         for (int i = 0; i < thread->mNumStarted; ++i) {
+            if ((thread->mItems[i].revents & ZMQ_POLLIN) == 0) {
+               continue;
+            }
+            nbPeer* peer = thread->mPeers[i];
+            while (zmq_msg_recv(&msg, peer->mSub, ZMQ_DONTWAIT) >= 0) {
+               uint64_t start = getNanos();
+               nbDispatch(thread, peer, zmq_msg_data(&msg), zmq_msg_size(&msg));
+               zmqBridgeMamaHistogram_record(&thread->mDispatch[phase], getNanos() - start);
+               ++thread->mMsgsIn[phase];
+               thread->mBytesIn[phase] += zmq_msg_size(&msg);
+            }
+         }
+      }
+
+      int newPhase = wInterlocked_read(&gPhase);
+      if (newPhase != phase) {
+         uint64_t newCpu = nbThreadCpu();
+         thread->mCpu[phase] = newCpu - cpu;
+         cpu = newCpu;
+         phase = newPhase;
+      }
+   }
+
+   zmq_msg_close(&msg);
+   for (int i = 0; i < thread->mNumStarted; ++i) {
+      nbStopPeer(thread, thread->mPeers[i]);
+   }
+   return NULL;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+
+static void usage(void)
+{
+   printf("Usage: namingbench [-n peers] [-t threads] [-r rate] [-b interval] [-d secs] [-T secs] [-v 1|2] [-S] [-e endpoint] [-P pid]\n");
+   printf("  -n    number of simulated peers (default: %d)\n", gNumPeers);
+   printf("  -t    number of threads (default: %d)\n", gNumThreads);
+   printf("  -r    peers started per second (default: all at once)\n");
+   printf("  -b    beacon interval in millis (default: %d)\n", gBeaconInterval);
+   printf("  -d    duration of steady-state phase in secs (default: %d)\n", gDuration);
+   printf("  -T    max time to wait for convergence in secs (default: %d)\n", gTimeout);
+   printf("  -v    naming protocol (default: %d)\n", gProtocol);
+   printf("  -S    get directory snapshot from nsd\n");
+   printf("  -e    nsd endpoint (default: %s)\n", gNsdEndpoint);
+   printf("  -P    pid of nsd (to report its cpu & memory usage)\n");
+   exit(1);
+}
+
+static void nbFreePeer(wtable_t table, void* data, const char* key, void* closure)
+{
+   free(data);
+}
+
+int main(int argc, char* argv[])
+{
+   int opt;
+   while ((opt = getopt(argc, argv, "n:t:r:b:d:T:v:Se:P:h")) != -1) {
+      switch (opt) {
+         case 'n':   gNumPeers = atoi(optarg);        break;
+         case 't':   gNumThreads = atoi(optarg);      break;
+         case 'r':   gRate = atof(optarg);            break;
+         case 'b':   gBeaconInterval = atoi(optarg);  break;
+         case 'd':   gDuration = atoi(optarg);        break;
+         case 'T':   gTimeout = atoi(optarg);         break;
+         case 'v':   gProtocol = atoi(optarg);        break;
+         case 'S':   gSnapshot = 1;                   break;
+         case 'e':   gNsdEndpoint = optarg;           break;
+         case 'P':   gNsdPid = atoi(optarg);          break;
+         default:    usage();
+      }
+   }
+   if ((gNumPeers < 1) || (gNumThreads < 1) || (gRate < 0) || (gBeaconInterval < 0) || (gDuration < 0)
+      || ((gProtocol != 1) && (gProtocol != 2))) {
+      usage();
+   }
+   if (gNumThreads > gNumPeers) {
+      gNumThreads = gNumPeers;
+   }
+
+   // each peer needs two sockets (and fds)
+   struct rlimit limit;
+   if ((getrlimit(RLIMIT_NOFILE, &limit) == 0) && (limit.rlim_cur < limit.rlim_max)) {
+      limit.rlim_cur = limit.rlim_max;
+      setrlimit(RLIMIT_NOFILE, &limit);
+   }
+   if ((getrlimit(RLIMIT_NOFILE, &limit) == 0) && (limit.rlim_cur < (rlim_t) gNumPeers * 2 + 64)) {
+      fprintf(stderr, "Warning: fd limit of %lu may be too low for %d peers\n", (unsigned long) limit.rlim_cur, gNumPeers);
+   }
+
+   gContext = zmq_ctx_new();
+   if (gContext == NULL) {
+      fprintf(stderr, "Unable to create context: %d(%s)\n", errno, zmq_strerror(errno));
+      exit(2);
+   }
+   zmq_ctx_set(gContext, ZMQ_MAX_SOCKETS, gNumPeers * 2 + 64);
+
+   gPeers = calloc(gNumPeers, sizeof(nbPeer));
+   gThreads = calloc(gNumThreads, sizeof(nbThread));
+   if ((gPeers == NULL) || (gThreads == NULL)) {
+      fprintf(stderr, "Unable to allocate peers\n");
+      exit(2);
+   }
+
+   char host[MAXHOSTNAMELEN +1] = "";
+   gethostname(host, sizeof(host));
+   for (int i = 0; i < gNumPeers; ++i) {
+      nbPeer* peer = &gPeers[i];
+      peer->mIndex = i;
+      zmqNamingMsg* msg = &peer->mMsg;
+      strcpy(msg->mTopic, (gProtocol == 2) ? ZMQ_NAMING_V2_PREFIX : ZMQ_NAMING_PREFIX);
+      strcpy(msg->mProgName, "namingbench");
+      wmStrSizeCpy(msg->mHost, host, sizeof(msg->mHost));
+      msg->mPid = getpid();
+      snprintf(msg->mUuid, sizeof(msg->mUuid), "%08x-0000-4000-8000-%012x", (unsigned int) getpid(), (unsigned int) i);
+      // data endpoints are not bound (or connected to)
+      sprintf(msg->mEndPointAddr, "tcp://127.0.0.1:%d", 10000 + (i % 50000));
+      msg->mGeneration = 1;
+   }
+
+   for (int t = 0; t < gNumThreads; ++t) {
+      nbThread* thread = &gThreads[t];
+      thread->mIndex = t;
+      int numPeers = gNumPeers / gNumThreads + ((t < gNumPeers % gNumThreads) ? 1 : 0);
+      thread->mPeers = calloc(numPeers, sizeof(nbPeer*));
+      thread->mItems = calloc(numPeers, sizeof(zmq_pollitem_t));
+      if ((thread->mPeers == NULL) || (thread->mItems == NULL)) {
+         fprintf(stderr, "Unable to allocate threads\n");
+         exit(2);
+      }
+      // peers are started in index order, so spread them across threads round-robin
+      for (int i = t; i < gNumPeers; i += gNumThreads) {
+         thread->mPeers[thread->mNumPeers++] = &gPeers[i];
+      }
+      zmqBridgeMamaHistogram_init(&thread->mDispatch[0]);
+      zmqBridgeMamaHistogram_init(&thread->mDispatch[1]);
+   }
+
+   printf("namingbench: peers=%d threads=%d rate=%.1f beacon=%dms protocol=%d snapshot=%d nsd=%s\n",
+      gNumPeers, gNumThreads, gRate, gBeaconInterval, gProtocol, gSnapshot, gNsdEndpoint);
+
+   wInterlocked_initialize(&gPhase);
+   wInterlocked_initialize(&gConverged);
+   wInterlocked_set(PHASE_CONVERGE, &gPhase);
+   wInterlocked_set(0, &gConverged);
+   long rssStart = nbRss(0);
+   long nsdRssStart = gNsdPid ? nbRss(gNsdPid) : 0;
+   gStartTime = getNanos();
+   for (int t = 0; t < gNumThreads; ++t) {
+      wthread_create(&gThreads[t].mThread, NULL, nbThreadMain, &gThreads[t]);
+   }
+
+   // converge phase
+   uint64_t nsdCpu = gNsdPid ? nbProcessCpu(gNsdPid) : 0;
+   while (((int) wInterlocked_read(&gConverged) < gNumPeers) && (getNanos() - gStartTime < (uint64_t) gTimeout * 1000000000)) {
+      usleep(1000);
+   }
+   uint64_t convergeEnd = getNanos();
+   int converged = wInterlocked_read(&gConverged);
+   long rssConverged = nbRss(0);
+   uint64_t nsdCpuConverge = gNsdPid ? nbProcessCpu(gNsdPid) - nsdCpu : 0;
+
+   // steady phase
+   wInterlocked_set(PHASE_STEADY, &gPhase);
+   nsdCpu = gNsdPid ? nbProcessCpu(gNsdPid) : 0;
+   sleep(gDuration);
+   uint64_t steadyEnd = getNanos();
+   uint64_t nsdCpuSteady = gNsdPid ? nbProcessCpu(gNsdPid) - nsdCpu : 0;
+   long nsdRssEnd = gNsdPid ? nbRss(gNsdPid) : 0;
+
+   wInterlocked_set(PHASE_DONE, &gPhase);
+   for (int t = 0; t < gNumThreads; ++t) {
+      wthread_join(gThreads[t].mThread, NULL);
+   }
+
+   // results
+   zmqHistogram convergence;
+   zmqBridgeMamaHistogram_init(&convergence);
+   uint64_t tableEntries = 0;
+   for (int i = 0; i < gNumPeers; ++i) {
+      nbPeer* peer = &gPeers[i];
+      if (peer->mConvergedTime != 0) {
+         zmqBridgeMamaHistogram_record(&convergence, peer->mConvergedTime - peer->mStartTime);
+      }
+      if (peer->mPeers != NULL) {
+         tableEntries += wtable_get_count(peer->mPeers);
+      }
+   }
+   zmqHistogram dispatch[2];
+   uint64_t msgsIn[2] = {0, 0}, bytesIn[2] = {0, 0}, msgsOut[2] = {0, 0}, cpu[2] = {0, 0};
+   for (int p = 0; p < 2; ++p) {
+      zmqBridgeMamaHistogram_init(&dispatch[p]);
+      for (int t = 0; t < gNumThreads; ++t) {
+         zmqBridgeMamaHistogram_merge(&dispatch[p], &gThreads[t].mDispatch[p]);
+         msgsIn[p] += gThreads[t].mMsgsIn[p];
+         bytesIn[p] += gThreads[t].mBytesIn[p];
+         msgsOut[p] += gThreads[t].mMsgsOut[p];
+         cpu[p] += gThreads[t].mCpu[p];
+      }
+   }
+
+   char buf[512];
+   double secs[2] = { (convergeEnd - gStartTime) / 1e9, (steadyEnd - convergeEnd) / 1e9 };
+   const char* phases[2] = { "converge", "steady" };
+   printf("full mesh: %d of %d peers in %.3f secs\n", converged, gNumPeers, secs[0]);
+   printf("per-peer convergence %s\n", zmqBridgeMamaHistogram_format(&convergence, buf, sizeof(buf)));
+   for (int p = 0; p < 2; ++p) {
+      printf("%-8s msgs in=%" PRIu64 " (%.0f/sec, %.1f MB/sec) out=%" PRIu64 " (%.0f/sec) cpu=%.3f secs (%.1f%% of one core)\n",
+         phases[p], msgsIn[p], msgsIn[p] / secs[p], bytesIn[p] / secs[p] / (1024 * 1024), msgsOut[p], msgsOut[p] / secs[p],
+         cpu[p] / 1e9, cpu[p] / 1e7 / secs[p]);
+      printf("%-8s dispatch %s\n", phases[p], zmqBridgeMamaHistogram_format(&dispatch[p], buf, sizeof(buf)));
+   }
+   printf("peer tables: %" PRIu64 " entries, %.1f MB of peer msgs (%zu bytes each), rss growth %.1f MB\n",
+      tableEntries, tableEntries * sizeof(zmqNamingMsg) / (1024.0 * 1024), sizeof(zmqNamingMsg), (rssConverged - rssStart) / 1024.0);
+   if (gNsdPid != 0) {
+      printf("nsd: cpu converge=%.3f secs steady=%.3f secs (%.1f%% of one core), rss %.1f => %.1f MB\n",
+         nsdCpuConverge / 1e3, nsdCpuSteady / 1e3, nsdCpuSteady / 10.0 / secs[1], nsdRssStart / 1024.0, nsdRssEnd / 1024.0);
+   }
+
+   for (int i = 0; i < gNumPeers; ++i) {
+      if (gPeers[i].mPeers != NULL) {
+         wtable_for_each(gPeers[i].mPeers, nbFreePeer, NULL);
+         wtable_destroy(gPeers[i].mPeers);
+      }
+   }
+   for (int t = 0; t < gNumThreads; ++t) {
+      free(gThreads[t].mPeers);
+      free(gThreads[t].mItems);
+   }
+   free(gThreads);
+   free(gPeers);
+   zmq_ctx_destroy(gContext);
+
+   return (converged == gNumPeers) ? 0 : 4;
+}
@@ -0,0 +1,158 @@
+//
+// v2 (compact) naming msgs -- see namingmsg.h
+//
+// All msgs start w/a fixed header:
+//    "_NAMING2\0" | type (1) | generation (4) | uuid (36)
+// which, for connect ("C", "c") and disconnect ("D") msgs, is followed by:
+//    pid (4) | progName | host | endpoint | ipc endpoint | shm ring name | reply endpoint | prefixes
+// where each string is a 2-byte length followed by that many chars (w/o a trailing null).
+// Integers are in network byte order.  Strings missing from the end of a msg are treated as empty, and
+// anything following the last known string is ignored, so that fields can be added in future.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+#include <mama/mama.h>
+
+#include "zmqdefs.h"
+#include "namingmsg.h"
+
+#define ZMQ_NAMING_V2_HEADER_SIZE      (sizeof(ZMQ_NAMING_V2_PREFIX) + 1 + sizeof(uint32_t) + UUID_STRING_SIZE)
+
+
+static int zmqBridgeMamaNamingMsgImpl_isFull(unsigned char type)
+{
+   return ((type == 'C') || (type == 'c') || (type == 'D')) ? 1 : 0;
+}
+
+
+static uint8_t* zmqBridgeMamaNamingMsgImpl_putString(uint8_t* p, const uint8_t* end, const char* value)
+{
+   size_t len = strlen(value);
+   if ((p == NULL) || (p + sizeof(uint16_t) + len > end)) {
+      return NULL;
+   }
+   uint16_t netLen = htons((uint16_t) len);
+   memcpy(p, &netLen, sizeof(netLen));
+   memcpy(p + sizeof(netLen), value, len);
+   return p + sizeof(netLen) + len;
+}
+
+
+// copies string at p into value (truncating if necessary) -- returns NULL at end of msg (value is empty)
+static const uint8_t* zmqBridgeMamaNamingMsgImpl_getString(const uint8_t* p, const uint8_t* end, char* value, size_t size)
+{
+   value[0] = '\0';
+   if ((p == NULL) || (p + sizeof(uint16_t) > end)) {
+      return NULL;
+   }
+   uint16_t netLen;
+   memcpy(&netLen, p, sizeof(netLen));
+   size_t len = ntohs(netLen);
+   p += sizeof(netLen);
+   if (p + len > end) {
+      return NULL;
+   }
+   size_t copyLen = (len < size) ? len : size - 1;
+   memcpy(value, p, copyLen);
+   value[copyLen] = '\0';
+   return p + len;
+}
+
+
+int zmqBridgeMamaNamingMsg_isV2(const void* data, size_t size)
+{
+   return ((size >= sizeof(ZMQ_NAMING_V2_PREFIX)) && (memcmp(data, ZMQ_NAMING_V2_PREFIX, sizeof(ZMQ_NAMING_V2_PREFIX)) == 0)) ? 1 : 0;
+}
+
+
+size_t zmqBridgeMamaNamingMsg_encode(const zmqNamingMsg* msg, void* buf, size_t size)
+{
+   if (size < ZMQ_NAMING_V2_HEADER_SIZE) {
+      return 0;
+   }
+
+   uint8_t* p = (uint8_t*) buf;
+   const uint8_t* end = p + size;
+   memcpy(p, ZMQ_NAMING_V2_PREFIX, sizeof(ZMQ_NAMING_V2_PREFIX));
+   p += sizeof(ZMQ_NAMING_V2_PREFIX);
+   *p++ = msg->mType;
+   uint32_t netGeneration = htonl(msg->mGeneration);
+   memcpy(p, &netGeneration, sizeof(netGeneration));
+   p += sizeof(netGeneration);
+   memset(p, '\0', UUID_STRING_SIZE);
+   memcpy(p, msg->mUuid, strnlen(msg->mUuid, UUID_STRING_SIZE));
+   p += UUID_STRING_SIZE;
+
+   if (zmqBridgeMamaNamingMsgImpl_isFull(msg->mType) == 0) {
+      return p - (uint8_t*) buf;
+   }
+
+   if (p + sizeof(uint32_t) > end) {
+      return 0;
+   }
+   uint32_t netPid = htonl((uint32_t) msg->mPid);
+   memcpy(p, &netPid, sizeof(netPid));
+   p += sizeof(netPid);
+   p = zmqBridgeMamaNamingMsgImpl_putString(p, end, msg->mProgName);
+   p = zmqBridgeMamaNamingMsgImpl_putString(p, end, msg->mHost);
+   p = zmqBridgeMamaNamingMsgImpl_putString(p, end, msg->mEndPointAddr);
+   p = zmqBridgeMamaNamingMsgImpl_putString(p, end, msg->mIpcEndPointAddr);
+   p = zmqBridgeMamaNamingMsgImpl_putString(p, end, msg->mShmRingName);
+   p = zmqBridgeMamaNamingMsgImpl_putString(p, end, msg->mReplyEndPointAddr);
+   p = zmqBridgeMamaNamingMsgImpl_putString(p, end, msg->mPrefixes);
+   if (p == NULL) {
+      return 0;
+   }
+
+   return p - (uint8_t*) buf;
+}
+
+
+mama_status zmqBridgeMamaNamingMsg_decode(const void* data, size_t size, zmqNamingMsg* msg)
+{
+   if ((size < ZMQ_NAMING_V2_HEADER_SIZE) || (zmqBridgeMamaNamingMsg_isV2(data, size) == 0)) {
+      return MAMA_STATUS_INVALID_ARG;
+   }
+
+   memset(msg, '\0', sizeof(zmqNamingMsg));
+   const uint8_t* p = (const uint8_t*) data;
+   const uint8_t* end = p + size;
+   memcpy(msg->mTopic, ZMQ_NAMING_V2_PREFIX, sizeof(ZMQ_NAMING_V2_PREFIX));
+   p += sizeof(ZMQ_NAMING_V2_PREFIX);
+   msg->mType = *p++;
+   uint32_t netGeneration;
+   memcpy(&netGeneration, p, sizeof(netGeneration));
+   msg->mGeneration = ntohl(netGeneration);
+   p += sizeof(netGeneration);
+   memcpy(msg->mUuid, p, UUID_STRING_SIZE);
+   msg->mUuid[UUID_STRING_SIZE] = '\0';
+   p += UUID_STRING_SIZE;
+
+   if (zmqBridgeMamaNamingMsgImpl_isFull(msg->mType) == 0) {
+      return MAMA_STATUS_OK;
+   }
+
+   // full msgs must include at least the endpoint
+   if (p + sizeof(uint32_t) > end) {
+      return MAMA_STATUS_INVALID_ARG;
+   }
+   uint32_t netPid;
+   memcpy(&netPid, p, sizeof(netPid));
+   msg->mPid = ntohl(netPid);
+   p += sizeof(netPid);
+   p = zmqBridgeMamaNamingMsgImpl_getString(p, end, msg->mProgName, sizeof(msg->mProgName));
+   p = zmqBridgeMamaNamingMsgImpl_getString(p, end, msg->mHost, sizeof(msg->mHost));
+   p = zmqBridgeMamaNamingMsgImpl_getString(p, end, msg->mEndPointAddr, sizeof(msg->mEndPointAddr));
+   if (msg->mEndPointAddr[0] == '\0') {
+      return MAMA_STATUS_INVALID_ARG;
+   }
+   p = zmqBridgeMamaNamingMsgImpl_getString(p, end, msg->mIpcEndPointAddr, sizeof(msg->mIpcEndPointAddr));
+   p = zmqBridgeMamaNamingMsgImpl_getString(p, end, msg->mShmRingName, sizeof(msg->mShmRingName));
+   p = zmqBridgeMamaNamingMsgImpl_getString(p, end, msg->mReplyEndPointAddr, sizeof(msg->mReplyEndPointAddr));
+   zmqBridgeMamaNamingMsgImpl_getString(p, end, msg->mPrefixes, sizeof(msg->mPrefixes));
+
+   return MAMA_STATUS_OK;
+}
@@ -0,0 +1,49 @@
+//
+// v2 (compact) naming msgs
+//
+// v1 naming msgs are the fixed-size leading part of a zmqNamingMsg (ZMQ_NAMING_V1_SIZE, ~0.9KB), and every
+// peer re-sends its msg as a beacon each beacon interval.  v2 msgs encode the same fields w/variable-length
+// strings, along w/the fields that v1 msgs do not carry (ipc endpoint, shm ring, reply endpoint, generation
+// and prefixes), and beacons carry only the peer's uuid and generation -- full details are sent at startup,
+// when a peer's generation changes, and in response to requests from peers that don't (yet) have them.
+//
+// Internally, v2 msgs are always decoded into a zmqNamingMsg, so that the rest of the transport is
+// unaware of the protocol version.
+//
+
+#ifndef MAMA_BRIDGE_ZMQ_NAMINGMSG_H__
+#define MAMA_BRIDGE_ZMQ_NAMINGMSG_H__
+
+#include <stdint.h>
+#include <mama/mama.h>
+
+#include "zmqdefs.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+// v2 msgs still match the v1 prefix subscription
+#define ZMQ_NAMING_V2_PREFIX           "_NAMING2"
+
+// a peer answers requests for its details at most this often (in millis)
+#define ZMQ_NAMING_MIN_DETAILS_INTERVAL   100
+
+// largest possible encoded msg
+#define ZMQ_NAMING_V2_MAX_SIZE         sizeof(zmqNamingMsg)
+
+// returns non-zero if msg is a v2 naming msg
+int zmqBridgeMamaNamingMsg_isV2(const void* data, size_t size);
+
+// encodes msg in v2 format -- returns the encoded size, or zero if buf is too small
+// (heartbeat ("h") and request ("R") msgs encode only the uuid and generation)
+size_t zmqBridgeMamaNamingMsg_encode(const zmqNamingMsg* msg, void* buf, size_t size);
+
+// decodes a v2 msg into msg (fields not present in the encoded msg are empty)
+mama_status zmqBridgeMamaNamingMsg_decode(const void* data, size_t size, zmqNamingMsg* msg);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* MAMA_BRIDGE_ZMQ_NAMINGMSG_H__ */
@@ -1,6 +1,17 @@
 //
 // This code was cribbed from "The ZeroMQ Guide - for C Developers" -- Example 2.7 Weather Update proxy
 //
+// In addition to forwarding naming msgs, nsd keeps a registry of the latest connect msg from each peer, and
+// sends a snapshot of the registry to each transport that subscribes to its snapshot topic ("_SNAPSHOT.<uuid>"),
+// so that a new transport learns about all existing peers as soon as it connects.
+//
+// Optionally, nsd can also:
+// - log statistics (msgs/sec, peer counts) at a fixed interval (-s)
+// - copy all naming msgs it receives to a capture socket (-c)
+// - federate w/other nsd instances (-f, -r), so that transports connected to different nsds discover each other
+//   (each nsd publishes the naming msgs it receives from its own transports on its federation socket, and
+//   forwards msgs it receives from remote nsds to its own transports, dropping those it has already seen)
+//
 
 // required for definition of progname/program_invocation_short_name,
 // which is used for naming messages
@@ -14,16 +25,295 @@
 #include <stdlib.h>
 #include <signal.h>
 #include <string.h>
+#include <errno.h>
+#include <stddef.h>
+#include <inttypes.h>
+#include <arpa/inet.h>
+#include <sys/time.h>
 
 #include <wombat/strutils.h>
+#include <wombat/wtable.h>
 
 #include <zmq.h>
 #include "zmqdefs.h"
+#include "namingmsg.h"
+
+// max number of remote nsds that can be federated w/
+#define NSD_MAX_REMOTES    16
 
 void sighandler(int unused)
 {
 }
 
+
+///////////////////////////////////////////////////////////////////////////////
+// peer registry
+
+typedef struct nsdPeer {
+   uint64_t    mLastSeen;              // millis
+   uint64_t    mLocalSeen;             // millis -- when last received directly (i.e., not from a remote nsd)
+   size_t      mSize;
+   char        mMsg[];                 // latest connect msg, exactly as received (v1 or v2)
+} nsdPeer;
+
+typedef struct nsdSnapshot {
+   char*       mBuf;
+   size_t      mSize;
+   size_t      mCapacity;
+} nsdSnapshot;
+
+typedef struct nsdStats {
+   uint64_t    mMsgsIn;                // from our own transports
+   uint64_t    mFederatedIn;           // from remote nsds
+   uint64_t    mDuplicates;            // from remote nsds, but already received directly
+   uint64_t    mBytesIn;
+   uint64_t    mSubscriptions;
+   uint64_t    mSnapshots;
+} nsdStats;
+
+typedef struct nsdStale {
+   uint64_t    mStaleTime;
+   char**      mKeys;
+   size_t      mNumKeys;
+} nsdStale;
+
+uint64_t nsdGetMillis(void)
+{
+   struct timeval tv;
+   gettimeofday(&tv, NULL);
+   return (uint64_t) tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+// updates registry w/naming msg -- returns zero if msg is from a remote nsd, and the peer's msgs have been received
+// directly within the last window millis (i.e., the msg is a duplicate and should be dropped)
+int nsdRegistry_update(wtable_t registry, const void* data, size_t size, int federated, uint64_t window)
+{
+   // extract type & uuid from either format
+   zmqNamingMsg v2Msg;
+   unsigned char type;
+   char uuid[UUID_STRING_SIZE +1];
+   if (zmqBridgeMamaNamingMsg_isV2(data, size)) {
+      if (zmqBridgeMamaNamingMsg_decode(data, size, &v2Msg) != MAMA_STATUS_OK) {
+         return 1;
+      }
+      type = v2Msg.mType;
+      strcpy(uuid, v2Msg.mUuid);
+   }
+   else if (size >= offsetof(zmqNamingMsg, mEndPointAddr)) {
+      const zmqNamingMsg* pMsg = (const zmqNamingMsg*) data;
+      type = pMsg->mType;
+      wmStrSizeCpy(uuid, pMsg->mUuid, sizeof(uuid));
+   }
+   else {
+      return 1;
+   }
+   if (uuid[0] == '\0') {
+      return 1;
+   }
+
+   // the uuid in a request ("R") is that of the target, not the sender
+   if (type == 'R') {
+      return 1;
+   }
+
+   uint64_t now = nsdGetMillis();
+   nsdPeer* peer = wtable_lookup(registry, uuid);
+   if (federated) {
+      if (type == 'W') {
+         return 0;
+      }
+      if ((peer != NULL) && (peer->mLocalSeen + window > now)) {
+         return 0;
+      }
+      if ((type == 'D') && (peer == NULL)) {
+         // already gone (or never known)
+         return 0;
+      }
+   }
+
+   if ((type == 'C') || (type == 'c')) {
+      if ((peer == NULL) || (peer->mSize != size) || (memcmp(peer->mMsg, data, size) != 0)) {
+         uint64_t localSeen = 0;
+         if (peer == NULL) {
+            mama_log(MAMA_LOG_LEVEL_FINE, "Registered %speer %s", federated ? "remote " : "", uuid);
+         }
+         else {
+            localSeen = peer->mLocalSeen;
+         }
+         free(wtable_remove(registry, uuid));
+         peer = malloc(sizeof(nsdPeer) + size);
+         if (peer == NULL) {
+            return 1;
+         }
+         peer->mLocalSeen = localSeen;
+         peer->mSize = size;
+         memcpy(peer->mMsg, data, size);
+         wtable_insert(registry, uuid, peer);
+      }
+      peer->mLastSeen = now;
+      if (federated == 0) {
+         peer->mLocalSeen = now;
+      }
+   }
+   else if (type == 'h') {
+      if (peer != NULL) {
+         peer->mLastSeen = now;
+         if (federated == 0) {
+            peer->mLocalSeen = now;
+         }
+      }
+   }
+   else if (type == 'D') {
+      if (peer != NULL) {
+         mama_log(MAMA_LOG_LEVEL_FINE, "Unregistered peer %s", uuid);
+      }
+      free(wtable_remove(registry, uuid));
+   }
+
+   return 1;
+}
+
+// appends peer's msg to snapshot (as a 4-byte length followed by the msg)
+void nsdRegistry_append(wtable_t registry, void* data, const char* key, void* closure)
+{
+   nsdPeer* peer = (nsdPeer*) data;
+   nsdSnapshot* snapshot = (nsdSnapshot*) closure;
+   size_t needed = snapshot->mSize + sizeof(uint32_t) + peer->mSize;
+   if (needed > snapshot->mCapacity) {
+      size_t capacity = (needed > snapshot->mCapacity * 2) ? needed : snapshot->mCapacity * 2;
+      char* buf = realloc(snapshot->mBuf, capacity);
+      if (buf == NULL) {
+         return;
+      }
+      snapshot->mBuf = buf;
+      snapshot->mCapacity = capacity;
+   }
+   uint32_t netSize = htonl((uint32_t) peer->mSize);
+   memcpy(snapshot->mBuf + snapshot->mSize, &netSize, sizeof(netSize));
+   memcpy(snapshot->mBuf + snapshot->mSize + sizeof(netSize), peer->mMsg, peer->mSize);
+   snapshot->mSize = needed;
+}
+
+// sends snapshot of registry on topic
+int nsdRegistry_sendSnapshot(wtable_t registry, void* backend, const char* topic, size_t topicSize)
+{
+   nsdSnapshot snapshot;
+   memset(&snapshot, '\0', sizeof(snapshot));
+   snapshot.mCapacity = topicSize + 1 + 4096;
+   snapshot.mBuf = malloc(snapshot.mCapacity);
+   if (snapshot.mBuf == NULL) {
+      return -1;
+   }
+   memcpy(snapshot.mBuf, topic, topicSize);
+   snapshot.mBuf[topicSize] = '\0';
+   snapshot.mSize = topicSize + 1;
+   wtable_for_each(registry, nsdRegistry_append, &snapshot);
+
+   int rc = zmq_send(backend, snapshot.mBuf, snapshot.mSize, ZMQ_DONTWAIT);
+   if (rc < 0) {
+      mama_log(MAMA_LOG_LEVEL_ERROR, "Unable to send snapshot on %.*s: %d(%s)", (int) topicSize, topic, errno, zmq_strerror(errno));
+   }
+   else {
+      mama_log(MAMA_LOG_LEVEL_FINE, "Sent snapshot of %u peers (%zu bytes) on %.*s", wtable_get_count(registry), snapshot.mSize, (int) topicSize, topic);
+   }
+   free(snapshot.mBuf);
+   return rc;
+}
+
+void nsdRegistry_findStale(wtable_t registry, void* data, const char* key, void* closure)
+{
+   nsdPeer* peer = (nsdPeer*) data;
+   nsdStale* stale = (nsdStale*) closure;
+   if (peer->mLastSeen < stale->mStaleTime) {
+      char** keys = realloc(stale->mKeys, (stale->mNumKeys + 1) * sizeof(char*));
+      if (keys != NULL) {
+         stale->mKeys = keys;
+         stale->mKeys[stale->mNumKeys++] = strdup(key);
+      }
+   }
+}
+
+// removes peers that have not been seen (i.e., have not beaconed) for expiry millis
+void nsdRegistry_expire(wtable_t registry, uint64_t expiry)
+{
+   nsdStale stale;
+   memset(&stale, '\0', sizeof(stale));
+   stale.mStaleTime = nsdGetMillis() - expiry;
+   wtable_for_each(registry, nsdRegistry_findStale, &stale);
+   for (size_t i = 0; i < stale.mNumKeys; ++i) {
+      mama_log(MAMA_LOG_LEVEL_NORMAL, "Expired peer %s", stale.mKeys[i]);
+      free(wtable_remove(registry, stale.mKeys[i]));
+      free(stale.mKeys[i]);
+   }
+   free(stale.mKeys);
+}
+
+void nsdRegistry_freePeer(wtable_t registry, void* data, const char* key, void* closure)
+{
+   free(data);
+}
+
+void nsdRegistry_countLocal(wtable_t registry, void* data, const char* key, void* closure)
+{
+   nsdPeer* peer = (nsdPeer*) data;
+   if (peer->mLocalSeen != 0) {
+      ++(*(unsigned int*) closure);
+   }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// stats
+
+void nsdStats_log(wtable_t registry, nsdStats* stats, nsdStats* prevStats, uint64_t elapsed)
+{
+   double secs = (elapsed > 0) ? elapsed / 1000.0 : 1.0;
+   unsigned int localPeers = 0;
+   wtable_for_each(registry, nsdRegistry_countLocal, &localPeers);
+   mama_log(MAMA_LOG_LEVEL_NORMAL, "msgs/sec:%.1f federated/sec:%.1f duplicates/sec:%.1f KB/sec:%.1f subscriptions:%" PRIu64 " snapshots:%" PRIu64 " peers:%u (local:%u)",
+      (stats->mMsgsIn - prevStats->mMsgsIn) / secs,
+      (stats->mFederatedIn - prevStats->mFederatedIn) / secs,
+      (stats->mDuplicates - prevStats->mDuplicates) / secs,
+      (stats->mBytesIn - prevStats->mBytesIn) / secs / 1024,
+      stats->mSubscriptions - prevStats->mSubscriptions,
+      stats->mSnapshots - prevStats->mSnapshots,
+      wtable_get_count(registry), localPeers);
+   *prevStats = *stats;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// sockets
+
+// sends a copy of msg (w/o blocking) -- used for the capture and federation sockets, which must never hold up the proxy
+void nsdSendCopy(void* socket, zmq_msg_t* msg, int more)
+{
+   if (socket == NULL) {
+      return;
+   }
+   zmq_msg_t copy;
+   zmq_msg_init(&copy);
+   zmq_msg_copy(&copy, msg);
+   if (zmq_msg_send(&copy, socket, ZMQ_DONTWAIT | (more ? ZMQ_SNDMORE : 0)) < 0) {
+      zmq_msg_close(&copy);
+   }
+}
+
+void* nsdBindSocket(void* context, int type, const char* endpoint, const char* name)
+{
+   void* socket = zmq_socket(context, type);
+   if (socket == NULL) {
+      mama_log(MAMA_LOG_LEVEL_SEVERE, "Unable to create %s socket: %d(%s)", name, errno, zmq_strerror(errno));
+      exit(10);
+   }
+   if (zmq_bind(socket, endpoint) != 0) {
+      mama_log(MAMA_LOG_LEVEL_SEVERE, "Unable to bind %s socket to %s: %d(%s)", name, endpoint, errno, zmq_strerror(errno));
+      exit(11);
+   }
+   mama_log(MAMA_LOG_LEVEL_NORMAL, "Bound %s socket to %s", name, endpoint);
+   return socket;
+}
+
 int main (int argc, char** argv)
 {
    // setup logging
@@ -37,6 +327,12 @@ int main (int argc, char** argv)
    // get/check params
    const char* interface = NULL;
    int port = 0;
+   uint64_t expiry = 10 * 1000;
+   uint64_t statsInterval = 0;
+   const char* captureEndpoint = NULL;
+   int federationPort = 0;
+   const char* remotes[NSD_MAX_REMOTES];
+   int numRemotes = 0;
    for (int i = 1; i < argc; i++) {
       if (strcasecmp("-i", argv[i]) == 0) {
          interface = argv[++i];
@@ -44,6 +340,25 @@ int main (int argc, char** argv)
       if (strcasecmp("-p", argv[i]) == 0) {
          port = atoi(argv[++i]);
       }
+      if (strcasecmp("-e", argv[i]) == 0) {
+         expiry = atof(argv[++i]) * 1000;
+      }
+      if (strcasecmp("-s", argv[i]) == 0) {
+         statsInterval = atof(argv[++i]) * 1000;
+      }
+      if (strcasecmp("-c", argv[i]) == 0) {
+         captureEndpoint = argv[++i];
+      }
+      if (strcasecmp("-f", argv[i]) == 0) {
+         federationPort = atoi(argv[++i]);
+      }
+      if (strcasecmp("-r", argv[i]) == 0) {
+         if (numRemotes == NSD_MAX_REMOTES) {
+            mama_log(MAMA_LOG_LEVEL_SEVERE, "Can not specify more than %d remote nsds", NSD_MAX_REMOTES);
+            exit(1);
+         }
+         remotes[numRemotes++] = argv[++i];
+      }
    }
    if ((interface == NULL) || (port == 0)) {
       mama_log(MAMA_LOG_LEVEL_SEVERE, "Must specify both -i and -p");
@@ -105,12 +420,20 @@ int main (int argc, char** argv)
    wmStrSizeCpy(welcomeMsg.mEndPointAddr, subEndpoint, sizeof(welcomeMsg.mEndPointAddr));
    gethostname(welcomeMsg.mHost, sizeof(welcomeMsg.mHost));
    welcomeMsg.mPid = getpid();
-   rc = zmq_setsockopt(backend, ZMQ_XPUB_WELCOME_MSG, &welcomeMsg, sizeof(welcomeMsg));
+   rc = zmq_setsockopt(backend, ZMQ_XPUB_WELCOME_MSG, &welcomeMsg, ZMQ_NAMING_V1_SIZE);
    if (rc != 0) {
       mama_log(MAMA_LOG_LEVEL_SEVERE, "Unable to set welcome message: %d(%s)", errno, zmq_strerror(errno));
       exit(7);
    }
 
+   // pass all subscriptions to us, so we see each transport's snapshot subscription
+   int verbose = 1;
+   rc = zmq_setsockopt(backend, ZMQ_XPUB_VERBOSE, &verbose, sizeof(verbose));
+   if (rc != 0) {
+      mama_log(MAMA_LOG_LEVEL_SEVERE, "Unable to set verbose: %d(%s)", errno, zmq_strerror(errno));
+      exit(7);
+   }
+
    // bind the backend socket to pub endpoint
    rc = zmq_bind (backend, pubEndpoint);
    if (rc != 0) {
@@ -118,12 +441,166 @@ int main (int argc, char** argv)
       exit(8);
    }
 
+   wtable_t registry = wtable_create("registry", PEER_TABLE_SIZE);
+   if (registry == NULL) {
+      mama_log(MAMA_LOG_LEVEL_SEVERE, "Unable to create peer registry");
+      exit(9);
+   }
+
+   // copies of all naming msgs go here
+   void* capture = NULL;
+   if (captureEndpoint != NULL) {
+      capture = nsdBindSocket(context, ZMQ_PUB, captureEndpoint, "capture");
+   }
+
+   // naming msgs from our own transports are published here for remote nsds ...
+   void* federationPub = NULL;
+   if (federationPort != 0) {
+      char federationEndpoint[ZMQ_MAX_ENDPOINT_LENGTH];
+      sprintf(federationEndpoint, "tcp://%s:%d", interface, federationPort);
+      federationPub = nsdBindSocket(context, ZMQ_PUB, federationEndpoint, "federation");
+   }
+
+   // ... and naming msgs from remote nsds' transports are received here
+   void* federationSub = NULL;
+   if (numRemotes > 0) {
+      federationSub = zmq_socket(context, ZMQ_SUB);
+      if (federationSub == NULL) {
+         mama_log(MAMA_LOG_LEVEL_SEVERE, "Unable to create federation subscriber: %d(%s)", errno, zmq_strerror(errno));
+         exit(12);
+      }
+      zmq_setsockopt(federationSub, ZMQ_SUBSCRIBE, ZMQ_NAMING_PREFIX, strlen(ZMQ_NAMING_PREFIX));
+      for (int i = 0; i < numRemotes; ++i) {
+         if (zmq_connect(federationSub, remotes[i]) != 0) {
+            mama_log(MAMA_LOG_LEVEL_SEVERE, "Unable to connect to remote nsd at %s: %d(%s)", remotes[i], errno, zmq_strerror(errno));
+            exit(13);
+         }
+         mama_log(MAMA_LOG_LEVEL_NORMAL, "Federating w/remote nsd at %s", remotes[i]);
+      }
+   }
+
+   // remote msgs are only dropped as duplicates while we're receiving the same peer's msgs directly
+   uint64_t window = (expiry > 0) ? expiry : 10 * 1000;
+   nsdStats stats;
+   memset(&stats, '\0', sizeof(stats));
+   nsdStats prevStats = stats;
+
    //  Run the proxy until the user interrupts us
    signal(SIGINT, &sighandler);
    mama_log(MAMA_LOG_LEVEL_NORMAL, "%s running at %s", programName, pubEndpoint);
-   zmq_proxy (frontend, backend, NULL);
+   zmq_msg_t msg;
+   zmq_msg_init(&msg);
+   zmq_pollitem_t items[] = {
+      { frontend,      0, ZMQ_POLLIN, 0 },
+      { backend,       0, ZMQ_POLLIN, 0 },
+      { federationSub, 0, ZMQ_POLLIN, 0 }
+   };
+   int numItems = (federationSub != NULL) ? 3 : 2;
+   uint64_t lastStats = nsdGetMillis();
+   uint64_t nextStats = (statsInterval > 0) ? lastStats + statsInterval : 0;
+   uint64_t nextExpiry = (expiry > 0) ? nsdGetMillis() + expiry : 0;
+   while (1) {
+      // wake up in time for whichever timer is due first
+      long timeout = -1;
+      uint64_t now = nsdGetMillis();
+      uint64_t nextTimer = nextExpiry;
+      if ((nextStats > 0) && ((nextTimer == 0) || (nextStats < nextTimer))) {
+         nextTimer = nextStats;
+      }
+      if (nextTimer > 0) {
+         timeout = (nextTimer > now) ? (long) (nextTimer - now) : 0;
+      }
+      rc = zmq_poll(items, numItems, timeout);
+      if (rc < 0) {
+         if (errno != EINTR) {
+            mama_log(MAMA_LOG_LEVEL_SEVERE, "zmq_poll failed: %d(%s)", errno, zmq_strerror(errno));
+         }
+         break;
+      }
+
+      // naming msgs from publishers -- record, then forward to subscribers
+      if (items[0].revents & ZMQ_POLLIN) {
+         int more = 0;
+         do {
+            if (zmq_msg_recv(&msg, frontend, 0) < 0) {
+               break;
+            }
+            more = zmq_msg_more(&msg);
+            ++stats.mMsgsIn;
+            stats.mBytesIn += zmq_msg_size(&msg);
+            nsdRegistry_update(registry, zmq_msg_data(&msg), zmq_msg_size(&msg), 0, window);
+            nsdSendCopy(capture, &msg, more);
+            nsdSendCopy(federationPub, &msg, more);
+            zmq_msg_send(&msg, backend, more ? ZMQ_SNDMORE : 0);
+         } while (more);
+      }
+
+      // naming msgs from remote nsds -- forward to our subscribers (but not to other remote nsds, which get them
+      // directly from the originating nsd)
+      if ((numItems > 2) && (items[2].revents & ZMQ_POLLIN)) {
+         if (zmq_msg_recv(&msg, federationSub, 0) >= 0) {
+            ++stats.mFederatedIn;
+            stats.mBytesIn += zmq_msg_size(&msg);
+            if (nsdRegistry_update(registry, zmq_msg_data(&msg), zmq_msg_size(&msg), 1, window)) {
+               nsdSendCopy(capture, &msg, 0);
+               zmq_msg_send(&msg, backend, 0);
+            }
+            else {
+               ++stats.mDuplicates;
+            }
+         }
+      }
+
+      // subscriptions from subscribers -- answer snapshot subscriptions, and forward all to publishers
+      if (items[1].revents & ZMQ_POLLIN) {
+         int more = 0;
+         do {
+            if (zmq_msg_recv(&msg, backend, 0) < 0) {
+               break;
+            }
+            more = zmq_msg_more(&msg);
+            const char* data = zmq_msg_data(&msg);
+            size_t size = zmq_msg_size(&msg);
+            if ((size > 0) && (data[0] == 1)) {
+               ++stats.mSubscriptions;
+            }
+            if ((size > strlen(ZMQ_SNAPSHOT_PREFIX)) && (data[0] == 1) && (memcmp(&data[1], ZMQ_SNAPSHOT_PREFIX, strlen(ZMQ_SNAPSHOT_PREFIX)) == 0)) {
+               if (nsdRegistry_sendSnapshot(registry, backend, &data[1], size - 1) >= 0) {
+                  ++stats.mSnapshots;
+               }
+            }
+            zmq_msg_send(&msg, frontend, more ? ZMQ_SNDMORE : 0);
+         } while (more);
+      }
+
+      // forget peers that went away w/o saying goodbye
+      if ((nextExpiry > 0) && (nsdGetMillis() >= nextExpiry)) {
+         nsdRegistry_expire(registry, expiry);
+         nextExpiry = nsdGetMillis() + expiry;
+      }
+
+      if ((nextStats > 0) && (nsdGetMillis() >= nextStats)) {
+         uint64_t now = nsdGetMillis();
+         nsdStats_log(registry, &stats, &prevStats, now - lastStats);
+         lastStats = now;
+         nextStats = now + statsInterval;
+      }
+   }
+   zmq_msg_close(&msg);
    mama_log(MAMA_LOG_LEVEL_NORMAL, "%s shutting down at %s", programName, pubEndpoint);
 
+   wtable_for_each(registry, nsdRegistry_freePeer, NULL);
+   wtable_destroy(registry);
+
+   if (capture != NULL) {
+      zmq_close(capture);
+   }
+   if (federationPub != NULL) {
+      zmq_close(federationPub);
+   }
+   if (federationSub != NULL) {
+      zmq_close(federationSub);
+   }
    zmq_close (frontend);
    zmq_close (backend);
    zmq_ctx_destroy (context);
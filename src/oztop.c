@@ -0,0 +1,304 @@
+//
+// oz-top -- displays stats exported by OZ transports w/stats.shm=1
+//
+// Scans /dev/shm for stats segments, maps them read-only and displays msg and byte rates, drops, queue
+// depths etc. for each transport.  Reading the segments has no effect on the processes being monitored.
+//
+// usage: oz-top [-i interval] [-n count] [-p pid] [-v]
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "statsshm.h"
+
+#define MAX_SEGMENTS    256
+
+// a copy of the interesting parts of one transport's segment
+typedef struct ozTopSegment {
+   char                    mName[256];          // shm name
+   int                     mFound;              // seen on latest scan?
+   int                     mHasPrev;
+   zmqStatsShmSegment      mCurr;
+   uint64_t                mPrevTime;
+   uint64_t                mPrevStats[ZMQ_STATS_SHM_MAX_STATS];
+} ozTopSegment;
+
+static ozTopSegment* gSegments[MAX_SEGMENTS];
+static int gNumSegments = 0;
+
+static volatile sig_atomic_t gStop = 0;
+
+
+static void onSignal(int sig)
+{
+   gStop = 1;
+}
+
+
+static void usage(const char* prog)
+{
+   fprintf(stderr, "usage: %s [-i interval] [-n count] [-p pid] [-v]\n", prog);
+   fprintf(stderr, "  -i interval   refresh interval in seconds (default 1)\n");
+   fprintf(stderr, "  -n count      exit after count refreshes (default 0 => run until interrupted)\n");
+   fprintf(stderr, "  -p pid        only show transports in this process\n");
+   fprintf(stderr, "  -v            also show latency, queues and peers\n");
+}
+
+
+static int statIndex(const zmqStatsShmSegment* seg, const char* name)
+{
+   for (uint32_t i = 0; i < seg->mNumStats; ++i) {
+      if (strcmp(seg->mStatNames[i], name) == 0) {
+         return i;
+      }
+   }
+   return -1;
+}
+
+
+static uint64_t statValue(const zmqStatsShmSegment* seg, const char* name)
+{
+   int i = statIndex(seg, name);
+   return (i < 0) ? 0 : seg->mStats[i];
+}
+
+
+// per-second rate of a counter since the previous refresh
+static double statRate(const ozTopSegment* s, const char* name)
+{
+   int i = statIndex(&s->mCurr, name);
+   if ((i < 0) || (!s->mHasPrev) || (s->mCurr.mUpdateTime <= s->mPrevTime)) {
+      return 0;
+   }
+   return (s->mCurr.mStats[i] - s->mPrevStats[i]) / ((s->mCurr.mUpdateTime - s->mPrevTime) / 1e9);
+}
+
+
+static ozTopSegment* findSegment(const char* name)
+{
+   for (int i = 0; i < gNumSegments; ++i) {
+      if (strcmp(gSegments[i]->mName, name) == 0) {
+         return gSegments[i];
+      }
+   }
+
+   if (gNumSegments == MAX_SEGMENTS) {
+      return NULL;
+   }
+   ozTopSegment* s = (ozTopSegment*) calloc(1, sizeof(ozTopSegment));
+   if (s == NULL) {
+      return NULL;
+   }
+   snprintf(s->mName, sizeof(s->mName), "%s", name);
+   gSegments[gNumSegments++] = s;
+   return s;
+}
+
+
+// maps a segment and takes a consistent copy of it, returning 0 on failure
+static int readSegment(ozTopSegment* s)
+{
+   char path[512];
+   snprintf(path, sizeof(path), "%s/%s", ZMQ_STATS_SHM_DIR, s->mName);
+   int fd = open(path, O_RDONLY);
+   if (fd < 0) {
+      return 0;
+   }
+   struct stat st;
+   if ((fstat(fd, &st) != 0) || (st.st_size < (off_t) sizeof(zmqStatsShmSegment))) {
+      close(fd);
+      return 0;
+   }
+   void* addr = mmap(NULL, sizeof(zmqStatsShmSegment), PROT_READ, MAP_SHARED, fd, 0);
+   close(fd);
+   if (addr == MAP_FAILED) {
+      return 0;
+   }
+
+   const zmqStatsShmSegment* seg = (const zmqStatsShmSegment*) addr;
+   int rc = 0;
+   if ((__atomic_load_n(&seg->mMagic, __ATOMIC_ACQUIRE) == ZMQ_STATS_SHM_MAGIC) && (seg->mVersion == ZMQ_STATS_SHM_VERSION)) {
+      // header is immutable once magic is set
+      zmqStatsShmSegment* curr = &s->mCurr;
+      memcpy(curr, seg, offsetof(zmqStatsShmSegment, mSeq));
+
+      // stats section
+      size_t statsStart = offsetof(zmqStatsShmSegment, mUpdateTime);
+      size_t statsSize = offsetof(zmqStatsShmSegment, mPeerSeq) - statsStart;
+      int statsOk = zmqBridgeMamaStatsShm_read(&seg->mSeq, (char*) curr + statsStart, (const char*) seg + statsStart, statsSize, 100);
+
+      // peers section
+      size_t peersStart = offsetof(zmqStatsShmSegment, mNumPeers);
+      size_t peersSize = sizeof(zmqStatsShmSegment) - peersStart;
+      int peersOk = zmqBridgeMamaStatsShm_read(&seg->mPeerSeq, (char*) curr + peersStart, (const char*) seg + peersStart, peersSize, 100);
+      if (!peersOk) {
+         curr->mNumPeers = 0;
+      }
+
+      rc = statsOk;
+   }
+
+   munmap(addr, sizeof(zmqStatsShmSegment));
+   return rc;
+}
+
+
+static void scan(long pid)
+{
+   for (int i = 0; i < gNumSegments; ++i) {
+      gSegments[i]->mFound = 0;
+   }
+
+   DIR* dir = opendir(ZMQ_STATS_SHM_DIR);
+   if (dir == NULL) {
+      return;
+   }
+   struct dirent* entry;
+   while ((entry = readdir(dir)) != NULL) {
+      if (strncmp(entry->d_name, ZMQ_STATS_SHM_PREFIX, strlen(ZMQ_STATS_SHM_PREFIX)) != 0) {
+         continue;
+      }
+      if ((pid != 0) && (strtol(entry->d_name + strlen(ZMQ_STATS_SHM_PREFIX), NULL, 10) != pid)) {
+         continue;
+      }
+      if (zmqBridgeMamaStatsShm_reap(entry->d_name)) {
+         continue;
+      }
+
+      ozTopSegment* s = findSegment(entry->d_name);
+      if (s == NULL) {
+         continue;
+      }
+      // keep previous values to calculate rates
+      if (s->mCurr.mUpdateTime != 0) {
+         s->mHasPrev = 1;
+         s->mPrevTime = s->mCurr.mUpdateTime;
+         memcpy(s->mPrevStats, s->mCurr.mStats, sizeof(s->mPrevStats));
+      }
+      s->mFound = readSegment(s);
+   }
+   closedir(dir);
+}
+
+
+static void printLatency(const zmqStatsShmSegment* seg)
+{
+   if (!seg->mHasLatency) {
+      return;
+   }
+
+   printf("    %-10s %12s %10s %10s %10s %10s %10s %10s (usec)\n", "stage", "count", "min", "mean", "p50", "p99", "p99.9", "max");
+   for (uint32_t i = 0; (i < seg->mNumStages) && (i < ZMQ_STATS_SHM_MAX_STAGES); ++i) {
+      const zmqStatsShmLatency* l = &seg->mLatency[i];
+      printf("    %-10s %12llu %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n", seg->mStageNames[i], (unsigned long long) l->mCount,
+         l->mMin / 1000.0, l->mMean / 1000.0, l->mP50 / 1000.0, l->mP99 / 1000.0, l->mP999 / 1000.0, l->mMax / 1000.0);
+   }
+}
+
+
+static void printQueues(const zmqStatsShmSegment* seg)
+{
+   printf("    %-32s %10s %10s %12s %10s %10s\n", "queue", "depth", "max", "oldest(ms)", "stale", "dropped");
+   for (uint32_t i = 0; (i < seg->mNumQueues) && (i < ZMQ_STATS_SHM_MAX_QUEUES); ++i) {
+      const zmqStatsShmQueue* q = &seg->mQueues[i];
+      printf("    %-32s %10llu %10llu %12.3f %10llu %10llu\n", (q->mName[0] != '\0') ? q->mName : "(unnamed)",
+         (unsigned long long) q->mDepth, (unsigned long long) q->mDepthMax, q->mOldestAge / 1e6,
+         (unsigned long long) q->mStaleCount, (unsigned long long) q->mStaleDrops);
+   }
+}
+
+
+static void printPeers(const zmqStatsShmSegment* seg)
+{
+   printf("    %-20s %8s %-20s %s\n", "peer", "pid", "host", "endpoint");
+   for (uint32_t i = 0; (i < seg->mNumPeers) && (i < ZMQ_STATS_SHM_MAX_PEERS); ++i) {
+      const zmqStatsShmPeer* p = &seg->mPeers[i];
+      printf("    %-20s %8lld %-20s %s\n", p->mProgName, (long long) p->mPid, p->mHost, p->mEndpoint);
+   }
+}
+
+
+static void display(int verbose)
+{
+   printf("%-8s %-16s %-16s %10s %12s %10s %12s %8s %8s %8s\n",
+      "pid", "prog", "transport", "msgs/s in", "bytes/s in", "msgs/s out", "bytes/s out", "drops", "qmax", "peers");
+
+   for (int i = 0; i < gNumSegments; ++i) {
+      ozTopSegment* s = gSegments[i];
+      if (!s->mFound) {
+         continue;
+      }
+      const zmqStatsShmSegment* seg = &s->mCurr;
+
+      printf("%-8lld %-16.16s %-16.16s %10.0f %12.0f %10.0f %12.0f %8llu %8llu %8u\n",
+         (long long) seg->mPid, seg->mProgName, seg->mTransport,
+         statRate(s, "msgs_in"), statRate(s, "bytes_in"), statRate(s, "msgs_out"), statRate(s, "bytes_out"),
+         (unsigned long long) (statValue(seg, "drops_in") + statValue(seg, "shm_drops")),
+         (unsigned long long) statValue(seg, "queue_depth_max"),
+         seg->mNumPeers);
+
+      if (verbose) {
+         printLatency(seg);
+         printQueues(seg);
+         printPeers(seg);
+         printf("\n");
+      }
+   }
+}
+
+
+int main(int argc, char** argv)
+{
+   int interval = 1;
+   long count = 0;
+   long pid = 0;
+   int verbose = 0;
+
+   int c;
+   while ((c = getopt(argc, argv, "i:n:p:vh")) != -1) {
+      switch (c) {
+         case 'i': interval = atoi(optarg); break;
+         case 'n': count = atol(optarg); break;
+         case 'p': pid = atol(optarg); break;
+         case 'v': verbose = 1; break;
+         default:
+            usage(argv[0]);
+            return 1;
+      }
+   }
+   if (interval < 1) {
+      interval = 1;
+   }
+
+   signal(SIGINT, onSignal);
+   signal(SIGTERM, onSignal);
+
+   int isTty = isatty(STDOUT_FILENO);
+   for (long n = 0; !gStop && ((count == 0) || (n < count)); ++n) {
+      scan(pid);
+      if (isTty) {
+         printf("\033[H\033[2J");
+      }
+      display(verbose);
+      fflush(stdout);
+      if ((count == 0) || (n + 1 < count)) {
+         sleep(interval);
+      }
+   }
+
+   for (int i = 0; i < gNumSegments; ++i) {
+      free(gSegments[i]);
+   }
+
+   return 0;
+}
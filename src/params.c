@@ -2,6 +2,9 @@
 // split out the parameter handling code from main transport
 //
 
+#include <string.h>
+#include <ctype.h>
+
 #include <mama/mama.h>
 #include <mama/integration/mama.h>
 #include <property.h>
@@ -9,12 +12,14 @@
 
 #include "zmqdefs.h"
 #include "params.h"
+#include "groups.h"
 
 #define PARAM_NAME_MAX_LENGTH 1024
 
 int log_level_beacon =0;
 int log_level_naming =0;
 int log_level_inbox  =0;
+int log_level_stats  =0;
 
 const char* zmqBridgeMamaTransportImpl_getParameterWithVaList(char* defaultVal, char* paramName, const char* format, va_list arguments)
 {
@@ -80,6 +85,21 @@ int getInt(const char* name, const char* property, int defaultValue, int minValu
    return temp;
 }
 
+// bridge-wide parameters (i.e., mama.zmq.<property>)
+int getBridgeInt(const char* property, int defaultValue, int minValue)
+{
+   char valStr[256];
+   sprintf(valStr, "%d", defaultValue);
+   const char* result = zmqBridgeMamaTransportImpl_getParameter(valStr, "%s.%s", BRIDGE_PARAM_PREFIX, property);
+   int temp = atoi(result);
+   if (temp < minValue) {
+      MAMA_LOG(MAMA_LOG_LEVEL_WARN, "%s cannot be less than %d", property, minValue);
+      temp = minValue;
+   }
+
+   return temp;
+}
+
 long long getLong(const char* name, const char* property, long long defaultValue, long long minValue)
 {
    char valStr[256];
@@ -122,6 +142,16 @@ const char* getStr(const char* name, const char* property, const char* defaultVa
 }
 
 
+// These parameters apply to the bridge as a whole
+void MAMACALLTYPE  zmqBridgeMamaImpl_parseBridgeParams(zmqBridgeClosure* closure)
+{
+   closure->mUseTimerWheel = getBridgeInt("timer.wheel", 0, 0);
+   closure->mTimerWheelTick = getBridgeInt("timer.wheel.tick", 1000, 1);                  // micros
+   closure->mUseQueueTimers = getBridgeInt("timer.queue", 0, 0);
+   closure->mQueueTimerTick = getBridgeInt("timer.queue.tick", 10, 1);                    // micros
+}
+
+
 // These parameters apply to both naming and non-naming transports
 void MAMACALLTYPE  zmqBridgeMamaTransportImpl_parseCommonParams(zmqTransportBridge* impl)
 {
@@ -131,14 +161,32 @@ void MAMACALLTYPE  zmqBridgeMamaTransportImpl_parseCommonParams(zmqTransportBrid
    impl->mReconnectInterval = getFloat(name, "reconnect_interval", 10, 0) * 1000.0;    // millis
    impl->mHeartbeatInterval = getFloat(name, "heartbeat_interval", 10, 0) * 1000.0;    // millis
    impl->mSocketMonitor = getInt(name, "socket_monitor", 1, 0);
+   impl->mSharedContext = getInt(name, "shared_context", 0, 0);
+   impl->mIoThreads = getInt(name, "io_threads", 1, 1);
+   impl->mNumReactors = getInt(name, "reactors", 0, 0);
    impl->mIsNaming = getInt(name, "is_naming", 1, 0);
    impl->mPublishAddress = getStr(name, "publish_address", "127.0.0.1");
    impl->mDisableRefresh = getInt(name, "disable_refresh", 1, 0);
    impl->mReconnectOptions = getInt(name, "reconnect_stop", ZMQ_RECONNECT_STOP_CONN_REFUSED, 0);
+   impl->mTopicIds = getInt(name, "topic_ids", 0, 0);
+   impl->mTopicIdsRefresh = getInt(name, "topic_ids.refresh", 100, 1);
+   if (impl->mTopicIdsRefresh == 0) {
+      impl->mTopicIdsRefresh = 1;
+   }
+   impl->mLatencyStats = getInt(name, "latency_stats", 0, 0);
+   impl->mStatsInterval = getInt(name, "stats.interval", 0, 0);
+   impl->mStatsPath = getStr(name, "stats.path", NULL);
+   impl->mQueueMaxAge = getInt(name, "queue.max_age", 0, 0);
+   impl->mQueueDropStale = getInt(name, "queue.drop_stale", 0, 0);
+   impl->mStatsShmEnabled = getInt(name, "stats.shm", 0, 0);
+   if ((impl->mStatsShmEnabled == 1) && (impl->mStatsInterval == 0)) {
+      impl->mStatsInterval = 1;
+   }
 
    log_level_beacon = getInt(name, "log_level_beacon", MAMA_LOG_LEVEL_FINER, MAMA_LOG_LEVEL_OFF);
    log_level_naming = getInt(name, "log_level_naming", MAMA_LOG_LEVEL_NORMAL, MAMA_LOG_LEVEL_OFF);
    log_level_inbox = getInt(name, "log_level_inbox", MAMA_LOG_LEVEL_FINER, MAMA_LOG_LEVEL_OFF);
+   log_level_stats = getInt(name, "log_level_stats", MAMA_LOG_LEVEL_FINE, MAMA_LOG_LEVEL_OFF);
 
 }
 
@@ -153,6 +201,82 @@ void MAMACALLTYPE  zmqBridgeMamaTransportImpl_parseNamingParams(zmqTransportBrid
    impl->mNamingConnectInterval = getFloat(name, "naming.connect_interval", .1, .1) * 1000000.0;    // micros
    impl->mNamingConnectRetries = getInt(name, "naming.connect_retries", 100, 10);
    impl->mBeaconInterval = getFloat(name, "naming.beacon_interval", 1, 0) * 1000.0;    // millis;
+   impl->mNamingProtocol = (getInt(name, "naming.protocol", 1, 1) == 2) ? 2 : 1;
+   impl->mNamingSnapshot = getInt(name, "naming.snapshot", 0, 0);
+   impl->mBeaconJitter = getFloat(name, "naming.beacon_jitter", 0, 0);
+   if (impl->mBeaconJitter > .5) {
+      MAMA_LOG(MAMA_LOG_LEVEL_WARN, "naming.beacon_jitter cannot be more than .5");
+      impl->mBeaconJitter = .5;
+   }
+   impl->mConnectRate = getInt(name, "naming.connect_rate", 0, 1);
+   impl->mRebroadcastInterval = getFloat(name, "naming.rebroadcast_interval", .1, 0) * 1000.0;    // millis
+   impl->mInterestConnect = getInt(name, "naming.interest_connect", 0, 0);
+   const char* prefixes = getStr(name, "naming.publish_prefixes", NULL);
+   if ((prefixes != NULL) && (strlen(prefixes) > ZMQ_MAX_PREFIXES_LENGTH)) {
+      MAMA_LOG(MAMA_LOG_LEVEL_WARN, "naming.publish_prefixes is longer than %d characters -- ignored", ZMQ_MAX_PREFIXES_LENGTH);
+      prefixes = NULL;
+   }
+   if (prefixes != NULL) {
+      // strip any whitespace from list
+      char* stripped = strdup(prefixes);
+      char* q = stripped;
+      for (const char* p = prefixes; *p != '\0'; ++p) {
+         if (!isspace((unsigned char) *p)) {
+            *q++ = *p;
+         }
+      }
+      *q = '\0';
+      impl->mPublishPrefixes = stripped;
+   }
+   impl->mIpcEndpoints = getInt(name, "naming.ipc_endpoints", 0, 0);
+   impl->mIpcPath = getStr(name, "naming.ipc_path", "/tmp");
+   impl->mShmRingEnabled = getInt(name, "naming.shm_ring", 0, 0);
+   impl->mShmRingSize = getLong(name, "naming.shm_ring.size", 4 * 1024 * 1024, 4096);
+   impl->mShmPollInterval = getInt(name, "naming.shm_ring.poll_interval", 100, 0);
+
+   // peers are only known to be alive if they (and we) beacon
+   impl->mMissedBeacons = getInt(name, "naming.missed_beacons", 0, 2);
+   if ((impl->mMissedBeacons != 0) && (impl->mBeaconInterval == 0)) {
+      MAMA_LOG(MAMA_LOG_LEVEL_WARN, "naming.missed_beacons requires naming.beacon_interval -- peers will not be evicted");
+      impl->mMissedBeacons = 0;
+   }
+   impl->mDirectReplies = getInt(name, "naming.direct_replies", 0, 0);
+
+   // v1 naming msgs keep the original layout, so cannot advertise any of the following to peers
+   if ((impl->mNamingProtocol == 1) && (impl->mIpcEndpoints || impl->mShmRingEnabled || impl->mDirectReplies || (impl->mPublishPrefixes != NULL))) {
+      MAMA_LOG(MAMA_LOG_LEVEL_WARN, "naming.ipc_endpoints, naming.shm_ring, naming.direct_replies and naming.publish_prefixes require naming.protocol=2 -- disabled");
+      impl->mIpcEndpoints = 0;
+      impl->mShmRingEnabled = 0;
+      impl->mDirectReplies = 0;
+      free((void*) impl->mPublishPrefixes);
+      impl->mPublishPrefixes = NULL;
+   }
+
+   // queue groups are sent via the direct reply sockets
+   impl->mQueueGroups = getInt(name, "naming.queue_groups", 0, 0);
+   if ((impl->mQueueGroups != 0) && (impl->mDirectReplies == 0)) {
+      MAMA_LOG(MAMA_LOG_LEVEL_WARN, "naming.queue_groups requires naming.direct_replies -- queue groups disabled");
+      impl->mQueueGroups = 0;
+   }
+   impl->mQueueGroup = getStr(name, "naming.queue_group", NULL);
+   if ((impl->mQueueGroup != NULL) && (strlen(impl->mQueueGroup) > ZMQ_MAX_GROUP_NAME_LENGTH)) {
+      MAMA_LOG(MAMA_LOG_LEVEL_WARN, "naming.queue_group %s is longer than %d characters -- ignored", impl->mQueueGroup, ZMQ_MAX_GROUP_NAME_LENGTH);
+      impl->mQueueGroup = NULL;
+   }
+   // membership must be explicitly scoped, since it changes the semantics of ordinary subscriptions
+   impl->mQueueGroupPrefix = getStr(name, "naming.queue_group.prefix", "");
+   if ((impl->mQueueGroup != NULL) && (impl->mQueueGroupPrefix[0] == '\0')) {
+      MAMA_LOG(MAMA_LOG_LEVEL_WARN, "naming.queue_group %s requires naming.queue_group.prefix -- not joining group", impl->mQueueGroup);
+      impl->mQueueGroup = NULL;
+   }
+   const char* policy = getStr(name, "naming.queue_group.policy", "round_robin");
+   impl->mQueueGroupPolicy = (strcmp(policy, "least_loaded") == 0) ? ZMQ_GROUP_LEAST_LOADED : ZMQ_GROUP_ROUND_ROBIN;
+   impl->mQueueGroupInterval = getFloat(name, "naming.queue_group.interval", 1, .1) * 1000.0;    // millis
+
+   // peers that aren't interested in our prefixes wont be connected to our data socket
+   if ((impl->mPublishPrefixes != NULL) && (impl->mDirectReplies == 0)) {
+      MAMA_LOG(MAMA_LOG_LEVEL_WARN, "naming.publish_prefixes is set w/o naming.direct_replies -- inbox replies to peers w/naming.interest_connect may be lost");
+   }
 
    // The naming server address can be specified in any of the following formats:
    // 1. naming.subscribe_address[_n]/naming.subscribe_port[_n]
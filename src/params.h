@@ -1,6 +1,9 @@
 #ifndef OPENMAMA_ZMQ_PARAMS_H
 #define OPENMAMA_ZMQ_PARAMS_H
 
+/* Bridge-wide configuration parameters */
+#define     BRIDGE_PARAM_PREFIX                 "mama.zmq"
+
 /* Transport configuration parameters */
 #define     TPORT_PARAM_PREFIX                  "mama.zmq.transport"
 #define     TPORT_PARAM_OUTGOING_URL            "outgoing_url"
@@ -63,6 +66,7 @@ zmqBridgeMamaTransportImpl_getParameter(const char* defaultVal,
 void MAMACALLTYPE  zmqBridgeMamaTransportImpl_parseCommonParams(zmqTransportBridge* impl);
 void MAMACALLTYPE  zmqBridgeMamaTransportImpl_parseNamingParams(zmqTransportBridge* impl);
 void MAMACALLTYPE  zmqBridgeMamaTransportImpl_parseNonNamingParams(zmqTransportBridge* impl);
+void MAMACALLTYPE  zmqBridgeMamaImpl_parseBridgeParams(zmqBridgeClosure* closure);
 
 // sets socket options as specified in Mama configuration file
 mama_status MAMACALLTYPE zmqBridgeMamaTransportImpl_setCommonSocketOptions(const char* name, zmqSocket* socket);
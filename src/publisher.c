@@ -39,6 +39,8 @@
 #include <mama/integration/inbox.h>
 #include <mama/integration/msg.h>
 #include <mama/integration/endpointpool.h>
+#include <wombat/strutils.h>
+#include <wombat/wInterlocked.h>
 
 // local includes
 #include "transport.h"
@@ -47,6 +49,10 @@
 #include "inbox.h"
 #include "subscription.h"
 #include "zmqbridgefunctions.h"
+#include "topicids.h"
+#include "shmring.h"
+#include "stats.h"
+#include "groups.h"
 
 #include <zmq.h>
 
@@ -63,6 +69,7 @@ typedef struct zmqPublisherBridge {
    mamaPublisher           mParent;
    mamaPublisherCallbacks  mCallbacks;
    void*                   mCallbackClosure;
+   zmqTopicId*             mTopicId;            // if topic ids are enabled, id of mSubject
 } zmqPublisherBridge;
 
 /*=========================================================================
@@ -121,6 +128,9 @@ mama_status zmqBridgeMamaPublisher_createByIndex(publisherBridge* result, mamaTr
    /* Generate a topic name based on the publisher details */
    mama_status status = zmqBridgeMamaPublisherImpl_buildSendSubject(impl);
 
+   /* Look up the topic id once, rather than on every send */
+   impl->mTopicId = zmqBridgeMamaTopicIds_intern(transport, impl->mSubject);
+
    /* Populate the publisherBridge pointer with the publisher implementation */
    *result = (publisherBridge) impl;
 
@@ -207,9 +217,12 @@ mama_status zmqBridgeMamaPublisher_sendReplyToInboxHandle(publisherBridge publis
    CALL_MAMA_FUNC(zmqBridgeMamaMsgImpl_setMsgType((msgBridge) &bridgeMsg, ZMQ_MSG_INBOX_RESPONSE));
    CALL_MAMA_FUNC(zmqBridgeMamaMsgImpl_setReplyHandle((msgBridge) &bridgeMsg, replyHandle));
 
+   zmqBridgeMamaMsg_setSendSubject((msgBridge) &bridgeMsg, (const char*) replyHandle, NULL);
+
    MAMA_LOG(log_level_inbox, "Sent inbox reply to %s", (const char*) replyHandle);
 
-   return zmqBridgeMamaPublisherImpl_sendSubject(publisher, reply, (msgBridge) &bridgeMsg, (const char*) replyHandle);
+   zmqPublisherBridge* impl = (zmqPublisherBridge*) publisher;
+   return zmqBridgeMamaPublisherImpl_sendReply(impl->mTransport, (msgBridge) &bridgeMsg, reply, (const char*) replyHandle);
 }
 
 
@@ -320,26 +333,143 @@ mama_status zmqBridgeMamaPublisherImpl_sendSubject(publisherBridge publisher, ma
    }
    else {
       zmqBridgeMamaMsg_setSendSubject(bridgeMsg, impl->mSubject, impl->mSource);
+
+      // send topic id in place of subject, except when (re-)announcing it
+      zmqBridgeMsgImpl* msgImpl = (zmqBridgeMsgImpl*) bridgeMsg;
+      if ((impl->mTopicId != NULL) && (msgImpl->mMsgType == ZMQ_MSG_PUB_SUB)) {
+         msgImpl->mTopicTag = impl->mTransport->mTopicTag;
+         msgImpl->mTopicId = impl->mTopicId->mId;
+         if (zmqBridgeMamaTopicIds_needsAnnounce(impl->mTransport, impl->mTopicId)) {
+            msgImpl->mMsgType = ZMQ_MSG_PUB_SUB_TOPICID;
+         }
+         else {
+            msgImpl->mIsCompact = 1;
+         }
+      }
    }
 
+   return zmqBridgeMamaPublisherImpl_sendMsg(impl->mTransport, bridgeMsg, mamaMsg);
+}
+
+
+mama_status zmqBridgeMamaPublisherImpl_sendMsg(zmqTransportBridge* transport, msgBridge bridgeMsg, mamaMsg mamaMsg)
+{
    // serialize the msg
    zmq_msg_t zmq_msg;
    CALL_MAMA_FUNC(zmqBridgeMamaMsgImpl_serialize(bridgeMsg, mamaMsg, &zmq_msg));
 
    // send it
    mama_status status = MAMA_STATUS_OK;
-   wlock_lock(impl->mTransport->mZmqDataPub.mLock);
+   wlock_lock(transport->mZmqDataPub.mLock);
+   // same-host peers read from the shm ring (must be written before zmq_msg_send, which takes ownership of the data)
+   if (transport->mShmRing != NULL) {
+      if (zmqBridgeMamaShmRing_write(transport->mShmRing, zmq_msg_data(&zmq_msg), zmq_msg_size(&zmq_msg)) != MAMA_STATUS_OK) {
+         zmqBridgeMamaStats_add(transport->mStats, ZMQ_STATS_PUBLISH, ZMQ_STAT_SHM_DROPS, 1);
+         MAMA_LOG(MAMA_LOG_LEVEL_WARN, "Unable to write msg w/subject:%s, size=%ld to shm ring", ((zmqBridgeMsgImpl*) bridgeMsg)->mSendSubject, zmq_msg_size(&zmq_msg));
+      }
+   }
    // ZMQ_DONTWAIT is superfluous w/PUB sockets, but...
-   int i = zmq_msg_send(&zmq_msg, impl->mTransport->mZmqDataPub.mSocket, ZMQ_DONTWAIT);
-   wlock_unlock(impl->mTransport->mZmqDataPub.mLock);
+   size_t size = zmq_msg_size(&zmq_msg);
+   int i = zmq_msg_send(&zmq_msg, transport->mZmqDataPub.mSocket, ZMQ_DONTWAIT);
+   int err = zmq_errno();
+   // stats are updated under the lock, which makes publishers a single writer
+   if (i < 0) {
+      zmqBridgeMamaStats_add(transport->mStats, ZMQ_STATS_PUBLISH, ZMQ_STAT_SEND_ERRORS, 1);
+   }
+   else {
+      zmqBridgeMamaStats_add(transport->mStats, ZMQ_STATS_PUBLISH, ZMQ_STAT_MSGS_OUT, 1);
+      zmqBridgeMamaStats_add(transport->mStats, ZMQ_STATS_PUBLISH, ZMQ_STAT_BYTES_OUT, size);
+   }
+   wlock_unlock(transport->mZmqDataPub.mLock);
    if (i < 0) {
-      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "zmq_msg_send failed %d(%s)", zmq_errno(), zmq_strerror(errno));
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "zmq_msg_send failed %d(%s)", err, zmq_strerror(err));
       status = MAMA_STATUS_PLATFORM;
    }
    else {
-      MAMA_LOG(MAMA_LOG_LEVEL_FINEST, "Sent msg w/subject:%s, size=%ld", zmq_msg_data(&zmq_msg), zmq_msg_size(&zmq_msg));
+      MAMA_LOG(MAMA_LOG_LEVEL_FINEST, "Sent msg w/subject:%s, size=%zu", ((zmqBridgeMsgImpl*) bridgeMsg)->mSendSubject, size);
+   }
+   zmq_msg_close (&zmq_msg);
+
+   // copies of msgs on subjects w/queue groups also go to one member of each group
+   if ((status == MAMA_STATUS_OK) && (transport->mQueueGroups == 1) && (wInterlocked_read(&transport->mNumGroups) > 0)) {
+      status = zmqBridgeMamaGroups_send(transport, bridgeMsg, mamaMsg);
+   }
+
+   return status;
+}
+
+
+mama_status zmqBridgeMamaPublisherImpl_sendReply(zmqTransportBridge* transport, msgBridge bridgeMsg, mamaMsg mamaMsg, const char* replyHandle)
+{
+   if ((transport->mDirectReplies == 0) || (strlen(replyHandle) < ZMQ_INBOX_SUBJECT_SIZE)) {
+      return zmqBridgeMamaPublisherImpl_sendMsg(transport, bridgeMsg, mamaMsg);
+   }
+
+   // reply handle is _INBOX.<uuid>.<inbox> -- uuid identifies the requesting peer
+   char uuid[UUID_STRING_SIZE +1];
+   wmStrSizeCpy(uuid, &replyHandle[strlen(ZMQ_REPLYHANDLE_PREFIX) +1], sizeof(uuid));
+
+   wlock_lock(transport->mZmqReplyPub.mLock);
+   int isDirect = (wtable_lookup(transport->mDirectPeers, uuid) != NULL);
+   wlock_unlock(transport->mZmqReplyPub.mLock);
+   if (isDirect == 0) {
+      // peer doesn't accept direct replies (or hasn't been discovered yet)
+      return zmqBridgeMamaPublisherImpl_sendMsg(transport, bridgeMsg, mamaMsg);
+   }
+
+   // serialize the msg
+   zmq_msg_t zmq_msg;
+   CALL_MAMA_FUNC(zmqBridgeMamaMsgImpl_serialize(bridgeMsg, mamaMsg, &zmq_msg));
+
+   // send it
+   mama_status status = zmqBridgeMamaPublisherImpl_sendDirect(transport, uuid, &zmq_msg, ZMQ_STAT_DIRECT_REPLIES);
+   if (status == MAMA_STATUS_IO_ERROR) {
+      MAMA_LOG(MAMA_LOG_LEVEL_WARN, "Unable to deliver reply to %s -- peer is not connected", replyHandle);
+   }
+   else if (status == MAMA_STATUS_OK) {
+      MAMA_LOG(MAMA_LOG_LEVEL_FINEST, "Sent direct reply w/subject:%s", replyHandle);
    }
    zmq_msg_close (&zmq_msg);
 
    return status;
 }
+
+
+mama_status zmqBridgeMamaPublisherImpl_sendDirect(zmqTransportBridge* transport, const char* uuid, zmq_msg_t* zmq_msg, int okStat)
+{
+   // w/ZMQ_ROUTER_MANDATORY, sending the routing id fails if the peer is no longer connected
+   wlock_lock(transport->mZmqReplyPub.mLock);
+   size_t size = zmq_msg_size(zmq_msg);
+   int i = -1;
+   int err = EHOSTUNREACH;
+   zmqDirectPeer* peer = wtable_lookup(transport->mDirectPeers, uuid);
+   // connect on first send
+   if ((peer != NULL) && (peer->mRoutingId[0] == '\0') && (zmqBridgeMamaTransportImpl_connectDirect(transport, peer) != MAMA_STATUS_OK)) {
+      peer = NULL;
+   }
+   if (peer != NULL) {
+      i = zmq_send(transport->mZmqReplyPub.mSocket, peer->mRoutingId, strlen(peer->mRoutingId), ZMQ_SNDMORE | ZMQ_DONTWAIT);
+      if (i >= 0) {
+         i = zmq_msg_send(zmq_msg, transport->mZmqReplyPub.mSocket, ZMQ_DONTWAIT);
+      }
+      err = zmq_errno();
+   }
+   // stats are updated under the lock, which makes direct senders a single writer
+   if (i < 0) {
+      zmqBridgeMamaStats_add(transport->mStats, ZMQ_STATS_REPLY, (err == EHOSTUNREACH) ? ZMQ_STAT_DIRECT_FAILURES : ZMQ_STAT_SEND_ERRORS, 1);
+   }
+   else {
+      zmqBridgeMamaStats_add(transport->mStats, ZMQ_STATS_REPLY, okStat, 1);
+      zmqBridgeMamaStats_add(transport->mStats, ZMQ_STATS_REPLY, ZMQ_STAT_BYTES_OUT, size);
+   }
+   wlock_unlock(transport->mZmqReplyPub.mLock);
+
+   if ((i < 0) && (err == EHOSTUNREACH)) {
+      return MAMA_STATUS_IO_ERROR;
+   }
+   if (i < 0) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "zmq_msg_send failed %d(%s)", err, zmq_strerror(err));
+      return MAMA_STATUS_PLATFORM;
+   }
+   return MAMA_STATUS_OK;
+}
@@ -24,6 +24,16 @@
  * THE SOFTWARE.
  */
 
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <stdint.h>
+#if defined __linux__
+#include <sys/timerfd.h>
+#endif
+
 // MAMA includes
 #include <mama/mama.h>
 #include <mama/integration/queue.h>
@@ -33,6 +43,10 @@
 #include "zmqbridgefunctions.h"
 #include "zmqdefs.h"
 #include "uqueue.h"
+#include "latency.h"
+#include "util.h"
+#include "timerwheel.h"
+#include "queuegroup.h"
 
 /**
  * This funcion is called to check the current queue size against configured
@@ -44,6 +58,20 @@
  */
 static void zmqBridgeMamaQueueImpl_checkWatermarks(zmqQueueBridge* impl);
 
+// all queues, so stats can report their depths
+static pthread_mutex_t gQueuesLock = PTHREAD_MUTEX_INITIALIZER;
+static zmqQueueBridge* gQueues = NULL;
+static void zmqBridgeMamaQueueImpl_register(zmqQueueBridge* impl);
+static void zmqBridgeMamaQueueImpl_unregister(zmqQueueBridge* impl);
+
+static int zmqBridgeMamaQueueImpl_onAge(void* closure, uint64_t age, uint8_t isStale, uint8_t isMsg, void* item);
+static mama_status zmqBridgeMamaQueueImpl_setMaxAge(zmqQueueBridge* impl, uint32_t maxAgeMillis, int dropStale, zmqQueueAgeCB callback, void* closure);
+
+// timers hosted on the queue
+static void zmqBridgeMamaQueueImpl_processTimers(zmqQueueBridge* impl);
+static void zmqBridgeMamaQueueImpl_setTimerDeadline(zmqQueueBridge* impl, uint64_t deadline);
+static wombatQueueStatus zmqBridgeMamaQueueImpl_timedDispatchTimers(zmqQueueBridge* impl, uint64_t timeout);
+
 
 mama_status zmqBridgeMamaQueue_create(queueBridge* queue, mamaQueue parent)
 {
@@ -65,6 +93,8 @@ mama_status zmqBridgeMamaQueue_create(queueBridge* queue, mamaQueue parent)
       return MAMA_STATUS_NOMEM;
    }
 
+   impl->mTimerFd = -1;
+
    /* Initialize the active flag */
    wInterlocked_initialize(&impl->mIsActive);
    wInterlocked_set(1, &impl->mIsActive);
@@ -91,6 +121,8 @@ mama_status zmqBridgeMamaQueue_create(queueBridge* queue, mamaQueue parent)
       return MAMA_STATUS_PLATFORM;
    }
 
+   zmqBridgeMamaQueueImpl_register(impl);
+
    /* Populate the queueBridge pointer with the implementation for return */
    *queue = (queueBridge) impl;
 
@@ -121,6 +153,8 @@ mama_status zmqBridgeMamaQueue_create_usingNative(queueBridge* queue,
    /* Wombat queue has already been created, so simply reference it here */
    impl->mQueue = (uQueue) nativeQueue;
 
+   impl->mTimerFd = -1;
+
    /* Populate the queueBridge pointer with the implementation for return */
    *queue = (queueBridge) impl;
 
@@ -135,11 +169,32 @@ mama_status zmqBridgeMamaQueue_destroy(queueBridge queue)
    /* Perform null checks and return if null arguments provided */
    CHECK_QUEUE(impl);
 
+   zmqBridgeMamaQueueImpl_unregister(impl);
+
+   // waits for the group's worker (if any) to finish w/the queue
+   if (impl->mGroup != NULL) {
+      zmqBridgeMamaQueueGroupImpl_remove(impl->mGroup, impl);
+   }
+
    /* Destroy the underlying wombatQueue - can be called from any thread*/
    wthread_mutex_lock(&impl->mDispatchLock);
    status = uQueue_destroy(impl->mQueue);
    wthread_mutex_unlock(&impl->mDispatchLock);
 
+   if (impl->mTimers != NULL) {
+      zmqBridgeMamaTimerWheel_destroy(impl->mTimers);
+   }
+   if (impl->mTimerFd >= 0) {
+      close(impl->mTimerFd);
+   }
+
+   if (impl->mLatency != NULL) {
+      char name[32];
+      snprintf(name, sizeof(name), "queue %p", impl->mParent);
+      zmqBridgeMamaLatency_log(impl->mLatency, name);
+      zmqBridgeMamaLatency_destroy(impl->mLatency);
+   }
+
    /* Free the zmqQueueImpl container struct */
    free(impl);
 
@@ -180,12 +235,17 @@ mama_status zmqBridgeMamaQueue_dispatch(queueBridge queue)
 
    /* Perform null checks and return if null arguments provided */
    CHECK_QUEUE(impl);
+   CHECK_NOT_GROUPED(impl);
 
    /* Lock for dispatching */
    wthread_mutex_lock(&impl->mDispatchLock);
 
-   wInterlocked_initialize(&impl->mIsDispatching);
-   wInterlocked_set(1, &impl->mIsDispatching);
+   // claim the queue (fails if it was added to a queue group since the check above)
+   if (!__sync_bool_compare_and_swap(&impl->mIsDispatching, 0, 1)) {
+      wthread_mutex_unlock(&impl->mDispatchLock);
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Queue %p is already being dispatched", impl->mParent);
+      return MAMA_STATUS_INVALID_QUEUE;
+   }
 
    /*
     * Continually dispatch as long as the calling application wants dispatching
@@ -199,11 +259,19 @@ mama_status zmqBridgeMamaQueue_dispatch(queueBridge queue)
        * Perform a dispatch with a timeout to allow the dispatching process
        * to be interrupted by the calling application between iterations
        */
-      status = uQueue_timedDispatch(impl->mQueue, ZMQ_QUEUE_DISPATCH_TIMEOUT);
+      if (impl->mTimers != NULL) {
+         status = zmqBridgeMamaQueueImpl_timedDispatchTimers(impl, ZMQ_QUEUE_DISPATCH_TIMEOUT);
+      }
+      else {
+         status = uQueue_timedDispatch(impl->mQueue, ZMQ_QUEUE_DISPATCH_TIMEOUT);
+      }
    }
    while ((WOMBAT_QUEUE_OK == status || WOMBAT_QUEUE_TIMEOUT == status)
           && wInterlocked_read(&impl->mIsDispatching) == 1);
 
+   // release the queue (if dispatching stopped because of an error)
+   wInterlocked_set(0, &impl->mIsDispatching);
+
    /* Unlock the dispatch lock */
    wthread_mutex_unlock(&impl->mDispatchLock);
 
@@ -223,12 +291,18 @@ mama_status zmqBridgeMamaQueue_timedDispatch(queueBridge queue, uint64_t timeout
 
    /* Perform null checks and return if null arguments provided */
    CHECK_QUEUE(impl);
+   CHECK_NOT_GROUPED(impl);
 
    /* Check the watermarks to see if thresholds have been breached */
    zmqBridgeMamaQueueImpl_checkWatermarks(impl);
 
    /* Attempt to dispatch the queue with a timeout once */
-   status = uQueue_timedDispatch(impl->mQueue, timeout);
+   if (impl->mTimers != NULL) {
+      status = zmqBridgeMamaQueueImpl_timedDispatchTimers(impl, timeout);
+   }
+   else {
+      status = uQueue_timedDispatch(impl->mQueue, timeout);
+   }
 
    /* If dispatch failed, report here */
    if (WOMBAT_QUEUE_OK != status && WOMBAT_QUEUE_TIMEOUT != status) {
@@ -247,12 +321,20 @@ mama_status zmqBridgeMamaQueue_dispatchEvent(queueBridge queue)
 
    /* Perform null checks and return if null arguments provided */
    CHECK_QUEUE(impl);
+   CHECK_NOT_GROUPED(impl);
 
    /* Check the watermarks to see if thresholds have been breached */
    zmqBridgeMamaQueueImpl_checkWatermarks(impl);
 
-   /* Attempt to dispatch the queue with a timeout once */
-   status = uQueue_dispatch(impl->mQueue);
+   if (impl->mTimers != NULL) {
+      // don't block past the next timer
+      zmqBridgeMamaQueueImpl_processTimers(impl);
+      uint64_t deadline = __atomic_load_n(&impl->mTimerDeadline, __ATOMIC_ACQUIRE);
+      status = (deadline != UINT64_MAX) ? uQueue_timedDispatchUntil(impl->mQueue, deadline) : uQueue_dispatch(impl->mQueue);
+   }
+   else {
+      status = uQueue_dispatch(impl->mQueue);
+   }
 
    /* If dispatch failed, report here */
    if (WOMBAT_QUEUE_OK != status && WOMBAT_QUEUE_TIMEOUT != status) {
@@ -298,6 +380,11 @@ static mama_status zmqBridgeMamaQueue_enqueueEventInt(queueBridge queue,
    /* Call the underlying wombatQueue_enqueue method */
    status = uQueue_enqueue(impl->mQueue, (wombatQueueCb) callback, impl->mParent, closure, isMsg);
 
+   // schedule the queue on one of its group's workers
+   if ((WOMBAT_QUEUE_OK == status) && (impl->mGroup != NULL)) {
+      zmqBridgeMamaQueueGroupImpl_notify(impl->mGroup, impl);
+   }
+
    /* Call the enqueue callback if provided */
    if (NULL != impl->mEnqueueCallback) {
       impl->mEnqueueCallback(impl->mParent, impl->mEnqueueClosure);
@@ -312,6 +399,24 @@ static mama_status zmqBridgeMamaQueue_enqueueEventInt(queueBridge queue,
    return MAMA_STATUS_OK;
 }
 
+int zmqBridgeMamaQueueImpl_dispatchBatch(zmqQueueBridge* impl, int maxEvents)
+{
+   int count = 0;
+
+   wthread_mutex_lock(&impl->mDispatchLock);
+   zmqBridgeMamaQueueImpl_checkWatermarks(impl);
+   while (count < maxEvents) {
+      wombatQueueStatus status = uQueue_timedDispatch(impl->mQueue, 0);
+      if (WOMBAT_QUEUE_OK != status) {
+         break;
+      }
+      ++count;
+   }
+   wthread_mutex_unlock(&impl->mDispatchLock);
+
+   return count;
+}
+
 mama_status zmqBridgeMamaQueue_enqueueMsg(queueBridge queue, mamaQueueEnqueueCB callback, struct zmqTransportMsg_ *msg)
 {
    zmqQueueBridge* impl = (zmqQueueBridge*) queue;
@@ -329,6 +434,382 @@ mama_status zmqBridgeMamaQueue_enqueueEvent(queueBridge queue, mamaQueueEventCB
    return zmqBridgeMamaQueue_enqueueEventInt(queue, callback, closure, 0);
 }
 
+int zmqBridgeMamaQueue_getAllStats(zmqQueueStats* stats, int maxQueues)
+{
+   int count = 0;
+
+   pthread_mutex_lock(&gQueuesLock);
+   for (zmqQueueBridge* impl = gQueues; (impl != NULL) && (count < maxQueues); impl = impl->mNextQueue) {
+      zmqQueueStats* pStats = &stats[count++];
+      memset(pStats, '\0', sizeof(zmqQueueStats));
+      pStats->mQueue = impl;
+      const char* name = NULL;
+      if ((mamaQueue_getQueueName(impl->mParent, &name) == MAMA_STATUS_OK) && (name != NULL)) {
+         snprintf(pStats->mName, sizeof(pStats->mName), "%s", name);
+      }
+      int size = 0;
+      uQueue_getSize(impl->mQueue, &size);
+      pStats->mDepth = size;
+      uQueue_getHighWater(impl->mQueue, &size);
+      pStats->mDepthMax = size;
+      uQueue_getOldestAge(impl->mQueue, &pStats->mOldestAge);
+      pStats->mStaleCount = __atomic_load_n(&impl->mStaleCount, __ATOMIC_RELAXED);
+      pStats->mStaleDrops = __atomic_load_n(&impl->mStaleDrops, __ATOMIC_RELAXED);
+   }
+   pthread_mutex_unlock(&gQueuesLock);
+
+   return count;
+}
+
+void zmqBridgeMamaQueueImpl_register(zmqQueueBridge* impl)
+{
+   pthread_mutex_lock(&gQueuesLock);
+   impl->mPrevQueue = NULL;
+   impl->mNextQueue = gQueues;
+   if (gQueues != NULL) {
+      gQueues->mPrevQueue = impl;
+   }
+   gQueues = impl;
+   impl->mIsRegistered = 1;
+   pthread_mutex_unlock(&gQueuesLock);
+}
+
+void zmqBridgeMamaQueueImpl_unregister(zmqQueueBridge* impl)
+{
+   if (impl->mIsRegistered == 0) {
+      return;
+   }
+
+   pthread_mutex_lock(&gQueuesLock);
+   if (impl->mPrevQueue != NULL) {
+      impl->mPrevQueue->mNextQueue = impl->mNextQueue;
+   }
+   else {
+      gQueues = impl->mNextQueue;
+   }
+   if (impl->mNextQueue != NULL) {
+      impl->mNextQueue->mPrevQueue = impl->mPrevQueue;
+   }
+   impl->mIsRegistered = 0;
+   pthread_mutex_unlock(&gQueuesLock);
+}
+
+mama_status zmqBridgeMamaQueue_setMaxAge(mamaQueue queue, uint32_t maxAgeMillis, int dropStale, zmqQueueAgeCB callback, void* closure)
+{
+   if (queue == NULL) {
+      return MAMA_STATUS_NULL_ARG;
+   }
+
+   zmqQueueBridge* impl = NULL;
+   CALL_MAMA_FUNC(mamaQueue_getNativeHandle(queue, (void**) &impl));
+   CHECK_QUEUE(impl);
+
+   return zmqBridgeMamaQueueImpl_setMaxAge(impl, maxAgeMillis, dropStale, callback, closure);
+}
+
+mama_status zmqBridgeMamaQueue_getAgeStats(mamaQueue queue, uint64_t* oldestAge, uint64_t* staleCount, uint64_t* staleDrops)
+{
+   if ((queue == NULL) || (oldestAge == NULL) || (staleCount == NULL) || (staleDrops == NULL)) {
+      return MAMA_STATUS_NULL_ARG;
+   }
+
+   zmqQueueBridge* impl = NULL;
+   CALL_MAMA_FUNC(mamaQueue_getNativeHandle(queue, (void**) &impl));
+   CHECK_QUEUE(impl);
+
+   uQueue_getOldestAge(impl->mQueue, oldestAge);
+   *staleCount = __atomic_load_n(&impl->mStaleCount, __ATOMIC_RELAXED);
+   *staleDrops = __atomic_load_n(&impl->mStaleDrops, __ATOMIC_RELAXED);
+
+   return MAMA_STATUS_OK;
+}
+
+mama_status zmqBridgeMamaQueue_applyMaxAge(queueBridge queue, uint32_t maxAgeMillis, int dropStale)
+{
+   zmqQueueBridge* impl = (zmqQueueBridge*) queue;
+
+   CHECK_QUEUE(impl);
+
+   // NOTE: can't use mDispatchLock, which is held for as long as the queue is dispatching
+   if (!__sync_bool_compare_and_swap(&impl->mMaxAge, 0, (uint64_t) maxAgeMillis * 1000000)) {
+      // already set (either explicitly, or by another transport)
+      return MAMA_STATUS_OK;
+   }
+
+   return zmqBridgeMamaQueueImpl_setMaxAge(impl, maxAgeMillis, dropStale, impl->mAgeCallback, impl->mAgeClosure);
+}
+
+mama_status zmqBridgeMamaQueueImpl_setMaxAge(zmqQueueBridge* impl, uint32_t maxAgeMillis, int dropStale, zmqQueueAgeCB callback, void* closure)
+{
+   impl->mMaxAge = (uint64_t) maxAgeMillis * 1000000;
+   impl->mDropStale = dropStale;
+   impl->mAgeCallback = callback;
+   impl->mAgeClosure = closure;
+   impl->mAgeFired = 0;
+
+   if (uQueue_setMaxAge(impl->mQueue, impl->mMaxAge, (maxAgeMillis > 0) ? zmqBridgeMamaQueueImpl_onAge : NULL, impl) != WOMBAT_QUEUE_OK) {
+      return MAMA_STATUS_PLATFORM;
+   }
+
+   return MAMA_STATUS_OK;
+}
+
+// called by uQueue for stale items (and for the first non-stale item after)
+int zmqBridgeMamaQueueImpl_onAge(void* closure, uint64_t age, uint8_t isStale, uint8_t isMsg, void* item)
+{
+   zmqQueueBridge* impl = (zmqQueueBridge*) closure;
+   const char* name = NULL;
+
+   if (isStale == 0) {
+      if (impl->mAgeFired != 0) {
+         impl->mAgeFired = 0;
+         mamaQueue_getQueueName(impl->mParent, &name);
+         MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Queue %s (%p) is no longer stale", (name != NULL) ? name : "", impl->mParent);
+         if (impl->mAgeCallback != NULL) {
+            impl->mAgeCallback(impl->mParent, age, 0, impl->mAgeClosure);
+         }
+      }
+      return 0;
+   }
+
+   __sync_add_and_fetch(&impl->mStaleCount, 1);
+
+   if (impl->mAgeFired == 0) {
+      impl->mAgeFired = 1;
+      mamaQueue_getQueueName(impl->mParent, &name);
+      MAMA_LOG(MAMA_LOG_LEVEL_WARN, "Queue %s (%p) dispatched item that waited %.3f ms (max=%.3f ms)", (name != NULL) ? name : "",
+         impl->mParent, age / 1e6, impl->mMaxAge / 1e6);
+      if (impl->mAgeCallback != NULL) {
+         impl->mAgeCallback(impl->mParent, age, 1, impl->mAgeClosure);
+      }
+   }
+
+   // only msgs can be dropped -- other events (e.g., destroy callbacks) must always be dispatched
+   if ((impl->mDropStale == 1) && (isMsg == 1)) {
+      zmqTransportMsg* tmsg = (zmqTransportMsg*) item;
+      zmq_msg_close(&tmsg->mZmsg);
+      __sync_add_and_fetch(&impl->mStaleDrops, 1);
+      return 1;
+   }
+
+   return 0;
+}
+
+mama_status zmqBridgeMamaQueue_enableLatency(queueBridge queue)
+{
+   zmqQueueBridge* impl = (zmqQueueBridge*) queue;
+
+   CHECK_QUEUE(impl);
+
+   if (impl->mLatency != NULL) {
+      return MAMA_STATUS_OK;
+   }
+
+   zmqLatencyStats* stats = zmqBridgeMamaLatency_create();
+   if (stats == NULL) {
+      return MAMA_STATUS_NOMEM;
+   }
+
+   // NOTE: can't use mDispatchLock, which is held for as long as the queue is dispatching
+   if (!__sync_bool_compare_and_swap(&impl->mLatency, NULL, stats)) {
+      // someone else got there first
+      zmqBridgeMamaLatency_destroy(stats);
+   }
+
+   return MAMA_STATUS_OK;
+}
+
+mama_status zmqBridgeMamaQueue_enableTimers(queueBridge queue, uint64_t tickNanos)
+{
+   zmqQueueBridge* impl = (zmqQueueBridge*) queue;
+
+   CHECK_QUEUE(impl);
+
+   if (impl->mTimers != NULL) {
+      return MAMA_STATUS_OK;
+   }
+   // queues in a group are dispatched in batches, which can't be interrupted to fire timers
+   if (impl->mGroup != NULL) {
+      return MAMA_STATUS_NOT_IMPLEMENTED;
+   }
+
+   // the wheel is not started -- it is advanced by the dispatcher
+   zmqTimerWheel* wheel = NULL;
+   CALL_MAMA_FUNC(zmqBridgeMamaTimerWheel_create(&wheel, tickNanos));
+
+   __atomic_store_n(&impl->mTimerDeadline, UINT64_MAX, __ATOMIC_RELEASE);
+   // NOTE: can't use mDispatchLock, which is held for as long as the queue is dispatching
+   if (!__sync_bool_compare_and_swap(&impl->mTimers, NULL, wheel)) {
+      // someone else got there first
+      zmqBridgeMamaTimerWheel_destroy(wheel);
+   }
+
+   return MAMA_STATUS_OK;
+}
+
+mama_status zmqBridgeMamaQueue_addTimer(queueBridge queue, zmqTimerWheelEntry* entry, uint64_t delayNanos, zmqTimerWheelCb cb, void* closure)
+{
+   zmqQueueBridge* impl = (zmqQueueBridge*) queue;
+
+   CHECK_QUEUE(impl);
+   if (impl->mTimers == NULL) {
+      return MAMA_STATUS_INVALID_QUEUE;
+   }
+
+   uint64_t due = getNanos() + delayNanos;
+   int wake = 0;
+
+   zmqBridgeMamaTimerWheel_lock(impl->mTimers);
+   zmqBridgeMamaTimerWheel_add(impl->mTimers, entry, delayNanos, cb, closure);
+   // if the dispatcher is processing timers it will pick this one up when it's done, otherwise it may need
+   // to wake up sooner than planned
+   uint64_t deadline = __atomic_load_n(&impl->mTimerDeadline, __ATOMIC_ACQUIRE);
+   if ((deadline != 0) && (due < deadline)) {
+      zmqBridgeMamaQueueImpl_setTimerDeadline(impl, due);
+      wake = (impl->mTimerFd < 0);
+   }
+   zmqBridgeMamaTimerWheel_unlock(impl->mTimers);
+
+   if (wake) {
+      uQueue_wake(impl->mQueue);
+   }
+
+   return MAMA_STATUS_OK;
+}
+
+mama_status zmqBridgeMamaQueue_cancelTimer(queueBridge queue, zmqTimerWheelEntry* entry)
+{
+   zmqQueueBridge* impl = (zmqQueueBridge*) queue;
+
+   CHECK_QUEUE(impl);
+   if (impl->mTimers == NULL) {
+      return MAMA_STATUS_INVALID_QUEUE;
+   }
+
+   // leaves mTimerDeadline alone -- at worst, the dispatcher wakes up for nothing
+   zmqBridgeMamaTimerWheel_cancel(impl->mTimers, entry);
+
+   return MAMA_STATUS_OK;
+}
+
+mama_status zmqBridgeMamaQueue_getTimerFd(mamaQueue queue, int* fd)
+{
+   if ((queue == NULL) || (fd == NULL)) {
+      return MAMA_STATUS_NULL_ARG;
+   }
+
+   zmqQueueBridge* impl = NULL;
+   CALL_MAMA_FUNC(mamaQueue_getNativeHandle(queue, (void**) &impl));
+   CHECK_QUEUE(impl);
+   if (impl->mTimers == NULL) {
+      return MAMA_STATUS_INVALID_QUEUE;
+   }
+
+   #if defined __linux__
+   zmqBridgeMamaTimerWheel_lock(impl->mTimers);
+   if (impl->mTimerFd < 0) {
+      impl->mTimerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+      if (impl->mTimerFd < 0) {
+         MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "timerfd_create failed %d(%s)", errno, strerror(errno));
+         zmqBridgeMamaTimerWheel_unlock(impl->mTimers);
+         return MAMA_STATUS_PLATFORM;
+      }
+      zmqBridgeMamaQueueImpl_setTimerDeadline(impl, __atomic_load_n(&impl->mTimerDeadline, __ATOMIC_ACQUIRE));
+   }
+   *fd = impl->mTimerFd;
+   zmqBridgeMamaTimerWheel_unlock(impl->mTimers);
+
+   return MAMA_STATUS_OK;
+   #else
+   return MAMA_STATUS_NOT_IMPLEMENTED;
+   #endif
+}
+
+mama_status zmqBridgeMamaQueue_processTimers(mamaQueue queue)
+{
+   if (queue == NULL) {
+      return MAMA_STATUS_NULL_ARG;
+   }
+
+   zmqQueueBridge* impl = NULL;
+   CALL_MAMA_FUNC(mamaQueue_getNativeHandle(queue, (void**) &impl));
+   CHECK_QUEUE(impl);
+   if (impl->mTimers == NULL) {
+      return MAMA_STATUS_INVALID_QUEUE;
+   }
+
+   if (impl->mTimerFd >= 0) {
+      uint64_t expirations;
+      if (read(impl->mTimerFd, &expirations, sizeof(expirations)) < 0) {
+         // EAGAIN => not due yet, but there's no harm in checking
+      }
+   }
+   zmqBridgeMamaQueueImpl_processTimers(impl);
+
+   return MAMA_STATUS_OK;
+}
+
+// fires any timers that are due (must be called on the dispatch thread)
+void zmqBridgeMamaQueueImpl_processTimers(zmqQueueBridge* impl)
+{
+   if (getNanos() < __atomic_load_n(&impl->mTimerDeadline, __ATOMIC_ACQUIRE)) {
+      return;
+   }
+
+   // timers re-armed while we're processing (e.g., by their own callbacks) don't need to wake us up
+   __atomic_store_n(&impl->mTimerDeadline, 0, __ATOMIC_RELEASE);
+
+   // NOTE: callbacks are called w/o the wheel's lock held
+   zmqBridgeMamaTimerWheel_advance(impl->mTimers);
+
+   zmqBridgeMamaTimerWheel_lock(impl->mTimers);
+   uint64_t next = zmqBridgeMamaTimerWheel_getNextExpiry(impl->mTimers);
+   zmqBridgeMamaQueueImpl_setTimerDeadline(impl, (next != 0) ? next : UINT64_MAX);
+   zmqBridgeMamaTimerWheel_unlock(impl->mTimers);
+}
+
+// called w/the wheel's lock held
+void zmqBridgeMamaQueueImpl_setTimerDeadline(zmqQueueBridge* impl, uint64_t deadline)
+{
+   __atomic_store_n(&impl->mTimerDeadline, deadline, __ATOMIC_RELEASE);
+
+   #if defined __linux__
+   if ((impl->mTimerFd >= 0) && (deadline != 0)) {
+      // all zeroes disarms the timer
+      struct itimerspec spec;
+      memset(&spec, '\0', sizeof(spec));
+      if (deadline != UINT64_MAX) {
+         spec.it_value.tv_sec = deadline / 1000000000;
+         spec.it_value.tv_nsec = deadline % 1000000000;
+      }
+      if (timerfd_settime(impl->mTimerFd, TFD_TIMER_ABSTIME, &spec, NULL) != 0) {
+         MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "timerfd_settime failed %d(%s)", errno, strerror(errno));
+      }
+   }
+   #endif
+}
+
+// fires any timers that are due, then waits for an event until the next timer is due (or timeout millis)
+wombatQueueStatus zmqBridgeMamaQueueImpl_timedDispatchTimers(zmqQueueBridge* impl, uint64_t timeout)
+{
+   zmqBridgeMamaQueueImpl_processTimers(impl);
+
+   uint64_t deadline = getNanos() + timeout * 1000000;
+   uint64_t timerDeadline = __atomic_load_n(&impl->mTimerDeadline, __ATOMIC_ACQUIRE);
+   if (timerDeadline < deadline) {
+      deadline = timerDeadline;
+   }
+
+   wombatQueueStatus status = uQueue_timedDispatchUntil(impl->mQueue, deadline);
+   // a timer coming due is not a timeout as far as our caller is concerned
+   if ((status == WOMBAT_QUEUE_TIMEOUT) && (deadline == timerDeadline)) {
+      zmqBridgeMamaQueueImpl_processTimers(impl);
+      status = WOMBAT_QUEUE_OK;
+   }
+
+   return status;
+}
+
 mama_status zmqBridgeMamaQueue_stopDispatch(queueBridge queue)
 {
    zmqQueueBridge* impl = (zmqQueueBridge*) queue;
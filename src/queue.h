@@ -29,9 +29,17 @@
 
 #include <mama/integration/types.h>
 #include <mama/queue.h>
+
+// called on the queue's dispatch thread when msgs start (isStale=1) or stop (isStale=0) waiting longer than
+// the queue's max age to be dispatched
+// NOTE: must precede zmqdefs.h, which uses it
+typedef void (MAMACALLTYPE *zmqQueueAgeCB)(mamaQueue queue, uint64_t age, uint8_t isStale, void* closure);
+
 #include "zmqdefs.h"
+#include "timerwheel.h"
 
 struct zmqTransportMsg_;
+struct zmqQueueBridge;
 
 #define     CHECK_QUEUE(IMPL)                                          \
    do {                                                                \
@@ -39,6 +47,15 @@ struct zmqTransportMsg_;
       if (IMPL->mQueue == NULL)      return MAMA_STATUS_NULL_ARG;      \
    } while(0)
 
+// queues in a group are dispatched by the group's workers (see queuegroup.h)
+#define     CHECK_NOT_GROUPED(IMPL)                                    \
+   do {                                                                \
+      if (IMPL->mGroup != NULL) {                                      \
+         MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Queue %p is dispatched by a queue group", IMPL->mParent); \
+         return MAMA_STATUS_INVALID_QUEUE;                             \
+      }                                                                \
+   } while(0)
+
 /* Timeout is in milliseconds */
 #define     ZMQ_QUEUE_DISPATCH_TIMEOUT     500
 #define     ZMQ_QUEUE_MAX_SIZE             WOMBAT_QUEUE_MAX_SIZE
@@ -51,6 +68,54 @@ extern "C" {
 
 mama_status zmqBridgeMamaQueue_enqueueMsg(queueBridge queue, mamaQueueEnqueueCB callback, struct zmqTransportMsg_ *msg);
 
+// depth of a queue, as reported by zmqBridgeMamaQueue_getAllStats
+typedef struct zmqQueueStats {
+   void*                   mQueue;
+   char                    mName[64];
+   size_t                  mDepth;
+   size_t                  mDepthMax;              // high-water mark (since queue was created)
+   uint64_t                mOldestAge;             // how long the oldest item has been waiting (nanos, w/max age only)
+   uint64_t                mStaleCount;            // items that waited longer than the queue's max age
+   uint64_t                mStaleDrops;            // ... and were dropped
+} zmqQueueStats;
+
+// fills in stats for up to maxQueues queues, and returns the number filled in (safe to call from any thread)
+int zmqBridgeMamaQueue_getAllStats(zmqQueueStats* stats, int maxQueues);
+
+// start keeping latency stats for msgs dispatched from this queue (safe to call more than once, from any thread)
+mama_status zmqBridgeMamaQueue_enableLatency(queueBridge queue);
+
+// sets the max time that items may wait on the queue before being dispatched (zero disables the check)
+// items that wait longer are counted, the first one in any run fires the callback (which may be NULL),
+// and w/dropStale, msgs (but not other events) are discarded rather than dispatched
+MAMAExpDLL
+mama_status zmqBridgeMamaQueue_setMaxAge(mamaQueue queue, uint32_t maxAgeMillis, int dropStale, zmqQueueAgeCB callback, void* closure);
+
+// gets the age of the oldest item on the queue, and the number of items that were stale (and dropped)
+MAMAExpDLL
+mama_status zmqBridgeMamaQueue_getAgeStats(mamaQueue queue, uint64_t* oldestAge, uint64_t* staleCount, uint64_t* staleDrops);
+
+// applies the transport's default max age, unless the queue already has one (safe to call more than once, from any thread)
+mama_status zmqBridgeMamaQueue_applyMaxAge(queueBridge queue, uint32_t maxAgeMillis, int dropStale);
+
+// starts hosting timers on this queue, w/the given resolution (safe to call more than once, from any thread)
+// timers are fired by the queue's dispatcher, w/o a hop through a timer thread
+mama_status zmqBridgeMamaQueue_enableTimers(queueBridge queue, uint64_t tickNanos);
+// (re-)schedules a timer on a queue w/timers enabled (from any thread)
+mama_status zmqBridgeMamaQueue_addTimer(queueBridge queue, zmqTimerWheelEntry* entry, uint64_t delayNanos, zmqTimerWheelCb cb, void* closure);
+mama_status zmqBridgeMamaQueue_cancelTimer(queueBridge queue, zmqTimerWheelEntry* entry);
+
+// for queues dispatched from an application's event loop (e.g., via mamaQueue_setEnqueueCallback) -- returns a
+// file descriptor that becomes readable when timers hosted on the queue are due, at which point the application
+// should call zmqBridgeMamaQueue_processTimers on the queue's dispatch thread (Linux only)
+MAMAExpDLL
+mama_status zmqBridgeMamaQueue_getTimerFd(mamaQueue queue, int* fd);
+MAMAExpDLL
+mama_status zmqBridgeMamaQueue_processTimers(mamaQueue queue);
+
+// dispatches up to maxEvents events w/o waiting, and returns the number dispatched (for queue groups)
+int zmqBridgeMamaQueueImpl_dispatchBatch(struct zmqQueueBridge* impl, int maxEvents);
+
 #if defined(__cplusplus)
 }
 #endif
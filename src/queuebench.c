@@ -1,213 +1,425 @@
-#include <zmq.h>
+//
+// queue microbenchmark -- measures throughput and enqueue-to-dispatch latency of the queues used by OZ,
+// and of alternative queue implementations
+//
+// Queue backends:
+//    uqueue   uQueue, as used by OZ (default)
+//    bridge   zmqBridgeMamaQueue_enqueueEvent/enqueueMsg, i.e., the full path used by the transport
+//    wombat   wombatQueue, as used by the OpenMAMA reference bridges
+//    zmq      zmq inproc PUSH/PULL sockets
+//
+// Payload types:
+//    event    closure only (as for timers and other events)
+//    msg      zmqTransportMsg containing a zmq_msg_t of -s bytes (as for msgs received by the transport) --
+//             with uqueue and bridge the zmqTransportMsg is copied into the queue item, with wombat it is
+//             allocated by the producer and freed by the consumer
+//
+
 #include <unistd.h>
 #include <stdlib.h>
+#include <stdio.h>
 #include <string.h>
+#include <errno.h>
+
+#include <zmq.h>
+#include <mama/mama.h>
+#include <mama/integration/queue.h>
 #include <wombat/port.h>
 #include <wombat/queue.h>
 #include <wombat/wInterlocked.h>
 
-#define QB_SIZE 10000000
-#define QB_MAX_CONS 32
+#include "zmqdefs.h"
+#include "zmqbridgefunctions.h"
+#include "uqueue.h"
+#include "queue.h"
+#include "util.h"
+#include "histogram.h"
+
+#define QB_MAX_THREADS  64
+
+#define QUEUE_UQUEUE    1
+#define QUEUE_BRIDGE    2
+#define QUEUE_WOMBAT    3
+#define QUEUE_ZMQ       4
+
+#define PAYLOAD_EVENT   1
+#define PAYLOAD_MSG     2
+
+typedef struct qbThread {
+   int                     mIdx;
+   wthread_t               mThread;
+   void*                   mSocket;             // zmq only
+   long                    mCount;              // producers: number of items to enqueue
+   uint64_t                mDone;               // time at which thread finished
+   zmqHistogram            mLatency;            // consumers only
+} qbThread;
+
+// options
+int gQueueChoice = QUEUE_UQUEUE;
+int gPayload = PAYLOAD_EVENT;
+int gSize = 100;
+int gProducers = 1;
+int gConsumers = 1;
+long gCount = 10000000;
+int gRate = 0;                                  // per producer
 
-#define QUEUE_WOMBAT 1
-#define QUEUE_ZMQ    2
+void* gCtx = NULL;
+uQueue gUQueue = NULL;
+mamaQueue gParentQueue = NULL;
+queueBridge gBridgeQueue = NULL;
+wombatQueue gWombatQueue = NULL;
+wInterlockedInt gReceived;
+uint64_t gStart = 0;
 
-struct qbn {
-   char mUri[256];
-   wombatQueue mWombatQueue;
-   int mNumSubs;
-   int mNumPubs;
-};
+// each consumer records latency in its own histogram
+__thread zmqHistogram* tLatency = NULL;
 
-struct qbnEndpoint {
-   void* mSocket;
-   int mIdx;
-   struct qbn* mQbn;
-};
 
-void* gCtx = NULL;
-int gDebug = 0;
-int gQueueChoice = 0;
-wInterlockedInt gSentEvents;
-wInterlockedInt gReceivedEvents;
-wthread_mutex_t gLock; /* for multiple readers */
+///////////////////////////////////////////////////////////////////////////////
+// payloads
 
-void wQueueCb(void* data, void* closure)
+static void qbInitMsg(zmqTransportMsg* tmsg, uint64_t now)
 {
-   wInterlocked_increment(&gReceivedEvents);
+   memset(tmsg, '\0', sizeof(zmqTransportMsg));
+   zmq_msg_init_size(&tmsg->mZmsg, gSize);
+   memcpy(zmq_msg_data(&tmsg->mZmsg), &now, sizeof(now));
 }
 
-void* dealer(void* closure)
+static void qbReceived(uint64_t then)
 {
-   struct qbnEndpoint* ep = (struct qbnEndpoint*) closure;
-   struct qbn* newQbn = ep->mQbn;
-   int hwm = 0;
-   int currentSize = 0;
-   int local = 0;
-
-   while ((currentSize = wInterlocked_read(&gSentEvents)) <= QB_SIZE) {
-      if (gQueueChoice == QUEUE_ZMQ) {
-         char buf[6];
-         buf[0] = 'A';
-         buf[1] = '\0';
-
-         memcpy(buf + 2, &currentSize, sizeof(int));
-         wthread_mutex_lock(&gLock);
-         zmq_send(ep->mSocket, buf, 6, 0);
-         wthread_mutex_unlock(&gLock);
-      }
-      if (gQueueChoice == QUEUE_WOMBAT) {
-         wombatQueue_enqueue(newQbn->mWombatQueue, wQueueCb, NULL, NULL);
-      }
-      local++;
-      if (currentSize % 1000000 == 0) {
-         printf("So far spammed %ld messages onto queue %d\n", currentSize, ep->mIdx);
-      }
-      wInterlocked_increment(&gSentEvents);
-   }
-   printf("Done spamming from producer %d (%d messages from here)\n", ep->mIdx, local);
+   uint64_t now = getNanos();
+   zmqBridgeMamaHistogram_record(tLatency, now - then);
+   wInterlocked_increment(&gReceived);
 }
 
-void* worker(void* closure)
+static void qbReceivedMsg(zmqTransportMsg* tmsg)
 {
-   struct qbnEndpoint* ep = (struct qbnEndpoint*) closure;
-   struct qbn* newQbn = ep->mQbn;
-   wombatQueueStatus status;
-   int hwm = 0;
-   int rcvto = 10;
+   uint64_t then;
+   memcpy(&then, zmq_msg_data(&tmsg->mZmsg), sizeof(then));
+   zmq_msg_close(&tmsg->mZmsg);
+   qbReceived(then);
+}
 
-   zmq_msg_t zmsg;
-   zmq_msg_init(&zmsg);
+// called w/closure containing enqueue timestamp
+static void qbEventCb(void* data, void* closure)
+{
+   qbReceived((uint64_t) (uintptr_t) closure);
+}
+
+// called w/pointer to zmqTransportMsg (embedded in queue item)
+static void qbMsgCb(void* data, void* closure)
+{
+   qbReceivedMsg((zmqTransportMsg*) closure);
+}
 
-   int lastSeqNo = 0;
-   int recvSeqNo = 0;
-   int recEv = 0;
-   int local = 0;
-   while ((recEv = wInterlocked_read(&gReceivedEvents)) < QB_SIZE) {
-      if (gQueueChoice == QUEUE_ZMQ) {
-         wthread_mutex_lock(&gLock);
-         int size = zmq_msg_recv(&zmsg, ep->mSocket, ZMQ_DONTWAIT);
-         wthread_mutex_unlock(&gLock);
-         if (size == -1) {
-            continue;
+// called w/pointer to zmqTransportMsg allocated by producer
+static void qbAllocMsgCb(void* data, void* closure)
+{
+   qbReceivedMsg((zmqTransportMsg*) closure);
+   free(closure);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// producer/consumer threads
+
+static int qbEnqueue(qbThread* thread, uint64_t now)
+{
+   zmqTransportMsg tmsg;
+   void* closure = (void*) (uintptr_t) now;
+
+   switch (gQueueChoice) {
+      case QUEUE_UQUEUE:
+         if (gPayload == PAYLOAD_MSG) {
+            qbInitMsg(&tmsg, now);
+            return uQueue_enqueue(gUQueue, qbMsgCb, NULL, &tmsg, 1);
          }
+         return uQueue_enqueue(gUQueue, qbEventCb, NULL, closure, 0);
 
-         memcpy(&recvSeqNo, ((char*)zmq_msg_data(&zmsg)) + 2, sizeof(int));
-         //            if (ep->mQbn->mNumSubs == 1 && recvSeqNo > 0 && recvSeqNo != lastSeqNo + 1)
-         //                printf ("Gap detected - %d != %d\n", recvSeqNo, lastSeqNo + 1);
+      case QUEUE_BRIDGE:
+         if (gPayload == PAYLOAD_MSG) {
+            qbInitMsg(&tmsg, now);
+            return zmqBridgeMamaQueue_enqueueMsg(gBridgeQueue, (mamaQueueEnqueueCB) qbMsgCb, &tmsg);
+         }
+         return zmqBridgeMamaQueue_enqueueEvent(gBridgeQueue, (mamaQueueEnqueueCB) qbEventCb, closure);
 
-         wInterlocked_increment(&gReceivedEvents);
-         lastSeqNo = recvSeqNo;
-         local++;
-      }
-      if (gQueueChoice == QUEUE_WOMBAT) {
-         status = wombatQueue_timedDispatch(newQbn->mWombatQueue, NULL, NULL, 1000);
+      case QUEUE_WOMBAT:
+         if (gPayload == PAYLOAD_MSG) {
+            zmqTransportMsg* pMsg = malloc(sizeof(zmqTransportMsg));
+            qbInitMsg(pMsg, now);
+            return wombatQueue_enqueue(gWombatQueue, qbAllocMsgCb, NULL, pMsg);
+         }
+         return wombatQueue_enqueue(gWombatQueue, qbEventCb, NULL, closure);
+
+      case QUEUE_ZMQ:
+         if (gPayload == PAYLOAD_MSG) {
+            qbInitMsg(&tmsg, now);
+            return (zmq_msg_send(&tmsg.mZmsg, thread->mSocket, 0) < 0) ? -1 : 0;
+         }
+         return (zmq_send(thread->mSocket, &now, sizeof(now), 0) < 0) ? -1 : 0;
+   }
+
+   return -1;
+}
+
+void* producer(void* closure)
+{
+   qbThread* thread = (qbThread*) closure;
+
+   uint64_t interval = (gRate > 0) ? 1000000000 / gRate : 0;
+   uint64_t next = getNanos();
+   for (long i = 0; i < thread->mCount; ++i) {
+      uint64_t now = getNanos();
+      if (interval > 0) {
+         while (now < next) {
+            now = getNanos();
+         }
+         // timestamp w/scheduled time (see "coordinated omission")
+         now = next;
+         next += interval;
       }
-      if (recEv > 0 && recEv % 1000000 == 0) {
-         printf("So far chewed %d messages from queue %d\n", recEv, ep->mIdx);
+      if (qbEnqueue(thread, now) != 0) {
+         fprintf(stderr, "Enqueue failed on producer %d\n", thread->mIdx);
+         exit(3);
       }
    }
+
+   thread->mDone = getNanos();
+   return NULL;
 }
 
-int main(int argc, char* argv[])
+void* consumer(void* closure)
 {
-   int i = 0;
-   int hwm = 0;
-   int rcvto = 100;
-   int pubs = 1;
-   int subs = 1;
+   qbThread* thread = (qbThread*) closure;
+   tLatency = &thread->mLatency;
+
+   zmq_msg_t zmsg;
+   zmq_msg_init(&zmsg);
 
-   /* Create the counter lock. */
-   wInterlocked_initialize(&gSentEvents);
-   wInterlocked_set(0, &gSentEvents);
+   while (wInterlocked_read(&gReceived) < gCount) {
+      switch (gQueueChoice) {
+         case QUEUE_UQUEUE:
+            uQueue_timedDispatch(gUQueue, 10);
+            break;
+
+         case QUEUE_BRIDGE:
+            zmqBridgeMamaQueue_timedDispatch(gBridgeQueue, 10);
+            break;
+
+         case QUEUE_WOMBAT:
+            wombatQueue_timedDispatch(gWombatQueue, NULL, NULL, 10);
+            break;
+
+         case QUEUE_ZMQ:
+            if (zmq_msg_recv(&zmsg, thread->mSocket, 0) >= 0) {
+               uint64_t then;
+               memcpy(&then, zmq_msg_data(&zmsg), sizeof(then));
+               qbReceived(then);
+            }
+            break;
+      }
+   }
+
+   zmq_msg_close(&zmsg);
+   thread->mDone = getNanos();
+   return NULL;
+}
 
-   wInterlocked_initialize(&gReceivedEvents);
-   wInterlocked_set(0, &gReceivedEvents);
 
-   wthread_mutex_init(&gLock, NULL);
+///////////////////////////////////////////////////////////////////////////////
 
-   if (argc == 1 || argc > 4) {
-      printf("Usage: queuebench [wombat|zmq] [producers] [consumers]");
-      exit(1);
+static void usage(void)
+{
+   printf("Usage: queuebench [-q uqueue|bridge|wombat|zmq] [-t event|msg] [-s size] [-p producers] [-c consumers] [-n count] [-r rate]\n");
+   printf("  -q    queue implementation (default: uqueue)\n");
+   printf("  -t    payload type (default: event)\n");
+   printf("  -s    size of zmq msg for msg payloads (default: %d, minimum: %zu)\n", gSize, sizeof(uint64_t));
+   printf("  -p    number of producer threads (default: %d)\n", gProducers);
+   printf("  -c    number of consumer threads (default: %d)\n", gConsumers);
+   printf("  -n    total number of items (default: %ld)\n", gCount);
+   printf("  -r    items/second per producer, 0 for as fast as possible (default: %d)\n", gRate);
+   exit(1);
+}
+
+static const char* queueName(int choice)
+{
+   switch (choice) {
+      case QUEUE_UQUEUE:   return "uqueue";
+      case QUEUE_BRIDGE:   return "bridge";
+      case QUEUE_WOMBAT:   return "wombat";
+      case QUEUE_ZMQ:      return "zmq";
    }
+   return "unknown";
+}
 
-   if (0 == strcmp(argv[1], "wombat")) {
-      gQueueChoice = QUEUE_WOMBAT;
+int main(int argc, char* argv[])
+{
+   int opt;
+   while ((opt = getopt(argc, argv, "q:t:s:p:c:n:r:h")) != -1) {
+      switch (opt) {
+         case 'q':
+            if      (strcmp(optarg, "uqueue") == 0)     gQueueChoice = QUEUE_UQUEUE;
+            else if (strcmp(optarg, "bridge") == 0)     gQueueChoice = QUEUE_BRIDGE;
+            else if (strcmp(optarg, "wombat") == 0)     gQueueChoice = QUEUE_WOMBAT;
+            else if (strcmp(optarg, "zmq") == 0)        gQueueChoice = QUEUE_ZMQ;
+            else usage();
+            break;
+         case 't':
+            if      (strcmp(optarg, "event") == 0)      gPayload = PAYLOAD_EVENT;
+            else if (strcmp(optarg, "msg") == 0)        gPayload = PAYLOAD_MSG;
+            else usage();
+            break;
+         case 's':   gSize = atoi(optarg);         break;
+         case 'p':   gProducers = atoi(optarg);    break;
+         case 'c':   gConsumers = atoi(optarg);    break;
+         case 'n':   gCount = atol(optarg);        break;
+         case 'r':   gRate = atoi(optarg);         break;
+         default:    usage();
+      }
    }
-   else if (0 == strcmp(argv[1], "zmq")) {
-      gQueueChoice = QUEUE_ZMQ;
+   if ((gSize < (int) sizeof(uint64_t)) || (gProducers < 1) || (gProducers > QB_MAX_THREADS)
+      || (gConsumers < 1) || (gConsumers > QB_MAX_THREADS) || (gCount < gProducers) || (gRate < 0)) {
+      usage();
    }
-   else {
-      printf("First arg must be wombat or zmq\n");
+
+   wInterlocked_initialize(&gReceived);
+   wInterlocked_set(0, &gReceived);
+
+   qbThread* producers = calloc(gProducers, sizeof(qbThread));
+   qbThread* consumers = calloc(gConsumers, sizeof(qbThread));
+   if ((producers == NULL) || (consumers == NULL)) {
+      fprintf(stderr, "Unable to allocate threads\n");
       exit(2);
    }
 
-   pubs = atoi(argv[2]);
-   subs = atoi(argv[3]);
-
-   struct qbn* newQbn = calloc(1, sizeof(struct qbn));
-   newQbn->mNumSubs = subs;
-   newQbn->mNumPubs = pubs;
-   wthread_t* subThreads = calloc(subs, sizeof(wthread_t));
-   wthread_t* pubThreads = calloc(pubs, sizeof(wthread_t));
-   struct qbnEndpoint* subEps = calloc(subs, sizeof(struct qbnEndpoint));
-   struct qbnEndpoint* pubEps = calloc(pubs, sizeof(struct qbnEndpoint));
+   switch (gQueueChoice) {
+      case QUEUE_UQUEUE:
+         uQueue_allocate(&gUQueue);
+         uQueue_create(gUQueue, ZMQ_QUEUE_MAX_SIZE, ZMQ_QUEUE_INITIAL_SIZE, ZMQ_QUEUE_CHUNK_SIZE);
+         break;
+
+      case QUEUE_BRIDGE:
+      {
+         // the bridge queue needs a real parent mamaQueue (e.g., for its name in stats and stale-queue logging)
+         mamaBridge bridge = NULL;
+         if ((mama_loadBridge(&bridge, "zmq") != MAMA_STATUS_OK)
+            || (mamaQueue_create(&gParentQueue, bridge) != MAMA_STATUS_OK)) {
+            fprintf(stderr, "Unable to create parent queue\n");
+            exit(2);
+         }
+         mamaQueue_setQueueName(gParentQueue, "queuebench");
+         if (zmqBridgeMamaQueue_create(&gBridgeQueue, gParentQueue) != MAMA_STATUS_OK) {
+            fprintf(stderr, "Unable to create bridge queue\n");
+            exit(2);
+         }
+         zmqBridgeMamaQueue_setHighWatermark(gBridgeQueue, SIZE_MAX);
+         // normally set by zmqBridgeMamaQueue_dispatch -- consumers call timedDispatch, so set it here
+         // to avoid warnings on enqueue
+         wInterlocked_set(1, &((zmqQueueBridge*) gBridgeQueue)->mIsDispatching);
+         break;
+      }
 
-   if (gQueueChoice == QUEUE_ZMQ) {
-      gCtx = zmq_ctx_new();
-      snprintf(newQbn->mUri, sizeof(newQbn->mUri), "inproc://worker");
+      case QUEUE_WOMBAT:
+         wombatQueue_allocate(&gWombatQueue);
+         wombatQueue_create(gWombatQueue, WOMBAT_QUEUE_MAX_SIZE, WOMBAT_QUEUE_CHUNK_SIZE, WOMBAT_QUEUE_CHUNK_SIZE);
+         break;
+
+      case QUEUE_ZMQ:
+      {
+         // each consumer binds its own PULL socket, and each producer connects to all of them
+         // (zmq load-balances between consumers)
+         gCtx = zmq_ctx_new();
+         int hwm = 0;
+         for (int i = 0; i < gConsumers; ++i) {
+            char endpoint[64];
+            snprintf(endpoint, sizeof(endpoint), "inproc://queuebench.%d", i);
+            consumers[i].mSocket = zmq_socket(gCtx, ZMQ_PULL);
+            zmq_setsockopt(consumers[i].mSocket, ZMQ_RCVHWM, &hwm, sizeof(hwm));
+            int rcvto = 10;
+            zmq_setsockopt(consumers[i].mSocket, ZMQ_RCVTIMEO, &rcvto, sizeof(rcvto));
+            zmq_bind(consumers[i].mSocket, endpoint);
+         }
+         for (int i = 0; i < gProducers; ++i) {
+            producers[i].mSocket = zmq_socket(gCtx, ZMQ_PUSH);
+            zmq_setsockopt(producers[i].mSocket, ZMQ_SNDHWM, &hwm, sizeof(hwm));
+            for (int j = 0; j < gConsumers; ++j) {
+               char endpoint[64];
+               snprintf(endpoint, sizeof(endpoint), "inproc://queuebench.%d", j);
+               zmq_connect(producers[i].mSocket, endpoint);
+            }
+         }
+         break;
+      }
    }
 
-   if (gQueueChoice == QUEUE_WOMBAT) {
-      wombatQueue_allocate(&newQbn->mWombatQueue);
-      wombatQueue_create(newQbn->mWombatQueue,
-                         WOMBAT_QUEUE_MAX_SIZE,
-                         WOMBAT_QUEUE_CHUNK_SIZE,
-                         WOMBAT_QUEUE_CHUNK_SIZE);
-   }
+   printf("queuebench: queue=%s payload=%s size=%d producers=%d consumers=%d count=%ld rate=%d\n",
+      queueName(gQueueChoice), (gPayload == PAYLOAD_MSG) ? "msg" : "event", gSize, gProducers, gConsumers, gCount, gRate);
 
-   void* dealerSocket = NULL;
-   for (i = 0; i < pubs; i++) {
-      struct qbnEndpoint* ep = &pubEps[i];
-      ep->mIdx = i;
-      ep->mQbn = newQbn;
-      if (0 == i) {
-         dealerSocket = zmq_socket(gCtx, ZMQ_PUB);
-         zmq_setsockopt(dealerSocket, ZMQ_SNDHWM, &hwm, sizeof(int));
-         zmq_bind(dealerSocket, newQbn->mUri);
-      } // Else reuse the last one
-
-      ep->mSocket = dealerSocket;
+   for (int i = 0; i < gConsumers; ++i) {
+      consumers[i].mIdx = i;
+      zmqBridgeMamaHistogram_init(&consumers[i].mLatency);
+      wthread_create(&consumers[i].mThread, NULL, consumer, &consumers[i]);
    }
 
-   for (i = 0; i < subs; i++) {
-      struct qbnEndpoint* ep = &subEps[i];
-      ep->mIdx = i;
-      ep->mQbn = newQbn;
-      void* workerSocket = zmq_socket(gCtx, ZMQ_SUB);
-      zmq_setsockopt(workerSocket, ZMQ_RCVHWM, &hwm, sizeof(int));
-      zmq_setsockopt(workerSocket, ZMQ_RCVTIMEO, &rcvto, sizeof(int));
-      zmq_setsockopt(workerSocket, ZMQ_SUBSCRIBE, "A", 1);
-      zmq_connect(workerSocket, newQbn->mUri);
-      ep->mSocket = workerSocket;
-
+   gStart = getNanos();
+   for (int i = 0; i < gProducers; ++i) {
+      producers[i].mIdx = i;
+      producers[i].mCount = gCount / gProducers + ((i < gCount % gProducers) ? 1 : 0);
+      wthread_create(&producers[i].mThread, NULL, producer, &producers[i]);
    }
 
-   for (i = 0; i < subs; i++) {
-      wthread_create(&subThreads[i], NULL, worker, &subEps[i]);
+   uint64_t enqueueDone = 0;
+   for (int i = 0; i < gProducers; ++i) {
+      wthread_join(producers[i].mThread, NULL);
+      if (producers[i].mDone > enqueueDone) {
+         enqueueDone = producers[i].mDone;
+      }
    }
 
-   for (i = 0; i < pubs; i++) {
-      wthread_create(&pubThreads[i], NULL, dealer, &pubEps[i]);
+   uint64_t dispatchDone = 0;
+   zmqHistogram* latency = malloc(sizeof(zmqHistogram));
+   zmqBridgeMamaHistogram_init(latency);
+   for (int i = 0; i < gConsumers; ++i) {
+      wthread_join(consumers[i].mThread, NULL);
+      if (consumers[i].mDone > dispatchDone) {
+         dispatchDone = consumers[i].mDone;
+      }
+      zmqBridgeMamaHistogram_merge(latency, &consumers[i].mLatency);
    }
 
-   for (i = 0; i < subs; i++) {
-      wthread_join(subThreads[i], NULL);
+   double enqueueSecs = (enqueueDone - gStart) / 1e9;
+   double dispatchSecs = (dispatchDone - gStart) / 1e9;
+   printf("enqueued   %ld items in %.3f secs (%.0f items/sec)\n", gCount, enqueueSecs, gCount / enqueueSecs);
+   printf("dispatched %ld items in %.3f secs (%.0f items/sec)\n", gCount, dispatchSecs, gCount / dispatchSecs);
+   char buf[512];
+   printf("latency    %s\n", zmqBridgeMamaHistogram_format(latency, buf, sizeof(buf)));
+   if (gConsumers > 1) {
+      for (int i = 0; i < gConsumers; ++i) {
+         printf("  consumer[%d] %s\n", i, zmqBridgeMamaHistogram_format(&consumers[i].mLatency, buf, sizeof(buf)));
+      }
    }
 
-   for (i = 0; i < pubs; i++) {
-      wthread_join(pubThreads[i], NULL);
+   switch (gQueueChoice) {
+      case QUEUE_UQUEUE:   uQueue_destroy(gUQueue);                     break;
+      case QUEUE_BRIDGE:
+         zmqBridgeMamaQueue_destroy(gBridgeQueue);
+         mamaQueue_destroy(gParentQueue);
+         break;
+      case QUEUE_WOMBAT:   wombatQueue_destroy(gWombatQueue);           break;
+      case QUEUE_ZMQ:
+         for (int i = 0; i < gProducers; ++i) {
+            zmq_close(producers[i].mSocket);
+         }
+         for (int i = 0; i < gConsumers; ++i) {
+            zmq_close(consumers[i].mSocket);
+         }
+         zmq_ctx_destroy(gCtx);
+         break;
    }
 
-   printf("Finished chewing through %ld messages across %d producers and %d consumers\n", QB_SIZE, pubs, subs);
+   free(latency);
+   free(producers);
+   free(consumers);
+
+   return 0;
 }
@@ -0,0 +1,434 @@
+//
+// queue groups -- see queuegroup.h
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <mama/mama.h>
+#include <wombat/wInterlocked.h>
+
+#include "zmqdefs.h"
+#include "queue.h"
+#include "uqueue.h"
+#include "queuegroup.h"
+
+// events dispatched from a queue before the worker gives other queues a turn
+#define ZMQ_QUEUEGROUP_BATCH           64
+
+// queue states -- a queue leaves IDLE only under the group's lock, so enqueuing on a queue that is already
+// scheduled or running doesn't need to take the lock
+#define ZMQ_QUEUEGROUP_IDLE            0           // no events (that we know of)
+#define ZMQ_QUEUEGROUP_SCHEDULED       1           // on a worker's run-queue
+#define ZMQ_QUEUEGROUP_RUNNING         2           // being dispatched by a worker
+#define ZMQ_QUEUEGROUP_NOTIFIED        3           // being dispatched, and events have been enqueued since
+
+typedef struct zmqQueueGroupWorker {
+   struct zmqQueueGroup_*  mGroup;
+   int                     mIndex;
+   wthread_t               mThread;
+   zmqQueueBridge*         mHead;               // run-queue
+   zmqQueueBridge*         mTail;
+} zmqQueueGroupWorker;
+
+struct zmqQueueGroup_ {
+   pthread_mutex_t         mLock;               // protects everything, incl. queues' mGroupXxx members
+   pthread_cond_t          mWork;               // signaled when a queue is scheduled, and on stop
+   pthread_cond_t          mIdle;               // signaled when a worker finishes a batch
+   int                     mStop;
+   zmqQueueGroupWorker*    mWorkers;
+   int                     mNumWorkers;
+   zmqQueueBridge**        mMembers;
+   int                     mNumMembers;
+   int                     mMaxMembers;
+   mamaQueue*              mLanes;
+   int                     mNumLanes;
+   uint64_t                mEvents;
+   uint64_t                mBatches;
+   uint64_t                mSteals;
+};
+
+
+///////////////////////////////////////////////////////////////////////////////
+// run-queues
+// The following must be called w/the group's lock held.
+
+static void zmqBridgeMamaQueueGroupImpl_push(zmqQueueGroupWorker* worker, zmqQueueBridge* queue)
+{
+   queue->mGroupNext = NULL;
+   queue->mGroupPrev = worker->mTail;
+   if (worker->mTail != NULL) {
+      worker->mTail->mGroupNext = queue;
+   }
+   else {
+      worker->mHead = queue;
+   }
+   worker->mTail = queue;
+   __atomic_store_n(&queue->mGroupState, ZMQ_QUEUEGROUP_SCHEDULED, __ATOMIC_RELEASE);
+}
+
+
+static void zmqBridgeMamaQueueGroupImpl_unlink(zmqQueueGroupWorker* worker, zmqQueueBridge* queue)
+{
+   if (queue->mGroupPrev != NULL) {
+      queue->mGroupPrev->mGroupNext = queue->mGroupNext;
+   }
+   else {
+      worker->mHead = queue->mGroupNext;
+   }
+   if (queue->mGroupNext != NULL) {
+      queue->mGroupNext->mGroupPrev = queue->mGroupPrev;
+   }
+   else {
+      worker->mTail = queue->mGroupPrev;
+   }
+   queue->mGroupNext = NULL;
+   queue->mGroupPrev = NULL;
+}
+
+
+// takes the next queue from the worker's own run-queue, or failing that steals the most recently scheduled queue
+// from another worker's run-queue (leaving the longest-waiting queues to their own worker)
+static zmqQueueBridge* zmqBridgeMamaQueueGroupImpl_take(struct zmqQueueGroup_* group, zmqQueueGroupWorker* worker)
+{
+   zmqQueueBridge* queue = worker->mHead;
+   if (queue != NULL) {
+      zmqBridgeMamaQueueGroupImpl_unlink(worker, queue);
+      return queue;
+   }
+
+   for (int i = 1; i < group->mNumWorkers; ++i) {
+      zmqQueueGroupWorker* victim = &group->mWorkers[(worker->mIndex + i) % group->mNumWorkers];
+      queue = victim->mTail;
+      if (queue != NULL) {
+         zmqBridgeMamaQueueGroupImpl_unlink(victim, queue);
+         ++group->mSteals;
+         return queue;
+      }
+   }
+
+   return NULL;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// workers
+
+static void* zmqBridgeMamaQueueGroupImpl_worker(void* closure)
+{
+   zmqQueueGroupWorker* worker = (zmqQueueGroupWorker*) closure;
+   struct zmqQueueGroup_* group = worker->mGroup;
+
+   pthread_mutex_lock(&group->mLock);
+   while (group->mStop == 0) {
+      zmqQueueBridge* queue = zmqBridgeMamaQueueGroupImpl_take(group, worker);
+      if (queue == NULL) {
+         pthread_cond_wait(&group->mWork, &group->mLock);
+         continue;
+      }
+      __atomic_store_n(&queue->mGroupState, ZMQ_QUEUEGROUP_RUNNING, __ATOMIC_RELEASE);
+      queue->mGroupWorker = worker->mIndex;
+      pthread_mutex_unlock(&group->mLock);
+
+      int events = zmqBridgeMamaQueueImpl_dispatchBatch(queue, ZMQ_QUEUEGROUP_BATCH);
+
+      pthread_mutex_lock(&group->mLock);
+      group->mEvents += events;
+      ++group->mBatches;
+      // if an event is enqueued after this, the enqueuer either sees the queue as IDLE (and schedules it), or
+      // changes it to NOTIFIED first (and the CAS fails)
+      int size = 0;
+      uQueue_getSize(queue->mQueue, &size);
+      int running = ZMQ_QUEUEGROUP_RUNNING;
+      if ((size > 0) || (!__atomic_compare_exchange_n(&queue->mGroupState, &running, ZMQ_QUEUEGROUP_IDLE, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))) {
+         // more to do -- go to the back of the line, so that other queues get a turn (or another worker takes it)
+         zmqBridgeMamaQueueGroupImpl_push(worker, queue);
+         pthread_cond_signal(&group->mWork);
+      }
+      pthread_cond_broadcast(&group->mIdle);
+   }
+   pthread_mutex_unlock(&group->mLock);
+
+   return NULL;
+}
+
+
+void zmqBridgeMamaQueueGroupImpl_notify(zmqQueueGroup group, zmqQueueBridge* queue)
+{
+   int state = __atomic_load_n(&queue->mGroupState, __ATOMIC_ACQUIRE);
+   while (state != ZMQ_QUEUEGROUP_IDLE) {
+      if (state != ZMQ_QUEUEGROUP_RUNNING) {
+         // already scheduled (or notified)
+         return;
+      }
+      // make sure the worker takes another look once it's done w/its batch
+      if (__atomic_compare_exchange_n(&queue->mGroupState, &state, ZMQ_QUEUEGROUP_NOTIFIED, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+         return;
+      }
+   }
+
+   pthread_mutex_lock(&group->mLock);
+   if ((queue->mGroup == group) && (__atomic_load_n(&queue->mGroupState, __ATOMIC_ACQUIRE) == ZMQ_QUEUEGROUP_IDLE)) {
+      zmqBridgeMamaQueueGroupImpl_push(&group->mWorkers[queue->mGroupWorker], queue);
+      pthread_cond_signal(&group->mWork);
+   }
+   pthread_mutex_unlock(&group->mLock);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// membership
+
+static mama_status zmqBridgeMamaQueueGroupImpl_add(struct zmqQueueGroup_* group, zmqQueueBridge* queue)
+{
+   if (queue->mTimers != NULL) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Queue %p hosts timers, and cannot be added to a queue group", queue->mParent);
+      return MAMA_STATUS_INVALID_QUEUE;
+   }
+   // claim the queue, so that it can't be dispatched both by mamaQueue_dispatch and by the group's workers
+   // (mamaQueue_dispatch does the same)
+   if (!__sync_bool_compare_and_swap(&queue->mIsDispatching, 0, 1)) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Queue %p is being dispatched, and cannot be added to a queue group", queue->mParent);
+      return MAMA_STATUS_INVALID_QUEUE;
+   }
+
+   pthread_mutex_lock(&group->mLock);
+   if (queue->mGroup != NULL) {
+      // (the queue is dispatched by its group, so mIsDispatching stays set)
+      pthread_mutex_unlock(&group->mLock);
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Queue %p is already in a queue group", queue->mParent);
+      return MAMA_STATUS_INVALID_QUEUE;
+   }
+   if (group->mNumMembers == group->mMaxMembers) {
+      int maxMembers = (group->mMaxMembers == 0) ? 16 : group->mMaxMembers * 2;
+      zmqQueueBridge** members = realloc(group->mMembers, maxMembers * sizeof(zmqQueueBridge*));
+      if (members == NULL) {
+         wInterlocked_set(0, &queue->mIsDispatching);
+         pthread_mutex_unlock(&group->mLock);
+         return MAMA_STATUS_NOMEM;
+      }
+      group->mMembers = members;
+      group->mMaxMembers = maxMembers;
+   }
+   group->mMembers[group->mNumMembers++] = queue;
+
+   // spread queues across the workers to start with
+   queue->mGroup = group;
+   queue->mGroupWorker = group->mNumMembers % group->mNumWorkers;
+   __atomic_store_n(&queue->mGroupState, ZMQ_QUEUEGROUP_IDLE, __ATOMIC_RELEASE);
+
+   // events may have been enqueued before the queue was added
+   int size = 0;
+   uQueue_getSize(queue->mQueue, &size);
+   if (size > 0) {
+      zmqBridgeMamaQueueGroupImpl_push(&group->mWorkers[queue->mGroupWorker], queue);
+      pthread_cond_signal(&group->mWork);
+   }
+   pthread_mutex_unlock(&group->mLock);
+
+   return MAMA_STATUS_OK;
+}
+
+
+void zmqBridgeMamaQueueGroupImpl_remove(zmqQueueGroup group, zmqQueueBridge* queue)
+{
+   pthread_mutex_lock(&group->mLock);
+   if (queue->mGroup != group) {
+      pthread_mutex_unlock(&group->mLock);
+      return;
+   }
+
+   // let the current batch finish
+   int state;
+   while (((state = __atomic_load_n(&queue->mGroupState, __ATOMIC_ACQUIRE)) == ZMQ_QUEUEGROUP_RUNNING) || (state == ZMQ_QUEUEGROUP_NOTIFIED)) {
+      pthread_cond_wait(&group->mIdle, &group->mLock);
+   }
+   if (state == ZMQ_QUEUEGROUP_SCHEDULED) {
+      zmqBridgeMamaQueueGroupImpl_unlink(&group->mWorkers[queue->mGroupWorker], queue);
+   }
+
+   for (int i = 0; i < group->mNumMembers; ++i) {
+      if (group->mMembers[i] == queue) {
+         group->mMembers[i] = group->mMembers[--group->mNumMembers];
+         break;
+      }
+   }
+   queue->mGroup = NULL;
+   __atomic_store_n(&queue->mGroupState, ZMQ_QUEUEGROUP_IDLE, __ATOMIC_RELEASE);
+   wInterlocked_set(0, &queue->mIsDispatching);
+   pthread_mutex_unlock(&group->mLock);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// public API
+
+mama_status zmqBridgeMamaQueueGroup_create(zmqQueueGroup* result, mamaBridge bridge, int numThreads, int numLanes)
+{
+   if ((result == NULL) || (bridge == NULL)) {
+      return MAMA_STATUS_NULL_ARG;
+   }
+   if ((numThreads <= 0) || (numLanes < 0)) {
+      return MAMA_STATUS_INVALID_ARG;
+   }
+   *result = NULL;
+
+   struct zmqQueueGroup_* group = calloc(1, sizeof(struct zmqQueueGroup_));
+   if (group == NULL) {
+      return MAMA_STATUS_NOMEM;
+   }
+   group->mWorkers = calloc(numThreads, sizeof(zmqQueueGroupWorker));
+   group->mLanes = calloc((numLanes > 0) ? numLanes : 1, sizeof(mamaQueue));
+   if ((group->mWorkers == NULL) || (group->mLanes == NULL)) {
+      free(group->mWorkers);
+      free(group->mLanes);
+      free(group);
+      return MAMA_STATUS_NOMEM;
+   }
+   pthread_mutex_init(&group->mLock, NULL);
+   pthread_cond_init(&group->mWork, NULL);
+   pthread_cond_init(&group->mIdle, NULL);
+
+   for (int i = 0; i < numThreads; ++i) {
+      zmqQueueGroupWorker* worker = &group->mWorkers[i];
+      worker->mGroup = group;
+      worker->mIndex = i;
+      int rc = wthread_create(&worker->mThread, NULL, zmqBridgeMamaQueueGroupImpl_worker, worker);
+      if (0 != rc) {
+         MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "create of queue group worker failed %d(%s)", rc, strerror(rc));
+         zmqBridgeMamaQueueGroup_destroy(group);
+         return MAMA_STATUS_PLATFORM;
+      }
+      group->mNumWorkers = i + 1;
+   }
+
+   for (int i = 0; i < numLanes; ++i) {
+      mama_status status = mamaQueue_create(&group->mLanes[i], bridge);
+      if (status == MAMA_STATUS_OK) {
+         zmqQueueBridge* queue = NULL;
+         mamaQueue_getNativeHandle(group->mLanes[i], (void**) &queue);
+         group->mNumLanes = i + 1;
+         status = zmqBridgeMamaQueueGroupImpl_add(group, queue);
+      }
+      if (status != MAMA_STATUS_OK) {
+         MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Failed to create queue group lane %d (%s)", i, mamaStatus_stringForStatus(status));
+         zmqBridgeMamaQueueGroup_destroy(group);
+         return status;
+      }
+   }
+
+   *result = group;
+   return MAMA_STATUS_OK;
+}
+
+
+mama_status zmqBridgeMamaQueueGroup_destroy(zmqQueueGroup group)
+{
+   if (group == NULL) {
+      return MAMA_STATUS_NULL_ARG;
+   }
+
+   pthread_mutex_lock(&group->mLock);
+   group->mStop = 1;
+   pthread_cond_broadcast(&group->mWork);
+   pthread_mutex_unlock(&group->mLock);
+   for (int i = 0; i < group->mNumWorkers; ++i) {
+      wthread_join(group->mWorkers[i].mThread, NULL);
+   }
+
+   // any remaining queues can be dispatched by the application from here on
+   for (int i = 0; i < group->mNumMembers; ++i) {
+      zmqQueueBridge* queue = group->mMembers[i];
+      queue->mGroup = NULL;
+      __atomic_store_n(&queue->mGroupState, ZMQ_QUEUEGROUP_IDLE, __ATOMIC_RELEASE);
+      queue->mGroupNext = NULL;
+      queue->mGroupPrev = NULL;
+      wInterlocked_set(0, &queue->mIsDispatching);
+   }
+   for (int i = 0; i < group->mNumLanes; ++i) {
+      mamaQueue_destroy(group->mLanes[i]);
+   }
+
+   pthread_cond_destroy(&group->mIdle);
+   pthread_cond_destroy(&group->mWork);
+   pthread_mutex_destroy(&group->mLock);
+   free(group->mMembers);
+   free(group->mLanes);
+   free(group->mWorkers);
+   free(group);
+
+   return MAMA_STATUS_OK;
+}
+
+
+mama_status zmqBridgeMamaQueueGroup_add(zmqQueueGroup group, mamaQueue queue)
+{
+   if ((group == NULL) || (queue == NULL)) {
+      return MAMA_STATUS_NULL_ARG;
+   }
+
+   zmqQueueBridge* impl = NULL;
+   CALL_MAMA_FUNC(mamaQueue_getNativeHandle(queue, (void**) &impl));
+   CHECK_QUEUE(impl);
+
+   return zmqBridgeMamaQueueGroupImpl_add(group, impl);
+}
+
+
+mama_status zmqBridgeMamaQueueGroup_remove(zmqQueueGroup group, mamaQueue queue)
+{
+   if ((group == NULL) || (queue == NULL)) {
+      return MAMA_STATUS_NULL_ARG;
+   }
+
+   zmqQueueBridge* impl = NULL;
+   CALL_MAMA_FUNC(mamaQueue_getNativeHandle(queue, (void**) &impl));
+   CHECK_QUEUE(impl);
+   if (impl->mGroup != group) {
+      return MAMA_STATUS_INVALID_QUEUE;
+   }
+
+   zmqBridgeMamaQueueGroupImpl_remove(group, impl);
+
+   return MAMA_STATUS_OK;
+}
+
+
+mamaQueue zmqBridgeMamaQueueGroup_getQueue(zmqQueueGroup group, const char* key)
+{
+   if ((group == NULL) || (key == NULL) || (group->mNumLanes == 0)) {
+      return NULL;
+   }
+
+   // FNV-1a
+   uint32_t hash = 2166136261u;
+   for (const char* p = key; *p != '\0'; ++p) {
+      hash ^= (uint8_t) *p;
+      hash *= 16777619u;
+   }
+
+   return group->mLanes[hash % group->mNumLanes];
+}
+
+
+mama_status zmqBridgeMamaQueueGroup_getStats(zmqQueueGroup group, uint64_t* events, uint64_t* batches, uint64_t* steals)
+{
+   if (group == NULL) {
+      return MAMA_STATUS_NULL_ARG;
+   }
+
+   pthread_mutex_lock(&group->mLock);
+   if (events != NULL) {
+      *events = group->mEvents;
+   }
+   if (batches != NULL) {
+      *batches = group->mBatches;
+   }
+   if (steals != NULL) {
+      *steals = group->mSteals;
+   }
+   pthread_mutex_unlock(&group->mLock);
+
+   return MAMA_STATUS_OK;
+}
@@ -0,0 +1,67 @@
+//
+// queue groups -- a pool of worker threads that dispatch a set of queues
+//
+// Normally, each queue is dispatched by its own thread (e.g., in mamaQueue_dispatch), so a busy queue can saturate
+// its thread while other threads are idle.  The queues in a group are instead dispatched by the group's workers:
+// when an event is enqueued on an idle queue, the queue is scheduled on the run-queue of the worker that last
+// dispatched it, and that worker dispatches a batch of events from it before moving on to the next queue.  A worker
+// whose run-queue is empty steals queues from the other workers' run-queues, so load is balanced across the
+// workers w/o having to partition subscriptions across queues up front.
+//
+// A queue is only ever dispatched by one worker at a time, so events on a queue are dispatched in order.  For
+// ordering by key (e.g., by topic), a group can also be created w/a number of "lanes" (queues owned by the
+// group) -- zmqBridgeMamaQueueGroup_getQueue returns the same lane for the same key, so subscriptions created
+// on that lane are dispatched in order, while subscriptions on other lanes are dispatched in parallel.
+//
+// Queues in a group must not be dispatched by the application (mamaQueue_dispatch etc. fail w/
+// MAMA_STATUS_INVALID_QUEUE, as does adding a queue that is being dispatched), and cannot host timers (see timer.queue in Configuration.md) -- timers created on
+// them use the bridge's timer thread instead.  Queues must be removed from the group (or destroyed) before the
+// group is destroyed, and must not have events enqueued on them while they are being removed.
+//
+
+#ifndef MAMA_BRIDGE_ZMQ_QUEUEGROUP_H__
+#define MAMA_BRIDGE_ZMQ_QUEUEGROUP_H__
+
+#include <stdint.h>
+#include <mama/mama.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+typedef struct zmqQueueGroup_* zmqQueueGroup;
+
+struct zmqQueueBridge;
+
+// starts numThreads workers, and creates numLanes queues (which may be zero) for use w/getQueue
+MAMAExpDLL
+mama_status zmqBridgeMamaQueueGroup_create(zmqQueueGroup* group, mamaBridge bridge, int numThreads, int numLanes);
+// stops the workers (after they finish their current batch), and destroys the group's lanes
+MAMAExpDLL
+mama_status zmqBridgeMamaQueueGroup_destroy(zmqQueueGroup group);
+
+// adds/removes an application queue (remove waits for the queue's current batch, if any, to be dispatched)
+MAMAExpDLL
+mama_status zmqBridgeMamaQueueGroup_add(zmqQueueGroup group, mamaQueue queue);
+MAMAExpDLL
+mama_status zmqBridgeMamaQueueGroup_remove(zmqQueueGroup group, mamaQueue queue);
+
+// returns the group's lane for key (or NULL if the group has no lanes)
+MAMAExpDLL
+mamaQueue zmqBridgeMamaQueueGroup_getQueue(zmqQueueGroup group, const char* key);
+
+// totals since the group was created: events dispatched, batches dispatched, and batches stolen from another
+// worker's run-queue
+MAMAExpDLL
+mama_status zmqBridgeMamaQueueGroup_getStats(zmqQueueGroup group, uint64_t* events, uint64_t* batches, uint64_t* steals);
+
+// called by the queue after an event is enqueued on it (from any thread)
+void zmqBridgeMamaQueueGroupImpl_notify(zmqQueueGroup group, struct zmqQueueBridge* queue);
+// called by the queue when it is destroyed
+void zmqBridgeMamaQueueGroupImpl_remove(zmqQueueGroup group, struct zmqQueueBridge* queue);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* MAMA_BRIDGE_ZMQ_QUEUEGROUP_H__ */
@@ -0,0 +1,393 @@
+//
+// shared zmq context and dispatch reactors -- see reactor.h
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include <mama/mama.h>
+#include <wombat/wInterlocked.h>
+
+#include "zmqdefs.h"
+#include "transport.h"
+#include "reactor.h"
+
+// commands sent to a reactor on its wake socket
+typedef struct zmqReactorCmd {
+   char                    mCommand;            // "A" (attach transport) or "X" (exit)
+   zmqTransportBridge*     mTransport;
+   // for "A", if the reactor's arrays need to grow: replacement arrays allocated by the attaching thread
+   // (so that allocation failures can be returned to the caller), which the reactor swaps in
+   int                     mMaxTransports;
+   zmqTransportBridge**    mTransports;
+   int*                    mOffsets;
+   zmq_pollitem_t*         mItems;
+} zmqReactorCmd;
+
+typedef struct zmqReactor {
+   int                     mIndex;
+   wthread_t               mThread;
+   void*                   mWakeSub;            // PULL -- polled by the reactor
+   void*                   mWakePub;            // PUSH -- protected by gReactorLock
+   int                     mLoad;               // number of transports attached (or being attached), protected by gReactorLock
+   int                     mCapacity;           // size of arrays once pending commands are processed, protected by gReactorLock
+
+   // reactor thread only
+   zmqTransportBridge**    mTransports;
+   int*                    mOffsets;            // index of each transport's first item in mItems
+   int                     mNumTransports;
+   int                     mMaxTransports;
+   zmq_pollitem_t*         mItems;
+} zmqReactor;
+
+// protects all of the following
+static pthread_mutex_t     gReactorLock = PTHREAD_MUTEX_INITIALIZER;
+static void*               gContext = NULL;
+static int                 gContextRefs = 0;
+static zmqReactor*         gReactors = NULL;
+static int                 gNumReactors = 0;
+static int                 gReactorRefs = 0;
+static unsigned int        gPoolGeneration = 0;  // keeps inproc endpoints unique if the pool is re-created
+
+
+///////////////////////////////////////////////////////////////////////////////
+// shared context
+
+static mama_status zmqBridgeMamaReactorImpl_acquireContext(void** context, int ioThreads)
+{
+   if (gContext == NULL) {
+      gContext = zmq_ctx_new();
+      if (gContext == NULL) {
+         MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Unable to allocate zmq context - error %d(%s)", errno, zmq_strerror(errno));
+         return MAMA_STATUS_PLATFORM;
+      }
+      zmq_ctx_set(gContext, ZMQ_IO_THREADS, ioThreads);
+      MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Created shared zmq context w/%d i/o threads", ioThreads);
+   }
+   ++gContextRefs;
+   *context = gContext;
+
+   return MAMA_STATUS_OK;
+}
+
+
+static void zmqBridgeMamaReactorImpl_releaseContext(void)
+{
+   if (--gContextRefs > 0) {
+      return;
+   }
+
+   zmq_ctx_shutdown(gContext);
+   zmq_ctx_term(gContext);
+   gContext = NULL;
+}
+
+
+mama_status zmqBridgeMamaReactor_acquireContext(void** context, int ioThreads)
+{
+   pthread_mutex_lock(&gReactorLock);
+   mama_status status = zmqBridgeMamaReactorImpl_acquireContext(context, ioThreads);
+   pthread_mutex_unlock(&gReactorLock);
+
+   return status;
+}
+
+
+void zmqBridgeMamaReactor_releaseContext(void)
+{
+   pthread_mutex_lock(&gReactorLock);
+   zmqBridgeMamaReactorImpl_releaseContext();
+   pthread_mutex_unlock(&gReactorLock);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// reactor thread
+
+static void zmqBridgeMamaReactorImpl_addTransport(zmqReactor* reactor, zmqReactorCmd* cmd)
+{
+   if (cmd->mMaxTransports > 0) {
+      // items are rebuilt on every pass, so only the transports need to be copied
+      memcpy(cmd->mTransports, reactor->mTransports, reactor->mNumTransports * sizeof(zmqTransportBridge*));
+      free(reactor->mTransports);
+      free(reactor->mOffsets);
+      free(reactor->mItems);
+      reactor->mTransports = cmd->mTransports;
+      reactor->mOffsets = cmd->mOffsets;
+      reactor->mItems = cmd->mItems;
+      reactor->mMaxTransports = cmd->mMaxTransports;
+   }
+
+   // attach guarantees room for every transport it has sent
+   zmqTransportBridge* impl = cmd->mTransport;
+   zmqBridgeMamaTransportImpl_dispatchBegin(impl);
+   reactor->mTransports[reactor->mNumTransports++] = impl;
+   MAMA_LOG(MAMA_LOG_LEVEL_FINE, "Reactor %d dispatching transport %s (%d transports)", reactor->mIndex, impl->mName, reactor->mNumTransports);
+}
+
+
+// detaches transports that have stopped dispatching (i.e., have processed their exit command)
+static void zmqBridgeMamaReactorImpl_removeStopped(zmqReactor* reactor)
+{
+   int i = 0;
+   while (i < reactor->mNumTransports) {
+      zmqTransportBridge* impl = reactor->mTransports[i];
+      if (wInterlocked_read(&impl->mIsDispatching) == 1) {
+         ++i;
+         continue;
+      }
+      zmqBridgeMamaTransportImpl_dispatchEnd(impl);
+      reactor->mTransports[i] = reactor->mTransports[--reactor->mNumTransports];
+      MAMA_LOG(MAMA_LOG_LEVEL_FINE, "Reactor %d stopped dispatching transport %s (%d transports)", reactor->mIndex, impl->mName, reactor->mNumTransports);
+      // NOTE: impl may be destroyed as soon as this is posted
+      wsem_post(&impl->mDispatchDone);
+   }
+}
+
+
+static void* zmqBridgeMamaReactorImpl_run(void* closure)
+{
+   zmqReactor* reactor = (zmqReactor*) closure;
+
+   zmq_msg_t zmsg;
+   zmq_msg_init(&zmsg);
+
+   zmq_pollitem_t wakeItem = { reactor->mWakeSub, 0, ZMQ_POLLIN, 0 };
+   int isRunning = 1;
+   while (isRunning) {
+      // the wake socket is always first, followed by the items for each transport -- the poll timeout is the
+      // shortest of any of the transports' timeouts
+      zmq_pollitem_t* items = (reactor->mItems != NULL) ? reactor->mItems : &wakeItem;
+      items[0] = wakeItem;
+      int numItems = 1;
+      long timeout = -1;
+      for (int i = 0; i < reactor->mNumTransports; ++i) {
+         zmqTransportBridge* impl = reactor->mTransports[i];
+         reactor->mOffsets[i] = numItems;
+         numItems += zmqBridgeMamaTransportImpl_pollItems(impl, &items[numItems]);
+         long transportTimeout = zmqBridgeMamaTransportImpl_pollTimeout(impl);
+         if ((transportTimeout >= 0) && ((timeout < 0) || (timeout > transportTimeout))) {
+            timeout = transportTimeout;
+         }
+      }
+
+      int rc = zmq_poll(items, numItems, timeout);
+      if ((rc < 0) && (errno != EINTR)) {
+         MAMA_LOG(MAMA_LOG_LEVEL_SEVERE, "zmq_poll failed  %d(%s)", errno, zmq_strerror(errno));
+         continue;
+      }
+
+      for (int i = 0; i < reactor->mNumTransports; ++i) {
+         zmqBridgeMamaTransportImpl_dispatchReady(reactor->mTransports[i], &items[reactor->mOffsets[i]], &zmsg);
+      }
+      zmqBridgeMamaReactorImpl_removeStopped(reactor);
+
+      // drain reactor commands
+      if (items[0].revents & ZMQ_POLLIN) {
+         zmqReactorCmd cmd;
+         while (zmq_recv(reactor->mWakeSub, &cmd, sizeof(cmd), ZMQ_DONTWAIT) == sizeof(cmd)) {
+            if (cmd.mCommand == 'A') {
+               zmqBridgeMamaReactorImpl_addTransport(reactor, &cmd);
+            }
+            else if (cmd.mCommand == 'X') {
+               isRunning = 0;
+            }
+            else {
+               MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Unknown command=%c", cmd.mCommand);
+            }
+         }
+      }
+   }
+
+   zmq_msg_close(&zmsg);
+
+   return NULL;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// reactor pool
+// The following must be called w/gReactorLock held.
+
+static mama_status zmqBridgeMamaReactorImpl_send(zmqReactor* reactor, zmqReactorCmd* cmd)
+{
+   if (zmq_send(reactor->mWakePub, cmd, sizeof(*cmd), 0) != sizeof(*cmd)) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "zmq_send failed  %d(%s)", zmq_errno(), zmq_strerror(zmq_errno()));
+      return MAMA_STATUS_PLATFORM;
+   }
+
+   return MAMA_STATUS_OK;
+}
+
+
+static mama_status zmqBridgeMamaReactorImpl_sendCommand(zmqReactor* reactor, char command, zmqTransportBridge* impl)
+{
+   zmqReactorCmd cmd;
+   memset(&cmd, '\0', sizeof(cmd));
+   cmd.mCommand = command;
+   cmd.mTransport = impl;
+   return zmqBridgeMamaReactorImpl_send(reactor, &cmd);
+}
+
+
+// sends an attach command for impl, w/larger arrays if the reactor will need them
+static mama_status zmqBridgeMamaReactorImpl_sendAttach(zmqReactor* reactor, zmqTransportBridge* impl)
+{
+   zmqReactorCmd cmd;
+   memset(&cmd, '\0', sizeof(cmd));
+   cmd.mCommand = 'A';
+   cmd.mTransport = impl;
+
+   if (reactor->mLoad == reactor->mCapacity) {
+      cmd.mMaxTransports = (reactor->mCapacity == 0) ? 4 : reactor->mCapacity * 2;
+      cmd.mTransports = malloc(cmd.mMaxTransports * sizeof(zmqTransportBridge*));
+      cmd.mOffsets = malloc(cmd.mMaxTransports * sizeof(int));
+      cmd.mItems = malloc((1 + cmd.mMaxTransports * ZMQ_MAX_DISPATCH_ITEMS) * sizeof(zmq_pollitem_t));
+      if ((cmd.mTransports == NULL) || (cmd.mOffsets == NULL) || (cmd.mItems == NULL)) {
+         MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Reactor %d unable to attach transport %s", reactor->mIndex, impl->mName);
+         free(cmd.mTransports);
+         free(cmd.mOffsets);
+         free(cmd.mItems);
+         return MAMA_STATUS_NOMEM;
+      }
+   }
+
+   mama_status status = zmqBridgeMamaReactorImpl_send(reactor, &cmd);
+   if (status != MAMA_STATUS_OK) {
+      free(cmd.mTransports);
+      free(cmd.mOffsets);
+      free(cmd.mItems);
+      return status;
+   }
+   if (cmd.mMaxTransports > 0) {
+      reactor->mCapacity = cmd.mMaxTransports;
+   }
+
+   return MAMA_STATUS_OK;
+}
+
+
+static void zmqBridgeMamaReactorImpl_destroyPool(void)
+{
+   for (int i = 0; i < gNumReactors; ++i) {
+      zmqReactor* reactor = &gReactors[i];
+      if (reactor->mThread != 0) {
+         zmqBridgeMamaReactorImpl_sendCommand(reactor, 'X', NULL);
+         wthread_join(reactor->mThread, NULL);
+      }
+      if (reactor->mWakePub != NULL) {
+         zmq_close(reactor->mWakePub);
+      }
+      if (reactor->mWakeSub != NULL) {
+         zmq_close(reactor->mWakeSub);
+      }
+      free(reactor->mTransports);
+      free(reactor->mOffsets);
+      free(reactor->mItems);
+   }
+   free(gReactors);
+   gReactors = NULL;
+   gNumReactors = 0;
+
+   zmqBridgeMamaReactorImpl_releaseContext();
+}
+
+
+static mama_status zmqBridgeMamaReactorImpl_createPool(int numReactors, int ioThreads)
+{
+   void* context = NULL;
+   CALL_MAMA_FUNC(zmqBridgeMamaReactorImpl_acquireContext(&context, ioThreads));
+
+   gReactors = calloc(numReactors, sizeof(zmqReactor));
+   if (gReactors == NULL) {
+      zmqBridgeMamaReactorImpl_releaseContext();
+      return MAMA_STATUS_NOMEM;
+   }
+   gNumReactors = numReactors;
+   ++gPoolGeneration;
+
+   for (int i = 0; i < numReactors; ++i) {
+      zmqReactor* reactor = &gReactors[i];
+      reactor->mIndex = i;
+
+      char endpoint[ZMQ_MAX_ENDPOINT_LENGTH +1];
+      snprintf(endpoint, sizeof(endpoint), "inproc://reactor.%u.%d", gPoolGeneration, i);
+      int linger = 0;
+      reactor->mWakeSub = zmq_socket(context, ZMQ_PULL);
+      reactor->mWakePub = zmq_socket(context, ZMQ_PUSH);
+      if ((reactor->mWakeSub == NULL) || (reactor->mWakePub == NULL)
+         || (zmq_setsockopt(reactor->mWakeSub, ZMQ_LINGER, &linger, sizeof(linger)) != 0)
+         || (zmq_setsockopt(reactor->mWakePub, ZMQ_LINGER, &linger, sizeof(linger)) != 0)
+         || (zmq_bind(reactor->mWakeSub, endpoint) != 0)
+         || (zmq_connect(reactor->mWakePub, endpoint) != 0)) {
+         MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Unable to create reactor sockets - error %d(%s)", zmq_errno(), zmq_strerror(zmq_errno()));
+         zmqBridgeMamaReactorImpl_destroyPool();
+         return MAMA_STATUS_PLATFORM;
+      }
+
+      int rc = wthread_create(&reactor->mThread, NULL, zmqBridgeMamaReactorImpl_run, reactor);
+      if (0 != rc) {
+         MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "create of reactor thread failed %d(%s)", rc, strerror(rc));
+         reactor->mThread = 0;
+         zmqBridgeMamaReactorImpl_destroyPool();
+         return MAMA_STATUS_PLATFORM;
+      }
+   }
+
+   MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Created pool of %d reactors", numReactors);
+   return MAMA_STATUS_OK;
+}
+
+
+mama_status zmqBridgeMamaReactor_attach(zmqTransportBridge* impl)
+{
+   pthread_mutex_lock(&gReactorLock);
+
+   if (gNumReactors == 0) {
+      mama_status status = zmqBridgeMamaReactorImpl_createPool(impl->mNumReactors, impl->mIoThreads);
+      if (status != MAMA_STATUS_OK) {
+         pthread_mutex_unlock(&gReactorLock);
+         return status;
+      }
+   }
+   else if (impl->mNumReactors != gNumReactors) {
+      MAMA_LOG(MAMA_LOG_LEVEL_WARN, "Transport %s specifies %d reactors, but the pool already has %d", impl->mName, impl->mNumReactors, gNumReactors);
+   }
+
+   // pick the least-loaded reactor
+   zmqReactor* reactor = &gReactors[0];
+   for (int i = 1; i < gNumReactors; ++i) {
+      if (gReactors[i].mLoad < reactor->mLoad) {
+         reactor = &gReactors[i];
+      }
+   }
+
+   mama_status status = zmqBridgeMamaReactorImpl_sendAttach(reactor, impl);
+   if (status == MAMA_STATUS_OK) {
+      ++reactor->mLoad;
+      ++gReactorRefs;
+      impl->mReactor = reactor;
+   }
+   else if (gReactorRefs == 0) {
+      zmqBridgeMamaReactorImpl_destroyPool();
+   }
+
+   pthread_mutex_unlock(&gReactorLock);
+   return status;
+}
+
+
+void zmqBridgeMamaReactor_detach(zmqTransportBridge* impl)
+{
+   pthread_mutex_lock(&gReactorLock);
+
+   --impl->mReactor->mLoad;
+   impl->mReactor = NULL;
+   if (--gReactorRefs == 0) {
+      zmqBridgeMamaReactorImpl_destroyPool();
+   }
+
+   pthread_mutex_unlock(&gReactorLock);
+}
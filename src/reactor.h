@@ -0,0 +1,44 @@
+//
+// shared zmq context and dispatch reactors
+//
+// By default, each transport has its own zmq context (w/its own i/o and reaper threads), dispatch thread and
+// monitor thread.  W/shared_context set, transports share a single process-wide context instead, which is
+// terminated when the last transport using it is destroyed.  W/reactors set, transports are dispatched by a
+// process-wide pool of reactor threads: each reactor polls the sockets (including the monitor sockets) of all the
+// transports attached to it, and calls the same dispatch functions that a transport's own dispatch thread would.
+// A transport is attached to the reactor w/the fewest transports when it is started, and detached when it is
+// stopped.  The pool is created w/the number of reactors requested by the first transport that uses it, and is
+// destroyed when the last transport using it is stopped.
+//
+// Note that a transport's dispatch functions all run on the reactor's thread, so that a transport that is slow to
+// dispatch delays the other transports on the same reactor.
+//
+
+#ifndef MAMA_BRIDGE_ZMQ_REACTOR_H__
+#define MAMA_BRIDGE_ZMQ_REACTOR_H__
+
+#include <mama/mama.h>
+
+#include "zmqdefs.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+// returns the process-wide context, creating it (w/ioThreads i/o threads) if necessary
+mama_status zmqBridgeMamaReactor_acquireContext(void** context, int ioThreads);
+// terminates the process-wide context when the last transport using it releases it
+// (all of the caller's sockets must have been closed)
+void zmqBridgeMamaReactor_releaseContext(void);
+
+// starts dispatching the transport on one of the reactors, creating the pool if necessary
+mama_status zmqBridgeMamaReactor_attach(zmqTransportBridge* impl);
+// called once the reactor has stopped dispatching the transport (i.e., mDispatchDone has been posted) -- destroys
+// the pool if this was the last transport using it
+void zmqBridgeMamaReactor_detach(zmqTransportBridge* impl);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* MAMA_BRIDGE_ZMQ_REACTOR_H__ */
@@ -0,0 +1,472 @@
+//
+// shared-memory ring -- single-producer, multi-consumer ring buffer in /dev/shm used to deliver
+// msgs to peers on the same host w/o going through zmq
+//
+// The writer appends variable-length records and advances mCommitPos once a record is complete.
+// Readers keep their own position, and detect being overrun by the writer the same way a seqlock
+// does: the writer advances mReservePos *before* it starts overwriting data, and readers check
+// mReservePos *after* copying a record -- if the writer has reserved space that overlaps the record,
+// the copy is discarded.
+//
+// Rather than polling the ring, a reader can register a wakeup socket (an abstract unix datagram socket, so
+// Linux only) in one of the slots in the ring's header.  Before it blocks, the reader sets its bit in mWakeMask
+// and re-checks mCommitPos; after committing a record, the writer checks mWakeMask, and sends a datagram to each
+// reader whose bit was set (clearing the bits as it does so).  The writer thus only makes a system call when a
+// reader is (about to be) blocked, and the reader's wakeup socket can be polled along w/its zmq sockets.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <stddef.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <mama/mama.h>
+
+#include "util.h"
+#include "shmring.h"
+
+#define ZMQ_SHMRING_MAGIC        0x4f5a5348     // "OZSH"
+#define ZMQ_SHMRING_VERSION      2
+#define ZMQ_SHMRING_HEADER_SIZE  4096           // data starts on its own page
+#define ZMQ_SHMRING_ALIGN        8
+#define ZMQ_SHMRING_MODE         0600           // rings carry all published data, so are only readable by the owner
+#define ZMQ_SHMRING_MAX_READERS  32             // readers that can be woken (others must poll)
+
+#define ZMQ_SHMRING_RECORD_MSG   1
+#define ZMQ_SHMRING_RECORD_PAD   2              // skip to start of ring
+
+typedef struct zmqShmReaderSlot_ {
+   int32_t                 mPid;                // owner of the slot (0 => free)
+   uint32_t                mReserved;
+   char                    mWakeName[56];       // name of reader's wakeup socket
+} zmqShmReaderSlot;
+
+typedef struct zmqShmRingHeader_ {
+   uint32_t                mMagic;
+   uint32_t                mVersion;
+   uint64_t                mCapacity;           // size of data area (power of 2)
+   char                    mPad1[48];
+   uint64_t                mReservePos;         // writer is (or has been) writing up to here
+   char                    mPad2[56];
+   uint64_t                mCommitPos;          // records are complete up to here
+   char                    mPad3[56];
+   uint64_t                mWakeMask;           // readers that are waiting to be woken (bit per slot)
+   char                    mPad4[56];
+   zmqShmReaderSlot        mReaders[ZMQ_SHMRING_MAX_READERS];
+} zmqShmRingHeader;
+
+typedef struct zmqShmRecord_ {
+   uint32_t                mSize;               // size of data (not including this header)
+   uint32_t                mType;
+} zmqShmRecord;
+
+struct zmqShmRing_ {
+   char*                   mName;
+   int                     mIsOwner;
+   size_t                  mMapSize;
+   zmqShmRingHeader*       mHeader;
+   uint8_t*                mData;
+   uint64_t                mCapacity;
+   uint64_t                mMaxRecord;          // largest record that can be written
+   uint64_t                mReadPos;            // reader only
+   long long               mLost;               // reader only
+   int                     mSlot;               // reader only (-1 => no wakeups)
+   int                     mWakeFd;             // writer only -- used to send wakeups
+};
+
+
+static socklen_t zmqBridgeMamaShmRingImpl_wakeAddr(struct sockaddr_un* addr, const char* name)
+{
+   // abstract namespace -- leading NUL, not NUL-terminated
+   memset(addr, '\0', sizeof(struct sockaddr_un));
+   addr->sun_family = AF_UNIX;
+   size_t len = strnlen(name, sizeof(addr->sun_path) -1);
+   memcpy(&addr->sun_path[1], name, len);
+   return (socklen_t) (offsetof(struct sockaddr_un, sun_path) + 1 + len);
+}
+
+
+static void zmqBridgeMamaShmRingImpl_wake(zmqShmRing* ring)
+{
+   zmqShmRingHeader* header = ring->mHeader;
+   uint64_t mask = __atomic_exchange_n(&header->mWakeMask, 0, __ATOMIC_ACQ_REL);
+   for (int i = 0; (mask != 0) && (i < ZMQ_SHMRING_MAX_READERS); ++i, mask >>= 1) {
+      if (mask & 1) {
+         char name[sizeof(header->mReaders[i].mWakeName)];
+         memcpy(name, header->mReaders[i].mWakeName, sizeof(name));
+         name[sizeof(name) -1] = '\0';
+         struct sockaddr_un addr;
+         socklen_t len = zmqBridgeMamaShmRingImpl_wakeAddr(&addr, name);
+         // failure just means the reader is gone (or will find the msgs on its next poll)
+         (void) sendto(ring->mWakeFd, "w", 1, MSG_DONTWAIT, (struct sockaddr*) &addr, len);
+      }
+   }
+}
+
+
+// claims a slot in the ring's header for the reader's wakeup socket -- slots of processes that have died
+// w/o detaching are reclaimed
+static int zmqBridgeMamaShmRingImpl_claimSlot(zmqShmRing* ring, const char* wakeName)
+{
+   zmqShmRingHeader* header = ring->mHeader;
+   int32_t pid = (int32_t) getpid();
+   for (int pass = 0; pass < 2; ++pass) {
+      for (int i = 0; i < ZMQ_SHMRING_MAX_READERS; ++i) {
+         zmqShmReaderSlot* slot = &header->mReaders[i];
+         int32_t owner = __atomic_load_n(&slot->mPid, __ATOMIC_ACQUIRE);
+         if ((pass == 1) && (owner != 0) && (kill(owner, 0) == 0 || errno != ESRCH)) {
+            continue;
+         }
+         if ((pass == 0) && (owner != 0)) {
+            continue;
+         }
+         if (__atomic_compare_exchange_n(&slot->mPid, &owner, pid, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            __atomic_and_fetch(&header->mWakeMask, ~((uint64_t) 1 << i), __ATOMIC_ACQ_REL);
+            strncpy(slot->mWakeName, wakeName, sizeof(slot->mWakeName) -1);
+            slot->mWakeName[sizeof(slot->mWakeName) -1] = '\0';
+            return i;
+         }
+      }
+   }
+
+   return -1;
+}
+
+
+static size_t zmqBridgeMamaShmRingImpl_align(size_t size)
+{
+   return (size + ZMQ_SHMRING_ALIGN -1) & ~((size_t) ZMQ_SHMRING_ALIGN -1);
+}
+
+
+static mama_status zmqBridgeMamaShmRingImpl_map(zmqShmRing* ring, int fd, int prot)
+{
+   void* addr = mmap(NULL, ring->mMapSize, prot, MAP_SHARED, fd, 0);
+   if (addr == MAP_FAILED) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "mmap(%s) failed %d(%s)", ring->mName, errno, strerror(errno));
+      return MAMA_STATUS_PLATFORM;
+   }
+
+   ring->mHeader = (zmqShmRingHeader*) addr;
+   ring->mData = (uint8_t*) addr + ZMQ_SHMRING_HEADER_SIZE;
+   return MAMA_STATUS_OK;
+}
+
+
+mama_status zmqBridgeMamaShmRing_create(zmqShmRing** result, const char* name, size_t size)
+{
+   // round capacity up to a power of 2
+   uint64_t capacity = 4096;
+   while (capacity < size) {
+      capacity *= 2;
+   }
+
+   zmqShmRing* ring = calloc(1, sizeof(zmqShmRing));
+   if (ring == NULL) {
+      return MAMA_STATUS_NOMEM;
+   }
+   ring->mName = strdup(name);
+   ring->mIsOwner = 1;
+   ring->mCapacity = capacity;
+   ring->mMaxRecord = capacity / 4;
+   ring->mMapSize = ZMQ_SHMRING_HEADER_SIZE + capacity;
+
+   int fd = shm_open(name, O_CREAT | O_TRUNC | O_RDWR, ZMQ_SHMRING_MODE);
+   if (fd < 0) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "shm_open(%s) failed %d(%s)", name, errno, strerror(errno));
+      free(ring->mName);
+      free(ring);
+      return MAMA_STATUS_PLATFORM;
+   }
+   if (ftruncate(fd, ring->mMapSize) != 0) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "ftruncate(%s) failed %d(%s)", name, errno, strerror(errno));
+      close(fd);
+      shm_unlink(name);
+      free(ring->mName);
+      free(ring);
+      return MAMA_STATUS_PLATFORM;
+   }
+   mama_status status = zmqBridgeMamaShmRingImpl_map(ring, fd, PROT_READ | PROT_WRITE);
+   close(fd);
+   if (status != MAMA_STATUS_OK) {
+      shm_unlink(name);
+      free(ring->mName);
+      free(ring);
+      return status;
+   }
+
+   ring->mWakeFd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+   ring->mSlot = -1;
+
+   ring->mHeader->mVersion = ZMQ_SHMRING_VERSION;
+   ring->mHeader->mCapacity = capacity;
+   ring->mHeader->mReservePos = 0;
+   ring->mHeader->mCommitPos = 0;
+   // readers check magic last
+   __atomic_store_n(&ring->mHeader->mMagic, ZMQ_SHMRING_MAGIC, __ATOMIC_RELEASE);
+
+   *result = ring;
+   return MAMA_STATUS_OK;
+}
+
+
+void zmqBridgeMamaShmRing_destroy(zmqShmRing* ring)
+{
+   if (ring == NULL) {
+      return;
+   }
+
+   if (ring->mSlot >= 0) {
+      zmqShmRingHeader* header = ring->mHeader;
+      __atomic_and_fetch(&header->mWakeMask, ~((uint64_t) 1 << ring->mSlot), __ATOMIC_ACQ_REL);
+      __atomic_store_n(&header->mReaders[ring->mSlot].mPid, 0, __ATOMIC_RELEASE);
+   }
+   munmap(ring->mHeader, ring->mMapSize);
+   if (ring->mIsOwner == 1) {
+      shm_unlink(ring->mName);
+   }
+   if (ring->mWakeFd >= 0) {
+      close(ring->mWakeFd);
+   }
+   free(ring->mName);
+   free(ring);
+}
+
+
+mama_status zmqBridgeMamaShmRing_attach(zmqShmRing** result, const char* name, const char* wakeName)
+{
+   // read-write, since readers register for wakeups in the header
+   int fd = shm_open(name, O_RDWR, 0);
+   if (fd < 0) {
+      MAMA_LOG(MAMA_LOG_LEVEL_FINE, "shm_open(%s) failed %d(%s)", name, errno, strerror(errno));
+      return MAMA_STATUS_NOT_FOUND;
+   }
+
+   struct stat st;
+   if ((fstat(fd, &st) != 0) || (st.st_size <= ZMQ_SHMRING_HEADER_SIZE)) {
+      MAMA_LOG(MAMA_LOG_LEVEL_WARN, "shm ring %s has invalid size", name);
+      close(fd);
+      return MAMA_STATUS_INVALID_ARG;
+   }
+
+   zmqShmRing* ring = calloc(1, sizeof(zmqShmRing));
+   if (ring == NULL) {
+      close(fd);
+      return MAMA_STATUS_NOMEM;
+   }
+   ring->mName = strdup(name);
+   ring->mIsOwner = 0;
+   ring->mMapSize = st.st_size;
+   ring->mSlot = -1;
+   ring->mWakeFd = -1;
+
+   mama_status status = zmqBridgeMamaShmRingImpl_map(ring, fd, PROT_READ | PROT_WRITE);
+   close(fd);
+   if (status != MAMA_STATUS_OK) {
+      free(ring->mName);
+      free(ring);
+      return status;
+   }
+
+   if ((__atomic_load_n(&ring->mHeader->mMagic, __ATOMIC_ACQUIRE) != ZMQ_SHMRING_MAGIC)
+      || (ring->mHeader->mVersion != ZMQ_SHMRING_VERSION)
+      || (ring->mHeader->mCapacity + ZMQ_SHMRING_HEADER_SIZE != ring->mMapSize)) {
+      MAMA_LOG(MAMA_LOG_LEVEL_WARN, "shm ring %s is not valid (magic=%x version=%u)", name, ring->mHeader->mMagic, ring->mHeader->mVersion);
+      zmqBridgeMamaShmRing_detach(ring);
+      return MAMA_STATUS_INVALID_ARG;
+   }
+
+   ring->mCapacity = ring->mHeader->mCapacity;
+   ring->mMaxRecord = ring->mCapacity / 4;
+   ring->mReadPos = __atomic_load_n(&ring->mHeader->mCommitPos, __ATOMIC_ACQUIRE);
+
+   if (wakeName != NULL) {
+      ring->mSlot = zmqBridgeMamaShmRingImpl_claimSlot(ring, wakeName);
+      if (ring->mSlot < 0) {
+         MAMA_LOG(MAMA_LOG_LEVEL_WARN, "No free reader slots in shm ring %s -- ring will be polled", name);
+      }
+   }
+
+   *result = ring;
+   return MAMA_STATUS_OK;
+}
+
+
+void zmqBridgeMamaShmRing_detach(zmqShmRing* ring)
+{
+   zmqBridgeMamaShmRing_destroy(ring);
+}
+
+
+const char* zmqBridgeMamaShmRing_getName(zmqShmRing* ring)
+{
+   return ring->mName;
+}
+
+
+long long zmqBridgeMamaShmRing_getLost(zmqShmRing* ring)
+{
+   return ring->mLost;
+}
+
+
+mama_status zmqBridgeMamaShmRing_write(zmqShmRing* ring, const void* data, size_t size)
+{
+   uint64_t recordSize = zmqBridgeMamaShmRingImpl_align(sizeof(zmqShmRecord) + size);
+   if (recordSize > ring->mMaxRecord) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "msg of %zu bytes is too large for shm ring %s", size, ring->mName);
+      return MAMA_STATUS_INVALID_ARG;
+   }
+
+   zmqShmRingHeader* header = ring->mHeader;
+   uint64_t pos = header->mCommitPos;
+   uint64_t offset = pos & (ring->mCapacity -1);
+   uint64_t padSize = 0;
+   if (offset + recordSize > ring->mCapacity) {
+      // doesn't fit before end of ring -- pad to end and wrap
+      padSize = ring->mCapacity - offset;
+   }
+
+   // reserve space before touching it, so readers can tell if they've been overrun
+   __atomic_store_n(&header->mReservePos, pos + padSize + recordSize, __ATOMIC_RELAXED);
+   __atomic_thread_fence(__ATOMIC_RELEASE);
+
+   if (padSize > 0) {
+      zmqShmRecord* pad = (zmqShmRecord*) &ring->mData[offset];
+      pad->mSize = padSize - sizeof(zmqShmRecord);
+      pad->mType = ZMQ_SHMRING_RECORD_PAD;
+      pos += padSize;
+      offset = 0;
+   }
+
+   zmqShmRecord* record = (zmqShmRecord*) &ring->mData[offset];
+   record->mSize = size;
+   record->mType = ZMQ_SHMRING_RECORD_MSG;
+   memcpy(&ring->mData[offset + sizeof(zmqShmRecord)], data, size);
+
+   __atomic_store_n(&header->mCommitPos, pos + recordSize, __ATOMIC_RELEASE);
+
+   // pairs w/the fence in prepareWait -- either the reader sees the new commitPos, or we see its wake bit
+   __atomic_thread_fence(__ATOMIC_SEQ_CST);
+   if (__atomic_load_n(&header->mWakeMask, __ATOMIC_RELAXED) != 0) {
+      zmqBridgeMamaShmRingImpl_wake(ring);
+   }
+
+   return MAMA_STATUS_OK;
+}
+
+
+int zmqBridgeMamaShmRing_read(zmqShmRing* ring, zmq_msg_t* zmsg)
+{
+   zmqShmRingHeader* header = ring->mHeader;
+
+   while (1) {
+      uint64_t commitPos = __atomic_load_n(&header->mCommitPos, __ATOMIC_ACQUIRE);
+      if (ring->mReadPos == commitPos) {
+         return 0;
+      }
+      if ((commitPos - ring->mReadPos > ring->mCapacity) || (commitPos < ring->mReadPos)) {
+         // overrun (or writer restarted) -- skip to current position
+         ring->mLost++;
+         MAMA_LOG(MAMA_LOG_LEVEL_WARN, "Reader overrun on shm ring %s -- msgs lost", ring->mName);
+         ring->mReadPos = commitPos;
+         return 0;
+      }
+
+      uint64_t offset = ring->mReadPos & (ring->mCapacity -1);
+      zmqShmRecord record = *(zmqShmRecord*) &ring->mData[offset];
+      uint64_t recordSize = zmqBridgeMamaShmRingImpl_align(sizeof(zmqShmRecord) + record.mSize);
+      // the header may be torn or overwritten, so make sure the copy stays w/in the mapping
+      int isValid = (offset + recordSize <= ring->mCapacity)
+         && ((record.mType == ZMQ_SHMRING_RECORD_PAD) || ((record.mType == ZMQ_SHMRING_RECORD_MSG) && (recordSize <= ring->mMaxRecord)));
+      if (isValid && (record.mType == ZMQ_SHMRING_RECORD_MSG)) {
+         zmq_msg_close(zmsg);
+         zmq_msg_init_size(zmsg, record.mSize);
+         memcpy(zmq_msg_data(zmsg), &ring->mData[offset + sizeof(zmqShmRecord)], record.mSize);
+      }
+
+      // was any of this overwritten while we were reading it?
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      uint64_t reservePos = __atomic_load_n(&header->mReservePos, __ATOMIC_RELAXED);
+      if ((reservePos - ring->mReadPos > ring->mCapacity) || (isValid == 0)) {
+         ring->mLost++;
+         MAMA_LOG(MAMA_LOG_LEVEL_WARN, "Reader overrun on shm ring %s -- msgs lost", ring->mName);
+         ring->mReadPos = __atomic_load_n(&header->mCommitPos, __ATOMIC_ACQUIRE);
+         return 0;
+      }
+
+      if (record.mType == ZMQ_SHMRING_RECORD_PAD) {
+         ring->mReadPos += ring->mCapacity - offset;
+         continue;
+      }
+
+      ring->mReadPos += recordSize;
+      return 1;
+   }
+}
+
+
+int zmqBridgeMamaShmRing_prepareWait(zmqShmRing* ring)
+{
+   zmqShmRingHeader* header = ring->mHeader;
+   if (ring->mSlot < 0) {
+      return (__atomic_load_n(&header->mCommitPos, __ATOMIC_ACQUIRE) != ring->mReadPos) ? 1 : -1;
+   }
+
+   uint64_t bit = (uint64_t) 1 << ring->mSlot;
+   __atomic_or_fetch(&header->mWakeMask, bit, __ATOMIC_RELAXED);
+   // pairs w/the fence in write
+   __atomic_thread_fence(__ATOMIC_SEQ_CST);
+   if (__atomic_load_n(&header->mCommitPos, __ATOMIC_ACQUIRE) != ring->mReadPos) {
+      // no need to be woken after all
+      __atomic_and_fetch(&header->mWakeMask, ~bit, __ATOMIC_RELAXED);
+      return 1;
+   }
+
+   return 0;
+}
+
+
+mama_status zmqBridgeMamaShmRing_openWakeup(const char* wakeName, int* fd)
+{
+   *fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+   if (*fd < 0) {
+      MAMA_LOG(MAMA_LOG_LEVEL_WARN, "socket(AF_UNIX) failed %d(%s)", errno, strerror(errno));
+      return MAMA_STATUS_PLATFORM;
+   }
+
+   struct sockaddr_un addr;
+   socklen_t len = zmqBridgeMamaShmRingImpl_wakeAddr(&addr, wakeName);
+   if (bind(*fd, (struct sockaddr*) &addr, len) != 0) {
+      MAMA_LOG(MAMA_LOG_LEVEL_WARN, "bind(%s) failed %d(%s)", wakeName, errno, strerror(errno));
+      close(*fd);
+      *fd = -1;
+      return MAMA_STATUS_PLATFORM;
+   }
+
+   return MAMA_STATUS_OK;
+}
+
+
+void zmqBridgeMamaShmRing_drainWakeup(int fd)
+{
+   char buf[64];
+   while (recv(fd, buf, sizeof(buf), MSG_DONTWAIT) > 0) {
+      ;
+   }
+}
+
+
+void zmqBridgeMamaShmRing_closeWakeup(int fd)
+{
+   if (fd >= 0) {
+      close(fd);
+   }
+}
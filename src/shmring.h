@@ -0,0 +1,53 @@
+//
+// shared-memory ring -- single-producer, multi-consumer ring buffer in /dev/shm used to deliver
+// msgs to peers on the same host w/o going through zmq
+//
+
+#ifndef MAMA_BRIDGE_ZMQ_SHMRING_H__
+#define MAMA_BRIDGE_ZMQ_SHMRING_H__
+
+#include <mama/mama.h>
+#include <zmq.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+typedef struct zmqShmRing_ zmqShmRing;
+
+// creates (and owns) a ring w/at least size bytes of capacity -- the ring is unlinked when destroyed
+mama_status zmqBridgeMamaShmRing_create(zmqShmRing** result, const char* name, size_t size);
+void zmqBridgeMamaShmRing_destroy(zmqShmRing* ring);
+
+// maps an existing ring for reading -- reading starts w/the next msg written
+// if wakeName is not NULL, the writer wakes the reader's wakeup socket (see openWakeup) when it writes to the ring
+mama_status zmqBridgeMamaShmRing_attach(zmqShmRing** result, const char* name, const char* wakeName);
+void zmqBridgeMamaShmRing_detach(zmqShmRing* ring);
+
+const char* zmqBridgeMamaShmRing_getName(zmqShmRing* ring);
+
+// writes a msg to the ring -- the caller must ensure there is only one writer at a time
+mama_status zmqBridgeMamaShmRing_write(zmqShmRing* ring, const void* data, size_t size);
+
+// reads the next msg from the ring into zmsg (which must be initialized)
+// returns non-zero if a msg was read, zero if there are no more msgs
+int zmqBridgeMamaShmRing_read(zmqShmRing* ring, zmq_msg_t* zmsg);
+
+// called by a reader before it blocks -- returns 1 if there are msgs to read, 0 if the writer will wake the
+// reader's wakeup socket when there are, or -1 if the reader needs to poll the ring
+int zmqBridgeMamaShmRing_prepareWait(zmqShmRing* ring);
+
+// binds a (non-blocking) wakeup socket that can be polled for msgs on any of the rings attached w/wakeName
+mama_status zmqBridgeMamaShmRing_openWakeup(const char* wakeName, int* fd);
+// discards pending wakeups (call before reading from the rings)
+void zmqBridgeMamaShmRing_drainWakeup(int fd);
+void zmqBridgeMamaShmRing_closeWakeup(int fd);
+
+// number of msgs that were lost because the reader was overrun by the writer
+long long zmqBridgeMamaShmRing_getLost(zmqShmRing* ring);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* MAMA_BRIDGE_ZMQ_SHMRING_H__ */
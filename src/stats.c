@@ -0,0 +1,153 @@
+//
+// transport stats -- counters for msgs, bytes, drops etc.
+//
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <limits.h>
+
+#include <mama/mama.h>
+
+#include "stats.h"
+#include "util.h"
+
+typedef struct zmqStatInfo {
+   const char*             mName;
+   int                     mIsMax;           // high-water mark (as opposed to counter)?
+} zmqStatInfo;
+
+static const zmqStatInfo gStatInfo[ZMQ_STAT_COUNT] = {
+   [ZMQ_STAT_MSGS_IN]            = { "msgs_in",          0 },
+   [ZMQ_STAT_BYTES_IN]           = { "bytes_in",         0 },
+   [ZMQ_STAT_SHM_MSGS_IN]        = { "shm_msgs_in",      0 },
+   [ZMQ_STAT_SUB_MSGS]           = { "sub_msgs",         0 },
+   [ZMQ_STAT_INBOX_MSGS]         = { "inbox_msgs",       0 },
+   [ZMQ_STAT_WC_MATCHES]         = { "wc_matches",       0 },
+   [ZMQ_STAT_UNMATCHED]          = { "unmatched",        0 },
+   [ZMQ_STAT_TOPIC_ID_MISSES]    = { "topic_id_misses",  0 },
+   [ZMQ_STAT_DROPS_IN]           = { "drops_in",         0 },
+   [ZMQ_STAT_QUEUE_DEPTH_MAX]    = { "queue_depth_max",  1 },
+   [ZMQ_STAT_NAMING_MSGS]        = { "naming_msgs",      0 },
+   [ZMQ_STAT_CONTROL_MSGS]       = { "control_msgs",     0 },
+   [ZMQ_STAT_POLLS]              = { "polls",            0 },
+   [ZMQ_STAT_DIRECT_MSGS_IN]     = { "direct_msgs_in",   0 },
+   [ZMQ_STAT_PEERS_EVICTED]      = { "peers_evicted",    0 },
+   [ZMQ_STAT_MSGS_OUT]           = { "msgs_out",         0 },
+   [ZMQ_STAT_BYTES_OUT]          = { "bytes_out",        0 },
+   [ZMQ_STAT_SEND_ERRORS]        = { "send_errors",      0 },
+   [ZMQ_STAT_SHM_DROPS]          = { "shm_drops",        0 },
+   [ZMQ_STAT_DIRECT_REPLIES]     = { "direct_replies",   0 },
+   [ZMQ_STAT_DIRECT_FAILURES]    = { "direct_failures",  0 },
+   [ZMQ_STAT_GROUP_MSGS_OUT]     = { "group_msgs_out",   0 },
+};
+
+
+mama_status zmqBridgeMamaStats_create(zmqStats** stats)
+{
+   // calloc doesn't honor the alignment of zmqStatsBlock
+   void* p = NULL;
+   if (posix_memalign(&p, ZMQ_CACHE_LINE_SIZE, sizeof(zmqStats)) != 0) {
+      return MAMA_STATUS_NOMEM;
+   }
+   memset(p, '\0', sizeof(zmqStats));
+
+   *stats = (zmqStats*) p;
+   return MAMA_STATUS_OK;
+}
+
+
+void zmqBridgeMamaStats_destroy(zmqStats* stats)
+{
+   free(stats);
+}
+
+
+void zmqBridgeMamaStats_snapshot(const zmqStats* stats, uint64_t values[ZMQ_STAT_COUNT])
+{
+   memset(values, '\0', sizeof(uint64_t) * ZMQ_STAT_COUNT);
+   for (int i = 0; i < ZMQ_STATS_WRITERS; ++i) {
+      for (int j = 0; j < ZMQ_STAT_COUNT; ++j) {
+         uint64_t value = __atomic_load_n(&stats->mBlocks[i].mValues[j], __ATOMIC_RELAXED);
+         if (gStatInfo[j].mIsMax) {
+            if (value > values[j]) {
+               values[j] = value;
+            }
+         }
+         else {
+            values[j] += value;
+         }
+      }
+   }
+}
+
+
+const char* zmqBridgeMamaStats_name(zmqStat stat)
+{
+   if ((stat < 0) || (stat >= ZMQ_STAT_COUNT)) {
+      return "unknown";
+   }
+   return gStatInfo[stat].mName;
+}
+
+
+int zmqBridgeMamaStats_format(const uint64_t values[ZMQ_STAT_COUNT], const char* name, char* buf, size_t size)
+{
+   size_t len = 0;
+   for (int i = 0; i < ZMQ_STAT_COUNT; ++i) {
+      int n = snprintf(buf + len, (len < size) ? size - len : 0, "oz_%s%s{transport=\"%s\"} %llu\n",
+         gStatInfo[i].mName, gStatInfo[i].mIsMax ? "" : "_total", name, (unsigned long long) values[i]);
+      if (n < 0) {
+         return n;
+      }
+      len += n;
+   }
+
+   return (int) len;
+}
+
+
+mama_status zmqBridgeMamaStats_writeFile(const char* path, const char* text)
+{
+   char temp[PATH_MAX];
+   snprintf(temp, sizeof(temp), "%s.%d.tmp", path, getpid());
+
+   FILE* f = fopen(temp, "w");
+   if (f == NULL) {
+      MAMA_LOG(MAMA_LOG_LEVEL_WARN, "Unable to open stats file %s: %d(%s)", temp, errno, strerror(errno));
+      return MAMA_STATUS_PLATFORM;
+   }
+   size_t len = strlen(text);
+   int ok = (fwrite(text, 1, len, f) == len);
+   if (fclose(f) != 0) {
+      ok = 0;
+   }
+   if (!ok) {
+      MAMA_LOG(MAMA_LOG_LEVEL_WARN, "Unable to write stats file %s: %d(%s)", temp, errno, strerror(errno));
+      unlink(temp);
+      return MAMA_STATUS_PLATFORM;
+   }
+
+   // rename is atomic, so readers never see a partially-written file
+   if (rename(temp, path) != 0) {
+      MAMA_LOG(MAMA_LOG_LEVEL_WARN, "Unable to rename stats file %s: %d(%s)", path, errno, strerror(errno));
+      unlink(temp);
+      return MAMA_STATUS_PLATFORM;
+   }
+
+   return MAMA_STATUS_OK;
+}
+
+
+void zmqBridgeMamaStats_log(const uint64_t values[ZMQ_STAT_COUNT], const char* name, MamaLogLevel level)
+{
+   char buf[1024];
+   size_t len = 0;
+   for (int i = 0; (i < ZMQ_STAT_COUNT) && (len < sizeof(buf)); ++i) {
+      len += snprintf(buf + len, sizeof(buf) - len, "%s%s=%llu", (i > 0) ? " " : "", gStatInfo[i].mName, (unsigned long long) values[i]);
+   }
+
+   MAMA_LOG(level, "Stats %s: %s", name, buf);
+}
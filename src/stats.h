@@ -0,0 +1,121 @@
+//
+// transport stats -- counters for msgs, bytes, drops etc.
+//
+// Counters are kept in cache-line-aligned blocks, one per writer (e.g., the transport's dispatch thread, or
+// publishers, which are serialized by the dataPub lock), so that writers never share cache lines with each
+// other or w/hot transport fields, and can update counters w/plain (non-atomic) stores.  Readers sum the
+// blocks (or take the max, for high-water-mark values).
+//
+
+#ifndef MAMA_BRIDGE_ZMQ_STATS_H__
+#define MAMA_BRIDGE_ZMQ_STATS_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <mama/mama.h>
+#include <wombat/wtable.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#define ZMQ_CACHE_LINE_SIZE      64
+// queue depth is sampled every this many msgs (power of 2)
+#define ZMQ_STATS_DEPTH_SAMPLE   64
+
+typedef enum zmqStat {
+   // updated by dispatch thread
+   ZMQ_STAT_MSGS_IN = 0,            // data msgs received (from zmq or shm rings)
+   ZMQ_STAT_BYTES_IN,
+   ZMQ_STAT_SHM_MSGS_IN,            // data msgs received from shm rings
+   ZMQ_STAT_SUB_MSGS,               // msgs for subscriptions
+   ZMQ_STAT_INBOX_MSGS,             // msgs for inboxes
+   ZMQ_STAT_WC_MATCHES,             // msgs enqueued to wildcard subscriptions
+   ZMQ_STAT_UNMATCHED,              // msgs discarded because no subscription or inbox was interested
+   ZMQ_STAT_TOPIC_ID_MISSES,        // compact msgs discarded because id was not known
+   ZMQ_STAT_DROPS_IN,               // msgs that could not be enqueued
+   ZMQ_STAT_QUEUE_DEPTH_MAX,        // max queue depth seen on enqueue (high-water mark, sampled)
+   ZMQ_STAT_NAMING_MSGS,
+   ZMQ_STAT_CONTROL_MSGS,
+   ZMQ_STAT_POLLS,
+   ZMQ_STAT_DIRECT_MSGS_IN,         // inbox replies received directly from peers
+   ZMQ_STAT_PEERS_EVICTED,          // peers removed because they stopped beaconing
+   // updated by publishers
+   ZMQ_STAT_MSGS_OUT,
+   ZMQ_STAT_BYTES_OUT,
+   ZMQ_STAT_SEND_ERRORS,            // sends that failed (PUB sockets drop silently at HWM, so these are not HWM hits)
+   ZMQ_STAT_SHM_DROPS,              // msgs that could not be written to shm ring
+   // updated by repliers (serialized by the replyPub lock)
+   ZMQ_STAT_DIRECT_REPLIES,         // inbox replies sent directly to the requesting peer
+   ZMQ_STAT_DIRECT_FAILURES,        // direct replies that could not be delivered (peer unreachable)
+   ZMQ_STAT_GROUP_MSGS_OUT,         // msgs sent directly to queue group members
+   ZMQ_STAT_COUNT
+} zmqStat;
+
+typedef enum zmqStatsWriter {
+   ZMQ_STATS_DISPATCH = 0,
+   ZMQ_STATS_PUBLISH,
+   ZMQ_STATS_REPLY,
+   ZMQ_STATS_WRITERS
+} zmqStatsWriter;
+
+typedef struct zmqStatsBlock_ {
+   uint64_t                mValues[ZMQ_STAT_COUNT];
+} __attribute__((aligned(ZMQ_CACHE_LINE_SIZE))) zmqStatsBlock;
+
+typedef struct zmqStats_ {
+   zmqStatsBlock           mBlocks[ZMQ_STATS_WRITERS];
+} zmqStats;
+
+mama_status zmqBridgeMamaStats_create(zmqStats** stats);
+void zmqBridgeMamaStats_destroy(zmqStats* stats);
+
+// NOTE: only one thread at a time may update a given block
+static inline void zmqBridgeMamaStats_add(zmqStats* stats, zmqStatsWriter writer, zmqStat stat, uint64_t value)
+{
+   uint64_t* p = &stats->mBlocks[writer].mValues[stat];
+   __atomic_store_n(p, *p + value, __ATOMIC_RELAXED);
+}
+
+static inline void zmqBridgeMamaStats_max(zmqStats* stats, zmqStatsWriter writer, zmqStat stat, uint64_t value)
+{
+   uint64_t* p = &stats->mBlocks[writer].mValues[stat];
+   if (value > *p) {
+      __atomic_store_n(p, value, __ATOMIC_RELAXED);
+   }
+}
+
+// sums (or maxes) all blocks into values (may be called from any thread)
+void zmqBridgeMamaStats_snapshot(const zmqStats* stats, uint64_t values[ZMQ_STAT_COUNT]);
+
+const char* zmqBridgeMamaStats_name(zmqStat stat);
+
+// formats values in Prometheus text format, one line per stat, labeled w/the transport name
+// (returns number of chars written, as per snprintf)
+int zmqBridgeMamaStats_format(const uint64_t values[ZMQ_STAT_COUNT], const char* name, char* buf, size_t size);
+
+// writes text to path atomically (i.e., readers will see either the old or the new contents)
+mama_status zmqBridgeMamaStats_writeFile(const char* path, const char* text);
+
+// logs values on a single line
+void zmqBridgeMamaStats_log(const uint64_t values[ZMQ_STAT_COUNT], const char* name, MamaLogLevel level);
+
+
+// shared-memory stats segment (see statsshm.h)
+struct zmqLatencyStats_;
+typedef struct zmqStatsShm_ zmqStatsShm;
+
+mama_status zmqBridgeMamaStatsShm_create(zmqStatsShm** shm, const char* transportName, const char* uuid);
+void zmqBridgeMamaStatsShm_destroy(zmqStatsShm* shm);
+
+// writes stats, latency summaries (if latency is not NULL) and queue depths (stats thread only)
+void zmqBridgeMamaStatsShm_update(zmqStatsShm* shm, const uint64_t values[ZMQ_STAT_COUNT], struct zmqLatencyStats_* latency);
+
+// writes the current list of peers (dispatch thread only)
+void zmqBridgeMamaStatsShm_updatePeers(zmqStatsShm* shm, wtable_t peers);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* MAMA_BRIDGE_ZMQ_STATS_H__ */
@@ -0,0 +1,224 @@
+//
+// shared-memory stats segment -- see statsshm.h for layout
+//
+
+// required for definition of progname/program_invocation_short_name
+#if defined __APPLE__
+#include <stdlib.h>
+#else
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <mama/mama.h>
+#include <wombat/wtable.h>
+
+#include "util.h"
+#include "zmqdefs.h"
+#include "queue.h"
+#include "histogram.h"
+#include "latency.h"
+#include "stats.h"
+#include "statsshm.h"
+
+// the segment has fixed-size arrays of stats and latency stages (negative array size => compile error)
+typedef char zmqStatsShmStatsFit[(ZMQ_STAT_COUNT <= ZMQ_STATS_SHM_MAX_STATS) ? 1 : -1];
+typedef char zmqStatsShmStagesFit[(ZMQ_LATENCY_STAGES <= ZMQ_STATS_SHM_MAX_STAGES) ? 1 : -1];
+
+struct zmqStatsShm_ {
+   char                    mName[ZMQ_STATS_SHM_NAME_SIZE * 2];
+   zmqStatsShmSegment*     mSegment;
+   zmqHistogram            mHist;               // scratch space for latency summaries (stats thread only)
+};
+
+
+// removes segments left behind by processes that have since died
+static void zmqBridgeMamaStatsShmImpl_reapAll(void)
+{
+   DIR* dir = opendir(ZMQ_STATS_SHM_DIR);
+   if (dir == NULL) {
+      return;
+   }
+   struct dirent* entry;
+   while ((entry = readdir(dir)) != NULL) {
+      if (zmqBridgeMamaStatsShm_reap(entry->d_name)) {
+         MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Removed stale stats segment:%s", entry->d_name);
+      }
+   }
+   closedir(dir);
+}
+
+
+mama_status zmqBridgeMamaStatsShm_create(zmqStatsShm** result, const char* transportName, const char* uuid)
+{
+   zmqBridgeMamaStatsShmImpl_reapAll();
+
+   zmqStatsShm* shm = (zmqStatsShm*) calloc(1, sizeof(zmqStatsShm));
+   if (shm == NULL) {
+      return MAMA_STATUS_NOMEM;
+   }
+
+   // transport names may contain chars that are not legal in shm names
+   snprintf(shm->mName, sizeof(shm->mName), "/%s%ld.%s", ZMQ_STATS_SHM_PREFIX, (long) getpid(), transportName);
+   for (char* p = shm->mName + 1; *p != '\0'; ++p) {
+      if (*p == '/') {
+         *p = '_';
+      }
+   }
+
+   int fd = shm_open(shm->mName, O_RDWR | O_CREAT | O_TRUNC, 0600);
+   if (fd < 0) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "shm_open(%s) failed %d(%s)", shm->mName, errno, strerror(errno));
+      free(shm);
+      return MAMA_STATUS_PLATFORM;
+   }
+   if (ftruncate(fd, sizeof(zmqStatsShmSegment)) != 0) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "ftruncate(%s) failed %d(%s)", shm->mName, errno, strerror(errno));
+      close(fd);
+      shm_unlink(shm->mName);
+      free(shm);
+      return MAMA_STATUS_PLATFORM;
+   }
+   void* addr = mmap(NULL, sizeof(zmqStatsShmSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+   close(fd);
+   if (addr == MAP_FAILED) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "mmap(%s) failed %d(%s)", shm->mName, errno, strerror(errno));
+      shm_unlink(shm->mName);
+      free(shm);
+      return MAMA_STATUS_PLATFORM;
+   }
+   shm->mSegment = (zmqStatsShmSegment*) addr;
+
+   // fill in the header (new segment is zero-filled)
+   zmqStatsShmSegment* seg = shm->mSegment;
+   seg->mVersion = ZMQ_STATS_SHM_VERSION;
+   seg->mPid = getpid();
+   #if defined __APPLE__
+   snprintf(seg->mProgName, sizeof(seg->mProgName), "%s", getprogname());
+   #else
+   snprintf(seg->mProgName, sizeof(seg->mProgName), "%s", program_invocation_short_name);
+   #endif
+   snprintf(seg->mTransport, sizeof(seg->mTransport), "%s", transportName);
+   snprintf(seg->mUuid, sizeof(seg->mUuid), "%s", (uuid != NULL) ? uuid : "");
+   seg->mNumStats = ZMQ_STAT_COUNT;
+   for (int i = 0; i < ZMQ_STAT_COUNT; ++i) {
+      snprintf(seg->mStatNames[i], sizeof(seg->mStatNames[i]), "%s", zmqBridgeMamaStats_name((zmqStat) i));
+   }
+   seg->mNumStages = ZMQ_LATENCY_STAGES;
+   for (int i = 0; i < ZMQ_LATENCY_STAGES; ++i) {
+      snprintf(seg->mStageNames[i], sizeof(seg->mStageNames[i]), "%s", zmqBridgeMamaLatency_stageName((zmqLatencyStage) i));
+   }
+
+   // readers ignore the segment until magic is set
+   __atomic_store_n(&seg->mMagic, ZMQ_STATS_SHM_MAGIC, __ATOMIC_RELEASE);
+
+   MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Created stats segment:%s", shm->mName);
+
+   *result = shm;
+   return MAMA_STATUS_OK;
+}
+
+
+void zmqBridgeMamaStatsShm_destroy(zmqStatsShm* shm)
+{
+   if (shm == NULL) {
+      return;
+   }
+
+   munmap(shm->mSegment, sizeof(zmqStatsShmSegment));
+   shm_unlink(shm->mName);
+   free(shm);
+}
+
+
+static void zmqBridgeMamaStatsShmImpl_summarize(const zmqHistogram* hist, zmqStatsShmLatency* latency)
+{
+   latency->mCount = hist->mCount;
+   latency->mMin = (hist->mCount > 0) ? hist->mMin : 0;
+   latency->mMean = (hist->mCount > 0) ? hist->mSum / hist->mCount : 0;
+   latency->mP50 = zmqBridgeMamaHistogram_percentile(hist, 50);
+   latency->mP90 = zmqBridgeMamaHistogram_percentile(hist, 90);
+   latency->mP99 = zmqBridgeMamaHistogram_percentile(hist, 99);
+   latency->mP999 = zmqBridgeMamaHistogram_percentile(hist, 99.9);
+   latency->mMax = hist->mMax;
+}
+
+
+void zmqBridgeMamaStatsShm_update(zmqStatsShm* shm, const uint64_t values[ZMQ_STAT_COUNT], struct zmqLatencyStats_* latency)
+{
+   // gather everything first, to keep the write section (and the chance of readers retrying) short
+   zmqStatsShmLatency summaries[ZMQ_LATENCY_STAGES];
+   if (latency != NULL) {
+      for (int i = 0; i < ZMQ_LATENCY_STAGES; ++i) {
+         zmqBridgeMamaLatency_snapshot(latency, (zmqLatencyStage) i, &shm->mHist, 0);
+         zmqBridgeMamaStatsShmImpl_summarize(&shm->mHist, &summaries[i]);
+      }
+   }
+
+   zmqQueueStats queues[ZMQ_STATS_SHM_MAX_QUEUES];
+   int numQueues = zmqBridgeMamaQueue_getAllStats(queues, ZMQ_STATS_SHM_MAX_QUEUES);
+
+   struct timespec now;
+   clock_gettime(CLOCK_MONOTONIC, &now);
+
+   zmqStatsShmSegment* seg = shm->mSegment;
+   zmqBridgeMamaStatsShm_beginWrite(&seg->mSeq);
+   seg->mUpdateTime = (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+   memcpy(seg->mStats, values, sizeof(uint64_t) * ZMQ_STAT_COUNT);
+   seg->mHasLatency = (latency != NULL);
+   if (latency != NULL) {
+      memcpy(seg->mLatency, summaries, sizeof(summaries));
+   }
+   seg->mNumQueues = numQueues;
+   for (int i = 0; i < numQueues; ++i) {
+      seg->mQueues[i].mId = (uint64_t) (uintptr_t) queues[i].mQueue;
+      memcpy(seg->mQueues[i].mName, queues[i].mName, sizeof(seg->mQueues[i].mName));
+      seg->mQueues[i].mDepth = queues[i].mDepth;
+      seg->mQueues[i].mDepthMax = queues[i].mDepthMax;
+      seg->mQueues[i].mOldestAge = queues[i].mOldestAge;
+      seg->mQueues[i].mStaleCount = queues[i].mStaleCount;
+      seg->mQueues[i].mStaleDrops = queues[i].mStaleDrops;
+   }
+   zmqBridgeMamaStatsShm_endWrite(&seg->mSeq);
+}
+
+
+static void zmqBridgeMamaStatsShmImpl_addPeer(wtable_t table, void* data, const char* key, void* closure)
+{
+   zmqStatsShmSegment* seg = (zmqStatsShmSegment*) closure;
+   if (seg->mNumPeers >= ZMQ_STATS_SHM_MAX_PEERS) {
+      return;
+   }
+
+   zmqNamingMsg* pMsg = (zmqNamingMsg*) data;
+   zmqStatsShmPeer* peer = &seg->mPeers[seg->mNumPeers++];
+   peer->mPid = pMsg->mPid;
+   snprintf(peer->mProgName, sizeof(peer->mProgName), "%s", pMsg->mProgName);
+   snprintf(peer->mHost, sizeof(peer->mHost), "%s", pMsg->mHost);
+   if (pMsg->mShmRingName[0] != '\0') {
+      snprintf(peer->mEndpoint, sizeof(peer->mEndpoint), "shm://%s", pMsg->mShmRingName);
+   }
+   else {
+      snprintf(peer->mEndpoint, sizeof(peer->mEndpoint), "%s", pMsg->mEndPointAddr);
+   }
+}
+
+
+void zmqBridgeMamaStatsShm_updatePeers(zmqStatsShm* shm, wtable_t peers)
+{
+   zmqStatsShmSegment* seg = shm->mSegment;
+   zmqBridgeMamaStatsShm_beginWrite(&seg->mPeerSeq);
+   seg->mNumPeers = 0;
+   wtable_for_each(peers, zmqBridgeMamaStatsShmImpl_addPeer, seg);
+   zmqBridgeMamaStatsShm_endWrite(&seg->mPeerSeq);
+}
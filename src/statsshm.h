@@ -0,0 +1,152 @@
+//
+// shared-memory stats segment -- each transport exports its stats, queue depths, peers and latency
+// summaries to /dev/shm/oz-stats.<pid>.<transport>, where oz-top (or anything else) can read them w/o
+// any impact on the process.
+//
+// The segment has two sections, each w/its own writer and seqlock: the stats section is written by the
+// transport's stats thread every stats.interval seconds, and the peers section is written by the
+// dispatch thread whenever a peer connects or disconnects.  Readers copy a section, and retry if its
+// sequence number was odd (write in progress) or changed while copying.
+//
+// NOTE: this header is shared w/oz-top, so must not depend on MAMA or zmq headers.
+//
+
+#ifndef MAMA_BRIDGE_ZMQ_STATSSHM_H__
+#define MAMA_BRIDGE_ZMQ_STATSSHM_H__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/mman.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#define ZMQ_STATS_SHM_MAGIC         0x4f5a5354     // "OZST"
+#define ZMQ_STATS_SHM_VERSION       1
+#define ZMQ_STATS_SHM_PREFIX        "oz-stats."
+#define ZMQ_STATS_SHM_DIR           "/dev/shm"
+
+#define ZMQ_STATS_SHM_MAX_STATS     32
+#define ZMQ_STATS_SHM_MAX_STAGES    8
+#define ZMQ_STATS_SHM_MAX_QUEUES    64
+#define ZMQ_STATS_SHM_MAX_PEERS     256
+#define ZMQ_STATS_SHM_NAME_SIZE     64
+
+typedef struct zmqStatsShmLatency_ {
+   uint64_t                mCount;
+   uint64_t                mMin;                // all values in nanos
+   uint64_t                mMean;
+   uint64_t                mP50;
+   uint64_t                mP90;
+   uint64_t                mP99;
+   uint64_t                mP999;
+   uint64_t                mMax;
+} zmqStatsShmLatency;
+
+typedef struct zmqStatsShmQueue_ {
+   uint64_t                mId;                 // address of queue (for uniqueness only)
+   char                    mName[ZMQ_STATS_SHM_NAME_SIZE];
+   uint64_t                mDepth;
+   uint64_t                mDepthMax;
+   uint64_t                mOldestAge;          // nanos (only if queue has a max age)
+   uint64_t                mStaleCount;
+   uint64_t                mStaleDrops;
+} zmqStatsShmQueue;
+
+typedef struct zmqStatsShmPeer_ {
+   int64_t                 mPid;
+   char                    mProgName[ZMQ_STATS_SHM_NAME_SIZE];
+   char                    mHost[ZMQ_STATS_SHM_NAME_SIZE];
+   char                    mEndpoint[ZMQ_STATS_SHM_NAME_SIZE * 2];    // endpoint or shm ring we read from
+} zmqStatsShmPeer;
+
+typedef struct zmqStatsShmSegment_ {
+   // written once, at creation (readers check magic last)
+   uint32_t                mMagic;
+   uint32_t                mVersion;
+   int64_t                 mPid;
+   char                    mProgName[ZMQ_STATS_SHM_NAME_SIZE];
+   char                    mTransport[ZMQ_STATS_SHM_NAME_SIZE];
+   char                    mUuid[ZMQ_STATS_SHM_NAME_SIZE];
+   uint32_t                mNumStats;
+   uint32_t                mNumStages;
+   char                    mStatNames[ZMQ_STATS_SHM_MAX_STATS][32];
+   char                    mStageNames[ZMQ_STATS_SHM_MAX_STAGES][32];
+
+   // stats section -- written by stats thread
+   uint64_t                mSeq __attribute__((aligned(64)));
+   uint64_t                mUpdateTime;         // CLOCK_MONOTONIC nanos
+   uint64_t                mStats[ZMQ_STATS_SHM_MAX_STATS];
+   uint32_t                mHasLatency;
+   zmqStatsShmLatency      mLatency[ZMQ_STATS_SHM_MAX_STAGES];
+   uint32_t                mNumQueues;
+   zmqStatsShmQueue        mQueues[ZMQ_STATS_SHM_MAX_QUEUES];
+
+   // peers section -- written by dispatch thread
+   uint64_t                mPeerSeq __attribute__((aligned(64)));
+   uint32_t                mNumPeers;
+   zmqStatsShmPeer         mPeers[ZMQ_STATS_SHM_MAX_PEERS];
+} zmqStatsShmSegment;
+
+
+///////////////////////////////////////////////////////////////////////////////
+// seqlock helpers
+
+static inline void zmqBridgeMamaStatsShm_beginWrite(uint64_t* seq)
+{
+   __atomic_store_n(seq, *seq + 1, __ATOMIC_RELAXED);
+   __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void zmqBridgeMamaStatsShm_endWrite(uint64_t* seq)
+{
+   __atomic_store_n(seq, *seq + 1, __ATOMIC_RELEASE);
+}
+
+// copies size bytes at src (which is protected by seq) to dest, returning 0 if a consistent copy could not
+// be made after the given number of tries
+static inline int zmqBridgeMamaStatsShm_read(const uint64_t* seq, void* dest, const void* src, size_t size, int tries)
+{
+   for (int i = 0; i < tries; ++i) {
+      uint64_t before = __atomic_load_n(seq, __ATOMIC_ACQUIRE);
+      if (before & 1) {
+         continue;
+      }
+      memcpy(dest, src, size);
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      if (__atomic_load_n(seq, __ATOMIC_RELAXED) == before) {
+         return 1;
+      }
+   }
+   return 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// segments are left behind if a process dies w/o destroying its transport -- given the name of an entry in
+// ZMQ_STATS_SHM_DIR, unlinks the segment if the pid in its name no longer exists, and returns 1 if it did
+static inline int zmqBridgeMamaStatsShm_reap(const char* entryName)
+{
+   if (strncmp(entryName, ZMQ_STATS_SHM_PREFIX, strlen(ZMQ_STATS_SHM_PREFIX)) != 0) {
+      return 0;
+   }
+   long pid = strtol(entryName + strlen(ZMQ_STATS_SHM_PREFIX), NULL, 10);
+   if ((pid <= 0) || (kill((pid_t) pid, 0) == 0) || (errno != ESRCH)) {
+      return 0;
+   }
+
+   char name[256];
+   snprintf(name, sizeof(name), "/%s", entryName);
+   return (shm_unlink(name) == 0) ? 1 : 0;
+}
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* MAMA_BRIDGE_ZMQ_STATSSHM_H__ */
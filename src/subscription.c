@@ -49,6 +49,8 @@
 #include "zmqbridgefunctions.h"
 #include "msg.h"
 #include "util.h"
+#include "queue.h"
+#include "groups.h"
 
 #include <zmq.h>
 
@@ -166,6 +168,10 @@ mama_status zmqBridgeMamaSubscription_destroy(subscriptionBridge subscriber)
    zmqSubscription* impl = (zmqSubscription*) subscriber;
    zmqTransportBridge* transportBridge = impl->mTransport;
 
+   if (impl->mIsGroupMember == 1) {
+      zmqBridgeMamaGroups_leave(transportBridge, impl);
+   }
+
    if (impl->mIsWildcard == 0) {
       /* Remove the subscription from the transport's subscription pool. */
       if (NULL != transportBridge && NULL != transportBridge->mSubEndpoints && NULL != impl->mSubjectKey) {
@@ -197,7 +203,11 @@ mama_status zmqBridgeMamaSubscription_destroy(subscriptionBridge subscriber)
    // note that zmq subscriptions are reference-counted, such that the socket will continue to
    // receive subscribed topics until *all* subscribers have unsubscribed
    // see http://api.zeromq.org/4-2:zmq-setsockopt under ZMQ_UNSUBSCRIBE
-   mama_status status = zmqBridgeMamaSubscriptionImpl_unsubscribe(transportBridge, impl->mSubjectKey);
+   // (group members never subscribed in the first place)
+   mama_status status = MAMA_STATUS_OK;
+   if (impl->mIsGroupMember == 0) {
+      status = zmqBridgeMamaSubscriptionImpl_unsubscribe(transportBridge, impl->mSubjectKey);
+   }
 
    free((void*)impl->mSubjectKey);
    free((void*)impl->mEndpointIdentifier);
@@ -282,6 +292,12 @@ zmqSubscription* zmqBridgeMamaSubscriptionImpl_allocate(mamaTransport tport, mam
 
    mamaTransport_getBridgeTransport(tport, (transportBridge*) &impl->mTransport);
    mamaQueue_getNativeHandle(queue, &impl->mZmqQueue);
+   if (impl->mTransport->mLatency != NULL) {
+      zmqBridgeMamaQueue_enableLatency(impl->mZmqQueue);
+   }
+   if (impl->mTransport->mQueueMaxAge > 0) {
+      zmqBridgeMamaQueue_applyMaxAge(impl->mZmqQueue, impl->mTransport->mQueueMaxAge, impl->mTransport->mQueueDropStale);
+   }
    impl->mMamaQueue           = queue;
    impl->mMamaCallback        = callback;
    impl->mMamaSubscription    = subscription;
@@ -303,6 +319,11 @@ mama_status zmqBridgeMamaSubscriptionImpl_createWildcard(zmqSubscription* impl,
    /* Use a standard centralized method to determine a topic key */
    zmqBridgeMamaSubscriptionImpl_generateSubjectKey(NULL, source, symbol, &impl->mSubjectKey);
 
+   // publishers find group members by exact topic, so wildcards cannot be group members -- they subscribe as usual
+   if (zmqBridgeMamaGroups_isMember(impl->mTransport, impl->mSubjectKey)) {
+      MAMA_LOG(MAMA_LOG_LEVEL_WARN, "Wildcard subscription %s cannot join queue group %s -- subscribing normally", impl->mOrigRegex, impl->mTransport->mQueueGroup);
+   }
+
    impl->mEndpointIdentifier = zmqBridge_generateSerial(&impl->mTransport->mWcsUid);
 
    // add this to list of wildcards
@@ -330,8 +351,15 @@ mama_status zmqBridgeMamaSubscriptionImpl_create(zmqSubscription* impl, const ch
    impl->mEndpointIdentifier = zmqBridge_generateSerial(&impl->mTransport->mSubUid);
    endpointPool_registerWithIdentifier(impl->mTransport->mSubEndpoints, impl->mSubjectKey, impl->mEndpointIdentifier, impl);
 
-   /* subscribe to the topic */
-   CALL_MAMA_FUNC(zmqBridgeMamaSubscriptionImpl_subscribe(impl->mTransport, impl->mSubjectKey));
+   if (zmqBridgeMamaGroups_isMember(impl->mTransport, impl->mSubjectKey)) {
+      /* group members get msgs sent directly to them, so dont subscribe */
+      impl->mIsGroupMember = 1;
+      CALL_MAMA_FUNC(zmqBridgeMamaGroups_join(impl->mTransport, impl));
+   }
+   else {
+      /* subscribe to the topic */
+      CALL_MAMA_FUNC(zmqBridgeMamaSubscriptionImpl_subscribe(impl->mTransport, impl->mSubjectKey));
+   }
 
    MAMA_LOG(MAMA_LOG_LEVEL_FINER, "created interest for %s.", impl->mSubjectKey);
 
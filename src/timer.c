@@ -39,6 +39,7 @@
 #include "zmqbridgefunctions.h"
 #include "zmqdefs.h"
 #include "util.h"
+#include "timerwheel.h"
 
 /*=========================================================================
   =                Typedefs, structs, enums and globals                   =
@@ -46,6 +47,9 @@
 
 typedef struct zmqTimerImpl_ {
    timerElement    mTimerElement;
+   zmqTimerWheelEntry mWheelEntry;
+   zmqTimerWheel*  mWheel;                         // if not NULL, timer is on wheel (else on heap)
+   uint8_t         mOnQueue;                       // timer is hosted on its queue (see timer.queue)
    double          mInterval;
    void*           mClosure;
    mamaTimer       mParent;
@@ -97,6 +101,39 @@ static void MAMACALLTYPE zmqBridgeMamaTimerImpl_queueCallback(mamaQueue queue, v
  */
 static void zmqBridgeMamaTimerImpl_timerCallback(timerElement timer, void* closure);
 
+/**
+ * As above, but invoked by the timing wheel.
+ */
+static void zmqBridgeMamaTimerImpl_wheelCallback(zmqTimerWheelEntry* entry, void* closure);
+
+
+/**
+ * As above, but invoked by the queue's dispatcher for timers hosted on the queue.  Since we're already on the
+ * queue's thread, the action callback is called directly, rather than being enqueued.
+ */
+static void zmqBridgeMamaTimerImpl_queueTimerCallback(zmqTimerWheelEntry* entry, void* closure);
+
+
+/* This callback is invoked by the timing wheel's thread */
+static void zmqBridgeMamaTimerImpl_wheelCallback(zmqTimerWheelEntry* entry, void* closure)
+{
+   zmqBridgeMamaTimerImpl_timerCallback(NULL, closure);
+}
+
+
+/* This callback is invoked by the queue's dispatch thread */
+static void zmqBridgeMamaTimerImpl_queueTimerCallback(zmqTimerWheelEntry* entry, void* closure)
+{
+   zmqTimerImpl* impl = (zmqTimerImpl*) closure;
+
+   if (0 == wInterlocked_read(&impl->mDestroying)) {
+      /* Set the timer for the next firing */
+      zmqBridgeMamaTimer_reset((timerBridge) closure);
+
+      zmqBridgeMamaTimerImpl_queueCallback(((zmqQueueBridge*) impl->mQueue)->mParent, closure);
+   }
+}
+
 
 mama_status zmqBridgeMamaTimerImpl_reset(zmqTimerImpl* impl, mama_f64_t interval);
 
@@ -143,6 +180,24 @@ mama_status zmqBridgeMamaTimer_create(timerBridge* result, void* nativeQueueHand
     /* Get the timer heap from the bridge */
     zmqBridgeClosure* bridgeClosure = zmqBridgeMamaTimerImpl_getBridgeClosure (impl);
 
+   if (bridgeClosure->mUseQueueTimers == 1) {
+      mama_status status = zmqBridgeMamaQueue_enableTimers((queueBridge) impl->mQueue, (uint64_t) bridgeClosure->mQueueTimerTick * 1000);
+      if (status == MAMA_STATUS_OK) {
+         impl->mOnQueue = 1;
+         status = zmqBridgeMamaQueue_addTimer((queueBridge) impl->mQueue, &impl->mWheelEntry, (uint64_t) (interval * 1000000000.0), zmqBridgeMamaTimerImpl_queueTimerCallback, impl);
+      }
+      // queues in a group can't host timers -- use the timer thread instead
+      if (status != MAMA_STATUS_NOT_IMPLEMENTED) {
+         return status;
+      }
+   }
+
+   if (bridgeClosure->mWheel != NULL) {
+      impl->mWheel = bridgeClosure->mWheel;
+      zmqBridgeMamaTimerWheel_add(impl->mWheel, &impl->mWheelEntry, (uint64_t) (interval * 1000000000.0), zmqBridgeMamaTimerImpl_wheelCallback, impl);
+      return MAMA_STATUS_OK;
+   }
+
    /* Create the first single fire timer */
    int timerResult = createTimer(&impl->mTimerElement, bridgeClosure->mTimerHeap, zmqBridgeMamaTimerImpl_timerCallback, &timeout, impl);
    if (0 != timerResult) {
@@ -168,6 +223,21 @@ mama_status zmqBridgeMamaTimer_destroy(timerBridge timer)
    wInterlocked_set(1, &impl->mDestroying);
    impl->mAction = NULL;
 
+   if (impl->mOnQueue == 1) {
+      // any callback in progress is on the queue's thread, so will complete before destroyCallback is dispatched
+      // (which cancels the timer again, in case the callback re-armed it)
+      zmqBridgeMamaQueue_cancelTimer((queueBridge) impl->mQueue, &impl->mWheelEntry);
+      zmqBridgeMamaQueue_enqueueEvent((queueBridge) impl->mQueue, zmqBridgeMamaTimerImpl_destroyCallback, (void*) impl);
+      return MAMA_STATUS_OK;
+   }
+
+   if (impl->mWheel != NULL) {
+      // once cancelled (under the wheel's lock), the timer callback is guaranteed not to be running
+      zmqBridgeMamaTimerWheel_cancel(impl->mWheel, &impl->mWheelEntry);
+      zmqBridgeMamaQueue_enqueueEvent((queueBridge) impl->mQueue, zmqBridgeMamaTimerImpl_destroyCallback, (void*) impl);
+      return MAMA_STATUS_OK;
+   }
+
     /* Get the timer heap from the bridge */
     zmqBridgeClosure* bridgeClosure = zmqBridgeMamaTimerImpl_getBridgeClosure (impl);
 
@@ -241,6 +311,12 @@ static void MAMACALLTYPE zmqBridgeMamaTimerImpl_destroyCallback(mamaQueue queue,
    }
    zmqTimerImpl* impl = (zmqTimerImpl*) closure;
 
+   // a queue timer callback that was already running when destroy was called may have re-armed the timer after
+   // destroy cancelled it -- but timer callbacks run on this thread, so cancelling here is final
+   if (impl->mOnQueue == 1) {
+      zmqBridgeMamaQueue_cancelTimer((queueBridge) impl->mQueue, &impl->mWheelEntry);
+   }
+
    (*impl->mOnTimerDestroyed)(impl->mParent, impl->mClosure);
 
    /* Free the implementation memory here */
@@ -293,6 +369,20 @@ mama_status zmqBridgeMamaTimerImpl_reset(zmqTimerImpl* impl, mama_f64_t interval
 
    mama_status status = MAMA_STATUS_OK;
 
+   if (impl->mOnQueue == 1) {
+      impl->mInterval = interval;
+      return zmqBridgeMamaQueue_addTimer((queueBridge) impl->mQueue, &impl->mWheelEntry, (uint64_t) (interval * 1000000000.0), zmqBridgeMamaTimerImpl_queueTimerCallback, impl);
+   }
+
+   if (impl->mWheel != NULL) {
+      // O(1) -- re-arming an entry that is already on the wheel moves it
+      zmqBridgeMamaTimerWheel_lock(impl->mWheel);
+      impl->mInterval = interval;
+      zmqBridgeMamaTimerWheel_add(impl->mWheel, &impl->mWheelEntry, (uint64_t) (interval * 1000000000.0), zmqBridgeMamaTimerImpl_wheelCallback, impl);
+      zmqBridgeMamaTimerWheel_unlock(impl->mWheel);
+      return MAMA_STATUS_OK;
+   }
+
     /* Get the timer heap from the bridge */
     zmqBridgeClosure* bridgeClosure = zmqBridgeMamaTimerImpl_getBridgeClosure (impl);
 
@@ -0,0 +1,261 @@
+//
+// timer microbenchmark -- compares wombat's timerHeap against the bridge's timing wheel (see timerwheel.h)
+//
+// Phases:
+//    start    schedule -n timers w/random intervals between 1 and 60 seconds (so none fire during the test)
+//    reset    re-schedule -r randomly chosen timers (as zmqBridgeMamaTimer_reset does)
+//    fire     w/the -n timers still pending, schedule -f timers w/random intervals of up to 10ms, and measure
+//             how late they fire (i.e., actual firing time minus due time)
+//    cancel   cancel all -n timers
+//
+// The start, reset and cancel phases report the mean cost per operation, from a single thread, including
+// locking.  Note that the heap does not have an in-place reset, so (as in the bridge) reset is done as
+// destroyTimer + createTimer.
+//
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <mama/mama.h>
+#include <wombat/port.h>
+#include <timers.h>
+#include <wombat/wInterlocked.h>
+
+#include "util.h"
+#include "histogram.h"
+#include "timerwheel.h"
+
+#define TIMER_HEAP      1
+#define TIMER_WHEEL     2
+
+typedef struct tbTimer {
+   timerElement            mElement;            // heap only
+   zmqTimerWheelEntry      mEntry;              // wheel only
+   uint64_t                mDue;
+} tbTimer;
+
+// options
+int gTimerChoice = TIMER_WHEEL;
+long gCount = 100000;
+long gResets = 1000000;
+long gFires = 10000;
+int gTick = 1000;                               // micros
+
+timerHeap gHeap = NULL;
+zmqTimerWheel* gWheel = NULL;
+tbTimer* gTimers = NULL;
+tbTimer* gFireTimers = NULL;
+zmqHistogram gLateness;                         // only touched by the timer thread
+wInterlockedInt gFired;
+
+
+///////////////////////////////////////////////////////////////////////////////
+// callbacks
+
+static void tbFired(tbTimer* timer)
+{
+   uint64_t now = getNanos();
+   zmqBridgeMamaHistogram_record(&gLateness, (now > timer->mDue) ? now - timer->mDue : 0);
+   wInterlocked_increment(&gFired);
+}
+
+static void tbHeapCb(timerElement element, void* closure)
+{
+   tbTimer* timer = (tbTimer*) closure;
+   // heap timers are one-shot, but the element still needs to be destroyed
+   destroyTimer(gHeap, element);
+   tbFired(timer);
+}
+
+static void tbWheelCb(zmqTimerWheelEntry* entry, void* closure)
+{
+   tbFired((tbTimer*) closure);
+}
+
+// long-running timers should never fire
+static void tbUnexpectedHeapCb(timerElement element, void* closure)
+{
+   fprintf(stderr, "Unexpected timer fired\n");
+   exit(3);
+}
+
+static void tbUnexpectedWheelCb(zmqTimerWheelEntry* entry, void* closure)
+{
+   tbUnexpectedHeapCb(NULL, closure);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// timer operations
+
+static void tbStart(tbTimer* timer, uint64_t delayNanos, int fire)
+{
+   timer->mDue = getNanos() + delayNanos;
+
+   if (gTimerChoice == TIMER_WHEEL) {
+      zmqBridgeMamaTimerWheel_add(gWheel, &timer->mEntry, delayNanos, fire ? tbWheelCb : tbUnexpectedWheelCb, timer);
+      return;
+   }
+
+   struct timeval timeout;
+   timeout.tv_sec = delayNanos / 1000000000;
+   timeout.tv_usec = (delayNanos % 1000000000) / 1000;
+   if (createTimer(&timer->mElement, gHeap, fire ? tbHeapCb : tbUnexpectedHeapCb, &timeout, timer) != 0) {
+      fprintf(stderr, "createTimer failed\n");
+      exit(3);
+   }
+}
+
+static void tbReset(tbTimer* timer, uint64_t delayNanos)
+{
+   if (gTimerChoice == TIMER_WHEEL) {
+      zmqBridgeMamaTimerWheel_lock(gWheel);
+      tbStart(timer, delayNanos, 0);
+      zmqBridgeMamaTimerWheel_unlock(gWheel);
+      return;
+   }
+
+   lockTimerHeap(gHeap);
+   destroyTimer(gHeap, timer->mElement);
+   tbStart(timer, delayNanos, 0);
+   unlockTimerHeap(gHeap);
+}
+
+static void tbCancel(tbTimer* timer)
+{
+   if (gTimerChoice == TIMER_WHEEL) {
+      zmqBridgeMamaTimerWheel_cancel(gWheel, &timer->mEntry);
+      return;
+   }
+
+   destroyTimer(gHeap, timer->mElement);
+   timer->mElement = NULL;
+}
+
+// random delay between min and max millis
+static uint64_t tbDelay(long minMillis, long maxMillis)
+{
+   return (minMillis + (random() % (maxMillis - minMillis + 1))) * 1000000 + (random() % 1000000);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+
+static void usage(void)
+{
+   printf("Usage: timerbench [-w heap|wheel] [-n timers] [-r resets] [-f fires] [-t tick]\n");
+   printf("  -w    timer implementation (default: wheel)\n");
+   printf("  -n    number of long-running timers (default: %ld)\n", gCount);
+   printf("  -r    number of resets (default: %ld)\n", gResets);
+   printf("  -f    number of short timers to fire (default: %ld)\n", gFires);
+   printf("  -t    wheel tick in micros (default: %d)\n", gTick);
+   exit(1);
+}
+
+static void report(const char* phase, long count, uint64_t start, uint64_t end)
+{
+   double secs = (end - start) / 1e9;
+   printf("%-8s %10ld ops in %.3f secs (%.1f ns/op)\n", phase, count, secs, (count > 0) ? (end - start) / (double) count : 0);
+}
+
+int main(int argc, char* argv[])
+{
+   int opt;
+   while ((opt = getopt(argc, argv, "w:n:r:f:t:h")) != -1) {
+      switch (opt) {
+         case 'w':
+            if      (strcmp(optarg, "heap") == 0)       gTimerChoice = TIMER_HEAP;
+            else if (strcmp(optarg, "wheel") == 0)      gTimerChoice = TIMER_WHEEL;
+            else usage();
+            break;
+         case 'n':   gCount = atol(optarg);        break;
+         case 'r':   gResets = atol(optarg);       break;
+         case 'f':   gFires = atol(optarg);        break;
+         case 't':   gTick = atoi(optarg);         break;
+         default:    usage();
+      }
+   }
+   if ((gCount < 1) || (gResets < 0) || (gFires < 0) || (gTick < 1)) {
+      usage();
+   }
+
+   gTimers = calloc(gCount, sizeof(tbTimer));
+   gFireTimers = calloc((gFires > 0) ? gFires : 1, sizeof(tbTimer));
+   if ((gTimers == NULL) || (gFireTimers == NULL)) {
+      fprintf(stderr, "Unable to allocate timers\n");
+      exit(2);
+   }
+   zmqBridgeMamaHistogram_init(&gLateness);
+   wInterlocked_initialize(&gFired);
+   wInterlocked_set(0, &gFired);
+   srandom(1);
+
+   if (gTimerChoice == TIMER_WHEEL) {
+      if ((zmqBridgeMamaTimerWheel_create(&gWheel, (uint64_t) gTick * 1000) != MAMA_STATUS_OK)
+         || (zmqBridgeMamaTimerWheel_start(gWheel) != MAMA_STATUS_OK)) {
+         fprintf(stderr, "Unable to create timer wheel\n");
+         exit(2);
+      }
+   }
+   else {
+      if ((createTimerHeap(&gHeap) != 0) || (startDispatchTimerHeap(gHeap) != 0)) {
+         fprintf(stderr, "Unable to create timer heap\n");
+         exit(2);
+      }
+   }
+
+   printf("timerbench: timers=%s count=%ld resets=%ld fires=%ld", (gTimerChoice == TIMER_WHEEL) ? "wheel" : "heap", gCount, gResets, gFires);
+   if (gTimerChoice == TIMER_WHEEL) {
+      printf(" tick=%dus", gTick);
+   }
+   printf("\n");
+
+   uint64_t start = getNanos();
+   for (long i = 0; i < gCount; ++i) {
+      tbStart(&gTimers[i], tbDelay(1000, 60000), 0);
+   }
+   report("start", gCount, start, getNanos());
+
+   start = getNanos();
+   for (long i = 0; i < gResets; ++i) {
+      tbReset(&gTimers[random() % gCount], tbDelay(1000, 60000));
+   }
+   report("reset", gResets, start, getNanos());
+
+   // schedule short timers in small batches, so they are spread out over time
+   start = getNanos();
+   for (long i = 0; i < gFires; ++i) {
+      tbStart(&gFireTimers[i], tbDelay(0, 9), 1);
+      if ((i % 100) == 99) {
+         usleep(1000);
+      }
+   }
+   while (wInterlocked_read(&gFired) < gFires) {
+      usleep(1000);
+   }
+   report("fire", gFires, start, getNanos());
+
+   start = getNanos();
+   for (long i = 0; i < gCount; ++i) {
+      tbCancel(&gTimers[i]);
+   }
+   report("cancel", gCount, start, getNanos());
+
+   char buf[512];
+   printf("lateness %s\n", zmqBridgeMamaHistogram_format(&gLateness, buf, sizeof(buf)));
+
+   if (gTimerChoice == TIMER_WHEEL) {
+      zmqBridgeMamaTimerWheel_destroy(gWheel);
+   }
+   else {
+      destroyHeap(gHeap);
+   }
+
+   free(gTimers);
+   free(gFireTimers);
+
+   return 0;
+}
@@ -0,0 +1,367 @@
+//
+// hierarchical timing wheel -- see timerwheel.h
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <mama/mama.h>
+
+#include "util.h"
+#include "timerwheel.h"
+
+#define ZMQ_TIMERWHEEL_SLOT_MASK    (ZMQ_TIMERWHEEL_SLOTS -1)
+
+struct zmqTimerWheel_ {
+   pthread_mutex_t         mLock;               // recursive
+   pthread_cond_t          mCond;               // signaled when wheel goes from empty to non-empty, and on stop
+   pthread_t               mThread;
+   int                     mIsStarted;
+   int                     mStop;
+   uint64_t                mTickNanos;
+   uint64_t                mStartTime;          // tick 0
+   uint64_t                mCurrTick;           // all timers due up to and including this tick have fired
+   size_t                  mCount;
+   zmqTimerWheelEntry      mSlots[ZMQ_TIMERWHEEL_LEVELS][ZMQ_TIMERWHEEL_SLOTS];   // list heads
+};
+
+
+static void zmqBridgeMamaTimerWheelImpl_listInit(zmqTimerWheelEntry* head)
+{
+   head->mNext = head;
+   head->mPrev = head;
+}
+
+static void zmqBridgeMamaTimerWheelImpl_listAppend(zmqTimerWheelEntry* head, zmqTimerWheelEntry* entry)
+{
+   entry->mNext = head;
+   entry->mPrev = head->mPrev;
+   head->mPrev->mNext = entry;
+   head->mPrev = entry;
+}
+
+static void zmqBridgeMamaTimerWheelImpl_listRemove(zmqTimerWheelEntry* entry)
+{
+   entry->mPrev->mNext = entry->mNext;
+   entry->mNext->mPrev = entry->mPrev;
+   entry->mNext = NULL;
+   entry->mPrev = NULL;
+}
+
+// moves all entries in src to the end of dest
+static void zmqBridgeMamaTimerWheelImpl_listSplice(zmqTimerWheelEntry* dest, zmqTimerWheelEntry* src)
+{
+   if (src->mNext == src) {
+      return;
+   }
+   src->mNext->mPrev = dest->mPrev;
+   dest->mPrev->mNext = src->mNext;
+   src->mPrev->mNext = dest;
+   dest->mPrev = src->mPrev;
+   zmqBridgeMamaTimerWheelImpl_listInit(src);
+}
+
+
+static uint64_t zmqBridgeMamaTimerWheelImpl_nowTick(zmqTimerWheel* wheel)
+{
+   return (getNanos() - wheel->mStartTime) / wheel->mTickNanos;
+}
+
+
+// puts entry in the appropriate slot, based on how far in the future it expires
+// (entries due before minTick are put in minTick's slot)
+static void zmqBridgeMamaTimerWheelImpl_place(zmqTimerWheel* wheel, zmqTimerWheelEntry* entry, uint64_t minTick)
+{
+   uint64_t expiry = entry->mExpiry;
+   if (expiry < minTick) {
+      expiry = minTick;
+   }
+
+   uint64_t delta = expiry - wheel->mCurrTick;
+   int level = 0;
+   while ((level < ZMQ_TIMERWHEEL_LEVELS -1) && (delta >= ((uint64_t) 1 << ((level + 1) * ZMQ_TIMERWHEEL_SLOT_BITS)))) {
+      ++level;
+   }
+   if (delta >= ((uint64_t) 1 << (ZMQ_TIMERWHEEL_LEVELS * ZMQ_TIMERWHEEL_SLOT_BITS))) {
+      // beyond the range of the top level -- park it as far out as possible, it will be re-placed on cascade
+      expiry = wheel->mCurrTick + ((uint64_t) 1 << (ZMQ_TIMERWHEEL_LEVELS * ZMQ_TIMERWHEEL_SLOT_BITS)) -1;
+   }
+
+   int slot = (expiry >> (level * ZMQ_TIMERWHEEL_SLOT_BITS)) & ZMQ_TIMERWHEEL_SLOT_MASK;
+   zmqBridgeMamaTimerWheelImpl_listAppend(&wheel->mSlots[level][slot], entry);
+}
+
+
+// re-places all entries in a higher-level slot (which will land in lower levels)
+static void zmqBridgeMamaTimerWheelImpl_cascade(zmqTimerWheel* wheel, int level, int slot)
+{
+   zmqTimerWheelEntry temp;
+   zmqBridgeMamaTimerWheelImpl_listInit(&temp);
+   zmqBridgeMamaTimerWheelImpl_listSplice(&temp, &wheel->mSlots[level][slot]);
+   while (temp.mNext != &temp) {
+      zmqTimerWheelEntry* entry = temp.mNext;
+      zmqBridgeMamaTimerWheelImpl_listRemove(entry);
+      // NOTE: current tick's level 0 slot has not been expired yet
+      zmqBridgeMamaTimerWheelImpl_place(wheel, entry, wheel->mCurrTick);
+   }
+}
+
+
+// advances the wheel by one tick, moving expired entries to the expired list
+static void zmqBridgeMamaTimerWheelImpl_tick(zmqTimerWheel* wheel, zmqTimerWheelEntry* expired)
+{
+   uint64_t tick = ++wheel->mCurrTick;
+
+   // cascade higher levels when the level below wraps
+   for (int level = 1; level < ZMQ_TIMERWHEEL_LEVELS; ++level) {
+      if ((tick & (((uint64_t) 1 << (level * ZMQ_TIMERWHEEL_SLOT_BITS)) -1)) != 0) {
+         break;
+      }
+      zmqBridgeMamaTimerWheelImpl_cascade(wheel, level, (tick >> (level * ZMQ_TIMERWHEEL_SLOT_BITS)) & ZMQ_TIMERWHEEL_SLOT_MASK);
+   }
+
+   zmqBridgeMamaTimerWheelImpl_listSplice(expired, &wheel->mSlots[0][tick & ZMQ_TIMERWHEEL_SLOT_MASK]);
+}
+
+
+// advances the wheel to nowTick, moving expired entries to the expired list
+static void zmqBridgeMamaTimerWheelImpl_collect(zmqTimerWheel* wheel, uint64_t nowTick, zmqTimerWheelEntry* expired)
+{
+   while (wheel->mCurrTick < nowTick) {
+      zmqBridgeMamaTimerWheelImpl_tick(wheel, expired);
+   }
+}
+
+
+static void* zmqBridgeMamaTimerWheelImpl_thread(void* closure)
+{
+   zmqTimerWheel* wheel = (zmqTimerWheel*) closure;
+
+   pthread_mutex_lock(&wheel->mLock);
+   while (!wheel->mStop) {
+      if (wheel->mCount == 0) {
+         pthread_cond_wait(&wheel->mCond, &wheel->mLock);
+         continue;
+      }
+
+      uint64_t nowTick = zmqBridgeMamaTimerWheelImpl_nowTick(wheel);
+      if (wheel->mCurrTick < nowTick) {
+         // collect everything that is due (normally one tick, more if we fell behind), and fire it as a batch
+         zmqTimerWheelEntry expired;
+         zmqBridgeMamaTimerWheelImpl_listInit(&expired);
+         zmqBridgeMamaTimerWheelImpl_collect(wheel, nowTick, &expired);
+         while (expired.mNext != &expired) {
+            zmqTimerWheelEntry* entry = expired.mNext;
+            zmqBridgeMamaTimerWheelImpl_listRemove(entry);
+            --wheel->mCount;
+            // NOTE: callback may re-arm or cancel this or any other entry
+            entry->mCb(entry, entry->mClosure);
+         }
+         continue;
+      }
+
+      // sleep until next tick
+      uint64_t wakeNanos = wheel->mStartTime + (wheel->mCurrTick + 1) * wheel->mTickNanos;
+      struct timespec wake;
+      #if defined __APPLE__
+      // no monotonic condvars on macOS -- convert to realtime
+      clock_gettime(CLOCK_REALTIME, &wake);
+      wakeNanos += ((uint64_t) wake.tv_sec * 1000000000 + wake.tv_nsec) - getNanos();
+      #endif
+      wake.tv_sec = wakeNanos / 1000000000;
+      wake.tv_nsec = wakeNanos % 1000000000;
+      pthread_cond_timedwait(&wheel->mCond, &wheel->mLock, &wake);
+   }
+   pthread_mutex_unlock(&wheel->mLock);
+
+   return NULL;
+}
+
+
+mama_status zmqBridgeMamaTimerWheel_create(zmqTimerWheel** result, uint64_t tickNanos)
+{
+   if ((result == NULL) || (tickNanos == 0)) {
+      return MAMA_STATUS_INVALID_ARG;
+   }
+
+   zmqTimerWheel* wheel = (zmqTimerWheel*) calloc(1, sizeof(zmqTimerWheel));
+   if (wheel == NULL) {
+      return MAMA_STATUS_NOMEM;
+   }
+
+   pthread_mutexattr_t mutexAttr;
+   pthread_mutexattr_init(&mutexAttr);
+   pthread_mutexattr_settype(&mutexAttr, PTHREAD_MUTEX_RECURSIVE);
+   pthread_mutex_init(&wheel->mLock, &mutexAttr);
+   pthread_mutexattr_destroy(&mutexAttr);
+
+   pthread_condattr_t condAttr;
+   pthread_condattr_init(&condAttr);
+   #if !defined __APPLE__
+   pthread_condattr_setclock(&condAttr, CLOCK_MONOTONIC);
+   #endif
+   pthread_cond_init(&wheel->mCond, &condAttr);
+   pthread_condattr_destroy(&condAttr);
+
+   for (int level = 0; level < ZMQ_TIMERWHEEL_LEVELS; ++level) {
+      for (int slot = 0; slot < ZMQ_TIMERWHEEL_SLOTS; ++slot) {
+         zmqBridgeMamaTimerWheelImpl_listInit(&wheel->mSlots[level][slot]);
+      }
+   }
+
+   wheel->mTickNanos = tickNanos;
+   wheel->mStartTime = getNanos();
+
+   *result = wheel;
+   return MAMA_STATUS_OK;
+}
+
+
+mama_status zmqBridgeMamaTimerWheel_start(zmqTimerWheel* wheel)
+{
+   int rc = pthread_create(&wheel->mThread, NULL, zmqBridgeMamaTimerWheelImpl_thread, wheel);
+   if (rc != 0) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "create of timer wheel thread failed %d(%s)", rc, strerror(rc));
+      return MAMA_STATUS_PLATFORM;
+   }
+   wheel->mIsStarted = 1;
+
+   return MAMA_STATUS_OK;
+}
+
+
+void zmqBridgeMamaTimerWheel_destroy(zmqTimerWheel* wheel)
+{
+   if (wheel == NULL) {
+      return;
+   }
+
+   if (wheel->mIsStarted) {
+      pthread_mutex_lock(&wheel->mLock);
+      wheel->mStop = 1;
+      pthread_cond_signal(&wheel->mCond);
+      pthread_mutex_unlock(&wheel->mLock);
+      pthread_join(wheel->mThread, NULL);
+   }
+
+   if (wheel->mCount > 0) {
+      MAMA_LOG(MAMA_LOG_LEVEL_FINE, "Destroying timer wheel with %zu timers scheduled", wheel->mCount);
+   }
+
+   pthread_cond_destroy(&wheel->mCond);
+   pthread_mutex_destroy(&wheel->mLock);
+   free(wheel);
+}
+
+
+void zmqBridgeMamaTimerWheel_lock(zmqTimerWheel* wheel)
+{
+   pthread_mutex_lock(&wheel->mLock);
+}
+
+
+void zmqBridgeMamaTimerWheel_unlock(zmqTimerWheel* wheel)
+{
+   pthread_mutex_unlock(&wheel->mLock);
+}
+
+
+void zmqBridgeMamaTimerWheel_add(zmqTimerWheel* wheel, zmqTimerWheelEntry* entry, uint64_t delayNanos, zmqTimerWheelCb cb, void* closure)
+{
+   uint64_t now = getNanos();
+
+   pthread_mutex_lock(&wheel->mLock);
+
+   if (entry->mNext != NULL) {
+      zmqBridgeMamaTimerWheelImpl_listRemove(entry);
+      --wheel->mCount;
+   }
+
+   uint64_t nowTick = (now - wheel->mStartTime) / wheel->mTickNanos;
+   if (wheel->mCount == 0) {
+      // thread doesn't tick while wheel is empty, so catch up (there is nothing to fire or cascade)
+      wheel->mCurrTick = nowTick;
+      pthread_cond_signal(&wheel->mCond);
+   }
+
+   // round up, so timers never fire early
+   entry->mExpiry = ((now - wheel->mStartTime) + delayNanos + wheel->mTickNanos -1) / wheel->mTickNanos;
+   entry->mCb = cb;
+   entry->mClosure = closure;
+   // current tick has already been expired, so fire on next tick at the earliest
+   zmqBridgeMamaTimerWheelImpl_place(wheel, entry, wheel->mCurrTick + 1);
+   ++wheel->mCount;
+
+   pthread_mutex_unlock(&wheel->mLock);
+}
+
+
+void zmqBridgeMamaTimerWheel_cancel(zmqTimerWheel* wheel, zmqTimerWheelEntry* entry)
+{
+   pthread_mutex_lock(&wheel->mLock);
+   if (entry->mNext != NULL) {
+      zmqBridgeMamaTimerWheelImpl_listRemove(entry);
+      --wheel->mCount;
+   }
+   pthread_mutex_unlock(&wheel->mLock);
+}
+
+
+void zmqBridgeMamaTimerWheel_advance(zmqTimerWheel* wheel)
+{
+   zmqTimerWheelEntry expired;
+   zmqBridgeMamaTimerWheelImpl_listInit(&expired);
+
+   pthread_mutex_lock(&wheel->mLock);
+   if (wheel->mCount > 0) {
+      zmqBridgeMamaTimerWheelImpl_collect(wheel, zmqBridgeMamaTimerWheelImpl_nowTick(wheel), &expired);
+   }
+   while (expired.mNext != &expired) {
+      zmqTimerWheelEntry* entry = expired.mNext;
+      zmqBridgeMamaTimerWheelImpl_listRemove(entry);
+      --wheel->mCount;
+      zmqTimerWheelCb cb = entry->mCb;
+      void* closure = entry->mClosure;
+      // NOTE: while unlocked, other threads may cancel or re-arm entries that are still on the expired list
+      pthread_mutex_unlock(&wheel->mLock);
+      cb(entry, closure);
+      pthread_mutex_lock(&wheel->mLock);
+   }
+   pthread_mutex_unlock(&wheel->mLock);
+}
+
+
+uint64_t zmqBridgeMamaTimerWheel_getNextExpiry(zmqTimerWheel* wheel)
+{
+   uint64_t result = 0;
+
+   pthread_mutex_lock(&wheel->mLock);
+   if (wheel->mCount > 0) {
+      // higher levels cascade when level 0 wraps, so look no further than that
+      uint64_t nextTick = ((wheel->mCurrTick >> ZMQ_TIMERWHEEL_SLOT_BITS) + 1) << ZMQ_TIMERWHEEL_SLOT_BITS;
+      for (uint64_t tick = wheel->mCurrTick + 1; tick < nextTick; ++tick) {
+         zmqTimerWheelEntry* head = &wheel->mSlots[0][tick & ZMQ_TIMERWHEEL_SLOT_MASK];
+         if (head->mNext != head) {
+            nextTick = tick;
+            break;
+         }
+      }
+      result = wheel->mStartTime + nextTick * wheel->mTickNanos;
+   }
+   pthread_mutex_unlock(&wheel->mLock);
+
+   return result;
+}
+
+
+size_t zmqBridgeMamaTimerWheel_getCount(zmqTimerWheel* wheel)
+{
+   pthread_mutex_lock(&wheel->mLock);
+   size_t count = wheel->mCount;
+   pthread_mutex_unlock(&wheel->mLock);
+
+   return count;
+}
@@ -0,0 +1,76 @@
+//
+// hierarchical timing wheel -- alternative to wombat's timerHeap for bridge timers
+//
+// Time is divided into ticks (1ms by default), and timers are kept in ZMQ_TIMERWHEEL_LEVELS wheels of
+// ZMQ_TIMERWHEEL_SLOTS slots each: level 0 holds timers due in the next 256 ticks, level 1 those due in
+// the next 256^2 ticks etc.  Each slot is an intrusive doubly-linked list, so starting, resetting and
+// cancelling a timer are all O(1).  When level 0 wraps, the next slot of level 1 is "cascaded" into
+// level 0, and so on.
+//
+// Normally, a single thread advances the wheel, and fires all timers that expire on a tick as a batch, under one
+// acquisition of the wheel's lock.  As w/timerHeap, callbacks are called w/the lock held, and the lock is
+// recursive, so callbacks can re-arm (or cancel) timers, and cancelling a timer while holding the lock
+// guarantees that its callback is not running (and will not run).
+//
+// Alternatively, a wheel that is not started can be advanced by its owner (e.g., a queue's dispatch thread)
+// by calling zmqBridgeMamaTimerWheel_advance, in which case callbacks are called on the owner's thread.
+//
+
+#ifndef MAMA_BRIDGE_ZMQ_TIMERWHEEL_H__
+#define MAMA_BRIDGE_ZMQ_TIMERWHEEL_H__
+
+#include <stdint.h>
+#include <mama/mama.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#define ZMQ_TIMERWHEEL_LEVELS       4
+#define ZMQ_TIMERWHEEL_SLOT_BITS    8
+#define ZMQ_TIMERWHEEL_SLOTS        (1 << ZMQ_TIMERWHEEL_SLOT_BITS)
+
+typedef struct zmqTimerWheel_ zmqTimerWheel;
+typedef struct zmqTimerWheelEntry_ zmqTimerWheelEntry;
+
+typedef void (*zmqTimerWheelCb)(zmqTimerWheelEntry* entry, void* closure);
+
+// embedded in the owner's timer struct (and must be zero-initialized)
+struct zmqTimerWheelEntry_ {
+   zmqTimerWheelEntry*     mNext;               // NULL if not scheduled
+   zmqTimerWheelEntry*     mPrev;
+   uint64_t                mExpiry;             // in ticks
+   zmqTimerWheelCb         mCb;
+   void*                   mClosure;
+};
+
+// tickNanos is the resolution of the wheel -- timers fire on the first tick at or after their due time
+mama_status zmqBridgeMamaTimerWheel_create(zmqTimerWheel** wheel, uint64_t tickNanos);
+mama_status zmqBridgeMamaTimerWheel_start(zmqTimerWheel* wheel);
+// stops and joins the wheel's thread -- any timers still scheduled are simply forgotten
+void zmqBridgeMamaTimerWheel_destroy(zmqTimerWheel* wheel);
+
+void zmqBridgeMamaTimerWheel_lock(zmqTimerWheel* wheel);
+void zmqBridgeMamaTimerWheel_unlock(zmqTimerWheel* wheel);
+
+// (re-)schedules entry to fire once, delayNanos from now (if entry is already scheduled, it is cancelled first)
+void zmqBridgeMamaTimerWheel_add(zmqTimerWheel* wheel, zmqTimerWheelEntry* entry, uint64_t delayNanos, zmqTimerWheelCb cb, void* closure);
+void zmqBridgeMamaTimerWheel_cancel(zmqTimerWheel* wheel, zmqTimerWheelEntry* entry);
+
+// for wheels that are not started -- fires all timers that are due, on the calling thread
+// NOTE: unlike timers fired by the wheel's thread, callbacks are called w/o the wheel's lock held, so
+// cancelling a timer does not guarantee that its callback is not running
+void zmqBridgeMamaTimerWheel_advance(zmqTimerWheel* wheel);
+
+// returns the time (as per getNanos) at or before which advance should next be called, or 0 if no timers
+// are scheduled (may be earlier than the next timer is actually due, but never later)
+uint64_t zmqBridgeMamaTimerWheel_getNextExpiry(zmqTimerWheel* wheel);
+
+// number of timers currently scheduled
+size_t zmqBridgeMamaTimerWheel_getCount(zmqTimerWheel* wheel);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* MAMA_BRIDGE_ZMQ_TIMERWHEEL_H__ */
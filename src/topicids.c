@@ -0,0 +1,405 @@
+//
+// topic ids -- replace full subject strings on the wire w/compact integer ids
+//
+// Each transport assigns ids to the subjects it publishes, and identifies its ids w/a tag derived
+// from its uuid.  The first msg for a subject (and every topic_ids.refresh msgs after that) is sent
+// w/the full subject, along w/the tag and id.  Receivers that get such a msg record the mapping and
+// subscribe to the binary prefix (marker + tag + id) that is used in place of the subject for all
+// other msgs.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+#include <mama/mama.h>
+#include <wombat/wtable.h>
+#include <wlock.h>
+
+#include "transport.h"
+#include "topicids.h"
+#include "zmqdefs.h"
+
+
+static uint32_t zmqBridgeMamaTopicIdsImpl_makeTag(const char* uuid)
+{
+   // FNV-1a
+   uint32_t hash = 2166136261u;
+   for (const char* p = uuid; *p != '\0'; ++p) {
+      hash ^= (uint8_t) *p;
+      hash *= 16777619u;
+   }
+
+   // zero marks an empty slot in the peer table
+   return (hash == 0) ? 1 : hash;
+}
+
+
+static void zmqBridgeMamaTopicIdsImpl_freeTopicId(wtable_t table, void* data, const char* key, void* closure)
+{
+   zmqTopicId* topicId = (zmqTopicId*) data;
+   free((void*) topicId->mSubject);
+   free(topicId);
+}
+
+
+static void zmqBridgeMamaTopicIdsImpl_freeSubject(wtable_t table, void* data, const char* key, void* closure)
+{
+   free(data);
+}
+
+
+// returns the interned copy of str (msgs already enqueued may still point to it, so it lives until the
+// transport is destroyed)
+static const char* zmqBridgeMamaTopicIdsImpl_intern(zmqTransportBridge* impl, const char* str)
+{
+   const char* interned = wtable_lookup(impl->mTopicSubjects, str);
+   if (interned == NULL) {
+      interned = strdup(str);
+      if (interned == NULL) {
+         return NULL;
+      }
+      wtable_insert(impl->mTopicSubjects, interned, (void*) interned);
+   }
+
+   return interned;
+}
+
+
+typedef struct zmqTopicCoverClosure {
+   const char*             mSubject;
+   const char*             mCover;
+} zmqTopicCoverClosure;
+
+static void zmqBridgeMamaTopicIdsImpl_matchCover(wtable_t table, void* data, const char* key, void* closure)
+{
+   zmqTopicCoverClosure* cover = (zmqTopicCoverClosure*) closure;
+   // zmq subscriptions are prefix matches
+   if ((cover->mCover == NULL) && (strncmp(cover->mSubject, key, strlen(key)) == 0)) {
+      cover->mCover = key;
+   }
+}
+
+
+// returns the (interned) subscribed topic that matches subject, or NULL if none
+static const char* zmqBridgeMamaTopicIdsImpl_findCover(zmqTransportBridge* impl, const char* subject)
+{
+   if (wtable_lookup(impl->mTopicSubs, subject) != NULL) {
+      return zmqBridgeMamaTopicIdsImpl_intern(impl, subject);
+   }
+
+   zmqTopicCoverClosure cover;
+   cover.mSubject = subject;
+   cover.mCover = NULL;
+   wtable_for_each(impl->mTopicSubs, zmqBridgeMamaTopicIdsImpl_matchCover, &cover);
+   return (cover.mCover != NULL) ? zmqBridgeMamaTopicIdsImpl_intern(impl, cover.mCover) : NULL;
+}
+
+
+// finds the entry for tag, optionally creating it
+static zmqTopicPeer* zmqBridgeMamaTopicIdsImpl_findPeer(zmqTransportBridge* impl, uint32_t tag, int create)
+{
+   uint32_t index = tag & (TOPIC_PEER_TABLE_SIZE -1);
+   for (int i = 0; i < TOPIC_PEER_TABLE_SIZE; ++i) {
+      zmqTopicPeer* peer = &impl->mTopicPeers[index];
+      if (peer->mTag == tag) {
+         return peer;
+      }
+      if (peer->mTag == 0) {
+         if (create == 0) {
+            return NULL;
+         }
+         peer->mTag = tag;
+         return peer;
+      }
+      index = (index + 1) & (TOPIC_PEER_TABLE_SIZE -1);
+   }
+
+   return NULL;
+}
+
+
+mama_status zmqBridgeMamaTopicIds_create(zmqTransportBridge* impl)
+{
+   if (impl->mTopicIds == 0) {
+      return MAMA_STATUS_OK;
+   }
+
+   impl->mTopicTag = zmqBridgeMamaTopicIdsImpl_makeTag(impl->mUuid);
+   impl->mNextTopicId = 0;
+   impl->mTopicIdLock = wlock_create();
+
+   impl->mTopicIdTable = wtable_create("topicIds", TOPIC_TABLE_SIZE);
+   if (impl->mTopicIdTable == NULL) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Failed to create topic id table");
+      return MAMA_STATUS_NOMEM;
+   }
+
+   impl->mTopicSubjects = wtable_create("topicSubjects", TOPIC_TABLE_SIZE);
+   if (impl->mTopicSubjects == NULL) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Failed to create topic subject table");
+      return MAMA_STATUS_NOMEM;
+   }
+
+   impl->mTopicSubs = wtable_create("topicSubs", TOPIC_TABLE_SIZE);
+   if (impl->mTopicSubs == NULL) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Failed to create topic subscription table");
+      return MAMA_STATUS_NOMEM;
+   }
+
+   impl->mTopicPeers = calloc(TOPIC_PEER_TABLE_SIZE, sizeof(zmqTopicPeer));
+   if (impl->mTopicPeers == NULL) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Failed to create topic peer table");
+      return MAMA_STATUS_NOMEM;
+   }
+
+   MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Topic ids enabled: tag=%08x refresh=%u", impl->mTopicTag, impl->mTopicIdsRefresh);
+
+   return MAMA_STATUS_OK;
+}
+
+
+void zmqBridgeMamaTopicIds_destroy(zmqTransportBridge* impl)
+{
+   if (impl->mTopicIds == 0) {
+      return;
+   }
+
+   MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Topic ids assigned = %u", impl->mNextTopicId);
+
+   if (impl->mTopicPeers != NULL) {
+      for (int i = 0; i < TOPIC_PEER_TABLE_SIZE; ++i) {
+         free(impl->mTopicPeers[i].mSlots);
+      }
+      free(impl->mTopicPeers);
+      impl->mTopicPeers = NULL;
+   }
+
+   if (impl->mTopicSubs != NULL) {
+      wtable_destroy(impl->mTopicSubs);
+      impl->mTopicSubs = NULL;
+   }
+
+   if (impl->mTopicSubjects != NULL) {
+      wtable_for_each(impl->mTopicSubjects, zmqBridgeMamaTopicIdsImpl_freeSubject, NULL);
+      wtable_destroy(impl->mTopicSubjects);
+      impl->mTopicSubjects = NULL;
+   }
+
+   if (impl->mTopicIdTable != NULL) {
+      wtable_for_each(impl->mTopicIdTable, zmqBridgeMamaTopicIdsImpl_freeTopicId, NULL);
+      wtable_destroy(impl->mTopicIdTable);
+      impl->mTopicIdTable = NULL;
+   }
+
+   wlock_destroy(impl->mTopicIdLock);
+}
+
+
+zmqTopicId* zmqBridgeMamaTopicIds_intern(zmqTransportBridge* impl, const char* subject)
+{
+   if ((impl->mTopicIds == 0) || (subject == NULL)) {
+      return NULL;
+   }
+
+   wlock_lock(impl->mTopicIdLock);
+   zmqTopicId* topicId = wtable_lookup(impl->mTopicIdTable, subject);
+   if ((topicId == NULL) && (impl->mNextTopicId < ZMQ_MAX_TOPIC_IDS)) {
+      topicId = calloc(1, sizeof(zmqTopicId));
+      if (topicId != NULL) {
+         topicId->mSubject = strdup(subject);
+         topicId->mId = impl->mNextTopicId++;
+         wtable_insert(impl->mTopicIdTable, topicId->mSubject, topicId);
+         MAMA_LOG(MAMA_LOG_LEVEL_FINE, "Assigned topic id %u to %s", topicId->mId, subject);
+      }
+   }
+   wlock_unlock(impl->mTopicIdLock);
+
+   return topicId;
+}
+
+
+int zmqBridgeMamaTopicIds_needsAnnounce(zmqTransportBridge* impl, zmqTopicId* topicId)
+{
+   uint32_t count = __sync_fetch_and_add(&topicId->mCount, 1);
+   return (count % impl->mTopicIdsRefresh) == 0;
+}
+
+
+mama_status zmqBridgeMamaTopicIds_learn(zmqTransportBridge* impl, uint32_t tag, uint32_t id, const char* subject)
+{
+   if (id >= ZMQ_MAX_TOPIC_IDS) {
+      MAMA_LOG(MAMA_LOG_LEVEL_WARN, "Ignoring out-of-range topic id %u for %s", id, subject);
+      return MAMA_STATUS_INVALID_ARG;
+   }
+
+   zmqTopicPeer* peer = zmqBridgeMamaTopicIdsImpl_findPeer(impl, tag, 1);
+   if (peer == NULL) {
+      MAMA_LOG(MAMA_LOG_LEVEL_WARN, "Topic peer table full -- ignoring topic id %u for %s", id, subject);
+      return MAMA_STATUS_NOMEM;
+   }
+
+   // grow the slot array if needed
+   if (id >= peer->mSize) {
+      uint32_t newSize = (peer->mSize == 0) ? 64 : peer->mSize;
+      while (newSize <= id) {
+         newSize *= 2;
+      }
+      zmqTopicSlot* slots = realloc(peer->mSlots, newSize * sizeof(zmqTopicSlot));
+      if (slots == NULL) {
+         return MAMA_STATUS_NOMEM;
+      }
+      memset(&slots[peer->mSize], '\0', (newSize - peer->mSize) * sizeof(zmqTopicSlot));
+      peer->mSlots = slots;
+      peer->mSize = newSize;
+   }
+
+   const char* interned = zmqBridgeMamaTopicIdsImpl_intern(impl, subject);
+   if (interned == NULL) {
+      return MAMA_STATUS_NOMEM;
+   }
+
+   zmqTopicSlot* slot = &peer->mSlots[id];
+   if ((slot->mSubject != NULL) && (slot->mSubject != interned)) {
+      MAMA_LOG(MAMA_LOG_LEVEL_WARN, "Topic id %08x.%u remapped from %s to %s (tag collision?)", tag, id, slot->mSubject, interned);
+   }
+   slot->mSubject = interned;
+
+   // the binary prefix is subscribed only while some subscription matches the subject (the announcement
+   // may have been received after the last matching subscription went)
+   if (slot->mCover == NULL) {
+      const char* cover = zmqBridgeMamaTopicIdsImpl_findCover(impl, interned);
+      if (cover == NULL) {
+         return MAMA_STATUS_OK;
+      }
+      uint8_t prefix[ZMQ_TOPICID_PREFIX_SIZE];
+      zmqBridgeMamaTopicIds_encodePrefix(prefix, tag, id);
+      CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_subscribeBinary(impl->mZmqDataSub.mSocket, prefix, sizeof(prefix)));
+      slot->mCover = cover;
+      MAMA_LOG(MAMA_LOG_LEVEL_FINE, "Learned topic id %08x.%u for %s (subscribed to %s)", tag, id, interned, cover);
+   }
+
+   return MAMA_STATUS_OK;
+}
+
+
+const char* zmqBridgeMamaTopicIds_resolve(zmqTransportBridge* impl, uint32_t tag, uint32_t id)
+{
+   zmqTopicPeer* peer = zmqBridgeMamaTopicIdsImpl_findPeer(impl, tag, 0);
+   if ((peer == NULL) || (id >= peer->mSize)) {
+      return NULL;
+   }
+
+   return peer->mSlots[id].mSubject;
+}
+
+
+void zmqBridgeMamaTopicIds_subscribe(zmqTransportBridge* impl, const char* topic)
+{
+   if (impl->mTopicIds == 0) {
+      return;
+   }
+
+   uintptr_t count = (uintptr_t) wtable_remove(impl->mTopicSubs, topic);
+   wtable_insert(impl->mTopicSubs, topic, (void*) (count + 1));
+}
+
+
+void zmqBridgeMamaTopicIds_unsubscribe(zmqTransportBridge* impl, const char* topic)
+{
+   if (impl->mTopicIds == 0) {
+      return;
+   }
+
+   uintptr_t count = (uintptr_t) wtable_remove(impl->mTopicSubs, topic);
+   if (count > 1) {
+      wtable_insert(impl->mTopicSubs, topic, (void*) (count - 1));
+      return;
+   }
+
+   // release the binary prefixes learned under topic (including those learned under a wildcard's prefix),
+   // unless another subscribed topic still matches them
+   // the mapping is kept, so that the prefix is re-subscribed on the next announcement if needed
+   const char* interned = wtable_lookup(impl->mTopicSubjects, topic);
+   if (interned == NULL) {
+      return;
+   }
+   for (int i = 0; i < TOPIC_PEER_TABLE_SIZE; ++i) {
+      zmqTopicPeer* peer = &impl->mTopicPeers[i];
+      for (uint32_t id = 0; id < peer->mSize; ++id) {
+         zmqTopicSlot* slot = &peer->mSlots[id];
+         if (slot->mCover != interned) {
+            continue;
+         }
+         slot->mCover = zmqBridgeMamaTopicIdsImpl_findCover(impl, slot->mSubject);
+         if (slot->mCover == NULL) {
+            uint8_t prefix[ZMQ_TOPICID_PREFIX_SIZE];
+            zmqBridgeMamaTopicIds_encodePrefix(prefix, peer->mTag, id);
+            zmqBridgeMamaTransportImpl_unsubscribeBinary(impl->mZmqDataSub.mSocket, prefix, sizeof(prefix));
+         }
+      }
+   }
+}
+
+
+void zmqBridgeMamaTopicIds_removePeer(zmqTransportBridge* impl, const char* uuid)
+{
+   if (impl->mTopicIds == 0) {
+      return;
+   }
+
+   uint32_t tag = zmqBridgeMamaTopicIdsImpl_makeTag(uuid);
+   zmqTopicPeer* peer = zmqBridgeMamaTopicIdsImpl_findPeer(impl, tag, 0);
+   if (peer == NULL) {
+      return;
+   }
+
+   // the peer's ids are meaningless once it is gone
+   // (subjects stay interned, since msgs already enqueued may still point to them)
+   for (uint32_t id = 0; id < peer->mSize; ++id) {
+      if (peer->mSlots[id].mCover != NULL) {
+         uint8_t prefix[ZMQ_TOPICID_PREFIX_SIZE];
+         zmqBridgeMamaTopicIds_encodePrefix(prefix, tag, id);
+         zmqBridgeMamaTransportImpl_unsubscribeBinary(impl->mZmqDataSub.mSocket, prefix, sizeof(prefix));
+      }
+   }
+   free(peer->mSlots);
+
+   // the table is open-addressed w/linear probing, so entries that follow in the same run are shifted back
+   // to keep them reachable from their home index
+   uint32_t hole = (uint32_t) (peer - impl->mTopicPeers);
+   uint32_t next = (hole + 1) & (TOPIC_PEER_TABLE_SIZE -1);
+   while (impl->mTopicPeers[next].mTag != 0) {
+      uint32_t home = impl->mTopicPeers[next].mTag & (TOPIC_PEER_TABLE_SIZE -1);
+      // can the entry at next move to hole?  only if its home is not cyclically in (hole, next]
+      uint32_t distNext = (next - home) & (TOPIC_PEER_TABLE_SIZE -1);
+      uint32_t distHole = (hole - home) & (TOPIC_PEER_TABLE_SIZE -1);
+      if (distHole < distNext) {
+         impl->mTopicPeers[hole] = impl->mTopicPeers[next];
+         hole = next;
+      }
+      next = (next + 1) & (TOPIC_PEER_TABLE_SIZE -1);
+   }
+   memset(&impl->mTopicPeers[hole], '\0', sizeof(zmqTopicPeer));
+}
+
+
+void zmqBridgeMamaTopicIds_encodePrefix(uint8_t* buf, uint32_t tag, uint32_t id)
+{
+   uint32_t netTag = htonl(tag);
+   uint32_t netId = htonl(id);
+   buf[0] = ZMQ_TOPICID_MARKER;
+   memcpy(&buf[1], &netTag, sizeof(netTag));
+   memcpy(&buf[1 + sizeof(netTag)], &netId, sizeof(netId));
+}
+
+
+void zmqBridgeMamaTopicIds_decodePrefix(const uint8_t* buf, uint32_t* tag, uint32_t* id)
+{
+   uint32_t netTag;
+   uint32_t netId;
+   memcpy(&netTag, &buf[1], sizeof(netTag));
+   memcpy(&netId, &buf[1 + sizeof(netTag)], sizeof(netId));
+   *tag = ntohl(netTag);
+   *id = ntohl(netId);
+}
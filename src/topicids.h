@@ -0,0 +1,45 @@
+//
+// topic ids -- replace full subject strings on the wire w/compact integer ids
+//
+
+#ifndef MAMA_BRIDGE_ZMQ_TOPICIDS_H__
+#define MAMA_BRIDGE_ZMQ_TOPICIDS_H__
+
+#include "zmqdefs.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+// create/destroy the topic id tables for a transport (no-op unless topic_ids is enabled)
+mama_status zmqBridgeMamaTopicIds_create(zmqTransportBridge* impl);
+void zmqBridgeMamaTopicIds_destroy(zmqTransportBridge* impl);
+
+// publish side: returns the (possibly new) id entry for subject, or NULL if no id can be assigned
+// (safe to call from any thread)
+zmqTopicId* zmqBridgeMamaTopicIds_intern(zmqTransportBridge* impl, const char* subject);
+
+// returns non-zero if the next msg for this entry should be sent w/full subject
+int zmqBridgeMamaTopicIds_needsAnnounce(zmqTransportBridge* impl, zmqTopicId* topicId);
+
+// receive side: the following must only be called on the dispatch thread
+// records mapping announced by a peer, and subscribes to the corresponding binary prefix
+mama_status zmqBridgeMamaTopicIds_learn(zmqTransportBridge* impl, uint32_t tag, uint32_t id, const char* subject);
+// returns the subject for a compact msg, or NULL if not (yet) known
+const char* zmqBridgeMamaTopicIds_resolve(zmqTransportBridge* impl, uint32_t tag, uint32_t id);
+// track subscriptions to topic (which are ref-counted, like zmq subscriptions) -- the binary prefixes
+// learned under a topic are unsubscribed when its last subscription goes, unless another topic matches
+void zmqBridgeMamaTopicIds_subscribe(zmqTransportBridge* impl, const char* topic);
+void zmqBridgeMamaTopicIds_unsubscribe(zmqTransportBridge* impl, const char* topic);
+// forgets the ids announced by a peer that has left, and unsubscribes their binary prefixes
+void zmqBridgeMamaTopicIds_removePeer(zmqTransportBridge* impl, const char* uuid);
+
+// encode/decode the binary prefix that replaces the subject in compact msgs
+void zmqBridgeMamaTopicIds_encodePrefix(uint8_t* buf, uint32_t tag, uint32_t id);
+void zmqBridgeMamaTopicIds_decodePrefix(const uint8_t* buf, uint32_t* tag, uint32_t* id);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* MAMA_BRIDGE_ZMQ_TOPICIDS_H__ */
@@ -39,6 +39,9 @@
 // system includes
 #include <stdio.h>
 #include <errno.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <arpa/inet.h>
 
 // MAMA includes
 #include <mama/mama.h>
@@ -60,7 +63,16 @@
 #include "zmqbridgefunctions.h"
 #include "util.h"
 #include "inbox.h"
+#include "inboxpool.h"
 #include "params.h"
+#include "topicids.h"
+#include "shmring.h"
+#include "latency.h"
+#include "stats.h"
+#include "groups.h"
+#include "namingmsg.h"
+#include "interest.h"
+#include "reactor.h"
 
 #include "transport.h"
 
@@ -95,16 +107,18 @@ mama_status zmqBridgeMamaTransport_create(transportBridge* result, const char* n
    impl->mOmzmqDispatchThread  = 0;
    impl->mOmzmqDispatchStatus  = MAMA_STATUS_OK;
    impl->mName                 = name;
+   impl->mShmWakeFd            = -1;
 
    wsem_init(&impl->mIsReady, 0, 0);
+   wsem_init(&impl->mDispatchDone, 0, 0);
 
    // initialize counters
-   impl->mNamingMessages       = 0;
-   impl->mNormalMessages       = 0;
-   impl->mSubMessages          = 0;
-   impl->mInboxMessages        = 0;
-   impl->mControlMessages      = 0;
-   impl->mPolls                = 0;
+   status = zmqBridgeMamaStats_create(&impl->mStats);
+   if (MAMA_STATUS_OK != status) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Failed to create stats");
+      free(impl);
+      return status;
+   }
 
    {
    // init logging
@@ -122,6 +136,8 @@ mama_status zmqBridgeMamaTransport_create(transportBridge* result, const char* n
    zmqBridgeMamaTransportImpl_parseCommonParams(impl);
    if (impl->mIsNaming == 1) {
       zmqBridgeMamaTransportImpl_parseNamingParams(impl);
+      // our naming details are fixed for the life of the transport
+      impl->mNamingGeneration = 1;
    }
    else {
       zmqBridgeMamaTransportImpl_parseNonNamingParams(impl);
@@ -129,6 +145,13 @@ mama_status zmqBridgeMamaTransport_create(transportBridge* result, const char* n
 
    mamaTransport_disableRefresh(impl->mTransport, (uint8_t) impl->mDisableRefresh);
 
+   if (impl->mLatencyStats == 1) {
+      impl->mLatency = zmqBridgeMamaLatency_create();
+      if (impl->mLatency == NULL) {
+         MAMA_LOG(MAMA_LOG_LEVEL_WARN, "Failed to create latency stats");
+      }
+   }
+
    // create wildcard endpoints
    impl->mWcEndpoints = list_create(sizeof(zmqSubscription*));
    if (impl->mWcEndpoints == INVALID_LIST) {
@@ -179,7 +202,27 @@ mama_status zmqBridgeMamaTransport_create(transportBridge* result, const char* n
    sprintf(temp, "%s.%s", ZMQ_REPLYHANDLE_PREFIX, impl->mUuid);
    impl->mInboxSubject = strdup(temp);
 
+   // each transport needs its own sequence of beacon jitter
+   impl->mBeaconSeed = (unsigned int) getNanos() ^ (unsigned int) getpid();
+
    wInterlocked_initialize(&impl->mNamingConnected);
+   pthread_mutex_init(&impl->mNamingLock, NULL);
+   pthread_condattr_t condAttr;
+   pthread_condattr_init(&condAttr);
+   #if !defined __APPLE__
+   pthread_condattr_setclock(&condAttr, CLOCK_MONOTONIC);
+   #endif
+   pthread_cond_init(&impl->mNamingCond, &condAttr);
+   pthread_condattr_destroy(&condAttr);
+   wInterlocked_initialize(&impl->mNumPeers);
+   gethostname(impl->mHost, sizeof(impl->mHost));
+
+   // create topic id tables
+   status = zmqBridgeMamaTopicIds_create(impl);
+   if (MAMA_STATUS_OK != status) {
+      free(impl);
+      return status;
+   }
 
    // connect/bind/subscribe/etc. all sockets
    CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_init(impl));
@@ -208,20 +251,20 @@ mama_status zmqBridgeMamaTransport_destroy(transportBridge transport)
    // stop the dispatcher(s)
    status = zmqBridgeMamaTransportImpl_stop(impl);
    wsem_destroy(&impl->mIsReady);
+   wsem_destroy(&impl->mDispatchDone);
 
    // make sure we don't delete the transport out from under publishEndpoints, if it's running
-   // this can happen if transport is destroyed immediately after creation
-   if ((impl->mIsNaming == 1) && (wInterlocked_read(&impl->mNamingConnected) == 0)) {
-      // this can only be true if publishEndpoints is running in a separate thread(s)
-      // if so, give the thread a chance to terminate
-      usleep(impl->mNamingConnectInterval * 2);
-   }
+   // this can happen if transport is destroyed immediately after creation -- if so, wake it so it can terminate
+   zmqBridgeMamaTransportImpl_signalNaming(impl, 1);
    int rc = wthread_join(impl->mPublishThread, NULL);
    if (rc != 0) {
       MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Failed to join zmqBridgeMamaTransportImpl_publishEndpoints thread");
    }
 
    wInterlocked_destroy(&impl->mNamingConnected);
+   pthread_cond_destroy(&impl->mNamingCond);
+   pthread_mutex_destroy(&impl->mNamingLock);
+   wInterlocked_destroy(&impl->mNumPeers);
 
    // close sockets
    zmqBridgeMamaTransportImpl_destroySocket(&impl->mZmqDataSub);
@@ -232,15 +275,24 @@ mama_status zmqBridgeMamaTransport_destroy(transportBridge transport)
       zmqBridgeMamaTransportImpl_destroySocket(&impl->mZmqNamingSub);
       zmqBridgeMamaTransportImpl_destroySocket(&impl->mZmqNamingPub);
    }
+   if (impl->mDirectReplies == 1) {
+      zmqBridgeMamaTransportImpl_destroySocket(&impl->mZmqReplySub);
+      zmqBridgeMamaTransportImpl_destroySocket(&impl->mZmqReplyPub);
+   }
 
    // stop the monitor thread
    if (impl->mSocketMonitor != 0) {
       CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_stopMonitor(impl));
    }
 
-   // shutdown zmq
-   zmq_ctx_shutdown(impl->mZmqContext);
-   zmq_ctx_term(impl->mZmqContext);
+   // shutdown zmq (a shared context is only terminated when the last transport using it is destroyed)
+   if (impl->mSharedContext == 1) {
+      zmqBridgeMamaReactor_releaseContext();
+   }
+   else {
+      zmq_ctx_shutdown(impl->mZmqContext);
+      zmq_ctx_term(impl->mZmqContext);
+   }
 
    // free memory
    wlock_destroy(impl->mSubsLock);
@@ -252,9 +304,28 @@ mama_status zmqBridgeMamaTransport_destroy(transportBridge transport)
    wlock_destroy(impl->mWcsLock);
    list_destroy(impl->mWcEndpoints, NULL, NULL);
 
+   zmqBridgeMamaTopicIds_destroy(impl);
+
+   for (int i = 0; i < impl->mNumShmReaders; ++i) {
+      zmqBridgeMamaShmRing_detach(impl->mShmReaders[i]);
+   }
+   free(impl->mShmReaders);
+   zmqBridgeMamaShmRing_destroy(impl->mShmRing);
+   zmqBridgeMamaShmRing_closeWakeup(impl->mShmWakeFd);
+
    free((void*) impl->mUuid);
    free((void*) impl->mInboxSubject);
    free((void*) impl->mPubEndpoint);
+   free((void*) impl->mIpcEndpoint);
+   free((void*) impl->mReplyEndpoint);
+   free((void*) impl->mPublishPrefixes);
+   free(impl->mPendingConnects);
+   if (impl->mDirectPeers != NULL) {
+      wtable_free_all(impl->mDirectPeers);
+      wtable_destroy(impl->mDirectPeers);
+   }
+   zmqBridgeMamaGroups_destroy(impl);
+   zmqBridgeMamaInterest_destroy(impl);
 
    for (int i = 0; (i < ZMQ_MAX_NAMING_URIS); ++i) {
       free((void*) impl->mNamingAddress[i]);
@@ -265,12 +336,13 @@ mama_status zmqBridgeMamaTransport_destroy(transportBridge transport)
    wtable_free_all(impl->mPeers);
    wtable_destroy(impl->mPeers);
 
-   MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Naming messages = %ld", impl->mNamingMessages);
-   MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Normal messages = %ld", impl->mNormalMessages);
-   MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Subscription messages = %ld", impl->mSubMessages);
-   MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Inbox messages = %ld", impl->mInboxMessages);
-   MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Control messages = %ld", impl->mControlMessages);
-   MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Polls = %ld", impl->mPolls);
+   uint64_t stats[ZMQ_STAT_COUNT];
+   zmqBridgeMamaStats_snapshot(impl->mStats, stats);
+   zmqBridgeMamaStats_log(stats, impl->mName, MAMA_LOG_LEVEL_NORMAL);
+   zmqBridgeMamaStats_destroy(impl->mStats);
+   zmqBridgeMamaStatsShm_destroy(impl->mStatsShm);
+   zmqBridgeMamaLatency_log(impl->mLatency, impl->mName);
+   zmqBridgeMamaLatency_destroy(impl->mLatency);
 
    free(impl);
 
@@ -313,18 +385,28 @@ mama_status zmqBridgeMamaTransportImpl_init(zmqTransportBridge* impl)
       return MAMA_STATUS_NULL_ARG;
    }
 
-   // create context
-   impl->mZmqContext = zmq_ctx_new();
-   if (impl->mZmqContext == NULL) {
-      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Unable to allocate zmq context - error %d(%s)", errno, zmq_strerror(errno));
-      return MAMA_STATUS_PLATFORM;
+   // create context (or share the process-wide context)
+   if (impl->mSharedContext == 1) {
+      CALL_MAMA_FUNC(zmqBridgeMamaReactor_acquireContext(&impl->mZmqContext, impl->mIoThreads));
+   }
+   else {
+      impl->mZmqContext = zmq_ctx_new();
+      if (impl->mZmqContext == NULL) {
+         MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Unable to allocate zmq context - error %d(%s)", errno, zmq_strerror(errno));
+         return MAMA_STATUS_PLATFORM;
+      }
+      zmq_ctx_set(impl->mZmqContext, ZMQ_IO_THREADS, impl->mIoThreads);
    }
 
+   // inproc endpoints must be unique w/in a context
+   snprintf(impl->mControlEndpoint, sizeof(impl->mControlEndpoint), "%s.%s", ZMQ_CONTROL_ENDPOINT, impl->mUuid);
+   snprintf(impl->mMonitorEndpoint, sizeof(impl->mMonitorEndpoint), "%s.%s", ZMQ_MONITOR_ENDPOINT, impl->mUuid);
+
    // create control sockets for inter-thread commands
    CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_createSocket(impl->mZmqContext, &impl->mZmqControlSub, ZMQ_PULL, "controlSub", 0));
-   CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_bindSocket(&impl->mZmqControlSub,  ZMQ_CONTROL_ENDPOINT, NULL));
+   CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_bindSocket(&impl->mZmqControlSub,  impl->mControlEndpoint, NULL));
    CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_createSocket(impl->mZmqContext, &impl->mZmqControlPub, ZMQ_PUSH, "controlPub", 0));
-   CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_connectSocket(&impl->mZmqControlPub,  ZMQ_CONTROL_ENDPOINT, -1, 0));
+   CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_connectSocket(&impl->mZmqControlPub,  impl->mControlEndpoint, -1, 0));
 
    // create data sockets
    CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_createSocket(impl->mZmqContext, &impl->mZmqDataPub, ZMQ_PUB_TYPE, "dataPub", impl->mSocketMonitor));
@@ -346,6 +428,39 @@ mama_status zmqBridgeMamaTransportImpl_init(zmqTransportBridge* impl)
       CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_stopReconnectOnError(&impl->mZmqNamingPub, impl->mReconnectOptions));
       CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_createSocket(impl->mZmqContext, &impl->mZmqNamingSub, ZMQ_SUB_TYPE, "namingSub", impl->mSocketMonitor));
       CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_subscribe(impl->mZmqNamingSub.mSocket, ZMQ_NAMING_PREFIX));
+      if (impl->mNamingSnapshot == 1) {
+         // nsd answers this subscription w/a snapshot of its directory
+         char snapshotTopic[MAX_SUBJECT_LENGTH +1];
+         snprintf(snapshotTopic, sizeof(snapshotTopic), "%s%s", ZMQ_SNAPSHOT_PREFIX, impl->mUuid);
+         CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_subscribe(impl->mZmqNamingSub.mSocket, snapshotTopic));
+      }
+
+      if (impl->mDirectReplies == 1) {
+         // create direct reply sockets
+         impl->mDirectPeers = wtable_create("directPeers", PEER_TABLE_SIZE);
+         if (impl->mDirectPeers == NULL) {
+            MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Failed to create direct peers table");
+            return MAMA_STATUS_NOMEM;
+         }
+         CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_createSocket(impl->mZmqContext, &impl->mZmqReplyPub, ZMQ_ROUTER, "replyPub", 0));
+         CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_createSocket(impl->mZmqContext, &impl->mZmqReplySub, ZMQ_DEALER, "replySub", 0));
+         CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_setCommonSocketOptions(impl->mName, &impl->mZmqReplyPub));
+         CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_setCommonSocketOptions(impl->mName, &impl->mZmqReplySub));
+         // fail sends to peers that are not connected, rather than silently dropping them
+         int mandatory = 1;
+         CALL_ZMQ_FUNC(zmq_setsockopt(impl->mZmqReplyPub.mSocket, ZMQ_ROUTER_MANDATORY, &mandatory, sizeof(mandatory)));
+         CALL_ZMQ_FUNC(zmq_setsockopt(impl->mZmqReplyPub.mSocket, ZMQ_HEARTBEAT_IVL, &impl->mHeartbeatInterval, sizeof(impl->mHeartbeatInterval)));
+         CALL_ZMQ_FUNC(zmq_setsockopt(impl->mZmqReplyPub.mSocket, ZMQ_RECONNECT_IVL, &impl->mReconnectInterval, sizeof(impl->mReconnectInterval)));
+      }
+
+      CALL_MAMA_FUNC(zmqBridgeMamaInterest_create(impl));
+
+      if (impl->mQueueGroups == 1) {
+         // group members announce themselves on the data socket
+         CALL_MAMA_FUNC(zmqBridgeMamaGroups_create(impl));
+         CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_subscribe(impl->mZmqDataSub.mSocket, ZMQ_GROUP_PREFIX));
+         zmqBridgeMamaInterest_onSubscribe(impl, ZMQ_GROUP_PREFIX);
+      }
    }
 
    // start the monitor thread (before any connects/binds)
@@ -360,6 +475,42 @@ mama_status zmqBridgeMamaTransportImpl_init(zmqTransportBridge* impl)
       CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_bindSocket(&impl->mZmqDataPub,  endpointAddress, &impl->mPubEndpoint));
       MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Bound publish socket to:%s ", impl->mPubEndpoint);
 
+      // also bind to ipc endpoint, so same-host peers can bypass the tcp stack
+      // (failure is not fatal -- peers will simply connect via tcp)
+      if (impl->mIpcEndpoints == 1) {
+         snprintf(endpointAddress, sizeof(endpointAddress), "ipc://%s/oz.%s", impl->mIpcPath, impl->mUuid);
+         if (zmqBridgeMamaTransportImpl_bindSocket(&impl->mZmqDataPub, endpointAddress, &impl->mIpcEndpoint) == MAMA_STATUS_OK) {
+            MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Bound publish socket to:%s ", impl->mIpcEndpoint);
+         }
+         else {
+            MAMA_LOG(MAMA_LOG_LEVEL_WARN, "Unable to bind publish socket to:%s -- same-host peers will use tcp", endpointAddress);
+         }
+      }
+
+      // bind direct reply socket & get endpoint
+      if (impl->mDirectReplies == 1) {
+         sprintf(endpointAddress, "tcp://%s:*", impl->mPublishAddress);
+         CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_bindSocket(&impl->mZmqReplySub, endpointAddress, &impl->mReplyEndpoint));
+         MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Bound reply socket to:%s ", impl->mReplyEndpoint);
+      }
+
+      // create shm ring for same-host peers (failure is not fatal -- peers will simply connect via zmq)
+      if (impl->mShmRingEnabled == 1) {
+         char ringName[ZMQ_MAX_SHM_NAME_LENGTH +1];
+         snprintf(ringName, sizeof(ringName), "/oz.%s", impl->mUuid);
+         if (zmqBridgeMamaShmRing_create(&impl->mShmRing, ringName, impl->mShmRingSize) == MAMA_STATUS_OK) {
+            MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Created shm ring:%s ", ringName);
+         }
+         else {
+            MAMA_LOG(MAMA_LOG_LEVEL_WARN, "Unable to create shm ring:%s -- same-host peers will use zmq", ringName);
+         }
+         // writers of the rings we read from wake us up when they write to them
+         // (failure is not fatal either -- we'll poll the rings every naming.shm_ring.poll_interval instead)
+         if (zmqBridgeMamaShmRing_openWakeup(&ringName[1], &impl->mShmWakeFd) != MAMA_STATUS_OK) {
+            MAMA_LOG(MAMA_LOG_LEVEL_WARN, "Unable to create shm ring wakeup socket -- shm rings will be polled");
+         }
+      }
+
       // connect sub socket to proxy
       for (int i = 0; (i < ZMQ_MAX_NAMING_URIS) && (impl->mNamingAddress[i] != NULL); ++i) {
          CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_connectSocket(&impl->mZmqNamingSub, impl->mNamingAddress[i],
@@ -392,23 +543,46 @@ mama_status zmqBridgeMamaTransportImpl_init(zmqTransportBridge* impl)
 // starts the main dispatch thread
 mama_status zmqBridgeMamaTransportImpl_start(zmqTransportBridge* impl)
 {
-   /* Initialize dispatch thread */
-   int rc = wthread_create(&(impl->mOmzmqDispatchThread), NULL, zmqBridgeMamaTransportImpl_dispatchThread, impl);
-   if (0 != rc) {
-      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "create of dispatch thread failed %d(%s)", rc, strerror(rc));
-      return MAMA_STATUS_PLATFORM;
+   // export stats to shared memory? (failure is not fatal)
+   // NOTE: must be created before dispatch thread starts, since that writes the peers section
+   if (impl->mStatsShmEnabled == 1) {
+      if (zmqBridgeMamaStatsShm_create(&impl->mStatsShm, impl->mName, impl->mUuid) != MAMA_STATUS_OK) {
+         MAMA_LOG(MAMA_LOG_LEVEL_WARN, "Failed to create stats segment -- stats will not be exported to shared memory");
+      }
+   }
+
+   int rc = 0;
+   if (impl->mNumReactors > 0) {
+      // dispatch on the shared reactor pool, rather than our own thread
+      CALL_MAMA_FUNC(zmqBridgeMamaReactor_attach(impl));
+   }
+   else {
+      /* Initialize dispatch thread */
+      rc = wthread_create(&(impl->mOmzmqDispatchThread), NULL, zmqBridgeMamaTransportImpl_dispatchThread, impl);
+      if (0 != rc) {
+         MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "create of dispatch thread failed %d(%s)", rc, strerror(rc));
+         return MAMA_STATUS_PLATFORM;
+      }
+   }
+
+   // publish stats periodically? (failure is not fatal)
+   if (impl->mStatsInterval > 0) {
+      wsem_init(&impl->mStatsStop, 0, 0);
+      rc = wthread_create(&impl->mStatsThread, NULL, zmqBridgeMamaTransportImpl_statsThread, impl);
+      if (0 != rc) {
+         MAMA_LOG(MAMA_LOG_LEVEL_WARN, "create of stats thread failed %d(%s) -- stats will not be published", rc, strerror(rc));
+         wsem_destroy(&impl->mStatsStop);
+         impl->mStatsInterval = 0;
+      }
    }
 
    // dont proceed until we are connected to proxy?
    if ( (impl->mIsNaming == 1) && (impl->mNamingWaitForConnect == 1) ) {
       // wait for welcome msg from proxy to trigger publishEndpoints, which in turn
-      // causes mNamingConnected to be set on receipt of our naming msg
-      int retries = impl->mNamingConnectRetries;
-      while ((--retries > 0) && (wInterlocked_read(&impl->mNamingConnected) != 1)) {
-         usleep(impl->mNamingConnectInterval);
-      }
-      if (wInterlocked_read(&impl->mNamingConnected) != 1) {
-         MAMA_LOG(MAMA_LOG_LEVEL_SEVERE, "Failed connecting to naming service after %d retries", impl->mNamingConnectRetries);
+      // causes mNamingConnected to be set (and signaled) on receipt of our naming msg
+      uint64_t timeout = (uint64_t) impl->mNamingConnectRetries * impl->mNamingConnectInterval;
+      if (zmqBridgeMamaTransportImpl_waitNaming(impl, timeout) != 1) {
+         MAMA_LOG(MAMA_LOG_LEVEL_SEVERE, "Failed connecting to naming service after %llu ms", (unsigned long long) timeout / 1000);
          return MAMA_STATUS_TIMEOUT;
       }
    }
@@ -437,30 +611,99 @@ mama_status zmqBridgeMamaTransportImpl_stop(zmqTransportBridge* impl)
    CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_sendCommand(impl, &msg, sizeof(msg)));
 
    MAMA_LOG(MAMA_LOG_LEVEL_FINE, "Waiting on dispatch thread to terminate.");
-   int rc = wthread_join(impl->mOmzmqDispatchThread, NULL);
-   if (0 != rc) {
-      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "join of dispatch thread failed %d(%s)", rc, strerror(rc));
-      return MAMA_STATUS_PLATFORM;
+   if (impl->mReactor != NULL) {
+      // reactor has stopped dispatching us once it has processed the exit command
+      wsem_wait(&impl->mDispatchDone);
+      zmqBridgeMamaReactor_detach(impl);
+   }
+   else {
+      int rc = wthread_join(impl->mOmzmqDispatchThread, NULL);
+      if (0 != rc) {
+         MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "join of dispatch thread failed %d(%s)", rc, strerror(rc));
+         return MAMA_STATUS_PLATFORM;
+      }
    }
 
    mama_status status = impl->mOmzmqDispatchStatus;
    MAMA_LOG(MAMA_LOG_LEVEL_FINE, "Rejoined with status: %s.", mamaStatus_stringForStatus(status));
 
+   if (impl->mStatsInterval > 0) {
+      wsem_post(&impl->mStatsStop);
+      wthread_join(impl->mStatsThread, NULL);
+      wsem_destroy(&impl->mStatsStop);
+      // dont leave stale stats lying around
+      if (impl->mStatsPath != NULL) {
+         unlink(impl->mStatsPath);
+      }
+   }
+
    return MAMA_STATUS_OK;
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+// stats
+
+// publishes stats at regular intervals, until the transport is stopped
+void* zmqBridgeMamaTransportImpl_statsThread(void* closure)
+{
+   zmqTransportBridge* impl = (zmqTransportBridge*) closure;
+
+   int done = 0;
+   while (!done) {
+      done = (wsem_timedwait(&impl->mStatsStop, impl->mStatsInterval * 1000) == 0);
+      zmqBridgeMamaTransportImpl_publishStats(impl);
+   }
+
+   return NULL;
+}
+
+// logs stats and, if configured, writes them to a text file and/or shared memory
+void zmqBridgeMamaTransportImpl_publishStats(zmqTransportBridge* impl)
+{
+   uint64_t stats[ZMQ_STAT_COUNT];
+   zmqBridgeMamaStats_snapshot(impl->mStats, stats);
+   zmqBridgeMamaStats_log(stats, impl->mName, log_level_stats);
+
+   if (impl->mStatsShm != NULL) {
+      zmqBridgeMamaStatsShm_update(impl->mStatsShm, stats, impl->mLatency);
+   }
+
+   if (impl->mStatsPath != NULL) {
+      char buf[4096];
+      zmqBridgeMamaStats_format(stats, impl->mName, buf, sizeof(buf));
+      zmqBridgeMamaStats_writeFile(impl->mStatsPath, buf);
+   }
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 // dispatch functions
+// A transport's sockets are dispatched either by its own dispatch thread, or (w/reactors set) by one of a pool of
+// reactor threads shared w/other transports (see reactor.h).  Either way, dispatchBegin is called once on the
+// dispatching thread, then pollItems, pollTimeout and dispatchReady are called around each zmq_poll until
+// mIsDispatching is cleared, and finally dispatchEnd is called.
 
-// main thread that reads directly off zmq sockets and calls one of the dispatchXxxMsg methods
-void* zmqBridgeMamaTransportImpl_dispatchThread(void* closure)
+// The naming and reply sockets are defined last so they can be excluded from the list if we're not running a
+// "naming" transport (or direct replies are disabled).
+#define CONTROL_SOCKET  0
+#define NAMING_SOCKET   2
+#define DATA_SOCKET     1
+#define REPLY_SOCKET    3
+
+// names of the monitored sockets, in the order in which their monitor sockets are polled
+static const char* gMonitoredNames[ZMQ_MONITORED_SOCKETS] = { "dataPub", "dataSub", "namingPub", "namingSub" };
+
+
+// number of the transport's own sockets that are polled (i.e., excluding monitor sockets)
+static int zmqBridgeMamaTransportImpl_numDispatchSockets(zmqTransportBridge* impl)
 {
-   zmqTransportBridge* impl = (zmqTransportBridge*)closure;
+   return (impl->mIsNaming == 1) ? ((impl->mDirectReplies == 1) ? 4 : 3) : 2;
+}
 
-   zmq_msg_t zmsg;
-   zmq_msg_init(&zmsg);
 
+void zmqBridgeMamaTransportImpl_dispatchBegin(zmqTransportBridge* impl)
+{
    /* Set the transport bridge mIsDispatching to true. */
    wInterlocked_initialize(&impl->mIsDispatching);
    wInterlocked_set(1, &impl->mIsDispatching);
@@ -474,115 +717,270 @@ void* zmqBridgeMamaTransportImpl_dispatchThread(void* closure)
    if (impl->mIsNaming == 1) {
       wlock_lock(impl->mZmqNamingSub.mLock);
    }
+   if (impl->mDirectReplies == 1) {
+      wlock_lock(impl->mZmqReplySub.mLock);
+   }
 
    // set next beacon time
-   uint64_t lastBeacon = 0;
-   uint64_t nextBeacon = 0;
+   impl->mLastBeacon = 0;
+   impl->mNextBeacon = 0;
    if (wInterlocked_read(&impl->mBeaconInterval) > 0) {
-      nextBeacon = getMillis() + wInterlocked_read(&impl->mBeaconInterval);
+      impl->mNextBeacon = getMillis() + zmqBridgeMamaTransportImpl_jitterBeacon(impl, wInterlocked_read(&impl->mBeaconInterval));
    }
 
-   // The naming socket is defined last so it can be excluded from the list if we're not running a
-   // "naming" transport.
-   #define CONTROL_SOCKET  0
-   #define NAMING_SOCKET   2
-   #define DATA_SOCKET     1
-   zmq_pollitem_t items[] = {
-      { impl->mZmqControlSub.mSocket, 0, ZMQ_POLLIN , 0},
-      { impl->mZmqDataSub.mSocket,    0, ZMQ_POLLIN , 0},
-      { impl->mZmqNamingSub.mSocket,  0, ZMQ_POLLIN , 0}
-   };
+   // set next group heartbeat time
+   impl->mNextGroupHeartbeat = 0;
+   if (impl->mQueueGroups == 1) {
+      impl->mNextGroupHeartbeat = getMillis() + impl->mQueueGroupInterval;
+   }
+}
 
-   // Following is the transport's main dispatch loop -- it runs "forever"
-   // i.e., until mIsDispatching is set to zero, in dispatchControlMsg, on receipt of an exit ("X") command.
-   while (1 == wInterlocked_read(&impl->mIsDispatching)) {
 
-      // If we're beaconing, break out of the zmq_poll when it's time to send a beacon.
-      long timeout = -1;
-      if (wInterlocked_read(&impl->mBeaconInterval) > 0) {
-         timeout = nextBeacon - lastBeacon;
+void zmqBridgeMamaTransportImpl_dispatchEnd(zmqTransportBridge* impl)
+{
+   // unlock sockets
+   wlock_unlock(impl->mZmqDataSub.mLock);
+   if (impl->mIsNaming == 1) {
+      wlock_unlock(impl->mZmqNamingSub.mLock);
+   }
+   if (impl->mDirectReplies == 1) {
+      wlock_unlock(impl->mZmqReplySub.mLock);
+   }
+
+   impl->mOmzmqDispatchStatus = MAMA_STATUS_OK;
+}
+
+
+// fills in the items to poll (at most ZMQ_MAX_DISPATCH_ITEMS) -- returns the number of items
+int zmqBridgeMamaTransportImpl_pollItems(zmqTransportBridge* impl, zmq_pollitem_t* items)
+{
+   int numItems = zmqBridgeMamaTransportImpl_numDispatchSockets(impl);
+   void* sockets[] = { impl->mZmqControlSub.mSocket, impl->mZmqDataSub.mSocket, impl->mZmqNamingSub.mSocket, impl->mZmqReplySub.mSocket };
+   for (int i = 0; i < numItems; ++i) {
+      items[i].socket = sockets[i];
+      items[i].fd = 0;
+      items[i].events = ZMQ_POLLIN;
+      items[i].revents = 0;
+   }
+
+   // monitor sockets are only polled here if we're dispatched by a reactor (otherwise the monitor thread polls them)
+   for (int i = 0; (i < ZMQ_MONITORED_SOCKETS) && (impl->mMonitorSockets[i] != NULL); ++i) {
+      items[numItems].socket = impl->mMonitorSockets[i];
+      items[numItems].fd = 0;
+      items[numItems].events = ZMQ_POLLIN;
+      items[numItems].revents = 0;
+      ++numItems;
+   }
+
+   // wakeups from writers of shm rings (always last)
+   if (impl->mShmWakeFd >= 0) {
+      items[numItems].socket = NULL;
+      items[numItems].fd = impl->mShmWakeFd;
+      items[numItems].events = ZMQ_POLLIN;
+      items[numItems].revents = 0;
+      ++numItems;
+   }
+
+   return numItems;
+}
+
+
+// returns the maximum time (in millis) to wait in zmq_poll, or -1 to wait indefinitely
+long zmqBridgeMamaTransportImpl_pollTimeout(zmqTransportBridge* impl)
+{
+   // If we're beaconing, break out of the zmq_poll when it's time to send a beacon.
+   long timeout = -1;
+   if (wInterlocked_read(&impl->mBeaconInterval) > 0) {
+      timeout = impl->mNextBeacon - impl->mLastBeacon;
+   }
+   // arm wakeups from the writers of shm rings -- rings that can't wake us still need to be checked periodically
+   // (as do rings whose writer's wakeups can't reach us, e.g. from a different network namespace)
+   if (impl->mNumShmReaders > 0) {
+      long shmTimeout = impl->mShmPollInterval;
+      for (int i = 0; i < impl->mNumShmReaders; ++i) {
+         if (zmqBridgeMamaShmRing_prepareWait(impl->mShmReaders[i]) > 0) {
+            shmTimeout = 0;
+            break;
+         }
       }
-      int rc = zmq_poll(items, (impl->mIsNaming == 1) ? 3 : 2, timeout);
-      if ((rc < 0) && (errno != EINTR)) {
-         MAMA_LOG(MAMA_LOG_LEVEL_SEVERE, "zmq_poll failed  %d(%s)", errno, zmq_strerror(errno));
-         continue;
+      if ((timeout < 0) || (timeout > shmTimeout)) {
+         timeout = shmTimeout;
       }
-      ++impl->mPolls;
-
-      // TODO: is this the best place?
-      // Is it time to send a beacon? Note that doing this here means that once there is activity
-      // on *any* socket, we won't send another beacon until *all* sockets have been drained.
-      if (nextBeacon > 0) {
-         // if we're shutting down, beaconInterval will be 0, so dont send it
-         uint32_t beaconInterval = wInterlocked_read(&impl->mBeaconInterval);
-         if (beaconInterval > 0) {
-            uint64_t now = getMillis();
-            if (now >= nextBeacon) {
-               zmqBridgeMamaTransportImpl_sendEndpointsMsg(impl, 'c');
-               lastBeacon = now;
-               nextBeacon = now + beaconInterval;
-            }
+   }
+   // group members need to announce themselves periodically
+   if ((impl->mNextGroupHeartbeat > 0) && ((timeout < 0) || (timeout > impl->mQueueGroupInterval))) {
+      timeout = impl->mQueueGroupInterval;
+   }
+   // connect to (some of) the peers discovered so far, and let them know about us
+   long connectTimeout = zmqBridgeMamaTransportImpl_drainConnects(impl);
+   if ((connectTimeout >= 0) && ((timeout < 0) || (timeout > connectTimeout))) {
+      timeout = connectTimeout;
+   }
+   long rebroadcastTimeout = zmqBridgeMamaTransportImpl_flushRebroadcast(impl);
+   if ((rebroadcastTimeout >= 0) && ((timeout < 0) || (timeout > rebroadcastTimeout))) {
+      timeout = rebroadcastTimeout;
+   }
+
+   return timeout;
+}
+
+
+// called after each zmq_poll w/the items filled in by pollItems -- runs timers and drains the sockets
+void zmqBridgeMamaTransportImpl_dispatchReady(zmqTransportBridge* impl, zmq_pollitem_t* items, zmq_msg_t* zmsg)
+{
+   zmqBridgeMamaStats_add(impl->mStats, ZMQ_STATS_DISPATCH, ZMQ_STAT_POLLS, 1);
+
+   // TODO: is this the best place?
+   // Is it time to send a beacon? Note that doing this here means that once there is activity
+   // on *any* socket, we won't send another beacon until *all* sockets have been drained.
+   if (impl->mNextBeacon > 0) {
+      // if we're shutting down, beaconInterval will be 0, so dont send it
+      uint32_t beaconInterval = wInterlocked_read(&impl->mBeaconInterval);
+      if (beaconInterval > 0) {
+         uint64_t now = getMillis();
+         if (now >= impl->mNextBeacon) {
+            // v2 beacons are heartbeats, w/o details
+            zmqBridgeMamaTransportImpl_sendEndpointsMsg(impl, (impl->mNamingProtocol == 2) ? 'h' : 'c');
+            impl->mLastBeacon = now;
+            impl->mNextBeacon = now + zmqBridgeMamaTransportImpl_jitterBeacon(impl, beaconInterval);
+            zmqBridgeMamaTransportImpl_evictPeers(impl);
          }
       }
+   }
 
-      // This implementation drains each of the sockets (control, naming and data) in turn before reading from
-      // the next -- that is, it is not "fair", and it is theoretically possible for an earlier socket to starve
-      // later socket(s).  In practice this should not be a problem, as there should be little traffic on the
-      // control and naming sockets, and esp. for the control socket, its messages are more "important", as
-      // they affect the state of the transport.
+   if (impl->mNextGroupHeartbeat > 0) {
+      uint64_t now = getMillis();
+      if (now >= impl->mNextGroupHeartbeat) {
+         zmqBridgeMamaGroups_heartbeat(impl);
+         impl->mNextGroupHeartbeat = now + impl->mQueueGroupInterval;
+      }
+   }
 
-      // drain command msgs
-      while (items[CONTROL_SOCKET].revents & ZMQ_POLLIN) {
-         int size = zmq_msg_recv(&zmsg, impl->mZmqControlSub.mSocket, ZMQ_DONTWAIT);
-         if (size <= 0) {
-            items[CONTROL_SOCKET].revents = 0;
-            if (errno != EAGAIN) {
-               MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "zmq_poll returned w/ZMQ_POLLIN, but no command msg - errorno %d(%s)", zmq_errno(), zmq_strerror(zmq_errno()));
-            }
+   // This implementation drains each of the sockets (control, naming and data) in turn before reading from
+   // the next -- that is, it is not "fair", and it is theoretically possible for an earlier socket to starve
+   // later socket(s).  In practice this should not be a problem, as there should be little traffic on the
+   // control and naming sockets, and esp. for the control socket, its messages are more "important", as
+   // they affect the state of the transport.
+   int numSockets = zmqBridgeMamaTransportImpl_numDispatchSockets(impl);
+
+   // drain command msgs
+   while (items[CONTROL_SOCKET].revents & ZMQ_POLLIN) {
+      int size = zmq_msg_recv(zmsg, impl->mZmqControlSub.mSocket, ZMQ_DONTWAIT);
+      if (size <= 0) {
+         items[CONTROL_SOCKET].revents = 0;
+         if (errno != EAGAIN) {
+            MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "zmq_poll returned w/ZMQ_POLLIN, but no command msg - errorno %d(%s)", zmq_errno(), zmq_strerror(zmq_errno()));
          }
-         else {
-            zmqBridgeMamaTransportImpl_dispatchControlMsg(impl, &zmsg);
+      }
+      else {
+         zmqBridgeMamaTransportImpl_dispatchControlMsg(impl, zmsg);
+      }
+   }
+
+   // drain naming msgs
+   while ((numSockets > NAMING_SOCKET) && (items[NAMING_SOCKET].revents & ZMQ_POLLIN)) {
+      int size = zmq_msg_recv(zmsg, impl->mZmqNamingSub.mSocket, ZMQ_DONTWAIT);
+      if (size <= 0) {
+         items[NAMING_SOCKET].revents = 0;
+         if (errno != EAGAIN) {
+            MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "zmq_poll returned w/ZMQ_POLLIN, but no naming msg - errorno %d(%s)", zmq_errno(), zmq_strerror(zmq_errno()));
          }
       }
+      else {
+         zmqBridgeMamaTransportImpl_dispatchNamingMsg(impl, zmsg);
+      }
+   }
 
-      // drain naming msgs
-      while (items[NAMING_SOCKET].revents & ZMQ_POLLIN) {
-         int size = zmq_msg_recv(&zmsg, impl->mZmqNamingSub.mSocket, ZMQ_DONTWAIT);
-         if (size <= 0) {
-            items[NAMING_SOCKET].revents = 0;
-            if (errno != EAGAIN) {
-               MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "zmq_poll returned w/ZMQ_POLLIN, but no naming msg - errorno %d(%s)", zmq_errno(), zmq_strerror(zmq_errno()));
-            }
+   // drain normal (data) msgs
+   while (items[DATA_SOCKET].revents & ZMQ_POLLIN) {
+      int size = zmq_msg_recv(zmsg, impl->mZmqDataSub.mSocket, ZMQ_DONTWAIT);
+      if (size <= 0) {
+         items[DATA_SOCKET].revents = 0;
+         if (errno != EAGAIN) {
+            MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "zmq_poll returned w/ZMQ_POLLIN, but no normal msg - errorno %d(%s)", zmq_errno(), zmq_strerror(zmq_errno()));
          }
-         else {
-            zmqBridgeMamaTransportImpl_dispatchNamingMsg(impl, &zmsg);
+      }
+      else {
+         if (impl->mLatency != NULL) {
+            impl->mRecvTime = getNanos();
          }
+         zmqBridgeMamaTransportImpl_dispatchNormalMsg(impl, zmsg);
       }
+   }
 
-      // drain normal (data) msgs
-      while (items[DATA_SOCKET].revents & ZMQ_POLLIN) {
-         int size = zmq_msg_recv(&zmsg, impl->mZmqDataSub.mSocket, ZMQ_DONTWAIT);
-         if (size <= 0) {
-            items[DATA_SOCKET].revents = 0;
-            if (errno != EAGAIN) {
-               MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "zmq_poll returned w/ZMQ_POLLIN, but no normal msg - errorno %d(%s)", zmq_errno(), zmq_strerror(zmq_errno()));
-            }
+   // drain replies sent directly to us
+   while ((numSockets > REPLY_SOCKET) && (items[REPLY_SOCKET].revents & ZMQ_POLLIN)) {
+      int size = zmq_msg_recv(zmsg, impl->mZmqReplySub.mSocket, ZMQ_DONTWAIT);
+      if (size <= 0) {
+         items[REPLY_SOCKET].revents = 0;
+         if (errno != EAGAIN) {
+            MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "zmq_poll returned w/ZMQ_POLLIN, but no reply msg - errorno %d(%s)", zmq_errno(), zmq_strerror(zmq_errno()));
          }
-         else {
-            zmqBridgeMamaTransportImpl_dispatchNormalMsg(impl, &zmsg);
+      }
+      else {
+         zmqBridgeMamaStats_add(impl->mStats, ZMQ_STATS_DISPATCH, ZMQ_STAT_DIRECT_MSGS_IN, 1);
+         if (impl->mLatency != NULL) {
+            impl->mRecvTime = getNanos();
          }
+         impl->mIsDirectMsg = 1;
+         zmqBridgeMamaTransportImpl_dispatchNormalMsg(impl, zmsg);
+         impl->mIsDirectMsg = 0;
       }
    }
 
-   zmq_msg_close(&zmsg);
+   // drain normal (data) msgs from same-host peers' shm rings
+   if (impl->mShmWakeFd >= 0) {
+      int wakeItem = numSockets;
+      while ((wakeItem < numSockets + ZMQ_MONITORED_SOCKETS) && (impl->mMonitorSockets[wakeItem - numSockets] != NULL)) {
+         ++wakeItem;
+      }
+      if (items[wakeItem].revents & ZMQ_POLLIN) {
+         zmqBridgeMamaShmRing_drainWakeup(impl->mShmWakeFd);
+      }
+   }
+   for (int i = 0; i < impl->mNumShmReaders; ++i) {
+      while (zmqBridgeMamaShmRing_read(impl->mShmReaders[i], zmsg)) {
+         zmqBridgeMamaStats_add(impl->mStats, ZMQ_STATS_DISPATCH, ZMQ_STAT_SHM_MSGS_IN, 1);
+         if (impl->mLatency != NULL) {
+            impl->mRecvTime = getNanos();
+         }
+         zmqBridgeMamaTransportImpl_dispatchNormalMsg(impl, zmsg);
+      }
+   }
 
-   // unlock sockets
-   wlock_unlock(impl->mZmqDataSub.mLock);
-   if (impl->mIsNaming == 1) {
-      wlock_unlock(impl->mZmqNamingSub.mLock);
+   // socket events (if we're dispatched by a reactor)
+   zmqBridgeMamaTransportImpl_dispatchMonitors(impl, &items[numSockets]);
+}
+
+
+// main thread that reads directly off zmq sockets and calls one of the dispatchXxxMsg methods
+void* zmqBridgeMamaTransportImpl_dispatchThread(void* closure)
+{
+   zmqTransportBridge* impl = (zmqTransportBridge*)closure;
+
+   zmq_msg_t zmsg;
+   zmq_msg_init(&zmsg);
+
+   zmqBridgeMamaTransportImpl_dispatchBegin(impl);
+
+   zmq_pollitem_t items[ZMQ_MAX_DISPATCH_ITEMS];
+   int numItems = zmqBridgeMamaTransportImpl_pollItems(impl, items);
+
+   // Following is the transport's main dispatch loop -- it runs "forever"
+   // i.e., until mIsDispatching is set to zero, in dispatchControlMsg, on receipt of an exit ("X") command.
+   while (1 == wInterlocked_read(&impl->mIsDispatching)) {
+      long timeout = zmqBridgeMamaTransportImpl_pollTimeout(impl);
+      int rc = zmq_poll(items, numItems, timeout);
+      if ((rc < 0) && (errno != EINTR)) {
+         MAMA_LOG(MAMA_LOG_LEVEL_SEVERE, "zmq_poll failed  %d(%s)", errno, zmq_strerror(errno));
+         continue;
+      }
+      zmqBridgeMamaTransportImpl_dispatchReady(impl, items, &zmsg);
    }
 
-   impl->mOmzmqDispatchStatus = MAMA_STATUS_OK;
+   zmq_msg_close(&zmsg);
+
+   zmqBridgeMamaTransportImpl_dispatchEnd(impl);
    return NULL;
 }
 
@@ -593,7 +991,7 @@ void* zmqBridgeMamaTransportImpl_dispatchThread(void* closure)
 // control messages are processed immediately on the dispatch thread
 mama_status zmqBridgeMamaTransportImpl_dispatchControlMsg(zmqTransportBridge* impl, zmq_msg_t* zmsg)
 {
-   impl->mControlMessages++;
+   zmqBridgeMamaStats_add(impl->mStats, ZMQ_STATS_DISPATCH, ZMQ_STAT_CONTROL_MSGS, 1);
 
    zmqControlMsg* pMsg = zmq_msg_data(zmsg);
 
@@ -601,10 +999,14 @@ mama_status zmqBridgeMamaTransportImpl_dispatchControlMsg(zmqTransportBridge* im
 
    if (pMsg->command == 'S') {
       // subscribe
+      zmqBridgeMamaInterest_onSubscribe(impl, pMsg->arg1);
+      zmqBridgeMamaTopicIds_subscribe(impl, pMsg->arg1);
       return zmqBridgeMamaTransportImpl_subscribe(impl->mZmqDataSub.mSocket, pMsg->arg1);
    }
    else if (pMsg->command == 'U') {
       // unsubscribe
+      zmqBridgeMamaTopicIds_unsubscribe(impl, pMsg->arg1);
+      zmqBridgeMamaInterest_onUnsubscribe(impl, pMsg->arg1);
       return zmqBridgeMamaTransportImpl_unsubscribe(impl->mZmqDataSub.mSocket, pMsg->arg1);
    }
    else if (pMsg->command == 'X') {
@@ -614,6 +1016,10 @@ mama_status zmqBridgeMamaTransportImpl_dispatchControlMsg(zmqTransportBridge* im
    else if (pMsg->command == 'N') {
       // no-op
    }
+   else if (pMsg->command == 'd') {
+      // data socket disconnected from endpoint (reported by the monitor thread)
+      zmqBridgeMamaTransportImpl_markDisconnected(impl, pMsg->arg1);
+   }
    else {
       MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Unknown command=%c", pMsg->command);
    }
@@ -625,41 +1031,128 @@ mama_status zmqBridgeMamaTransportImpl_dispatchControlMsg(zmqTransportBridge* im
 // naming messages are processed immediately on the dispatch thread
 mama_status zmqBridgeMamaTransportImpl_dispatchNamingMsg(zmqTransportBridge* impl, zmq_msg_t* zmsg)
 {
-   impl->mNamingMessages++;
+   zmqBridgeMamaStats_add(impl->mStats, ZMQ_STATS_DISPATCH, ZMQ_STAT_NAMING_MSGS, 1);
 
    zmqNamingMsg* pMsg = zmq_msg_data(zmsg);
 
+   if ((zmq_msg_size(zmsg) > strlen(ZMQ_SNAPSHOT_PREFIX)) && (memcmp(pMsg, ZMQ_SNAPSHOT_PREFIX, strlen(ZMQ_SNAPSHOT_PREFIX)) == 0)) {
+      return zmqBridgeMamaTransportImpl_dispatchSnapshotMsg(impl, zmsg);
+   }
+
+   // v1 msgs include only the leading fields (the rest are empty)
+   zmqNamingMsg shortMsg;
+   size_t msgSize = zmq_msg_size(zmsg);
+   if (zmqBridgeMamaNamingMsg_isV2(pMsg, msgSize)) {
+      if (zmqBridgeMamaNamingMsg_decode(pMsg, msgSize, &shortMsg) != MAMA_STATUS_OK) {
+         MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Discarding malformed v2 naming msg (%zu bytes)", msgSize);
+         return MAMA_STATUS_INVALID_ARG;
+      }
+      pMsg = &shortMsg;
+   }
+   else {
+      if (msgSize < ZMQ_NAMING_V1_SIZE) {
+         MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Discarding malformed naming msg (%zu bytes)", msgSize);
+         return MAMA_STATUS_INVALID_ARG;
+      }
+      memset(&shortMsg, '\0', sizeof(shortMsg));
+      memcpy(&shortMsg, pMsg, ZMQ_NAMING_V1_SIZE);
+      pMsg = &shortMsg;
+   }
+
    MAMA_LOG(getNamingLogLevel(pMsg->mType), "Received endpoint msg: type=%c prog=%s host=%s uuid=%s pid=%ld topic=%s pub=%s", pMsg->mType, pMsg->mProgName, pMsg->mHost, pMsg->mUuid, pMsg->mPid, pMsg->mTopic, pMsg->mEndPointAddr);
 
-   if ((pMsg->mType == 'C') || (pMsg->mType == 'c')) {
+   if (pMsg->mType == 'h') {
+      // v2 heartbeat -- ask for details if we dont have them (or they're stale)
+      zmqNamingMsg* pOrigMsg = wtable_lookup(impl->mPeers, pMsg->mUuid);
+      if (pOrigMsg != NULL) {
+         zmqBridgeMamaTransportImpl_touchPeer(pOrigMsg);
+      }
+      if ((pOrigMsg == NULL) || (pOrigMsg->mGeneration != pMsg->mGeneration)) {
+         MAMA_LOG(log_level_beacon, "Requesting details for peer uuid=%s generation=%u", pMsg->mUuid, pMsg->mGeneration);
+         zmqBridgeMamaTransportImpl_sendNamingRequest(impl, pMsg->mUuid);
+      }
+      return MAMA_STATUS_OK;
+   }
+   else if (pMsg->mType == 'R') {
+      // v2 request for details -- only the peer whose details are requested answers
+      if (strcmp(pMsg->mUuid, impl->mUuid) == 0) {
+         // several peers may ask at once, and the answer goes to all of them, so only answer once
+         wlock_lock(impl->mZmqNamingPub.mLock);
+         int isRecent = (getMillis() - impl->mLastFullNamingMsg < ZMQ_NAMING_MIN_DETAILS_INTERVAL);
+         wlock_unlock(impl->mZmqNamingPub.mLock);
+         if (isRecent == 0) {
+            CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_sendEndpointsMsg(impl, 'c'));
+         }
+      }
+      return MAMA_STATUS_OK;
+   }
+   else if ((pMsg->mType == 'C') || (pMsg->mType == 'c')) {
       // connect
 
       zmqNamingMsg* pOrigMsg = wtable_lookup(impl->mPeers, pMsg->mUuid);
+      if ((pOrigMsg != NULL) && (pOrigMsg->mGeneration != pMsg->mGeneration)) {
+         // endpoints are bound once per transport, so existing connections remain valid
+         MAMA_LOG(log_level_naming, "Peer details changed: uuid=%s generation=%u=>%u", pMsg->mUuid, pOrigMsg->mGeneration, pMsg->mGeneration);
+         pOrigMsg->mGeneration = pMsg->mGeneration;
+      }
       if (pOrigMsg == NULL) {
          if (pMsg->mType == 'c') {
             // found peer via beacon message
             MAMA_LOG(log_level_beacon, "Received endpoint msg: type=%c prog=%s host=%s uuid=%s pid=%ld topic=%s pub=%s", pMsg->mType, pMsg->mProgName, pMsg->mHost, pMsg->mUuid, pMsg->mPid, pMsg->mTopic, pMsg->mEndPointAddr);
          }
 
-         // we've never seen this peer before, so connect (sub => pub)
-         CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_connectSocket(&impl->mZmqDataSub, pMsg->mEndPointAddr, impl->mReconnectInterval, impl->mHeartbeatInterval));
-
-         // send a discovery msg whenever we see a peer we haven't seen before
-         CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_sendEndpointsMsg(impl, 'C'));
-
          // save peer in table
-         pOrigMsg = malloc(sizeof(zmqNamingMsg));
+         pOrigMsg = calloc(1, sizeof(zmqPeer));
          if (NULL == pOrigMsg) return MAMA_STATUS_NOMEM;
          memcpy(pOrigMsg, pMsg, sizeof(zmqNamingMsg));
-         wtable_insert(impl->mPeers, pOrigMsg->mUuid, pOrigMsg);
 
-         MAMA_LOG(log_level_naming, "Connecting to publisher at endpoint:%s", pMsg->mEndPointAddr);
+         // we've never seen this peer before, so connect (sub => pub), or read from its shm ring
+         // (unless it doesn't publish anything we're interested in)
+         const char* endpoint = NULL;
+         if ((impl->mConnectRate > 0) && zmqBridgeMamaInterest_isInteresting(impl, pOrigMsg)) {
+            // connected later, from the dispatch loop
+            zmqBridgeMamaTransportImpl_queueConnect(impl, pOrigMsg);
+         }
+         else if (zmqBridgeMamaInterest_isInteresting(impl, pOrigMsg)) {
+            mama_status status = zmqBridgeMamaTransportImpl_connectPeer(impl, pOrigMsg, &endpoint);
+            if (status != MAMA_STATUS_OK) {
+               free(pOrigMsg);
+               return status;
+            }
+            MAMA_LOG(log_level_naming, "Connecting to publisher at endpoint:%s", endpoint);
+         }
+         else {
+            zmqBridgeMamaInterest_addUnconnected(impl, pOrigMsg);
+            MAMA_LOG(log_level_naming, "Not connecting to publisher uuid=%s -- not interested in prefixes %s", pOrigMsg->mUuid, pOrigMsg->mPrefixes);
+         }
+
+         // replies to the peer's requests can be sent directly to it? (failure is not fatal -- replies will go via dataPub)
+         zmqBridgeMamaTransportImpl_addDirect(impl, pOrigMsg);
+
+         // send a discovery msg whenever we see a peer we haven't seen before
+         // (unless peers get a snapshot from nsd, in which case the new peer already knows about us)
+         if (impl->mNamingSnapshot == 0) {
+            if (impl->mRebroadcastInterval == 0) {
+               CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_sendEndpointsMsg(impl, 'C'));
+            }
+            else {
+               // sent from the dispatch loop, once for all the peers found in the interval
+               impl->mRebroadcastPending = 1;
+            }
+         }
+
+         wtable_insert(impl->mPeers, pOrigMsg->mUuid, pOrigMsg);
+         wInterlocked_set(wtable_get_count(impl->mPeers), &impl->mNumPeers);
+         if (impl->mStatsShm != NULL) {
+            zmqBridgeMamaStatsShm_updatePeers(impl->mStatsShm, impl->mPeers);
+         }
       }
+      zmqBridgeMamaTransportImpl_touchPeer(pOrigMsg);
 
       // is this our msg? if so, we know we're connected to proxy
       if ((wInterlocked_read(&impl->mNamingConnected) != 1) && (strcmp(pMsg->mUuid, impl->mUuid) == 0)) {
          MAMA_LOG(log_level_naming, "Got own endpoint msg -- signaling");
-         wInterlocked_set(1, &impl->mNamingConnected);
+         zmqBridgeMamaTransportImpl_signalNaming(impl, 0);
       }
    }
    else if (pMsg->mType == 'D') {
@@ -676,57 +1169,320 @@ mama_status zmqBridgeMamaTransportImpl_dispatchNamingMsg(zmqTransportBridge* imp
       }
       #endif
 
-      // remove endpoint from the table
-      zmqNamingMsg* pOrigMsg = wtable_remove(impl->mPeers, pMsg->mUuid);
-      if (pOrigMsg != NULL) {
+      return zmqBridgeMamaTransportImpl_removePeer(impl, pMsg);
+   }
+   else if (pMsg->mType == 'W') {
+      // welcome msg - naming subscriber is connected
+
+      // connect to proxy
+      mama_status status = zmqBridgeMamaTransportImpl_connectSocket(&impl->mZmqNamingPub, pMsg->mEndPointAddr,
+         impl->mReconnectInterval, impl->mHeartbeatInterval);
+      if (status != MAMA_STATUS_OK) {
+         MAMA_LOG(MAMA_LOG_LEVEL_SEVERE, "connect to naming endpoint(%s) failed %d(%s)", pMsg->mEndPointAddr, status, mamaStatus_stringForStatus(status));
+         return MAMA_STATUS_PLATFORM;
+      }
+
+      // start thread to publish naming msg
+      int rc = wthread_create(&impl->mPublishThread, NULL, zmqBridgeMamaTransportImpl_publishEndpoints, impl);
+      if (0 != rc) {
+         MAMA_LOG(MAMA_LOG_LEVEL_SEVERE, "create of endpoint publish thread failed %d(%s)", rc, strerror(rc));
+         return MAMA_STATUS_PLATFORM;
+      }
+   }
+   else {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Unknown naming msg type=%c", pMsg->mType);
+      return MAMA_STATUS_PLATFORM;
+   }
+
+   return MAMA_STATUS_OK;
+}
+
+
+// removes peer from the table, and disconnects from it -- on receipt of a disconnect msg, or when the peer is evicted
+// (pMsg must not point to the entry in the table, which is freed)
+mama_status zmqBridgeMamaTransportImpl_removePeer(zmqTransportBridge* impl, const zmqNamingMsg* pMsg)
+{
+   // remove endpoint from the table
+   // (use the endpoint we originally connected to, which may be ipc)
+   char endpoint[ZMQ_MAX_ENDPOINT_LENGTH +1];
+   zmqNamingMsg* pOrigMsg = wtable_remove(impl->mPeers, pMsg->mUuid);
+   wInterlocked_set(wtable_get_count(impl->mPeers), &impl->mNumPeers);
+   if ((pOrigMsg != NULL) && (impl->mStatsShm != NULL)) {
+      zmqBridgeMamaStatsShm_updatePeers(impl->mStatsShm, impl->mPeers);
+   }
+   zmqBridgeMamaTransportImpl_disconnectDirect(impl, pMsg->mUuid);
+   zmqBridgeMamaGroups_removePeer(impl, pMsg->mUuid);
+   zmqBridgeMamaTopicIds_removePeer(impl, pMsg->mUuid);
+   if ((zmqBridgeMamaInterest_removeUnconnected(impl, pMsg->mUuid)) || ((pOrigMsg != NULL) && ((zmqPeer*) pOrigMsg)->mPending)) {
+      // never connected, so nothing to disconnect
+      free(pOrigMsg);
+      return MAMA_STATUS_OK;
+   }
+   if (pOrigMsg != NULL) {
+      if (pOrigMsg->mShmRingName[0] != '\0') {
+         // not connected via zmq -- just stop reading from the peer's ring
+         zmqBridgeMamaTransportImpl_detachShmRing(impl, pOrigMsg->mShmRingName);
+         MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Detached from shm ring:%s", pOrigMsg->mShmRingName);
          free(pOrigMsg);
+         return MAMA_STATUS_OK;
       }
+      strcpy(endpoint, (pOrigMsg->mIpcEndPointAddr[0] != '\0') ? pOrigMsg->mIpcEndPointAddr : pOrigMsg->mEndPointAddr);
+      free(pOrigMsg);
+   }
+   else {
+      strcpy(endpoint, pMsg->mEndPointAddr);
+   }
+
+   // zmq will silently ignore multiple attempts to connect to the same endpoint (see https://github.com/zeromq/libzmq/issues/788)
+   // so, we want to explicitly disconnect from sockets on normal shutdown so that zmq will know that the endpoint is
+   // disconnected and will *not* ignore a subsequent request to connect to it
+   // Note that we ignore the return value -- any errors are reported in disconnectSocket
+   // (which will happen if peer has already exited, for example)
+   zmqBridgeMamaTransportImpl_disconnectSocket(&impl->mZmqDataSub, endpoint);
+
+   // TODO: do we even need this?  only matters for transports that *never* publish data
+   #define KICK_DATAPUB
+   #ifdef KICK_DATAPUB
+   // In cases where a process doesn't send messages via dataPub socket, the socket must have an opportunity to
+   // clean up resources (e.g., disconnected endpoints), and this is as good a place as any.
+   // For more info see https://github.com/zeromq/libzmq/issues/3186
+   wlock_lock(impl->mZmqDataPub.mLock);
+   size_t fd_size = sizeof(uint32_t);
+   uint32_t fd;
+   zmq_getsockopt (impl->mZmqDataPub.mSocket, ZMQ_EVENTS, &fd, &fd_size);
+   wlock_unlock(impl->mZmqDataPub.mLock);
+   #endif
 
-      // zmq will silently ignore multiple attempts to connect to the same endpoint (see https://github.com/zeromq/libzmq/issues/788)
-      // so, we want to explicitly disconnect from sockets on normal shutdown so that zmq will know that the endpoint is
-      // disconnected and will *not* ignore a subsequent request to connect to it
-      // Note that we ignore the return value -- any errors are reported in disconnectSocket
-      // (which will happen if peer has already exited, for example)
-      zmqBridgeMamaTransportImpl_disconnectSocket(&impl->mZmqDataSub, pMsg->mEndPointAddr);
-
-      // TODO: do we even need this?  only matters for transports that *never* publish data
-      #define KICK_DATAPUB
-      #ifdef KICK_DATAPUB
-      // In cases where a process doesn't send messages via dataPub socket, the socket must have an opportunity to
-      // clean up resources (e.g., disconnected endpoints), and this is as good a place as any.
-      // For more info see https://github.com/zeromq/libzmq/issues/3186
-      wlock_lock(impl->mZmqDataPub.mLock);
-      size_t fd_size = sizeof(uint32_t);
-      uint32_t fd;
-      zmq_getsockopt (impl->mZmqDataPub.mSocket, ZMQ_EVENTS, &fd, &fd_size);
-      wlock_unlock(impl->mZmqDataPub.mLock);
-      #endif
+   MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Disconnected data sockets from publisher:%s", endpoint);
+
+   return MAMA_STATUS_OK;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// discovery pacing
+// When many peers start at once, every transport discovers all of them at once.  W/naming.connect_rate set, new
+// peers are queued, and connected from the dispatch loop at no more than that many peers per second, so that data
+// delivery is not starved.  W/naming.rebroadcast_interval set, the discovery msg we send on finding new peers is
+// sent at most once per interval, rather than once per peer.  Beacon intervals are also randomized (by
+// naming.beacon_jitter), so that peers that started together do not beacon in lock-step.
+// The following must only be called from the dispatch thread.
+
+uint32_t zmqBridgeMamaTransportImpl_jitterBeacon(zmqTransportBridge* impl, uint32_t interval)
+{
+   if (impl->mBeaconJitter <= 0) {
+      return interval;
+   }
+   double jitter = ((rand_r(&impl->mBeaconSeed) / (double) RAND_MAX) * 2 - 1) * impl->mBeaconJitter;
+   return (uint32_t) (interval * (1 + jitter));
+}
+
+
+void zmqBridgeMamaTransportImpl_queueConnect(zmqTransportBridge* impl, zmqNamingMsg* peer)
+{
+   if (impl->mNumPendingConnects == impl->mPendingConnectsSize) {
+      size_t size = (impl->mPendingConnectsSize == 0) ? 64 : impl->mPendingConnectsSize * 2;
+      char (*pending)[UUID_STRING_SIZE +1] = realloc(impl->mPendingConnects, size * sizeof(*pending));
+      if (pending == NULL) {
+         // connect now
+         const char* endpoint = NULL;
+         zmqBridgeMamaTransportImpl_connectPeer(impl, peer, &endpoint);
+         return;
+      }
+      impl->mPendingConnects = pending;
+      impl->mPendingConnectsSize = size;
+   }
+   wmStrSizeCpy(impl->mPendingConnects[impl->mNumPendingConnects++], peer->mUuid, UUID_STRING_SIZE +1);
+   ((zmqPeer*) peer)->mPending = 1;
+   MAMA_LOG(log_level_naming, "Queued connect to publisher uuid=%s (%zu pending)", peer->mUuid, impl->mNumPendingConnects - impl->mPendingConnectsHead);
+}
+
+
+// connects to as many queued peers as connect_rate allows -- returns millis until the next connect is due (or -1)
+long zmqBridgeMamaTransportImpl_drainConnects(zmqTransportBridge* impl)
+{
+   if (impl->mPendingConnectsHead == impl->mNumPendingConnects) {
+      return -1;
+   }
+
+   // token bucket, w/bursts of up to 100ms worth of connects
+   uint64_t now = getMillis();
+   double maxCredit = (impl->mConnectRate > 10) ? impl->mConnectRate / 10.0 : 1;
+   if (impl->mLastConnectCredit == 0) {
+      impl->mConnectCredit = maxCredit;
+   }
+   else {
+      impl->mConnectCredit += (now - impl->mLastConnectCredit) * impl->mConnectRate / 1000.0;
+      if (impl->mConnectCredit > maxCredit) {
+         impl->mConnectCredit = maxCredit;
+      }
+   }
+   impl->mLastConnectCredit = now;
+
+   while ((impl->mConnectCredit >= 1) && (impl->mPendingConnectsHead < impl->mNumPendingConnects)) {
+      const char* uuid = impl->mPendingConnects[impl->mPendingConnectsHead++];
+      zmqNamingMsg* peer = wtable_lookup(impl->mPeers, uuid);
+      if ((peer == NULL) || (((zmqPeer*) peer)->mPending == 0)) {
+         // removed (or no longer interesting) while queued
+         continue;
+      }
+      ((zmqPeer*) peer)->mPending = 0;
+      impl->mConnectCredit -= 1;
+      const char* endpoint = NULL;
+      if (zmqBridgeMamaTransportImpl_connectPeer(impl, peer, &endpoint) != MAMA_STATUS_OK) {
+         MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Unable to connect to publisher uuid=%s", peer->mUuid);
+         continue;
+      }
+      MAMA_LOG(log_level_naming, "Connecting to publisher at endpoint:%s", endpoint);
+   }
+
+   if (impl->mPendingConnectsHead == impl->mNumPendingConnects) {
+      impl->mPendingConnectsHead = impl->mNumPendingConnects = 0;
+      impl->mLastConnectCredit = 0;
+      return -1;
+   }
+   long timeout = (long) ((1 - impl->mConnectCredit) * 1000 / impl->mConnectRate);
+   return (timeout > 0) ? timeout : 1;
+}
+
+
+// sends our discovery msg if we've found new peers, and haven't sent it recently -- returns millis until it can next
+// be sent (or -1)
+long zmqBridgeMamaTransportImpl_flushRebroadcast(zmqTransportBridge* impl)
+{
+   if (impl->mRebroadcastPending == 0) {
+      return -1;
+   }
+   uint64_t now = getMillis();
+   if (now < impl->mLastRebroadcast + impl->mRebroadcastInterval) {
+      return (long) (impl->mLastRebroadcast + impl->mRebroadcastInterval - now);
+   }
+   impl->mRebroadcastPending = 0;
+   impl->mLastRebroadcast = now;
+   zmqBridgeMamaTransportImpl_sendEndpointsMsg(impl, 'C');
+   return -1;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// peer liveness
+// Peers that stop beaconing (e.g., because they crashed) w/o sending a disconnect msg are evicted after
+// naming.missed_beacons beacon intervals (or two intervals, if the data socket has also reported a disconnect).
+// The following must only be called from the dispatch thread.
+
+void zmqBridgeMamaTransportImpl_touchPeer(zmqNamingMsg* peer)
+{
+   ((zmqPeer*) peer)->mLastSeen = getMillis();
+   ((zmqPeer*) peer)->mDisconnected = 0;
+}
+
+
+typedef struct zmqEvictClosure {
+   const char*             mEndpoint;           // markDisconnected only
+   uint64_t                mNow;
+   uint64_t                mTimeout;
+   uint64_t                mDisconnectedTimeout;
+   zmqPeer*                mPeers;              // copies of peers to evict
+   size_t                  mNumPeers;
+} zmqEvictClosure;
+
+
+static void zmqBridgeMamaTransportImpl_markPeer(wtable_t table, void* data, const char* key, void* closure)
+{
+   zmqEvictClosure* evict = (zmqEvictClosure*) closure;
+   zmqNamingMsg* peer = (zmqNamingMsg*) data;
+   if ((strcmp(peer->mEndPointAddr, evict->mEndpoint) == 0) || (strcmp(peer->mIpcEndPointAddr, evict->mEndpoint) == 0)) {
+      ((zmqPeer*) peer)->mDisconnected = 1;
+   }
+}
+
+
+// called when the data socket reports that the connection to endpoint was dropped
+void zmqBridgeMamaTransportImpl_markDisconnected(zmqTransportBridge* impl, const char* endpoint)
+{
+   zmqEvictClosure evict;
+   memset(&evict, '\0', sizeof(evict));
+   evict.mEndpoint = endpoint;
+   wtable_for_each(impl->mPeers, zmqBridgeMamaTransportImpl_markPeer, &evict);
+}
+
+
+static void zmqBridgeMamaTransportImpl_findStalePeer(wtable_t table, void* data, const char* key, void* closure)
+{
+   zmqEvictClosure* evict = (zmqEvictClosure*) closure;
+   zmqPeer* peer = (zmqPeer*) data;
+   uint64_t timeout = peer->mDisconnected ? evict->mDisconnectedTimeout : evict->mTimeout;
+   if (peer->mLastSeen + timeout < evict->mNow) {
+      zmqPeer* peers = realloc(evict->mPeers, (evict->mNumPeers + 1) * sizeof(zmqPeer));
+      if (peers != NULL) {
+         evict->mPeers = peers;
+         evict->mPeers[evict->mNumPeers++] = *peer;
+      }
+   }
+}
+
+
+// evicts peers that have missed too many beacons
+void zmqBridgeMamaTransportImpl_evictPeers(zmqTransportBridge* impl)
+{
+   uint32_t beaconInterval = wInterlocked_read(&impl->mBeaconInterval);
+   if ((impl->mMissedBeacons == 0) || (beaconInterval == 0)) {
+      return;
+   }
+
+   zmqEvictClosure evict;
+   memset(&evict, '\0', sizeof(evict));
+   evict.mNow = getMillis();
+   evict.mTimeout = (uint64_t) impl->mMissedBeacons * beaconInterval;
+   evict.mDisconnectedTimeout = (uint64_t) ((impl->mMissedBeacons < 2) ? impl->mMissedBeacons : 2) * beaconInterval;
+
+   // if we're not getting our own beacons, the problem is (probably) w/the nsd, not our peers
+   zmqPeer* self = wtable_lookup(impl->mPeers, impl->mUuid);
+   if ((self == NULL) || (self->mLastSeen + evict.mTimeout < evict.mNow)) {
+      MAMA_LOG(log_level_naming, "Not receiving own beacons -- skipping peer eviction");
+      return;
+   }
+
+   wtable_for_each(impl->mPeers, zmqBridgeMamaTransportImpl_findStalePeer, &evict);
+   for (size_t i = 0; i < evict.mNumPeers; ++i) {
+      zmqNamingMsg* peer = &evict.mPeers[i].mMsg;
+      MAMA_LOG(MAMA_LOG_LEVEL_WARN, "Evicting peer uuid=%s prog=%s host=%s pid=%ld -- no beacon for %llu ms", peer->mUuid, peer->mProgName, peer->mHost, peer->mPid, (unsigned long long) (evict.mNow - evict.mPeers[i].mLastSeen));
+      peer->mType = 'D';
+      zmqBridgeMamaTransportImpl_removePeer(impl, peer);
+      zmqBridgeMamaStats_add(impl->mStats, ZMQ_STATS_DISPATCH, ZMQ_STAT_PEERS_EVICTED, 1);
+   }
+   free(evict.mPeers);
+}
 
-      MAMA_LOG(MAMA_LOG_LEVEL_NORMAL, "Disconnected data sockets from publisher:%s", pMsg->mEndPointAddr);
-   }
-   else if (pMsg->mType == 'W') {
-      // welcome msg - naming subscriber is connected
 
-      // connect to proxy
-      mama_status status = zmqBridgeMamaTransportImpl_connectSocket(&impl->mZmqNamingPub, pMsg->mEndPointAddr,
-         impl->mReconnectInterval, impl->mHeartbeatInterval);
-      if (status != MAMA_STATUS_OK) {
-         MAMA_LOG(MAMA_LOG_LEVEL_SEVERE, "connect to naming endpoint(%s) failed %d(%s)", pMsg->mEndPointAddr, status, mamaStatus_stringForStatus(status));
-         return MAMA_STATUS_PLATFORM;
+// snapshot of nsd's directory -- each entry is a 4-byte length followed by a naming msg
+mama_status zmqBridgeMamaTransportImpl_dispatchSnapshotMsg(zmqTransportBridge* impl, zmq_msg_t* zmsg)
+{
+   const char* data = zmq_msg_data(zmsg);
+   size_t size = zmq_msg_size(zmsg);
+   size_t offset = strnlen(data, size) + 1;
+   int count = 0;
+   while (offset + sizeof(uint32_t) <= size) {
+      uint32_t netSize;
+      memcpy(&netSize, data + offset, sizeof(netSize));
+      size_t entrySize = ntohl(netSize);
+      offset += sizeof(netSize);
+      if (offset + entrySize > size) {
+         MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Discarding truncated snapshot entry (%zu bytes)", entrySize);
+         return MAMA_STATUS_INVALID_ARG;
       }
 
-      // start thread to publish naming msg
-      int rc = wthread_create(&impl->mPublishThread, NULL, zmqBridgeMamaTransportImpl_publishEndpoints, impl);
-      if (0 != rc) {
-         MAMA_LOG(MAMA_LOG_LEVEL_SEVERE, "create of endpoint publish thread failed %d(%s)", rc, strerror(rc));
-         return MAMA_STATUS_PLATFORM;
-      }
-   }
-   else {
-      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Unknown naming msg type=%c", pMsg->mType);
-      return MAMA_STATUS_PLATFORM;
+      // entries are dispatched in place
+      zmq_msg_t entry;
+      zmq_msg_init_data(&entry, (void*) (data + offset), entrySize, NULL, NULL);
+      zmqBridgeMamaTransportImpl_dispatchNamingMsg(impl, &entry);
+      zmq_msg_close(&entry);
+      offset += entrySize;
+      ++count;
    }
 
+   MAMA_LOG(log_level_naming, "Received snapshot of %d peers (%zu bytes)", count, size);
+
    return MAMA_STATUS_OK;
 }
 
@@ -735,31 +1491,76 @@ mama_status zmqBridgeMamaTransportImpl_dispatchNamingMsg(zmqTransportBridge* imp
 mama_status zmqBridgeMamaTransportImpl_dispatchNormalMsg(zmqTransportBridge* impl, zmq_msg_t* zmsg)
 {
    const char* subject = (char*) zmq_msg_data(zmsg);
-   MAMA_LOG(MAMA_LOG_LEVEL_FINER, "Got msg with subject %s", subject);
 
-   impl->mNormalMessages++;
+   zmqBridgeMamaStats_add(impl->mStats, ZMQ_STATS_DISPATCH, ZMQ_STAT_MSGS_IN, 1);
+   zmqBridgeMamaStats_add(impl->mStats, ZMQ_STATS_DISPATCH, ZMQ_STAT_BYTES_IN, zmq_msg_size(zmsg));
+
+   // compact msg -- resolve subject from topic id
+   if ((subject[0] == ZMQ_TOPICID_MARKER) && (impl->mTopicIds == 1)) {
+      if (zmq_msg_size(zmsg) < ZMQ_TOPICID_PREFIX_SIZE) {
+         MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Discarding truncated topic id msg (%zu bytes)", zmq_msg_size(zmsg));
+         return MAMA_STATUS_INVALID_ARG;
+      }
+      uint32_t tag, id;
+      zmqBridgeMamaTopicIds_decodePrefix((const uint8_t*) subject, &tag, &id);
+      const char* resolved = zmqBridgeMamaTopicIds_resolve(impl, tag, id);
+      if (resolved == NULL) {
+         zmqBridgeMamaStats_add(impl->mStats, ZMQ_STATS_DISPATCH, ZMQ_STAT_TOPIC_ID_MISSES, 1);
+         MAMA_LOG(MAMA_LOG_LEVEL_FINER, "discarding msg with unknown topic id %08x.%u", tag, id);
+         return MAMA_STATUS_NOT_FOUND;
+      }
+      MAMA_LOG(MAMA_LOG_LEVEL_FINER, "Got msg with topic id %08x.%u subject %s", tag, id, resolved);
+      return zmqBridgeMamaTransportImpl_dispatchSubMsg(impl, resolved, 1, zmsg);
+   }
+
+   MAMA_LOG(MAMA_LOG_LEVEL_FINER, "Got msg with subject %s", subject);
 
    if (memcmp(subject, ZMQ_REPLYHANDLE_PREFIX, strlen(ZMQ_REPLYHANDLE_PREFIX)) == 0) {
       return zmqBridgeMamaTransportImpl_dispatchInboxMsg(impl, subject, zmsg);
    }
-   else {
-      return zmqBridgeMamaTransportImpl_dispatchSubMsg(impl, subject, zmsg);
+
+   // queue group membership announcement?
+   if ((impl->mQueueGroups == 1) && (memcmp(subject, ZMQ_GROUP_PREFIX, strlen(ZMQ_GROUP_PREFIX)) == 0)) {
+      return zmqBridgeMamaGroups_onMsg(impl, subject, zmsg);
    }
+
+   // full subject w/topic id announcement?
+   if (impl->mTopicIds == 1) {
+      size_t subjectSize = strlen(subject) + 1;
+      const uint8_t* msgType = (const uint8_t*) subject + subjectSize;
+      if ((zmq_msg_size(zmsg) >= subjectSize + ZMQ_TOPICID_PREFIX_SIZE) && (*msgType == ZMQ_MSG_PUB_SUB_TOPICID)) {
+         uint32_t tag, id;
+         // type byte takes the place of the marker
+         zmqBridgeMamaTopicIds_decodePrefix(msgType, &tag, &id);
+         zmqBridgeMamaTopicIds_learn(impl, tag, id, subject);
+      }
+   }
+
+   return zmqBridgeMamaTransportImpl_dispatchSubMsg(impl, subject, 0, zmsg);
 }
 
 
 // enqueue msg to the (one and only) inbox
 mama_status zmqBridgeMamaTransportImpl_dispatchInboxMsg(zmqTransportBridge* impl, const char* subject, zmq_msg_t* zmsg)
 {
-   impl->mInboxMessages++;
+   zmqBridgeMamaStats_add(impl->mStats, ZMQ_STATS_DISPATCH, ZMQ_STAT_INBOX_MSGS, 1);
+
+   // replies for other transports are normally filtered out by zmq's prefix matching, but readers of a shm ring
+   // get every msg written to it -- and inbox names are only unique w/in a transport
+   if ((strncmp(subject, impl->mInboxSubject, ZMQ_INBOX_SUBJECT_SIZE) != 0) || (subject[ZMQ_INBOX_SUBJECT_SIZE] != '.')) {
+      MAMA_LOG(log_level_inbox, "discarding reply for another transport w/subject %s", subject);
+      zmqBridgeMamaStats_add(impl->mStats, ZMQ_STATS_DISPATCH, ZMQ_STAT_UNMATCHED, 1);
+      return MAMA_STATUS_NOT_FOUND;
+   }
 
    // index directly into subject to pick up inbox name (last part)
    const char* inboxName = &subject[ZMQ_REPLYHANDLE_INBOXNAME_INDEX];
    wlock_lock(impl->mInboxesLock);
-   zmqInboxImpl* inbox = wtable_lookup(impl->mInboxes, inboxName);
+   zmqInboxImpl* inbox = zmqBridgeMamaTransportImpl_findInbox(impl, inboxName);
    if (inbox == NULL) {
       wlock_unlock(impl->mInboxesLock);
       MAMA_LOG(log_level_inbox, "discarding uninteresting message for subject %s", subject);
+      zmqBridgeMamaStats_add(impl->mStats, ZMQ_STATS_DISPATCH, ZMQ_STAT_UNMATCHED, 1);
       return MAMA_STATUS_NOT_FOUND;
    }
 
@@ -770,10 +1571,11 @@ mama_status zmqBridgeMamaTransportImpl_dispatchInboxMsg(zmqTransportBridge* impl
    // queue up message, callback will free
    zmqTransportMsg tmsg;
    tmsg.mTransport = impl;
-   strcpy(tmsg.mEndpointIdentifier, inboxName);
+   tmsg.mSubject = NULL;
+   snprintf(tmsg.mEndpointIdentifier, sizeof(tmsg.mEndpointIdentifier), "%s", inboxName);
    zmq_msg_init(&tmsg.mZmsg);
    zmq_msg_copy(&tmsg.mZmsg, zmsg);
-   zmqBridgeMamaQueue_enqueueMsg(queue, zmqBridgeMamaTransportImpl_inboxCallback, &tmsg);
+   zmqBridgeMamaTransportImpl_enqueueMsg(impl, queue, zmqBridgeMamaTransportImpl_inboxCallback, &tmsg);
 
    return MAMA_STATUS_OK;
 }
@@ -781,19 +1583,25 @@ mama_status zmqBridgeMamaTransportImpl_dispatchInboxMsg(zmqTransportBridge* impl
 
 // enqueue msg to all matching subscribers
 // (both regular and wildcard subscribers)
-mama_status zmqBridgeMamaTransportImpl_dispatchSubMsg(zmqTransportBridge* impl, const char* subject, zmq_msg_t* zmsg)
+// if isInterned is non-zero, subject is an interned topic id subject that outlives the msg
+mama_status zmqBridgeMamaTransportImpl_dispatchSubMsg(zmqTransportBridge* impl, const char* subject, int isInterned, zmq_msg_t* zmsg)
 {
-   impl->mSubMessages++;
+   zmqBridgeMamaStats_add(impl->mStats, ZMQ_STATS_DISPATCH, ZMQ_STAT_SUB_MSGS, 1);
 
    // process wildcard subscriptions
    zmqWildcardClosure wcClosure;
    wcClosure.subject = subject;
+   wcClosure.isInterned = isInterned;
    wcClosure.zmsg = zmsg;
    wcClosure.found = 0;
-   wlock_lock(impl->mWcsLock);
-   list_for_each(impl->mWcEndpoints, (wListCallback) zmqBridgeMamaTransportImpl_matchWildcards, &wcClosure);
-   wlock_unlock(impl->mWcsLock);
+   // msgs sent directly to a group member are for that member only
+   if (impl->mIsDirectMsg == 0) {
+      wlock_lock(impl->mWcsLock);
+      list_for_each(impl->mWcEndpoints, (wListCallback) zmqBridgeMamaTransportImpl_matchWildcards, &wcClosure);
+      wlock_unlock(impl->mWcsLock);
+   }
    MAMA_LOG(MAMA_LOG_LEVEL_FINEST, "Found %d wildcard matches for %s", wcClosure.found, subject);
+   zmqBridgeMamaStats_add(impl->mStats, ZMQ_STATS_DISPATCH, ZMQ_STAT_WC_MATCHES, wcClosure.found);
 
    // process regular (non-wildcard) subscriptions
    endpoint_t* subs = NULL;
@@ -809,6 +1617,7 @@ mama_status zmqBridgeMamaTransportImpl_dispatchSubMsg(zmqTransportBridge* impl,
       wlock_unlock(impl->mSubsLock);
       if (wcClosure.found == 0) {
          MAMA_LOG(MAMA_LOG_LEVEL_FINER, "discarding uninteresting message for subject %s", subject);
+         zmqBridgeMamaStats_add(impl->mStats, ZMQ_STATS_DISPATCH, ZMQ_STAT_UNMATCHED, 1);
       }
       return MAMA_STATUS_NOT_FOUND;
    }
@@ -823,17 +1632,24 @@ mama_status zmqBridgeMamaTransportImpl_dispatchSubMsg(zmqTransportBridge* impl,
          subscription->mIsTportDisconnected = 0;
       }
 
+      // group members only get msgs sent directly to them, and vice versa
+      if (subscription->mIsGroupMember != impl->mIsDirectMsg) {
+         continue;
+      }
+
       if (1 != subscription->mIsNotMuted) {
          MAMA_LOG(MAMA_LOG_LEVEL_WARN, "muted - not queueing update for symbol %s", subject);
+         zmqBridgeMamaStats_add(impl->mStats, ZMQ_STATS_DISPATCH, ZMQ_STAT_DROPS_IN, 1);
       }
       else {
          // queue up message, callback will free
          zmqTransportMsg tmsg;
          tmsg.mTransport = impl;
+         tmsg.mSubject = isInterned ? subject : NULL;
          strcpy(tmsg.mEndpointIdentifier, subscription->mEndpointIdentifier);
          zmq_msg_init(&tmsg.mZmsg);
          zmq_msg_copy(&tmsg.mZmsg, zmsg);
-         zmqBridgeMamaQueue_enqueueMsg(subscription->mZmqQueue, zmqBridgeMamaTransportImpl_subCallback, &tmsg);
+         zmqBridgeMamaTransportImpl_enqueueMsg(impl, subscription->mZmqQueue, zmqBridgeMamaTransportImpl_subCallback, &tmsg);
       }
    }
    wlock_unlock(impl->mSubsLock);
@@ -864,10 +1680,52 @@ void zmqBridgeMamaTransportImpl_matchWildcards(wList dummy, zmqSubscription** pS
    // queue up message, callback will free
    zmqTransportMsg tmsg;
    tmsg.mTransport = subscription->mTransport;
+   tmsg.mSubject = closure->isInterned ? closure->subject : NULL;
    strcpy(tmsg.mEndpointIdentifier, subscription->mEndpointIdentifier);
    zmq_msg_init(&tmsg.mZmsg);
    zmq_msg_copy(&tmsg.mZmsg, closure->zmsg);
-   zmqBridgeMamaQueue_enqueueMsg(subscription->mZmqQueue, zmqBridgeMamaTransportImpl_wcCallback, &tmsg);
+   zmqBridgeMamaTransportImpl_enqueueMsg(subscription->mTransport, subscription->mZmqQueue, zmqBridgeMamaTransportImpl_wcCallback, &tmsg);
+}
+
+
+// enqueues msg (which the callback will free) and updates stats
+// w/latency stats, also stamps msg w/receive and enqueue times and records receive latency
+void zmqBridgeMamaTransportImpl_enqueueMsg(zmqTransportBridge* impl, void* queue, mamaQueueEnqueueCB callback, zmqTransportMsg* tmsg)
+{
+   if (impl->mLatency == NULL) {
+      tmsg->mRecvTime = 0;
+      tmsg->mEnqueueTime = 0;
+   }
+   else {
+      tmsg->mRecvTime = impl->mRecvTime;
+      tmsg->mEnqueueTime = getNanos();
+      zmqBridgeMamaLatency_record(impl->mLatency, ZMQ_LATENCY_RECEIVE, tmsg->mEnqueueTime - tmsg->mRecvTime);
+   }
+
+   if (zmqBridgeMamaQueue_enqueueMsg(queue, callback, tmsg) != MAMA_STATUS_OK) {
+      zmq_msg_close(&tmsg->mZmsg);
+      zmqBridgeMamaStats_add(impl->mStats, ZMQ_STATS_DISPATCH, ZMQ_STAT_DROPS_IN, 1);
+      return;
+   }
+
+   // sampled, since getting the depth isn't free
+   if ((++impl->mEnqueueCount & (ZMQ_STATS_DEPTH_SAMPLE -1)) == 0) {
+      size_t depth = 0;
+      zmqBridgeMamaQueue_getEventCount(queue, &depth);
+      zmqBridgeMamaStats_max(impl->mStats, ZMQ_STATS_DISPATCH, ZMQ_STAT_QUEUE_DEPTH_MAX, depth);
+   }
+}
+
+
+// w/latency stats, records queue, dispatch and callback latency for both the transport and the queue
+void zmqBridgeMamaTransportImpl_recordLatency(zmqTransportMsg* tmsg, void* zmqQueue, uint64_t dequeueTime, uint64_t callbackTime)
+{
+   uint64_t now = getNanos();
+   zmqBridgeMamaLatency_recordDispatch(tmsg->mTransport->mLatency, tmsg->mEnqueueTime, dequeueTime, callbackTime, now);
+   zmqQueueBridge* queue = (zmqQueueBridge*) zmqQueue;
+   if (queue->mLatency != NULL) {
+      zmqBridgeMamaLatency_recordDispatch(queue->mLatency, tmsg->mEnqueueTime, dequeueTime, callbackTime, now);
+   }
 }
 
 
@@ -883,11 +1741,12 @@ void zmqBridgeMamaTransportImpl_matchWildcards(wList dummy, zmqSubscription** pS
 void MAMACALLTYPE  zmqBridgeMamaTransportImpl_inboxCallback(mamaQueue queue, void* closure)
 {
    zmqTransportMsg* tmsg = (zmqTransportMsg*) closure;
+   uint64_t dequeueTime = (tmsg->mEnqueueTime != 0) ? getNanos() : 0;
    zmqTransportBridge* impl = (zmqTransportBridge*) tmsg->mTransport;
 
    // find the inbox
    wlock_lock(impl->mInboxesLock);
-   zmqInboxImpl* inbox = wtable_lookup(impl->mInboxes, tmsg->mEndpointIdentifier);
+   zmqInboxImpl* inbox = zmqBridgeMamaTransportImpl_findInbox(impl, tmsg->mEndpointIdentifier);
    wlock_unlock(impl->mInboxesLock);
    if (inbox == NULL) {
       MAMA_LOG(log_level_inbox, "discarding uninteresting message for inbox %s", tmsg->mEndpointIdentifier);
@@ -916,7 +1775,18 @@ void MAMACALLTYPE  zmqBridgeMamaTransportImpl_inboxCallback(mamaQueue queue, voi
       goto exit;
    }
 
-   zmqBridgeMamaInboxImpl_onMsg(NULL, tmpMsg, inbox, NULL);
+   uint64_t callbackTime = (dequeueTime != 0) ? getNanos() : 0;
+   // the inbox may be destroyed by its callback
+   void* zmqQueue = inbox->mZmqQueue;
+   if (inbox->mPool != NULL) {
+      zmqBridgeMamaInboxPoolImpl_onMsg(inbox->mPool, tmpMsg, &tmsg->mEndpointIdentifier[ZMQ_INBOXPOOL_NAME_SIZE]);
+   }
+   else {
+      zmqBridgeMamaInboxImpl_onMsg(NULL, tmpMsg, inbox, NULL);
+   }
+   if (dequeueTime != 0) {
+      zmqBridgeMamaTransportImpl_recordLatency(tmsg, zmqQueue, dequeueTime, callbackTime);
+   }
 
 exit:
    zmq_msg_close(&tmsg->mZmsg);
@@ -934,7 +1804,8 @@ exit:
 void MAMACALLTYPE  zmqBridgeMamaTransportImpl_subCallback(mamaQueue queue, void* closure)
 {
    zmqTransportMsg* tmsg = (zmqTransportMsg*) closure;
-   const char *subject = (const char*) zmq_msg_data(&tmsg->mZmsg);
+   uint64_t dequeueTime = (tmsg->mEnqueueTime != 0) ? getNanos() : 0;
+   const char *subject = (tmsg->mSubject != NULL) ? tmsg->mSubject : (const char*) zmq_msg_data(&tmsg->mZmsg);
 
    // find the subscription based on its identifier
    zmqSubscription* subscription = NULL;
@@ -975,10 +1846,16 @@ void MAMACALLTYPE  zmqBridgeMamaTransportImpl_subCallback(mamaQueue queue, void*
    }
    else {
       /* Process the message as normal */
+      uint64_t callbackTime = (dequeueTime != 0) ? getNanos() : 0;
+      // the subscription may be destroyed by its callback
+      void* zmqQueue = subscription->mZmqQueue;
       status = mamaSubscription_processMsg(subscription->mMamaSubscription, tmpMsg);
       if (MAMA_STATUS_OK != status) {
          MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "mamaSubscription_processMsg() failed. [%s]", mamaStatus_stringForStatus(status));
       }
+      if (dequeueTime != 0) {
+         zmqBridgeMamaTransportImpl_recordLatency(tmsg, zmqQueue, dequeueTime, callbackTime);
+      }
    }
 
 exit:
@@ -997,7 +1874,8 @@ exit:
 void MAMACALLTYPE  zmqBridgeMamaTransportImpl_wcCallback(mamaQueue queue, void* closure)
 {
    zmqTransportMsg* tmsg = (zmqTransportMsg*) closure;
-   const char *subject = (const char*) zmq_msg_data(&tmsg->mZmsg);
+   uint64_t dequeueTime = (tmsg->mEnqueueTime != 0) ? getNanos() : 0;
+   const char *subject = (tmsg->mSubject != NULL) ? tmsg->mSubject : (const char*) zmq_msg_data(&tmsg->mZmsg);
 
    // is this subscription still in the list?
    zmqFindWildcardClosure findClosure;
@@ -1039,10 +1917,16 @@ void MAMACALLTYPE  zmqBridgeMamaTransportImpl_wcCallback(mamaQueue queue, void*
       MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "zmqBridgeMamaMsgImpl_deserialize() failed. [%s]", mamaStatus_stringForStatus(status));
    }
    else {
+      uint64_t callbackTime = (dequeueTime != 0) ? getNanos() : 0;
+      // the subscription may be destroyed by its callback
+      void* zmqQueue = subscription->mZmqQueue;
       status = mamaSubscription_processWildCardMsg(subscription->mMamaSubscription, tmpMsg, subject, subscription->mClosure);
       if (MAMA_STATUS_OK != status) {
          MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "mamaSubscription_processMsg() failed. [%s]", mamaStatus_stringForStatus(status));
       }
+      if (dequeueTime != 0) {
+         zmqBridgeMamaTransportImpl_recordLatency(tmsg, zmqQueue, dequeueTime, callbackTime);
+      }
    }
 
 exit:
@@ -1091,6 +1975,20 @@ mama_status zmqBridgeMamaTransportImpl_getInboxSubject(zmqTransportBridge* impl,
    return MAMA_STATUS_OK;
 }
 
+// inbox pools are registered under a prefix of the inbox name (caller must hold mInboxesLock)
+zmqInboxImpl* zmqBridgeMamaTransportImpl_findInbox(zmqTransportBridge* impl, const char* inboxName)
+{
+   if (inboxName[0] == ZMQ_INBOXPOOL_MARKER) {
+      char poolName[ZMQ_INBOXPOOL_NAME_SIZE +1];
+      memcpy(poolName, inboxName, ZMQ_INBOXPOOL_NAME_SIZE);
+      poolName[ZMQ_INBOXPOOL_NAME_SIZE] = '\0';
+      return wtable_lookup(impl->mInboxes, poolName);
+   }
+
+   return wtable_lookup(impl->mInboxes, inboxName);
+}
+
+
 mama_status zmqBridgeMamaTransportImpl_registerInbox(zmqTransportBridge* impl, zmqInboxImpl* inbox)
 {
    MAMA_LOG(log_level_inbox, "mamaInbox=%p,replyAddr=%s", inbox->mParent, inbox->mReplyHandle);
@@ -1123,6 +2021,14 @@ mama_status zmqBridgeMamaTransportImpl_unregisterInbox(zmqTransportBridge* impl,
 
 ///////////////////////////////////////////////////////////////////////////////
 // zmq socket functions
+
+// inproc endpoint for socket's monitor events (w/the socket's address, so it's unique w/in a shared context)
+static void zmqBridgeMamaTransportImpl_monitorEndpoint(char* endpoint, size_t size, const char* name, const zmqSocket* socket)
+{
+   snprintf(endpoint, size, "inproc://%s.%p", name, (const void*) socket);
+}
+
+
 mama_status zmqBridgeMamaTransportImpl_createSocket(void* zmqContext, zmqSocket* socket, int type, const char* name, int monitor)
 {
    void* temp = zmq_socket(zmqContext, type);
@@ -1135,14 +2041,15 @@ mama_status zmqBridgeMamaTransportImpl_createSocket(void* zmqContext, zmqSocket*
    socket->mLock = wlock_create();
    socket->mMonitor = monitor;
 
-   // we dont use router/dealer or req/rep, so we hijack the identity property to set a name to make debugging easier
+   // except for direct replies (where the ROUTER sets its peers' routing ids when it connects), we dont use
+   // router/dealer or req/rep, so we hijack the identity property to set a name to make debugging easier
    if (NULL != name) {
       CALL_ZMQ_FUNC(zmq_setsockopt(socket->mSocket, ZMQ_IDENTITY, name, strlen(name) +1));
    }
 
    if ((socket->mMonitor != 0) && (name != NULL)) {
       char endpoint[ZMQ_MAX_ENDPOINT_LENGTH +1];
-      sprintf(endpoint, "inproc://%s", name);
+      zmqBridgeMamaTransportImpl_monitorEndpoint(endpoint, sizeof(endpoint), name, socket);
       CALL_ZMQ_FUNC(zmq_socket_monitor_versioned(socket->mSocket, endpoint, get_zmqEventMask(gMamaLogLevel), 2, ZMQ_PAIR));
    }
 
@@ -1453,6 +2360,39 @@ mama_status zmqBridgeMamaTransportImpl_subscribe(void* socket, const char* topic
    return MAMA_STATUS_OK;
 }
 
+// binary prefixes are used for topic ids
+mama_status zmqBridgeMamaTransportImpl_subscribeBinary(void* socket, const void* prefix, size_t size)
+{
+   MAMA_LOG(MAMA_LOG_LEVEL_FINE, "Socket %p subscribing to %zu-byte prefix", socket, size);
+
+   #ifdef USE_XSUB
+   char buf[MAX_SUBJECT_LENGTH + 1];
+   buf[0] = '\1';
+   memcpy(&buf[1], prefix, size);
+   CALL_ZMQ_FUNC(zmq_send(socket, buf, size + 1, 0));
+   #else
+   CALL_ZMQ_FUNC(zmq_setsockopt (socket, ZMQ_SUBSCRIBE, prefix, size));
+   #endif
+
+   return MAMA_STATUS_OK;
+}
+
+mama_status zmqBridgeMamaTransportImpl_unsubscribeBinary(void* socket, const void* prefix, size_t size)
+{
+   MAMA_LOG(MAMA_LOG_LEVEL_FINE, "Socket %p unsubscribing from %zu-byte prefix", socket, size);
+
+   #ifdef USE_XSUB
+   char buf[MAX_SUBJECT_LENGTH + 1];
+   buf[0] = '\0';
+   memcpy(&buf[1], prefix, size);
+   CALL_ZMQ_FUNC(zmq_send(socket, buf, size + 1, 0));
+   #else
+   CALL_ZMQ_FUNC(zmq_setsockopt (socket, ZMQ_UNSUBSCRIBE, prefix, size));
+   #endif
+
+   return MAMA_STATUS_OK;
+}
+
 mama_status zmqBridgeMamaTransportImpl_unsubscribe(void* socket, const char* topic)
 {
    MAMA_LOG(MAMA_LOG_LEVEL_FINE, "Socket %p unsubscribing from %s", socket, topic);
@@ -1505,19 +2445,68 @@ mama_status zmqBridgeMamaTransportImpl_sendEndpointsMsg(zmqTransportBridge* impl
    #else
    wmStrSizeCpy(msg.mProgName, program_invocation_short_name, sizeof(msg.mProgName));
    #endif
-   gethostname(msg.mHost, sizeof(msg.mHost));
+   strcpy(msg.mHost, impl->mHost);
    msg.mPid = getpid();
    strcpy(msg.mUuid, impl->mUuid);
    strcpy(msg.mEndPointAddr, impl->mPubEndpoint);
+   if (impl->mIpcEndpoint != NULL) {
+      strcpy(msg.mIpcEndPointAddr, impl->mIpcEndpoint);
+   }
+   if (impl->mShmRing != NULL) {
+      strcpy(msg.mShmRingName, zmqBridgeMamaShmRing_getName(impl->mShmRing));
+   }
+   if (impl->mReplyEndpoint != NULL) {
+      strcpy(msg.mReplyEndPointAddr, impl->mReplyEndpoint);
+   }
+   msg.mGeneration = impl->mNamingGeneration;
+   if (impl->mPublishPrefixes != NULL) {
+      // group members also publish membership announcements
+      snprintf(msg.mPrefixes, sizeof(msg.mPrefixes), "%s%s", impl->mPublishPrefixes, (impl->mQueueGroup != NULL) ? "," ZMQ_GROUP_PREFIX : "");
+   }
+
+   // v2 msgs are encoded w/variable-length fields (v1 msgs send only the leading fields)
+   const void* data = &msg;
+   size_t size = ZMQ_NAMING_V1_SIZE;
+   char buf[ZMQ_NAMING_V2_MAX_SIZE];
+   if (impl->mNamingProtocol == 2) {
+      data = buf;
+      size = zmqBridgeMamaNamingMsg_encode(&msg, buf, sizeof(buf));
+   }
 
    wlock_lock(impl->mZmqNamingPub.mLock);
-   int i = zmq_send(impl->mZmqNamingPub.mSocket, &msg, sizeof(msg), 0);
-   if (i != sizeof(msg)) {
+   int i = zmq_send(impl->mZmqNamingPub.mSocket, data, size, 0);
+   if ((i < 0) || (i != (int) size)) {
       MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Failed to publish endpoints: prog=%s host=%s pid=%ld pub=%s", msg.mProgName, msg.mHost, msg.mPid, msg.mEndPointAddr);
       status = MAMA_STATUS_PLATFORM;
    }
    else {
       MAMA_LOG(getNamingLogLevel(msg.mType), "Published endpoint msg: type=%c prog=%s host=%s uuid=%s pid=%ld topic=%s pub=%s", msg.mType, msg.mProgName, msg.mHost, msg.mUuid, msg.mPid, msg.mTopic, msg.mEndPointAddr);
+      if (msg.mType != 'h') {
+         impl->mLastFullNamingMsg = getMillis();
+      }
+   }
+   wlock_unlock(impl->mZmqNamingPub.mLock);
+
+   return status;
+}
+
+
+// asks the peer w/uuid to (re-)send its details (v2 only)
+mama_status zmqBridgeMamaTransportImpl_sendNamingRequest(zmqTransportBridge* impl, const char* uuid)
+{
+   zmqNamingMsg msg;
+   memset(&msg, '\0', sizeof(msg));
+   msg.mType = 'R';
+   wmStrSizeCpy(msg.mUuid, uuid, sizeof(msg.mUuid));
+
+   char buf[ZMQ_NAMING_V2_MAX_SIZE];
+   size_t size = zmqBridgeMamaNamingMsg_encode(&msg, buf, sizeof(buf));
+
+   mama_status status = MAMA_STATUS_OK;
+   wlock_lock(impl->mZmqNamingPub.mLock);
+   if (zmq_send(impl->mZmqNamingPub.mSocket, buf, size, 0) != (int) size) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "Failed to publish naming request for uuid=%s", uuid);
+      status = MAMA_STATUS_PLATFORM;
    }
    wlock_unlock(impl->mZmqNamingPub.mLock);
 
@@ -1525,48 +2514,329 @@ mama_status zmqBridgeMamaTransportImpl_sendEndpointsMsg(zmqTransportBridge* impl
 }
 
 
-// publishes endpoint message continuously until we get it back
+// connects data socket to peer (sub => pub), or reads from its shm ring -- returns endpoint (or ring) in pEndpoint
+mama_status zmqBridgeMamaTransportImpl_connectPeer(zmqTransportBridge* impl, zmqNamingMsg* peer, const char** pEndpoint)
+{
+   *pEndpoint = peer->mShmRingName;
+   if (zmqBridgeMamaTransportImpl_attachShmRing(impl, peer) != MAMA_STATUS_OK) {
+      peer->mShmRingName[0] = '\0';
+      *pEndpoint = zmqBridgeMamaTransportImpl_selectEndpoint(impl, peer);
+      CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_connectSocket(&impl->mZmqDataSub, *pEndpoint, impl->mReconnectInterval, impl->mHeartbeatInterval));
+   }
+   return MAMA_STATUS_OK;
+}
+
+
+// undoes connectPeer (the peer remains in the peer table)
+void zmqBridgeMamaTransportImpl_disconnectPeer(zmqTransportBridge* impl, const zmqNamingMsg* peer)
+{
+   if (peer->mShmRingName[0] != '\0') {
+      zmqBridgeMamaTransportImpl_detachShmRing(impl, peer->mShmRingName);
+   }
+   else {
+      zmqBridgeMamaTransportImpl_disconnectSocket(&impl->mZmqDataSub, (peer->mIpcEndPointAddr[0] != '\0') ? peer->mIpcEndPointAddr : peer->mEndPointAddr);
+   }
+}
+
+
+// returns the cheapest endpoint that can be used to reach the peer
+// NOTE: clears the ipc endpoint in the peer msg if it is not used, so that the same endpoint
+// can be determined again on disconnect
+const char* zmqBridgeMamaTransportImpl_selectEndpoint(zmqTransportBridge* impl, zmqNamingMsg* pMsg)
+{
+   if ((impl->mIpcEndpoints == 1) && (pMsg->mIpcEndPointAddr[0] != '\0') && (strcmp(pMsg->mHost, impl->mHost) == 0)) {
+      // hostnames are not necessarily unique (e.g., containers), so make sure the endpoint is actually visible
+      const char* path = pMsg->mIpcEndPointAddr + strlen("ipc://");
+      if (access(path, F_OK) == 0) {
+         return pMsg->mIpcEndPointAddr;
+      }
+      MAMA_LOG(log_level_naming, "ipc endpoint %s not reachable from this host -- using %s", pMsg->mIpcEndPointAddr, pMsg->mEndPointAddr);
+   }
+
+   pMsg->mIpcEndPointAddr[0] = '\0';
+   return pMsg->mEndPointAddr;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// shm rings
+// The following must only be called from the dispatch thread.
+
+// starts reading from a same-host peer's shm ring, if possible
+mama_status zmqBridgeMamaTransportImpl_attachShmRing(zmqTransportBridge* impl, const zmqNamingMsg* pMsg)
+{
+   if ((impl->mShmRingEnabled == 0) || (pMsg->mShmRingName[0] == '\0') || (strcmp(pMsg->mHost, impl->mHost) != 0)) {
+      return MAMA_STATUS_NOT_FOUND;
+   }
+
+   zmqShmRing** readers = realloc(impl->mShmReaders, (impl->mNumShmReaders + 1) * sizeof(zmqShmRing*));
+   if (readers == NULL) {
+      return MAMA_STATUS_NOMEM;
+   }
+   impl->mShmReaders = readers;
+
+   // the ring may not be visible even though the host name matches (e.g., containers)
+   char wakeName[ZMQ_MAX_SHM_NAME_LENGTH +1];
+   snprintf(wakeName, sizeof(wakeName), "oz.%s", impl->mUuid);
+   CALL_MAMA_FUNC(zmqBridgeMamaShmRing_attach(&impl->mShmReaders[impl->mNumShmReaders], pMsg->mShmRingName,
+      (impl->mShmWakeFd >= 0) ? wakeName : NULL));
+   impl->mNumShmReaders++;
+
+   MAMA_LOG(log_level_naming, "Attached to shm ring:%s", pMsg->mShmRingName);
+   return MAMA_STATUS_OK;
+}
+
+
+void zmqBridgeMamaTransportImpl_detachShmRing(zmqTransportBridge* impl, const char* name)
+{
+   for (int i = 0; i < impl->mNumShmReaders; ++i) {
+      if (strcmp(zmqBridgeMamaShmRing_getName(impl->mShmReaders[i]), name) == 0) {
+         long long lost = zmqBridgeMamaShmRing_getLost(impl->mShmReaders[i]);
+         if (lost > 0) {
+            MAMA_LOG(MAMA_LOG_LEVEL_WARN, "Reader was overrun %lld times on shm ring:%s", lost, name);
+         }
+         zmqBridgeMamaShmRing_detach(impl->mShmReaders[i]);
+         impl->mShmReaders[i] = impl->mShmReaders[--impl->mNumShmReaders];
+         return;
+      }
+   }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// naming startup
+// Once connected to the proxy, we publish our endpoint msg until we get it back, at which point the dispatch thread
+// sets mNamingConnected and signals mNamingCond.  The msg is resent w/exponential backoff (from
+// ZMQ_NAMING_MIN_BACKOFF up to naming.connect_interval), so that we start as soon as the proxy is reachable,
+// without flooding it when it is not.  The total time allowed is naming.connect_retries * naming.connect_interval.
+
+// sets mNamingConnected (or, if stop is set, tells waiters to give up) and wakes any waiters
+void zmqBridgeMamaTransportImpl_signalNaming(zmqTransportBridge* impl, int stop)
+{
+   pthread_mutex_lock(&impl->mNamingLock);
+   if (stop) {
+      impl->mNamingStopped = 1;
+   }
+   else {
+      wInterlocked_set(1, &impl->mNamingConnected);
+   }
+   pthread_cond_broadcast(&impl->mNamingCond);
+   pthread_mutex_unlock(&impl->mNamingLock);
+}
+
+
+// waits up to timeoutMicros for mNamingConnected -- returns 1 if connected, 0 on timeout, -1 if stopped
+int zmqBridgeMamaTransportImpl_waitNaming(zmqTransportBridge* impl, uint64_t timeoutMicros)
+{
+   uint64_t wakeNanos = getNanos() + timeoutMicros * 1000;
+   struct timespec wake;
+   #if defined __APPLE__
+   // no monotonic condvars on macOS -- convert to realtime
+   clock_gettime(CLOCK_REALTIME, &wake);
+   wakeNanos += ((uint64_t) wake.tv_sec * 1000000000 + wake.tv_nsec) - getNanos();
+   #endif
+   wake.tv_sec = wakeNanos / 1000000000;
+   wake.tv_nsec = wakeNanos % 1000000000;
+
+   int result = 0;
+   pthread_mutex_lock(&impl->mNamingLock);
+   while (1) {
+      if (wInterlocked_read(&impl->mNamingConnected) == 1) {
+         result = 1;
+         break;
+      }
+      if (impl->mNamingStopped) {
+         result = -1;
+         break;
+      }
+      if (pthread_cond_timedwait(&impl->mNamingCond, &impl->mNamingLock, &wake) == ETIMEDOUT) {
+         result = (wInterlocked_read(&impl->mNamingConnected) == 1) ? 1 : 0;
+         break;
+      }
+   }
+   pthread_mutex_unlock(&impl->mNamingLock);
+
+   return result;
+}
+
+
+// publishes endpoint message (w/backoff) until we get it back
 void* zmqBridgeMamaTransportImpl_publishEndpoints(void* closure)
 {
    zmqTransportBridge* impl = (zmqTransportBridge*) closure;
 
    wInterlocked_set(0, &impl->mNamingConnected);
-   int retries = impl->mNamingConnectRetries;
-   while ( (--retries > 0) && (1 == wInterlocked_read(&impl->mIsDispatching)) ) {
+   uint64_t backoff = ZMQ_NAMING_MIN_BACKOFF;
+   uint64_t maxBackoff = (impl->mNamingConnectInterval > ZMQ_NAMING_MIN_BACKOFF) ? impl->mNamingConnectInterval : ZMQ_NAMING_MIN_BACKOFF;
+   uint64_t deadline = getNanos() + (uint64_t) impl->mNamingConnectRetries * impl->mNamingConnectInterval * 1000;
+   while ((1 == wInterlocked_read(&impl->mIsDispatching)) && (getNanos() < deadline)) {
       zmqBridgeMamaTransportImpl_sendEndpointsMsg(impl, 'C');
-      if (wInterlocked_read(&impl->mNamingConnected) == 1) {
+      int rc = zmqBridgeMamaTransportImpl_waitNaming(impl, backoff);
+      if (rc == 1) {
          MAMA_LOG(MAMA_LOG_LEVEL_FINER, "Successfully connected to proxy");
          return NULL;
       }
+      if (rc < 0) {
+         break;
+      }
 
-      usleep(impl->mNamingConnectInterval);
+      backoff = (backoff * 2 < maxBackoff) ? backoff * 2 : maxBackoff;
    }
 
    return NULL;
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+// direct replies
+// Peers that advertise a reply endpoint are connected to from the replyPub (ROUTER) socket, w/a routing id derived
+// from the peer's uuid, so that replies can be addressed to the requesting peer using the uuid in the reply handle.
+// Connections are only made on the first direct send to a peer, so that discovering peers doesn't connect to
+// every one of them.
+
+// records the peer's reply endpoint (must be called from the dispatch thread)
+mama_status zmqBridgeMamaTransportImpl_addDirect(zmqTransportBridge* impl, const zmqNamingMsg* pMsg)
+{
+   if ((impl->mDirectReplies == 0) || (pMsg->mReplyEndPointAddr[0] == '\0')) {
+      return MAMA_STATUS_NOT_FOUND;
+   }
+
+   zmqDirectPeer* peer = calloc(1, sizeof(zmqDirectPeer));
+   if (peer == NULL) {
+      return MAMA_STATUS_NOMEM;
+   }
+   wmStrSizeCpy(peer->mUuid, pMsg->mUuid, sizeof(peer->mUuid));
+   wmStrSizeCpy(peer->mEndpoint, pMsg->mReplyEndPointAddr, sizeof(peer->mEndpoint));
+
+   wlock_lock(impl->mZmqReplyPub.mLock);
+   zmqDirectPeer* oldPeer = wtable_remove(impl->mDirectPeers, pMsg->mUuid);
+   if (oldPeer != NULL) {
+      if ((oldPeer->mRoutingId[0] != '\0') && (strcmp(oldPeer->mEndpoint, peer->mEndpoint) == 0)) {
+         // already connected to the same endpoint
+         *peer = *oldPeer;
+      }
+      else if (oldPeer->mRoutingId[0] != '\0') {
+         zmq_disconnect(impl->mZmqReplyPub.mSocket, oldPeer->mEndpoint);
+      }
+      free(oldPeer);
+   }
+   wtable_insert(impl->mDirectPeers, pMsg->mUuid, peer);
+   wlock_unlock(impl->mZmqReplyPub.mLock);
+
+   return MAMA_STATUS_OK;
+}
+
+
+// connects the reply socket to peer (must be called w/mZmqReplyPub's lock held)
+mama_status zmqBridgeMamaTransportImpl_connectDirect(zmqTransportBridge* impl, zmqDirectPeer* peer)
+{
+   // the pipe from an earlier connection to the same peer may not have been reaped yet, so each connection gets
+   // a new routing id (which applies only to the next connect)
+   char routingId[sizeof(peer->mRoutingId)];
+   snprintf(routingId, sizeof(routingId), "%s.%08x", peer->mUuid, ++impl->mDirectConnects);
+   int rc = zmq_setsockopt(impl->mZmqReplyPub.mSocket, ZMQ_CONNECT_ROUTING_ID, routingId, strlen(routingId));
+   if (0 != rc) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "zmq_setsockopt(%p, ZMQ_CONNECT_ROUTING_ID, %s) failed: %d(%s)", impl->mZmqReplyPub.mSocket, routingId, zmq_errno(), zmq_strerror(errno));
+      return MAMA_STATUS_PLATFORM;
+   }
+
+   // NOTE: the pipe to the peer is created immediately (ZMQ_IMMEDIATE is not set), so msgs sent before the
+   // connection completes are queued, rather than failing
+   rc = zmq_connect(impl->mZmqReplyPub.mSocket, peer->mEndpoint);
+   if (0 != rc) {
+      MAMA_LOG(MAMA_LOG_LEVEL_ERROR, "zmq_connect(%p, %s) failed: %d(%s)", impl->mZmqReplyPub.mSocket, peer->mEndpoint, zmq_errno(), zmq_strerror(errno));
+      return MAMA_STATUS_PLATFORM;
+   }
+
+   strcpy(peer->mRoutingId, routingId);
+   MAMA_LOG(log_level_naming, "Connecting reply socket to:%s", peer->mEndpoint);
+
+   return MAMA_STATUS_OK;
+}
+
+
+void zmqBridgeMamaTransportImpl_disconnectDirect(zmqTransportBridge* impl, const char* uuid)
+{
+   if (impl->mDirectReplies == 0) {
+      return;
+   }
+
+   wlock_lock(impl->mZmqReplyPub.mLock);
+   zmqDirectPeer* peer = wtable_remove(impl->mDirectPeers, uuid);
+   if ((peer != NULL) && (peer->mRoutingId[0] == '\0')) {
+      // never connected
+      free(peer);
+   }
+   else if (peer != NULL) {
+      // subsequent replies to the peer will not be sent directly
+      if (zmq_disconnect(impl->mZmqReplyPub.mSocket, peer->mEndpoint) != 0) {
+         MAMA_LOG(MAMA_LOG_LEVEL_WARN, "zmq_disconnect(%p, %s) failed: %d(%s)", impl->mZmqReplyPub.mSocket, peer->mEndpoint, zmq_errno(), zmq_strerror(errno));
+      }
+      free(peer);
+
+      // as for dataPub (see KICK_DATAPUB), give the socket a chance to reap the disconnected pipe
+      size_t events_size = sizeof(uint32_t);
+      uint32_t events;
+      zmq_getsockopt(impl->mZmqReplyPub.mSocket, ZMQ_EVENTS, &events, &events_size);
+   }
+   wlock_unlock(impl->mZmqReplyPub.mLock);
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 // socket monitor
+// Monitor events are normally read by the transport's monitor thread -- for transports dispatched by a reactor, the
+// reactor polls the monitor sockets along w/the transport's other sockets instead.
+
+// opens (PAIR) sockets to receive the monitor events of each of the monitored sockets
+void zmqBridgeMamaTransportImpl_openMonitors(zmqTransportBridge* impl, void** monitors)
+{
+   zmqSocket* sockets[ZMQ_MONITORED_SOCKETS] = { &impl->mZmqDataPub, &impl->mZmqDataSub, &impl->mZmqNamingPub, &impl->mZmqNamingSub };
+   for (int i = 0; i < ZMQ_MONITORED_SOCKETS; ++i) {
+      char endpoint[ZMQ_MAX_ENDPOINT_LENGTH +1];
+      zmqBridgeMamaTransportImpl_monitorEndpoint(endpoint, sizeof(endpoint), gMonitoredNames[i], sockets[i]);
+      monitors[i] = zmq_socket(impl->mZmqContext, ZMQ_PAIR);
+      zmq_connect(monitors[i], endpoint);
+   }
+}
+
+
+void zmqBridgeMamaTransportImpl_closeMonitors(void** monitors)
+{
+   for (int i = 0; i < ZMQ_MONITORED_SOCKETS; ++i) {
+      if (monitors[i] != NULL) {
+         zmq_close(monitors[i]);
+         monitors[i] = NULL;
+      }
+   }
+}
+
+
+// reads events from monitor sockets that zmq_poll reported as readable
+// (items are as filled in by pollItems -- does nothing if the transport's monitor sockets are not being polled there)
+void zmqBridgeMamaTransportImpl_dispatchMonitors(zmqTransportBridge* impl, zmq_pollitem_t* items)
+{
+   for (int i = 0; (i < ZMQ_MONITORED_SOCKETS) && (impl->mMonitorSockets[i] != NULL); ++i) {
+      if (items[i].revents & ZMQ_POLLIN) {
+         zmqBridgeMamaTransportImpl_monitorEvent_v2(impl, items[i].socket, gMonitoredNames[i]);
+      }
+   }
+}
+
+
 void* zmqBridgeMamaTransportImpl_monitorThread(void* closure)
 {
    zmqTransportBridge* impl = (zmqTransportBridge*) closure;
 
-   void* dataPubMonitor = zmq_socket(impl->mZmqContext, ZMQ_PAIR);
-   zmq_connect(dataPubMonitor, "inproc://dataPub");
-   void* dataSubMonitor = zmq_socket(impl->mZmqContext, ZMQ_PAIR);
-   zmq_connect(dataSubMonitor, "inproc://dataSub");
-   void* namingPubMonitor = zmq_socket(impl->mZmqContext, ZMQ_PAIR);
-   zmq_connect(namingPubMonitor, "inproc://namingPub");
-   void* namingSubMonitor = zmq_socket(impl->mZmqContext, ZMQ_PAIR);
-   zmq_connect(namingSubMonitor, "inproc://namingSub");
+   void* monitors[ZMQ_MONITORED_SOCKETS];
+   zmqBridgeMamaTransportImpl_openMonitors(impl, monitors);
 
    while (1 == wInterlocked_read(&impl->mIsMonitoring)) {
       zmq_pollitem_t items[] = {
-         { dataPubMonitor,                   0, ZMQ_POLLIN , 0},
-         { dataSubMonitor,                   0, ZMQ_POLLIN , 0},
-         { namingPubMonitor,                 0, ZMQ_POLLIN , 0},
-         { namingSubMonitor,                 0, ZMQ_POLLIN , 0},
+         { monitors[0],                      0, ZMQ_POLLIN , 0},
+         { monitors[1],                      0, ZMQ_POLLIN , 0},
+         { monitors[2],                      0, ZMQ_POLLIN , 0},
+         { monitors[3],                      0, ZMQ_POLLIN , 0},
          { impl->mZmqMonitorSub.mSocket,     0, ZMQ_POLLIN , 0},
       };
       int rc = zmq_poll(items, 5, -1);
@@ -1575,27 +2845,17 @@ void* zmqBridgeMamaTransportImpl_monitorThread(void* closure)
          continue;
       }
 
-      if (items[0].revents & ZMQ_POLLIN) {
-         zmqBridgeMamaTransportImpl_monitorEvent_v2(dataPubMonitor, "dataPub");
-      }
-      if (items[1].revents & ZMQ_POLLIN) {
-         zmqBridgeMamaTransportImpl_monitorEvent_v2(dataSubMonitor, "dataSub");
-      }
-      if (items[2].revents & ZMQ_POLLIN) {
-         zmqBridgeMamaTransportImpl_monitorEvent_v2(namingPubMonitor, "namingPub");
-      }
-      if (items[3].revents & ZMQ_POLLIN) {
-         zmqBridgeMamaTransportImpl_monitorEvent_v2(namingSubMonitor, "namingSub");
+      for (int i = 0; i < ZMQ_MONITORED_SOCKETS; ++i) {
+         if (items[i].revents & ZMQ_POLLIN) {
+            zmqBridgeMamaTransportImpl_monitorEvent_v2(impl, monitors[i], gMonitoredNames[i]);
+         }
       }
       if (items[4].revents & ZMQ_POLLIN) {
          // nothing to do -- just loop around and check mIsMonitoring flag
       }
    }
 
-   zmq_close(dataPubMonitor);
-   zmq_close(dataSubMonitor);
-   zmq_close(namingPubMonitor);
-   zmq_close(namingSubMonitor);
+   zmqBridgeMamaTransportImpl_closeMonitors(monitors);
 
    return NULL;
 }
@@ -1603,11 +2863,16 @@ void* zmqBridgeMamaTransportImpl_monitorThread(void* closure)
 
 mama_status zmqBridgeMamaTransportImpl_startMonitor(zmqTransportBridge* impl)
 {
+   if (impl->mNumReactors > 0) {
+      // the reactor polls the monitor sockets, so no need for a thread
+      zmqBridgeMamaTransportImpl_openMonitors(impl, impl->mMonitorSockets);
+      return MAMA_STATUS_OK;
+   }
 
    CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_createSocket(impl->mZmqContext, &impl->mZmqMonitorSub, ZMQ_SERVER, "monitorSub", 0));
-   CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_bindSocket(&impl->mZmqMonitorSub,  ZMQ_MONITOR_ENDPOINT, NULL));
+   CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_bindSocket(&impl->mZmqMonitorSub,  impl->mMonitorEndpoint, NULL));
    CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_createSocket(impl->mZmqContext, &impl->mZmqMonitorPub, ZMQ_CLIENT, "monitorPub", 0));
-   CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_connectSocket(&impl->mZmqMonitorPub,  ZMQ_MONITOR_ENDPOINT, 0, 0));
+   CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_connectSocket(&impl->mZmqMonitorPub,  impl->mMonitorEndpoint, 0, 0));
 
    /* Set the transport bridge mIsMonitoring to true. */
    wInterlocked_initialize(&impl->mIsMonitoring);
@@ -1626,6 +2891,12 @@ mama_status zmqBridgeMamaTransportImpl_startMonitor(zmqTransportBridge* impl)
 
 mama_status zmqBridgeMamaTransportImpl_stopMonitor(zmqTransportBridge* impl)
 {
+   if (impl->mNumReactors > 0) {
+      // reactor has already stopped polling them (see zmqBridgeMamaTransportImpl_stop)
+      zmqBridgeMamaTransportImpl_closeMonitors(impl->mMonitorSockets);
+      return MAMA_STATUS_OK;
+   }
+
    wInterlocked_set(0, &impl->mIsMonitoring);
 
    // send command to force zmq_poll call to return and eval mIsMonitoring
@@ -1643,15 +2914,15 @@ mama_status zmqBridgeMamaTransportImpl_stopMonitor(zmqTransportBridge* impl)
    }
 
    // TODO: resolve https://github.com/zeromq/libzmq/issues/3152
-   CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_disconnectSocket(&impl->mZmqMonitorPub, ZMQ_MONITOR_ENDPOINT));
+   CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_disconnectSocket(&impl->mZmqMonitorPub, impl->mMonitorEndpoint));
    CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_destroySocket(&impl->mZmqMonitorPub));
-   CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_unbindSocket(&impl->mZmqMonitorSub, ZMQ_MONITOR_ENDPOINT));
+   CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_unbindSocket(&impl->mZmqMonitorSub, impl->mMonitorEndpoint));
    CALL_MAMA_FUNC(zmqBridgeMamaTransportImpl_destroySocket(&impl->mZmqMonitorSub));
 
    return MAMA_STATUS_OK;
 }
 
-uint64_t zmqBridgeMamaTransportImpl_monitorEvent_v2(void *socket, const char* socketName)
+uint64_t zmqBridgeMamaTransportImpl_monitorEvent_v2(zmqTransportBridge* impl, void *socket, const char* socketName)
 {
     //  First frame in message contains event number
     zmq_msg_t msg;
@@ -1715,5 +2986,14 @@ uint64_t zmqBridgeMamaTransportImpl_monitorEvent_v2(void *socket, const char* so
    int logLevel = get_zmqEventLogLevel(event);
    MAMA_LOG(logLevel, "name:%s event:%s value:%llu local:%s remote:%s", socketName, eventName, value, local_address, remote_address);
 
+   // let the dispatch thread know, so it can evict the peer sooner if it has stopped beaconing
+   if ((impl->mMissedBeacons > 0) && (event == ZMQ_EVENT_DISCONNECTED) && (strcmp(socketName, "dataSub") == 0)) {
+      zmqControlMsg controlMsg;
+      memset(&controlMsg, '\0', sizeof(controlMsg));
+      controlMsg.command = 'd';
+      wmStrSizeCpy(controlMsg.arg1, (remote_address[0] != '\0') ? remote_address : local_address, sizeof(controlMsg.arg1));
+      zmqBridgeMamaTransportImpl_sendCommand(impl, &controlMsg, sizeof(controlMsg));
+   }
+
    return 0;
 }
@@ -76,11 +76,18 @@ mama_status zmqBridgeMamaTransportImpl_bindOrConnect(void* socket, const char* u
 // message processing
 //
 static void* zmqBridgeMamaTransportImpl_dispatchThread(void* closure);
+// the steps of the dispatch loop, for use by reactors (see reactor.h)
+void zmqBridgeMamaTransportImpl_dispatchBegin(zmqTransportBridge* impl);
+int zmqBridgeMamaTransportImpl_pollItems(zmqTransportBridge* impl, zmq_pollitem_t* items);
+long zmqBridgeMamaTransportImpl_pollTimeout(zmqTransportBridge* impl);
+void zmqBridgeMamaTransportImpl_dispatchReady(zmqTransportBridge* impl, zmq_pollitem_t* items, zmq_msg_t* zmsg);
+void zmqBridgeMamaTransportImpl_dispatchEnd(zmqTransportBridge* impl);
 //
 mama_status MAMACALLTYPE  zmqBridgeMamaTransportImpl_dispatchNamingMsg(zmqTransportBridge* zmqTransport, zmq_msg_t* zmsg);
+mama_status zmqBridgeMamaTransportImpl_dispatchSnapshotMsg(zmqTransportBridge* zmqTransport, zmq_msg_t* zmsg);
 mama_status MAMACALLTYPE  zmqBridgeMamaTransportImpl_dispatchNormalMsg(zmqTransportBridge* zmqTransport, zmq_msg_t* zmsg);
 mama_status MAMACALLTYPE zmqBridgeMamaTransportImpl_dispatchControlMsg(zmqTransportBridge* impl, zmq_msg_t* zmsg);
-mama_status MAMACALLTYPE zmqBridgeMamaTransportImpl_dispatchSubMsg(zmqTransportBridge* impl, const char* subject, zmq_msg_t* zmsg);
+mama_status MAMACALLTYPE zmqBridgeMamaTransportImpl_dispatchSubMsg(zmqTransportBridge* impl, const char* subject, int isInterned, zmq_msg_t* zmsg);
 mama_status MAMACALLTYPE zmqBridgeMamaTransportImpl_dispatchInboxMsg(zmqTransportBridge* impl, const char* subject, zmq_msg_t* zmsg);
 //
 static void MAMACALLTYPE  zmqBridgeMamaTransportImpl_subCallback(mamaQueue queue, void* closure);
@@ -91,19 +98,57 @@ memoryNode* MAMACALLTYPE zmqBridgeMamaTransportImpl_allocTransportMsg(zmqTranspo
 
 mama_status MAMACALLTYPE zmqBridgeMamaTransportImpl_subscribe(void* socket, const char* topic);
 mama_status MAMACALLTYPE zmqBridgeMamaTransportImpl_unsubscribe(void* socket, const char* topic);
+mama_status MAMACALLTYPE zmqBridgeMamaTransportImpl_subscribeBinary(void* socket, const void* prefix, size_t size);
+mama_status MAMACALLTYPE zmqBridgeMamaTransportImpl_unsubscribeBinary(void* socket, const void* prefix, size_t size);
 
 // naming-style transports publish their endpoints so peers can connect
 void* MAMACALLTYPE zmqBridgeMamaTransportImpl_publishEndpoints(void* closure);
+void zmqBridgeMamaTransportImpl_signalNaming(zmqTransportBridge* impl, int stop);
+int zmqBridgeMamaTransportImpl_waitNaming(zmqTransportBridge* impl, uint64_t timeoutMicros);
 mama_status zmqBridgeMamaTransportImpl_sendEndpointsMsg(zmqTransportBridge* impl, char command);
+mama_status zmqBridgeMamaTransportImpl_sendNamingRequest(zmqTransportBridge* impl, const char* uuid);
+const char* zmqBridgeMamaTransportImpl_selectEndpoint(zmqTransportBridge* impl, zmqNamingMsg* pMsg);
+mama_status zmqBridgeMamaTransportImpl_connectPeer(zmqTransportBridge* impl, zmqNamingMsg* peer, const char** pEndpoint);
+void zmqBridgeMamaTransportImpl_disconnectPeer(zmqTransportBridge* impl, const zmqNamingMsg* peer);
+mama_status zmqBridgeMamaTransportImpl_removePeer(zmqTransportBridge* impl, const zmqNamingMsg* pMsg);
+
+// discovery pacing
+uint32_t zmqBridgeMamaTransportImpl_jitterBeacon(zmqTransportBridge* impl, uint32_t interval);
+void zmqBridgeMamaTransportImpl_queueConnect(zmqTransportBridge* impl, zmqNamingMsg* peer);
+long zmqBridgeMamaTransportImpl_drainConnects(zmqTransportBridge* impl);
+long zmqBridgeMamaTransportImpl_flushRebroadcast(zmqTransportBridge* impl);
+
+// peer liveness
+void zmqBridgeMamaTransportImpl_touchPeer(zmqNamingMsg* peer);
+void zmqBridgeMamaTransportImpl_markDisconnected(zmqTransportBridge* impl, const char* endpoint);
+void zmqBridgeMamaTransportImpl_evictPeers(zmqTransportBridge* impl);
+
+// stats
+void* zmqBridgeMamaTransportImpl_statsThread(void* closure);
+void zmqBridgeMamaTransportImpl_publishStats(zmqTransportBridge* impl);
+
+// shm rings for same-host peers
+mama_status zmqBridgeMamaTransportImpl_attachShmRing(zmqTransportBridge* impl, const zmqNamingMsg* pMsg);
+void zmqBridgeMamaTransportImpl_detachShmRing(zmqTransportBridge* impl, const char* name);
+
+// direct replies to peers that advertise a reply endpoint
+mama_status zmqBridgeMamaTransportImpl_addDirect(zmqTransportBridge* impl, const zmqNamingMsg* pMsg);
+mama_status zmqBridgeMamaTransportImpl_connectDirect(zmqTransportBridge* impl, zmqDirectPeer* peer);
+void zmqBridgeMamaTransportImpl_disconnectDirect(zmqTransportBridge* impl, const char* uuid);
 
 // wildcard support
 typedef struct zmqWildcardClosure {
    const char* subject;
+   int         isInterned;
    zmq_msg_t*  zmsg;
    int         found;
 } zmqWildcardClosure;
 void zmqBridgeMamaTransportImpl_matchWildcards(wList dummy, zmqSubscription** pSubscription, zmqWildcardClosure* closure);
 
+// enqueue, w/stats and latency stats
+void zmqBridgeMamaTransportImpl_enqueueMsg(zmqTransportBridge* impl, void* queue, mamaQueueEnqueueCB callback, zmqTransportMsg* tmsg);
+void zmqBridgeMamaTransportImpl_recordLatency(zmqTransportMsg* tmsg, void* zmqQueue, uint64_t dequeueTime, uint64_t callbackTime);
+
 typedef struct zmqFindWildcardClosure {
    const char*       mEndpointIdentifier;
    zmqSubscription*  mSubscription;
@@ -114,17 +159,30 @@ void zmqBridgeMamaTransportImpl_unregisterWildcard(zmqTransportBridge* impl, zmq
 
 // inbox support
 mama_status zmqBridgeMamaTransportImpl_getInboxSubject(zmqTransportBridge* impl, const char** inboxSubject);
+zmqInboxImpl* zmqBridgeMamaTransportImpl_findInbox(zmqTransportBridge* impl, const char* inboxName);
 mama_status zmqBridgeMamaTransportImpl_registerInbox(zmqTransportBridge* impl, zmqInboxImpl* inbox);
 mama_status zmqBridgeMamaTransportImpl_unregisterInbox(zmqTransportBridge* impl, zmqInboxImpl* inbox);
 
+// sends a msg (which must have its send subject set) on the transport's data publisher (see publisher.c)
+mama_status zmqBridgeMamaPublisherImpl_sendMsg(zmqTransportBridge* transport, msgBridge bridgeMsg, mamaMsg mamaMsg);
+// sends a reply directly to the requesting peer if possible, otherwise as per sendMsg
+// (returns MAMA_STATUS_IO_ERROR if the peer accepts direct replies, but is no longer reachable)
+mama_status zmqBridgeMamaPublisherImpl_sendReply(zmqTransportBridge* transport, msgBridge bridgeMsg, mamaMsg mamaMsg, const char* replyHandle);
+// sends a serialized msg directly to the peer w/uuid, and counts it as okStat if successful
+// (returns MAMA_STATUS_IO_ERROR if the peer is not reachable, in which case the msg is not consumed)
+mama_status zmqBridgeMamaPublisherImpl_sendDirect(zmqTransportBridge* transport, const char* uuid, zmq_msg_t* zmq_msg, int okStat);
+
 // control socket
 mama_status zmqBridgeMamaTransportImpl_sendCommand(zmqTransportBridge* impl, zmqControlMsg* msg, int msgSize);
 
 // socket monitor
 void* zmqBridgeMamaTransportImpl_monitorThread(void* closure);
+void zmqBridgeMamaTransportImpl_openMonitors(zmqTransportBridge* impl, void** monitors);
+void zmqBridgeMamaTransportImpl_closeMonitors(void** monitors);
+void zmqBridgeMamaTransportImpl_dispatchMonitors(zmqTransportBridge* impl, zmq_pollitem_t* items);
 mama_status zmqBridgeMamaTransportImpl_startMonitor(zmqTransportBridge* impl);
 mama_status zmqBridgeMamaTransportImpl_stopMonitor(zmqTransportBridge* impl);
-uint64_t zmqBridgeMamaTransportImpl_monitorEvent_v2(void *socket, const char* socketName);
+uint64_t zmqBridgeMamaTransportImpl_monitorEvent_v2(zmqTransportBridge* impl, void *socket, const char* socketName);
 
 
 #if defined(__cplusplus)
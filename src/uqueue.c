@@ -2,6 +2,10 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
+#if defined __linux__
+#include <semaphore.h>
+#endif
 
 #include <mama/integration/types.h>
 #include <mama/mama.h>
@@ -10,6 +14,7 @@
 #include <wombat/wInterlocked.h>
 #include "uqueue.h"
 #include "zmqdefs.h"
+#include "util.h"
 
 #define UQ_REMOVE(impl, ele)                  \
     (ele)->mPrev->mNext = (ele)->mNext;       \
@@ -26,6 +31,7 @@ typedef struct uQueueItem_
     wombatQueueCb         mCb;
     void*                 mData;
     uint8_t               mIsMsg;
+    uint64_t              mEnqueueTime; /* only w/maxAge */
     union {
         void              *mClosure;
         zmqTransportMsg   mMsg;
@@ -44,6 +50,13 @@ typedef struct
     uint32_t             mMaxSize;
     uint32_t             mChunkSize;
     int32_t              mCurrSize;
+    int32_t              mHighWater; /* max value of mCurrSize */
+
+    /* residency alarm */
+    uint64_t             mMaxAge;
+    uQueueAgeCb          mAgeCb;
+    void*                mAgeClosure;
+    uint8_t              mIsStale;  /* dispatch thread only */
 
     /* Dummy nodes for free, head and tail */
     uQueueItem   mHead;
@@ -199,6 +212,7 @@ uQueue_enqueue (uQueue queue,
    item->mCb      = cb;
    item->mData    = data;
    item->mIsMsg   = isMsg;
+   item->mEnqueueTime = (impl->mMaxAge > 0) ? getNanos() : 0;
 
    if (isMsg)
    {
@@ -216,6 +230,10 @@ uQueue_enqueue (uQueue queue,
    item->mPrev->mNext       = item;
    impl->mTail.mPrev        = item;
    ++impl->mCurrSize;
+   if (impl->mCurrSize > impl->mHighWater)
+   {
+      __atomic_store_n(&impl->mHighWater, impl->mCurrSize, __ATOMIC_RELAXED);
+   }
 
    /* Notify next available thread that an item is ready */
    wsem_post (&impl->mSem);
@@ -234,6 +252,71 @@ uQueue_getSize (uQueue queue, int* size)
 
 }
 
+wombatQueueStatus
+uQueue_getHighWater (uQueue queue, int* size)
+{
+   uQueueImpl* impl    = (uQueueImpl*)queue;
+   *size = __atomic_load_n(&impl->mHighWater, __ATOMIC_RELAXED);
+
+   return WOMBAT_QUEUE_OK;
+}
+
+wombatQueueStatus
+uQueue_setMaxAge (uQueue queue, uint64_t maxAge, uQueueAgeCb cb, void* closure)
+{
+   uQueueImpl* impl    = (uQueueImpl*)queue;
+
+   wthread_mutex_lock (&impl->mLock);
+   impl->mAgeCb      = cb;
+   impl->mAgeClosure = closure;
+   impl->mMaxAge     = (cb != NULL) ? maxAge : 0;
+   wthread_mutex_unlock (&impl->mLock);
+
+   return WOMBAT_QUEUE_OK;
+}
+
+wombatQueueStatus
+uQueue_getOldestAge (uQueue queue, uint64_t* age)
+{
+   uQueueImpl* impl    = (uQueueImpl*)queue;
+
+   *age = 0;
+   wthread_mutex_lock (&impl->mLock);
+   if ((impl->mHead.mNext != &impl->mTail) && (impl->mHead.mNext->mEnqueueTime != 0))
+   {
+      *age = getNanos() - impl->mHead.mNext->mEnqueueTime;
+   }
+   wthread_mutex_unlock (&impl->mLock);
+
+   return WOMBAT_QUEUE_OK;
+}
+
+/* waits for the semaphore until deadline, returning non-zero on timeout */
+static int
+uQueueImpl_waitUntil (uQueueImpl* impl, uint64_t deadline)
+{
+   uint64_t now = getNanos ();
+   uint64_t remaining = (deadline > now) ? deadline - now : 0;
+#if defined __linux__
+   /* wsem_t is sem_t on Linux -- sem_timedwait has nanosecond resolution, but uses CLOCK_REALTIME */
+   struct timespec ts;
+   clock_gettime (CLOCK_REALTIME, &ts);
+   uint64_t wake = (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec + remaining;
+   ts.tv_sec = wake / 1000000000;
+   ts.tv_nsec = wake % 1000000000;
+   while (sem_timedwait ((sem_t*) &impl->mSem, &ts) != 0)
+   {
+      if (errno != EINTR)
+         return -1;
+   }
+   return 0;
+#else
+   /* round up, so we never return early */
+   return wsem_timedwait (&impl->mSem, (unsigned int) ((remaining + 999999) / 1000000));
+#endif
+}
+
+/* isTimed: 0 => wait forever, 1 => timout is millis, 2 => timout is deadline */
 static wombatQueueStatus
 uQueue_dispatchInt (uQueue queue, uint8_t isTimed, uint64_t timout)
 {
@@ -244,8 +327,17 @@ uQueue_dispatchInt (uQueue queue, uint8_t isTimed, uint64_t timout)
    zmqTransportMsg  msg;
    void*            closure = NULL;
    void*            data    = NULL;
+   uint64_t         enqueueTime = 0;
+   uint64_t         maxAge  = 0;
+   uQueueAgeCb      ageCb   = NULL;
+   void*            ageClosure = NULL;
 
-   if (isTimed)
+   if (isTimed == 2)
+   {
+      if (uQueueImpl_waitUntil (impl, timout) != 0)
+         return WOMBAT_QUEUE_TIMEOUT;
+   }
+   else if (isTimed)
    {
       if (wsem_timedwait (&impl->mSem, (unsigned int)timout) !=0)
          return WOMBAT_QUEUE_TIMEOUT;
@@ -275,6 +367,10 @@ uQueue_dispatchInt (uQueue queue, uint8_t isTimed, uint64_t timout)
    cb = head->mCb;
    data = head->mData;
    isMsg   = head->mIsMsg;
+   enqueueTime = head->mEnqueueTime;
+   maxAge = impl->mMaxAge;
+   ageCb = impl->mAgeCb;
+   ageClosure = impl->mAgeClosure;
    if (isMsg)
    {
       msg = head->mMsg;
@@ -286,6 +382,25 @@ uQueue_dispatchInt (uQueue queue, uint8_t isTimed, uint64_t timout)
 
    wthread_mutex_unlock (&impl->mLock);
 
+   /* check residency (items enqueued before maxAge was set have no timestamp) */
+   if ((maxAge > 0) && (enqueueTime != 0))
+   {
+      uint64_t age = getNanos() - enqueueTime;
+      if (age > maxAge)
+      {
+         impl->mIsStale = 1;
+         if (ageCb (ageClosure, age, 1, isMsg, isMsg == 1 ? &msg : closure) != 0)
+         {
+            return WOMBAT_QUEUE_OK;
+         }
+      }
+      else if (impl->mIsStale)
+      {
+         impl->mIsStale = 0;
+         ageCb (ageClosure, age, 0, isMsg, isMsg == 1 ? &msg : closure);
+      }
+   }
+
    if (cb)
    {
       cb (data, isMsg == 1 ? &msg : closure);
@@ -306,6 +421,20 @@ uQueue_timedDispatch (uQueue queue, uint64_t timeout)
    return uQueue_dispatchInt (queue, 1, timeout);
 }
 
+wombatQueueStatus
+uQueue_timedDispatchUntil (uQueue queue, uint64_t deadline)
+{
+   return uQueue_dispatchInt (queue, 2, deadline);
+}
+
+wombatQueueStatus
+uQueue_wake (uQueue queue)
+{
+   uQueueImpl* impl = (uQueueImpl*)queue;
+   wsem_post (&impl->mSem);
+   return WOMBAT_QUEUE_OK;
+}
+
 
 /* Static/Private functions */
 static wombatQueueStatus
@@ -3,14 +3,30 @@
 
 typedef void* uQueue;
 
+/* Called on the dispatch thread for each item that waited more than maxAge nanos
+ * to be dispatched (isStale=1), and for the first item after that which did not
+ * (isStale=0).  item is the zmqTransportMsg for msgs, else the closure.  If the
+ * callback returns non-zero for a stale item, the item is dropped (not dispatched),
+ * and the callback is responsible for freeing it.
+ */
+typedef int (*uQueueAgeCb) (void* closure, uint64_t age, uint8_t isStale, uint8_t isMsg, void* item);
+
 wombatQueueStatus uQueue_allocate (uQueue *result);
 wombatQueueStatus uQueue_create (uQueue queue, uint32_t maxSize, uint32_t initialSize, uint32_t growBySize);
 wombatQueueStatus uQueue_destroy (uQueue queue);
 wombatQueueStatus uQueue_deallocate(uQueue queue);
 wombatQueueStatus uQueue_getSize (uQueue queue, int* size);
+wombatQueueStatus uQueue_getHighWater (uQueue queue, int* size);
 wombatQueueStatus uQueue_enqueue (uQueue queue, wombatQueueCb cb, void* data, void* closure, uint8_t isMsg);
+wombatQueueStatus uQueue_setMaxAge (uQueue queue, uint64_t maxAge, uQueueAgeCb cb, void* closure);
+wombatQueueStatus uQueue_getOldestAge (uQueue queue, uint64_t* age);
 wombatQueueStatus uQueue_dispatch (uQueue queue);
 wombatQueueStatus uQueue_timedDispatch (uQueue queue, uint64_t timeout);
+/* as above, but waits until deadline (as per getNanos) -- on Linux, w/nanosecond resolution */
+wombatQueueStatus uQueue_timedDispatchUntil (uQueue queue, uint64_t deadline);
+/* wakes up a waiting dispatcher w/o enqueueing anything (the dispatcher returns WOMBAT_QUEUE_OK w/o
+ * dispatching, and until then the wakeup is included in uQueue_getSize) */
+wombatQueueStatus uQueue_wake (uQueue queue);
 
 
 #endif /* MAMA_BRIDGE_ZMQ_UQUEUE_H__ */
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include <string.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <time.h>
 
 #include <wombat/wUuid.h>
 #include <mama/log.h>
@@ -142,7 +143,7 @@ uint64_t get_zmqEventMask(int logLevel)
 
 MamaLogLevel getNamingLogLevel(const char mType)
 {
-   if (mType == 'c')
+   if ((mType == 'c') || (mType == 'h') || (mType == 'R'))
       return log_level_beacon;
    else
       return log_level_naming;
@@ -156,3 +157,10 @@ uint64_t getMillis(void)
     gettimeofday(&tv, NULL);
     return ((tv.tv_sec * (uint64_t) 1000) + (tv.tv_usec / 1000));
 }
+
+uint64_t getNanos(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((ts.tv_sec * (uint64_t) 1000000000) + ts.tv_nsec);
+}
@@ -38,5 +38,7 @@ uint64_t get_zmqEventMask(int logLevel);
 MamaLogLevel getNamingLogLevel(const char mType);
 
 uint64_t getMillis(void);
+// nanoseconds from CLOCK_MONOTONIC (for measuring intervals only)
+uint64_t getNanos(void);
 
 #endif
\ No newline at end of file
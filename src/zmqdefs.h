@@ -32,6 +32,7 @@
 extern int log_level_beacon;
 extern int log_level_naming;
 extern int log_level_inbox;
+extern int log_level_stats;
 
 ///////////////////////////////////////////////////////////////////////
 // the following definitions control how the library is built
@@ -41,6 +42,10 @@ extern int log_level_inbox;
 // So a table of size 1024 will use 8MB (1024*10*sizeof(void*))
 #define     INBOX_TABLE_SIZE                 1024
 #define     PEER_TABLE_SIZE                  1024
+#define     TOPIC_TABLE_SIZE                 1024
+#define     GROUP_TABLE_SIZE                 256
+// max # of peers whose topic ids can be resolved (must be a power of 2)
+#define     TOPIC_PEER_TABLE_SIZE            1024
 
 
 // zmq has two ways to manage subscriptions
@@ -56,10 +61,14 @@ extern int log_level_inbox;
 
 #define     MAX_SUBJECT_LENGTH               256         // topic size
 #define     ZMQ_MAX_NAMING_URIS              8           // proxy processes for naming messages
+#define     ZMQ_NAMING_MIN_BACKOFF           10000       // initial interval between proxy connect attempts (micros)
 // ZMQ_MAX_...URIS are only used for direct (non-naming connections)
 #define     ZMQ_MAX_INCOMING_URIS            512         // incoming connections from other processes
 #define     ZMQ_MAX_OUTGOING_URIS            512         // outgoing connections to other processes
 #define     ZMQ_MAX_ENDPOINT_LENGTH          256
+#define     ZMQ_MAX_SHM_NAME_LENGTH          64
+#define     ZMQ_MAX_PREFIXES_LENGTH          256         // topic prefixes advertised in naming msgs
+#define     ZMQ_MAX_TOPIC_IDS                (1 << 20)   // upper bound on topic ids assigned by a single publisher
 ///////////////////////////////////////////////////////////////////////
 
 /*=========================================================================
@@ -67,7 +76,9 @@ extern int log_level_inbox;
   =========================================================================*/
 
 // system includes
+#include <stddef.h>
 #include <regex.h>
+#include <pthread.h>
 
 // Mama/Wombat includes
 #include <wombat/wSemaphore.h>
@@ -103,6 +114,7 @@ typedef enum zmqMsgType_ {
    ZMQ_MSG_PUB_SUB,
    ZMQ_MSG_INBOX_REQUEST,
    ZMQ_MSG_INBOX_RESPONSE,
+   ZMQ_MSG_PUB_SUB_TOPICID,         // pub/sub msg w/full subject that also announces the subject's topic id
 } zmqMsgType;
 
 typedef enum zmqTransportType_ {
@@ -123,6 +135,11 @@ typedef enum zmqTransportDirection_ {
 #define ZMQ_CONTROL_ENDPOINT  "inproc://control"
 #define ZMQ_MONITOR_ENDPOINT  "inproc://monitor"
 
+// dataPub, dataSub, namingPub, namingSub
+#define ZMQ_MONITORED_SOCKETS    4
+// control, data, naming, reply + monitored sockets + shm ring wakeups
+#define ZMQ_MAX_DISPATCH_ITEMS   (4 + ZMQ_MONITORED_SOCKETS + 1)
+
 typedef struct zmqSocket_ {
    void*       mSocket;        // the zmq socket
    wLock       mLock;          // mutex to control access to socket across threads
@@ -140,11 +157,17 @@ typedef struct zmqTransportBridge_ {
    const char*             mName;               // select from mama.properties: mama.<middleware>.transport.<name>.<property>
    wsem_t                  mIsReady;            // prevents shutdown from proceeding until startup has completed
    uint32_t                mNamingConnected;    // signals that we've received our own discovery msg
+   pthread_mutex_t         mNamingLock;         // protects mNamingStopped, and mNamingConnected transitions
+   pthread_cond_t          mNamingCond;         // signaled when mNamingConnected is set, and on shutdown
+   int                     mNamingStopped;      // wakes (and stops) anyone waiting on mNamingCond
    int                     mIsValid;            // required by Mama API
    mamaTransport           mTransport;          // parent Mama transport
    void*                   mZmqContext;
+   int                     mSharedContext;      // use the process-wide zmq context (see reactor.h)
+   int                     mIoThreads;          // zmq i/o threads for the context
    int                     mIsNaming;           // whether transport is a "naming" transport
    const char*             mPublishAddress;     // publish_address from mama.properties (e.g., "eth0")
+   char                    mHost[MAXHOSTNAMELEN + 1];   // (short) hostname, as sent in naming msgs
    const char*             mUuid;               // unique id of this transport object
    int                     mHeartbeatInterval;
    int                     mReconnectInterval;
@@ -154,17 +177,56 @@ typedef struct zmqTransportBridge_ {
    // inproc socket for inter-thread commands
    zmqSocket               mZmqControlSub;
    zmqSocket               mZmqControlPub;
+   char                    mControlEndpoint[ZMQ_MAX_ENDPOINT_LENGTH +1];   // unique per transport, since the context may be shared
 
    // naming transports only
    zmqSocket               mZmqNamingPub;             // outgoing connections to proxy
    zmqSocket               mZmqNamingSub;             // incoming connections from proxy
    const char*             mPubEndpoint;              // endpoint address for naming
+   int                     mIpcEndpoints;             // also bind dataPub to an ipc endpoint for same-host peers?
+   const char*             mIpcPath;                  // directory in which to create ipc endpoints
+   const char*             mIpcEndpoint;              // ipc endpoint address for naming (or NULL)
+   int                     mShmRingEnabled;           // publish to (and read from) shm rings for same-host peers?
+   size_t                  mShmRingSize;
+   int                     mShmPollInterval;          // how often dispatch thread checks shm rings w/o wakeups (millis, 0 => spin)
+   int                     mShmWakeFd;                // woken by writers of shm rings we read from (or -1)
+   struct zmqShmRing_*     mShmRing;                  // this transport's ring (written under mZmqDataPub.mLock)
+   struct zmqShmRing_**    mShmReaders;               // rings of same-host peers (dispatch thread only)
+   int                     mNumShmReaders;
    const char*             mNamingAddress[ZMQ_MAX_NAMING_URIS];
    int                     mNamingWaitForConnect;     // wait until connected to proxy at startup/abort if failed?
    int                     mNamingConnectRetries;     // max number of proxy connect attempts
-   int                     mNamingConnectInterval;    // interval between proxy connect attempts (in micros, as per usleep)
+   int                     mNamingConnectInterval;    // max interval between proxy connect attempts (in micros, as per usleep)
    uint32_t                mBeaconInterval;           // interval between beacons (in millis, as per zmq_poll), or -1 to disable beaconing
+   int                     mNamingProtocol;           // version of naming msgs to send (1 or 2, see namingmsg.h)
+   uint32_t                mNamingGeneration;         // generation of this transport's naming details
+   uint64_t                mLastFullNamingMsg;        // when full naming details were last sent (in millis, protected by mZmqNamingPub.mLock)
+   int                     mNamingSnapshot;           // get directory of peers from nsd at startup (rather than from peers' replies)?
+   int                     mMissedBeacons;            // evict peers after this many missed beacons (or 0 to never evict)
+   double                  mBeaconJitter;             // beacon interval is randomized by +/- this fraction
+   unsigned int            mBeaconSeed;               // for rand_r (dispatch thread only)
+   int                     mConnectRate;              // max new peers connected per second (or 0 for no limit)
+   char                    (*mPendingConnects)[UUID_STRING_SIZE +1];  // uuids of peers waiting to be connected (dispatch thread only)
+   size_t                  mPendingConnectsHead;
+   size_t                  mNumPendingConnects;
+   size_t                  mPendingConnectsSize;
+   double                  mConnectCredit;            // token bucket for paced connects
+   uint64_t                mLastConnectCredit;        // millis
+   uint32_t                mRebroadcastInterval;      // min interval between discovery msgs sent on finding new peers (millis)
+   int                     mRebroadcastPending;       // found new peer(s) since last discovery msg?
+   uint64_t                mLastRebroadcast;          // millis
+   const char*             mPublishPrefixes;          // topic prefixes advertised in naming msgs (or NULL, see interest.h)
+   int                     mInterestConnect;          // only connect to peers that publish topics we're interested in?
+   wtable_t                mInterests;                // subscribed topic => reference count (dispatch thread only)
+   wtable_t                mUnconnectedPeers;         // uuid => peers in mPeers that we're not connected to (dispatch thread only)
    wthread_t               mPublishThread;
+   int                     mDirectReplies;            // send inbox replies directly to the requesting peer (rather than via dataPub)?
+   zmqSocket               mZmqReplyPub;              // ROUTER, connected to peers' reply endpoints
+   zmqSocket               mZmqReplySub;              // DEALER, bound to mReplyEndpoint (dispatch thread only)
+   const char*             mReplyEndpoint;            // reply endpoint address for naming (or NULL)
+   wtable_t                mDirectPeers;              // uuid => zmqDirectPeer reachable via mZmqReplyPub (protected by its lock)
+   uint32_t                mDirectConnects;           // makes routing ids unique per connection (protected by mZmqReplyPub's lock)
+   int                     mIsDirectMsg;              // is the msg being dispatched from mZmqReplySub? (dispatch thread only)
 
    // "data" sockets for normal messaging
    zmqSocket               mZmqDataPub;
@@ -176,6 +238,12 @@ typedef struct zmqTransportBridge_ {
    wthread_t               mOmzmqDispatchThread;
    uint32_t                mIsDispatching;
    mama_status             mOmzmqDispatchStatus;
+   int                     mNumReactors;        // if non-zero, dispatch on the process-wide reactor pool (see reactor.h)
+   struct zmqReactor*      mReactor;            // reactor that dispatches this transport (NULL if it has its own thread)
+   wsem_t                  mDispatchDone;       // posted by the reactor when it stops dispatching this transport
+   uint64_t                mLastBeacon;         // dispatch timers (dispatch thread only)
+   uint64_t                mNextBeacon;
+   uint64_t                mNextGroupHeartbeat;
 
    // for zmq_socket_monitor
    zmqSocket               mZmqMonitorPub;
@@ -183,9 +251,12 @@ typedef struct zmqTransportBridge_ {
    wthread_t               mOmzmqMonitorThread;
    uint32_t                mIsMonitoring;
    int                     mSocketMonitor;
+   char                    mMonitorEndpoint[ZMQ_MAX_ENDPOINT_LENGTH +1];
+   void*                   mMonitorSockets[ZMQ_MONITORED_SOCKETS];   // monitor event sockets, if polled by a reactor
 
    // peers
    wtable_t                mPeers;
+   uint32_t                mNumPeers;             // count of mPeers (which is dispatch thread only), for other threads
 
    // subscription handling
    endpointPool_t          mSubEndpoints;         // regular subscription endpoints
@@ -195,19 +266,50 @@ typedef struct zmqTransportBridge_ {
    wLock                   mWcsLock;              // NOTE: this lock protects ONLY the collection, NOT the individual objects contained in it....
    unsigned long long      mWcsUid;               // unique ID of wildcard subscription
 
+   // queue groups (see groups.h)
+   int                     mQueueGroups;          // track group members, and send to them?
+   const char*             mQueueGroup;           // group that this transport's subscriptions join (or NULL)
+   const char*             mQueueGroupPrefix;     // ... if their subjects start w/this prefix
+   int                     mQueueGroupPolicy;     // how to choose a member (ZMQ_GROUP_ROUND_ROBIN etc.)
+   uint32_t                mQueueGroupInterval;   // interval between member heartbeats (in millis)
+   wLock                   mGroupsLock;           // protects mGroups & mMembers
+   wtable_t                mGroups;               // subject => list of groups w/members on that subject
+   uint32_t                mNumGroups;            // count of groups in mGroups
+   struct zmqSubscription_* mMembers;             // this transport's subscriptions that are group members
+
    // inbox support
    const char*             mInboxSubject;         // one subject per transport
    wtable_t                mInboxes;              // collection of inboxes
    wLock                   mInboxesLock;          // NOTE: this lock protects ONLY the collection, NOT the individual objects contained in it....
    unsigned long long      mInboxUid;             // unique ID of inbox
 
-   // misc stats
-   long long               mNormalMessages;        // msgs received over dataSubscriber socket
-   long long               mNamingMessages;        // msgs received over namingSubscriber socket
-   long long               mControlMessages;       // msgs received over controlSubscriber socket
-   long long               mSubMessages;           // subscription (as opposed to inbox) messages
-   long long               mInboxMessages;         // inbox (as opposed to subscription) messages
-   long long               mPolls;                 // msgs read after calling zmq_poll
+   // topic id support (see topicids.c)
+   int                     mTopicIds;             // whether to send compact topic-id frames
+   uint32_t                mTopicIdsRefresh;      // send full subject (w/id announcement) every n msgs
+   uint32_t                mTopicTag;             // identifies this transport's topic ids to peers
+   wtable_t                mTopicIdTable;         // subject => zmqTopicId (publish side)
+   wLock                   mTopicIdLock;
+   uint32_t                mNextTopicId;
+   wtable_t                mTopicSubjects;        // interned subjects (receive side, dispatch thread only)
+   wtable_t                mTopicSubs;            // subscribed topic => ref count (receive side, dispatch thread only)
+   struct zmqTopicPeer_*   mTopicPeers;           // tag => id => subject (receive side, dispatch thread only)
+
+   // stats (see stats.c)
+   struct zmqStats_*       mStats;                 // counters, in cache-line-aligned blocks (one per writer)
+   int                     mStatsInterval;         // interval at which stats are published (secs, 0 => disabled)
+   const char*             mStatsPath;             // file to which stats are published (or NULL)
+   wthread_t               mStatsThread;
+   wsem_t                  mStatsStop;
+   int                     mQueueMaxAge;           // default max age for queues used by this transport (millis, 0 => no limit)
+   int                     mQueueDropStale;        // default for dropping stale msgs
+   int                     mStatsShmEnabled;       // export stats to shared memory (for oz-top)?
+   struct zmqStatsShm_*    mStatsShm;
+
+   // latency stats (see latency.c)
+   int                     mLatencyStats;          // whether to keep latency stats
+   struct zmqLatencyStats_* mLatency;              // per-stage latency of msgs received (or NULL if latency_stats disabled)
+   uint64_t                mRecvTime;              // when current msg was received (dispatch thread only)
+   uint32_t                mEnqueueCount;          // for sampling queue depth (dispatch thread only)
 
 } zmqTransportBridge;
 
@@ -216,7 +318,12 @@ typedef struct zmqBridgeClosure_
 {
     // Note that mClosure is first - contains implementation bridge's own closure
     void*                 mImplClosure;
-    timerHeap             mTimerHeap;
+    timerHeap             mTimerHeap;            // timers are serviced by either the heap or the wheel
+    int                   mUseTimerWheel;        // use timing wheel instead of heap?
+    int                   mTimerWheelTick;       // resolution of timing wheel (micros)
+    struct zmqTimerWheel_* mWheel;
+    int                   mUseQueueTimers;       // host timers on their queues (fired by the queue's dispatcher)?
+    int                   mQueueTimerTick;       // resolution of queue timers (micros)
 } zmqBridgeClosure;
 
 
@@ -236,6 +343,8 @@ typedef struct zmqSubscription_ {
    int                     mIsWildcard;            // is this a wildcard subscription?
    const char*             mOrigRegex;             // for wildcards, original regex
    regex_t*                mCompRegex;             // for wildcards, compiled regex
+   int                     mIsGroupMember;         // is this a queue group member? (see groups.h)
+   struct zmqSubscription_* mNextMember;           // next member in transport's list
 } zmqSubscription;
 
 
@@ -250,14 +359,38 @@ typedef struct zmqQueueBridge {
    uint32_t                mIsActive;
    mamaQueueEnqueueCB      mEnqueueCallback;
    wthread_mutex_t         mDispatchLock;
+   struct zmqLatencyStats_* mLatency;              // per-stage latency of msgs dispatched from this queue (or NULL)
+   struct zmqQueueBridge*  mNextQueue;             // list of all queues (for stats)
+   struct zmqQueueBridge*  mPrevQueue;
+   int                     mIsRegistered;
+   uint64_t                mMaxAge;                // max time items may wait to be dispatched (nanos, 0 => no limit)
+   int                     mDropStale;             // drop msgs that waited longer than mMaxAge?
+   zmqQueueAgeCB           mAgeCallback;
+   void*                   mAgeClosure;
+   uint8_t                 mAgeFired;
+   uint64_t                mStaleCount;            // items that waited longer than mMaxAge
+   uint64_t                mStaleDrops;            // ... and were dropped
+   struct zmqTimerWheel_*  mTimers;                // timers hosted on this queue (or NULL if timer.queue disabled)
+   uint64_t                mTimerDeadline;         // when dispatcher must next process timers (0 => processing now)
+   int                     mTimerFd;               // timerfd armed at mTimerDeadline (-1 unless requested)
+   struct zmqQueueGroup_*  mGroup;                 // group whose workers dispatch this queue (or NULL) -- see queuegroup.h
+   int                     mGroupState;            // atomic -- only leaves IDLE under the group's lock
+   int                     mGroupWorker;           // worker that last dispatched the queue (this and the following are protected by the group's lock)
+   struct zmqQueueBridge*  mGroupNext;             // worker's run-queue
+   struct zmqQueueBridge*  mGroupPrev;
 } zmqQueueBridge;
 
 #define ZMQ_NAMING_PREFIX            "_NAMING"
+// nsd sends its directory of peers to each transport on "_SNAPSHOT.<uuid>" (see nsd.c)
+#define ZMQ_SNAPSHOT_PREFIX          "_SNAPSHOT."
 // Note: 0mq doesn't guarantee that messages will be aligned on any particular boundary, so use
 // pragma to ensure compiler knows that struct is unaligned
 #pragma pack(push, 1)
 // defines discovery (naming) msgs sent by transport on startup and received by other transports
 // naming msgs use namingSubscriber/namingPublisher, which is connected to one or more zmq_proxy processes
+// v1 msgs on the wire consist of only the fields up to and including mEndPointAddr (ZMQ_NAMING_V1_SIZE bytes),
+// so that they remain compatible w/older peers and nsd -- the remaining fields are only carried in v2 msgs
+// (see namingmsg.h)
 typedef struct zmqNamingMsg {
    char                    mTopic[MAX_SUBJECT_LENGTH +1];               // w/zmq, topic string must be first part of msg
    unsigned char           mType;                                       // "C"=connect, "D"=disconnect, "W"=welcome
@@ -266,15 +399,66 @@ typedef struct zmqNamingMsg {
    long                    mPid;                                        // process ID
    char                    mUuid[UUID_STRING_SIZE +1];                  // uuid of transport
    char                    mEndPointAddr[ZMQ_MAX_ENDPOINT_LENGTH +1];   // dataSub socket connects to this endpoint
+   char                    mIpcEndPointAddr[ZMQ_MAX_ENDPOINT_LENGTH +1];// same-host peers connect to this endpoint (if not empty)
+   char                    mShmRingName[ZMQ_MAX_SHM_NAME_LENGTH +1];    // same-host peers read from this shm ring (if not empty)
+   char                    mReplyEndPointAddr[ZMQ_MAX_ENDPOINT_LENGTH +1];// peers send inbox replies directly to this endpoint (if not empty)
+   uint32_t                mGeneration;                                 // changes whenever any of the above change (see namingmsg.h)
+   char                    mPrefixes[ZMQ_MAX_PREFIXES_LENGTH +1];       // comma-separated topic prefixes published by transport (empty => any)
 }  zmqNamingMsg;
+#define ZMQ_NAMING_V1_SIZE           offsetof(zmqNamingMsg, mIpcEndPointAddr)
+
+// entries in mPeers are the peer's naming msg, plus liveness info that is not sent on the wire
+// (the msg must be first, since peers are also passed around as zmqNamingMsg*)
+typedef struct zmqPeer {
+   zmqNamingMsg            mMsg;
+   uint64_t                mLastSeen;           // millis -- when we last received a naming msg (or beacon) from peer
+   int                     mDisconnected;       // data socket reported a disconnect since then?
+   int                     mPending;            // queued for connect (see naming.connect_rate)?
+} zmqPeer;
 #pragma pack(pop)
 
+// entries in mDirectPeers -- each connection gets its own routing id, since zmq does not reap the pipe of a
+// disconnected peer right away, and a ROUTER socket must never have two pipes w/the same routing id
+// (the connection is made lazily, on the first direct send to the peer)
+typedef struct zmqDirectPeer {
+   char                    mUuid[UUID_STRING_SIZE +1];
+   char                    mEndpoint[ZMQ_MAX_ENDPOINT_LENGTH +1];
+   char                    mRoutingId[UUID_STRING_SIZE +1 +8 +1];     // <uuid>.<connection#> (empty until connected)
+} zmqDirectPeer;
+
+
+// topic ids -- publishers assign a compact integer id to each subject they send, and
+// announce it by periodically sending the full subject along with the id.  All other
+// msgs are sent with a short binary prefix in place of the subject.
+#define ZMQ_TOPICID_MARKER             '\x01'                          // first byte of a compact msg
+#define ZMQ_TOPICID_PREFIX_SIZE        (1 + sizeof(uint32_t) * 2)       // marker + tag + id
+
+// publish side -- one per subject
+typedef struct zmqTopicId_ {
+   const char*             mSubject;
+   uint32_t                mId;
+   uint32_t                mCount;           // msgs sent since last announcement
+} zmqTopicId;
+
+// receive side -- one per publishing peer, indexed by id
+typedef struct zmqTopicSlot_ {
+   const char*             mSubject;         // interned, lives until transport is destroyed
+   const char*             mCover;           // (interned) subscribed topic that matches mSubject, if binary prefix
+                                             // is subscribed on dataSub (else NULL)
+} zmqTopicSlot;
+
+typedef struct zmqTopicPeer_ {
+   uint32_t                mTag;             // 0 => empty
+   uint32_t                mSize;
+   zmqTopicSlot*           mSlots;
+} zmqTopicPeer;
+
 
 #pragma pack(push, 1)
 // defines control msg sent to main dispatch thread via inproc transport
 typedef struct zmqControlMsg {
-   char     command;                         // "S"=subscribe, "U"=unsubscribe, "X"=exit
-   char     arg1[MAX_SUBJECT_LENGTH +1];     // for subscribe & unsubscribe this is the topic
+   char     command;                         // "S"=subscribe, "U"=unsubscribe, "X"=exit, "d"=data socket disconnected
+   char     arg1[MAX_SUBJECT_LENGTH +1];     // for subscribe & unsubscribe this is the topic (for "d", the endpoint)
 } zmqControlMsg;
 #pragma pack(pop)
 
@@ -290,6 +474,11 @@ typedef struct zmqControlMsg {
 #define ZMQ_REPLYHANDLE_INBOXNAME_SIZE    16                                  // long long in hex format
 #define ZMQ_REPLYHANDLE_SIZE              ZMQ_INBOX_SUBJECT_SIZE+1+ZMQ_REPLYHANDLE_INBOXNAME_SIZE
 
+// inbox pools (see inboxpool.h) use the same format, but the inboxID is "P<poolID><requestID>", where
+// poolID is 7 hex digits and requestID is 8 -- the pool is registered w/the transport under "P<poolID>"
+#define ZMQ_INBOXPOOL_MARKER              'P'
+#define ZMQ_INBOXPOOL_NAME_SIZE           8                                   // "P" + poolID
+
 // defines internal structure of an "inbox" for request/reply messaging
 typedef struct zmqInboxImpl {
    void*                           mClosure;
@@ -301,6 +490,7 @@ typedef struct zmqInboxImpl {
    mamaInboxDestroyCallback        mOnInboxDestroyed;
    mamaInbox                       mParent;
    const char*                     mReplyHandle;               // unique reply address for this inbox
+   struct zmqInboxPool_*           mPool;                      // non-NULL for inbox pools
 } zmqInboxImpl;
 
 
@@ -309,6 +499,9 @@ typedef struct zmqInboxImpl {
 typedef struct zmqTransportMsg_ {
     zmqTransportBridge*     mTransport;
     char                    mEndpointIdentifier[ZMQ_REPLYHANDLE_INBOXNAME_SIZE+1];    // UUID that uniquely identifies a specific subscriber
+    const char*             mSubject;               // resolved subject for topic-id msgs, else NULL (subject is in mZmsg)
+    uint64_t                mRecvTime;              // when msg was received (w/latency_stats, else 0)
+    uint64_t                mEnqueueTime;           // when msg was enqueued (w/latency_stats, else 0)
     zmq_msg_t               mZmsg;
 } zmqTransportMsg;
 
@@ -319,6 +512,9 @@ typedef struct zmqBridgeMsgImpl {
    uint8_t             mMsgType;                               // pub/sub, request or reply
    char                mReplyHandle[ZMQ_REPLYHANDLE_SIZE +1];  // for a request msg, unique identifier of the sending inbox
    char                mSendSubject[MAX_SUBJECT_LENGTH +1];    // topic on which the msg is sent
+   uint32_t            mTopicTag;                              // for topic-id msgs, tag of sending transport
+   uint32_t            mTopicId;                               // for topic-id msgs, id of mSendSubject
+   uint8_t             mIsCompact;                             // send id in place of subject
 } zmqBridgeMsgImpl;
 
 